@@ -0,0 +1,134 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Asset archive benchmarks over a PackAssets archive of the assets, built before the first
+// one runs. For timing only; tests/archiveTest.cpp checks what they read:
+//   Archive/ReadAssets/loose  -- MyJNIHelper::ReadAsset of every asset from the directory
+//   Archive/ReadAssets/packed -- the same through an archive, with no loose assets behind it
+//   Archive/Open              -- MyAssetArchive::OpenFile, mapping and validating the index
+//   LZ4/Decompress            -- reading every LZ4 entry of the archive
+// every benchmark reports bytes/s
+
+#include "myAssetArchive.h"
+#include "myJNIHelper.h"
+#include "myLogger.h"
+#include <benchmark/benchmark.h>
+
+#define ARCHIVE_BENCHMARK_PATH  "/tmp/ModelAssimpBenchmark/" MY_ASSET_ARCHIVE
+
+/**
+ * A helper that reads only from the archive: its asset directory does not exist, so an asset
+ * missing from the archive fails instead of being read loose
+ */
+static MyJNIHelper * GetPackedHelper() {
+
+    static MyJNIHelper *packedHelper = NULL;
+    if (packedHelper) {
+        return packedHelper;
+    }
+    MyAssetArchiveWriter writer;
+    if (!writer.AddDirectory(MY_HOST_ASSET_DIR, MY_ASSET_ARCHIVE) ||
+        !writer.Write(ARCHIVE_BENCHMARK_PATH)) {
+        MyLOGE("Cannot pack %s into %s", MY_HOST_ASSET_DIR, ARCHIVE_BENCHMARK_PATH);
+        return NULL;
+    }
+    packedHelper = new MyJNIHelper("/nonexistent", "/tmp/ModelAssimpBenchmark");
+    if (!packedHelper->OpenArchive(ARCHIVE_BENCHMARK_PATH)) {
+        delete packedHelper;
+        packedHelper = NULL;
+    }
+    return packedHelper;
+}
+
+static void BM_ReadAssets(benchmark::State &state, bool isPacked) {
+
+    MyJNIHelper *packedHelper = GetPackedHelper();
+    if (!packedHelper) {
+        state.SkipWithError("cannot build the archive");
+        return;
+    }
+    const MyAssetArchive &archive = packedHelper->GetArchive();
+    MyJNIHelper *helper = isPacked ? packedHelper : gHelperObject;
+    MyAssetBuffer buffer;
+    size_t assetBytes = 0;
+    for (auto _ : state) {
+        for (unsigned int e = 0; e < archive.GetEntryCount(); ++e) {
+            helper->ReadAsset(archive.GetEntryName(archive.GetEntry(e)), buffer);
+            benchmark::DoNotOptimize(buffer.GetData());
+            assetBytes += buffer.GetSize();
+        }
+    }
+    state.SetBytesProcessed(assetBytes);
+}
+BENCHMARK_CAPTURE(BM_ReadAssets, loose, false)->Name("Archive/ReadAssets/loose");
+BENCHMARK_CAPTURE(BM_ReadAssets, packed, true)->Name("Archive/ReadAssets/packed");
+
+static void BM_ArchiveOpen(benchmark::State &state) {
+
+    MyJNIHelper *packedHelper = GetPackedHelper();
+    if (!packedHelper) {
+        state.SkipWithError("cannot build the archive");
+        return;
+    }
+    unsigned int entryCount = packedHelper->GetArchive().GetEntryCount();
+    MyAssetArchive archive;
+    size_t indexBytes = 0;
+    for (auto _ : state) {
+        if (!archive.OpenFile(ARCHIVE_BENCHMARK_PATH)) {
+            state.SkipWithError("the archive does not open");
+            return;
+        }
+        indexBytes += entryCount * sizeof(ArchiveEntry);
+        archive.Close();
+    }
+    state.SetBytesProcessed(indexBytes);
+}
+BENCHMARK(BM_ArchiveOpen)->Name("Archive/Open");
+
+static void BM_LZ4Decompress(benchmark::State &state) {
+
+    MyJNIHelper *packedHelper = GetPackedHelper();
+    if (!packedHelper) {
+        state.SkipWithError("cannot build the archive");
+        return;
+    }
+    const MyAssetArchive &archive = packedHelper->GetArchive();
+    std::vector<const ArchiveEntry *> lz4Entries;
+    size_t storedBytes = 0, entryBytes = 0;
+    for (unsigned int e = 0; e < archive.GetEntryCount(); ++e) {
+        if (archive.GetEntry(e)->compression == ARCHIVE_LZ4) {
+            lz4Entries.push_back(archive.GetEntry(e));
+            storedBytes += archive.GetEntry(e)->storedSize;
+            entryBytes += archive.GetEntry(e)->size;
+        }
+    }
+    if (lz4Entries.empty()) {
+        state.SkipWithError("the archive has no LZ4 entries");
+        return;
+    }
+
+    std::vector<uint8_t> data;
+    for (auto _ : state) {
+        for (unsigned int e = 0; e < lz4Entries.size(); ++e) {
+            archive.ReadEntry(lz4Entries[e], data);
+            benchmark::DoNotOptimize(data.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * entryBytes);
+    state.counters["ratio"] = (double) entryBytes / storedBytes;
+}
+BENCHMARK(BM_LZ4Decompress)->Name("LZ4/Decompress");
@@ -0,0 +1,115 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// MyGLCamera benchmarks, for timing only; tests/cameraTest.cpp checks the results:
+//   Camera/EventBurst/lazy/<n>  -- n gestures and then one UpdateSnapshot, as Render does
+//   Camera/EventBurst/eager/<n> -- UpdateSnapshot after every gesture, the cost of the old
+//                                  camera that rebuilt the MVP in every gesture handler
+//   Camera/RotationDrift        -- 100k small rotations; reports how far the rotation is from
+//                                  orthonormal for the quaternion and for the old matrix product
+//   Camera/GetSnapshot          -- what a reader pays for the published matrices
+
+#include "myGLCamera.h"
+#include <benchmark/benchmark.h>
+
+/**
+ * A fling: rotations with some pinch and two-finger drag mixed in
+ */
+static void ApplyGesture(MyGLCamera &camera, int i) {
+    switch (i % 4) {
+        case 0:
+        case 1:
+            camera.RotateModel(0.01f, 0.002f, 0.2f, -0.1f);
+            break;
+        case 2:
+            camera.ScaleModel(1.001f);
+            break;
+        default:
+            camera.TranslateModel(0.001f, -0.001f);
+            break;
+    }
+}
+
+static void BM_EventBurst(benchmark::State &state, bool isEager) {
+
+    MyGLCamera camera;
+    camera.SetAspectRatio(16.f / 9.f);
+    int numberOfEvents = state.range(0);
+    for (auto _ : state) {
+        for (int i = 0; i < numberOfEvents; ++i) {
+            ApplyGesture(camera, i);
+            if (isEager) {
+                camera.UpdateSnapshot();
+            }
+        }
+        camera.UpdateSnapshot();
+        benchmark::DoNotOptimize(camera.GetSnapshot().mvpMat[0][0]);
+    }
+    state.SetItemsProcessed(state.iterations() * numberOfEvents);
+}
+BENCHMARK_CAPTURE(BM_EventBurst, lazy, false)->Name("Camera/EventBurst/lazy")
+        ->RangeMultiplier(4)->Range(1, 64);
+BENCHMARK_CAPTURE(BM_EventBurst, eager, true)->Name("Camera/EventBurst/eager")
+        ->RangeMultiplier(4)->Range(1, 64);
+
+/**
+ * Largest entry of |R^T R - I| for the upper 3x3 of a model matrix
+ */
+static float GetOrthonormalityError(const glm::mat4 &matrix) {
+    glm::mat3 rotation(matrix);
+    glm::mat3 product = glm::transpose(rotation) * rotation;
+    float error = 0;
+    for (int c = 0; c < 3; ++c) {
+        for (int r = 0; r < 3; ++r) {
+            error = std::max(error, fabsf(product[c][r] - (c == r ? 1.f : 0.f)));
+        }
+    }
+    return error;
+}
+
+static void BM_RotationDrift(benchmark::State &state) {
+
+    const int numberOfRotations = 100000;
+    float quaternionError = 0, matrixError = 0;
+    for (auto _ : state) {
+        MyGLCamera camera;
+        camera.SetAspectRatio(1.f);
+        glm::mat4 rotateMat(1.0f);
+        glm::quat stepQuaternion = glm::angleAxis(0.0137f, glm::normalize(glm::vec3(1, 2, 3)));
+        for (int i = 0; i < numberOfRotations; ++i) {
+            camera.RotateModel(0.01f, 0.002f, 0.2f, -0.1f);
+            rotateMat = glm::toMat4(stepQuaternion) * rotateMat;  // what the camera used to do
+        }
+        camera.UpdateSnapshot();
+        quaternionError = GetOrthonormalityError(camera.GetSnapshot().modelMat);
+        matrixError = GetOrthonormalityError(rotateMat);
+    }
+    state.counters["quaternionError"] = quaternionError;
+    state.counters["matrixProductError"] = matrixError;
+}
+BENCHMARK(BM_RotationDrift)->Name("Camera/RotationDrift")->Unit(benchmark::kMillisecond);
+
+static void BM_GetSnapshot(benchmark::State &state) {
+
+    MyGLCamera camera;
+    camera.SetAspectRatio(16.f / 9.f);
+    camera.UpdateSnapshot();
+    for (auto _ : state) {
+        const CameraSnapshot &snapshot = camera.GetSnapshot();
+        benchmark::DoNotOptimize(snapshot.mvpMat[3][3]);
+    }
+}
+BENCHMARK(BM_GetSnapshot)->Name("Camera/GetSnapshot");
@@ -0,0 +1,177 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// GLB loader benchmarks over every bundled OBJ, each converted to a GLB with WriteGLB the first
+// time one of its benchmarks runs, outside the timing, with the default import profile:
+//   GLB/Prepare/obj/<obj>, GLB/Prepare/glb/<obj> -- AssimpLoader::PrepareModel of the OBJ as the
+//                  app loads it, import and texture decode, against mapping and validating the
+//                  GLB and decoding its embedded images on the workers
+//   GLB/Load/obj/<obj>, GLB/Load/glb/<obj> -- PrepareModel and UploadModel on a GLES 2 context,
+//                  reporting the bytes uploaded straight from the mapping
+// both report the bytes of the files read; the OBJ's extraction from the assets is not timed.
+// tests/glbTest.cpp checks that a GLB has the meshes of its OBJ and draws the same frame
+
+#include "assimpLoader.h"
+#include "glbWriter.h"
+#include "hostGLContext.h"
+#include "misc.h"
+#include "myModelPreloader.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <sys/stat.h>
+
+#define GLB_BENCHMARK_DIR       "/tmp/ModelAssimpBenchmark/glb"
+#define GLB_FRAME_WIDTH         512
+#define GLB_FRAME_HEIGHT        512
+
+struct GLBModel {
+    std::string assetDir;
+    std::string objAsset;           // e.g. "andy/andy.obj"
+    std::string glbPath;            // empty until converted
+};
+
+static std::vector<GLBModel> gGLBModels;
+
+/**
+ * Convert the model's OBJ once; false if that fails, the next call tries again
+ */
+static bool ConvertModel(GLBModel &model) {
+
+    if (!model.glbPath.empty()) {
+        return true;
+    }
+    std::string objPath = model.assetDir + "/" + model.objAsset;
+    std::string glbName = model.objAsset;
+    std::replace(glbName.begin(), glbName.end(), '/', '_');
+    std::string glbPath = std::string(GLB_BENCHMARK_DIR) + "/" + glbName + ".glb";
+    mkdir(GLB_BENCHMARK_DIR, 0755);
+
+    Assimp::Importer importer;
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    const aiScene *scene = importer.ReadFile(objPath,
+                                             GetImportProfileFlags(DEFAULT_IMPORT_PROFILE));
+    if (!scene || !WriteGLB(scene, GetDirectoryName(objPath), glbPath)) {
+        MyLOGE("Cannot convert %s into %s", objPath.c_str(), glbPath.c_str());
+        return false;
+    }
+    model.glbPath = glbPath;
+    return true;
+}
+
+/**
+ * Prepare the OBJ as the app does, with the MTL and textures found from it and no mesh cache,
+ * or the GLB. Extraction of the OBJ is left out of the timing
+ */
+static bool PrepareModel(benchmark::State &state, const GLBModel &model, bool isGLB,
+                         AssimpLoader &loader) {
+
+    if (isGLB) {
+        return loader.PrepareModel(model.glbPath);
+    }
+    ModelRequest modelRequest = {model.objAsset, model.objAsset, {}, DEFAULT_IMPORT_PROFILE, 0};
+    std::string objPath;
+    state.PauseTiming();
+    bool isExtracted = ExtractModelAssets(modelRequest, &loader, objPath);
+    state.ResumeTiming();
+    return isExtracted && loader.PrepareModel(objPath, modelRequest.importProfile);
+}
+
+/**
+ * Bytes of the model files a prepare reads
+ */
+static size_t GetReadBytes(const AssimpLoader &loader) {
+    ModelReadStats readStats = loader.GetReadStats();
+    return readStats.modelBytes + readStats.meshCacheBytes + readStats.textureBytes;
+}
+
+static void BM_GLBPrepare(benchmark::State &state, GLBModel *model, bool isGLB) {
+
+    if (!ConvertModel(*model)) {
+        state.SkipWithError("Cannot convert the OBJ into a GLB");
+        return;
+    }
+    size_t readBytes = 0;
+    for (auto _ : state) {
+        AssimpLoader loader;
+        if (!PrepareModel(state, *model, isGLB, loader)) {
+            state.SkipWithError("PrepareModel failed");
+            return;
+        }
+        readBytes = GetReadBytes(loader);
+    }
+    state.SetBytesProcessed(state.iterations() * readBytes);
+    state.counters["readMB"] = readBytes / 1048576.;
+}
+
+static void BM_GLBLoad(benchmark::State &state, GLBModel *model, bool isGLB) {
+
+    if (!InitBenchmarkGLContext(GLB_FRAME_WIDTH, GLB_FRAME_HEIGHT)) {
+        state.SkipWithError("No GLES 2 context, see HostGLContext");
+        return;
+    }
+    if (!ConvertModel(*model)) {
+        state.SkipWithError("Cannot convert the OBJ into a GLB");
+        return;
+    }
+    size_t readBytes = 0, uploadBytes = 0, mappedUploadBytes = 0;
+    for (auto _ : state) {
+        AssimpLoader *loader = new AssimpLoader;
+        bool isLoaded = PrepareModel(state, *model, isGLB, *loader);
+        readBytes = GetReadBytes(*loader);
+        uploadBytes = loader->GetPreparedBytes();
+        isLoaded = isLoaded && loader->UploadModel();
+        glFinish();
+        mappedUploadBytes = loader->GetMappedUploadBytes();
+        // the loader deletes its GL objects, which is not part of a load
+        state.PauseTiming();
+        delete loader;
+        state.ResumeTiming();
+        if (!isLoaded) {
+            state.SkipWithError("Cannot load the model");
+            return;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * readBytes);
+    state.counters["readMB"] = readBytes / 1048576.;
+    state.counters["uploadMB"] = uploadBytes / 1048576.;
+    state.counters["mappedUploadMB"] = mappedUploadBytes / 1048576.;
+}
+
+/**
+ * Register the benchmarks for the OBJs found by loadBenchmark.cpp, the GLBs are converted
+ * lazily so that filtered runs do not convert every model
+ */
+void RegisterGLBBenchmarks(const std::string &assetDir,
+                           const std::vector<std::string> &objAssets) {
+
+    gGLBModels.resize(objAssets.size());
+    for (unsigned int i = 0; i < objAssets.size(); ++i) {
+        GLBModel *model = &gGLBModels[i];
+        model->assetDir = assetDir;
+        model->objAsset = objAssets[i];
+        for (int isGLB = 0; isGLB < 2; ++isGLB) {
+            std::string format = isGLB ? "glb/" : "obj/";
+            benchmark::RegisterBenchmark(("GLB/Prepare/" + format + objAssets[i]).c_str(),
+                                         BM_GLBPrepare, model, isGLB != 0)
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+            benchmark::RegisterBenchmark(("GLB/Load/" + format + objAssets[i]).c_str(),
+                                         BM_GLBLoad, model, isGLB != 0)
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+        }
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// MyJobSystem benchmarks, for timing only; tests/jobSystemTest.cpp checks the results:
+//   JobSystem/Submit          -- cost of submitting and waiting for empty jobs
+//   JobSystem/ParallelFor/<n> -- sum over 4M elements with at most n threads
+//   JobSystem/NestedParallelFor -- ParallelFor inside the chunks of another one
+//   JobSystem/Dependencies    -- layers of jobs, each depending on every job of the layer above
+//   JobSystem/GLThread        -- worker job followed by a job for the GL thread
+// every benchmark reports the mean utilization and the steals of the pool's workers
+
+#include "myJobSystem.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+
+static void ReportWorkerCounters(benchmark::State &state) {
+
+    std::vector<MyJobWorkerStats> workerStats = GetJobSystem().GetWorkerStats();
+    double utilization = 0;
+    unsigned long jobsStolen = 0;
+    for (unsigned int i = 0; i < workerStats.size(); ++i) {
+        utilization += workerStats[i].utilization;
+        jobsStolen += workerStats[i].jobsStolen;
+    }
+    state.counters["workers"] = workerStats.size();
+    state.counters["utilization"] = workerStats.empty() ? 0 : utilization / workerStats.size();
+    state.counters["steals"] = benchmark::Counter(jobsStolen, benchmark::Counter::kAvgIterations);
+}
+
+static void BM_JobSubmit(benchmark::State &state) {
+
+    MyJobSystem &jobSystem = GetJobSystem();
+    std::atomic<int> jobsRun(0);
+    std::vector<MyJobHandle> jobs(256);
+    jobSystem.ResetStats();
+    for (auto _ : state) {
+        for (unsigned int i = 0; i < jobs.size(); ++i) {
+            jobs[i] = jobSystem.Submit([&jobsRun]() { jobsRun++; });
+        }
+        for (unsigned int i = 0; i < jobs.size(); ++i) {
+            jobSystem.Wait(jobs[i]);
+        }
+    }
+    benchmark::DoNotOptimize(jobsRun.load());
+    state.SetItemsProcessed(state.iterations() * jobs.size());
+    ReportWorkerCounters(state);
+}
+BENCHMARK(BM_JobSubmit)->Name("JobSystem/Submit")->UseRealTime();
+
+static void BM_ParallelFor(benchmark::State &state) {
+
+    MyJobSystem &jobSystem = GetJobSystem();
+    std::vector<unsigned int> values(4 << 20);
+    for (unsigned int i = 0; i < values.size(); ++i) {
+        values[i] = i * 2654435761u;
+    }
+    std::atomic<unsigned long long> sum(0);
+    jobSystem.ResetStats();
+    for (auto _ : state) {
+        sum = 0;
+        jobSystem.ParallelFor(values.size(), 16384, [&](unsigned int begin, unsigned int end) {
+            unsigned long long partialSum = 0;
+            for (unsigned int i = begin; i < end; ++i) {
+                partialSum += values[i] >> 8;
+            }
+            sum += partialSum;
+        }, state.range(0));
+        benchmark::DoNotOptimize(sum.load());
+    }
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(unsigned int));
+    ReportWorkerCounters(state);
+}
+BENCHMARK(BM_ParallelFor)->Name("JobSystem/ParallelFor")->RangeMultiplier(2)->Range(1, 8)
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_NestedParallelFor(benchmark::State &state) {
+
+    MyJobSystem &jobSystem = GetJobSystem();
+    const unsigned int outerCount = 64, innerCount = 4096;
+    std::atomic<unsigned int> visited(0);
+    jobSystem.ResetStats();
+    for (auto _ : state) {
+        visited = 0;
+        jobSystem.ParallelFor(outerCount, 1, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; ++i) {
+                jobSystem.ParallelFor(innerCount, 256, [&](unsigned int innerBegin,
+                                                           unsigned int innerEnd) {
+                    visited += innerEnd - innerBegin;
+                });
+            }
+        });
+        benchmark::DoNotOptimize(visited.load());
+    }
+    ReportWorkerCounters(state);
+}
+BENCHMARK(BM_NestedParallelFor)->Name("JobSystem/NestedParallelFor")->UseRealTime();
+
+static void BM_Dependencies(benchmark::State &state) {
+
+    MyJobSystem &jobSystem = GetJobSystem();
+    const unsigned int numberOfLayers = 16, layerWidth = 8;
+    std::atomic<unsigned int> jobsRun(0);
+    jobSystem.ResetStats();
+    for (auto _ : state) {
+        std::vector<MyJobHandle> previousLayer, currentLayer;
+        for (unsigned int l = 0; l < numberOfLayers; ++l) {
+            currentLayer.clear();
+            for (unsigned int j = 0; j < layerWidth; ++j) {
+                currentLayer.push_back(jobSystem.Submit([&jobsRun]() { jobsRun++; },
+                                                        previousLayer));
+            }
+            previousLayer.swap(currentLayer);
+        }
+        for (unsigned int j = 0; j < previousLayer.size(); ++j) {
+            jobSystem.Wait(previousLayer[j]);
+        }
+    }
+    benchmark::DoNotOptimize(jobsRun.load());
+    state.SetItemsProcessed(state.iterations() * numberOfLayers * layerWidth);
+    ReportWorkerCounters(state);
+}
+BENCHMARK(BM_Dependencies)->Name("JobSystem/Dependencies")->UseRealTime();
+
+/**
+ * The benchmark thread plays the GL thread and pumps RunGLThreadJobs like Render does
+ */
+static void BM_GLThread(benchmark::State &state) {
+
+    MyJobSystem &jobSystem = GetJobSystem();
+    jobSystem.ResetStats();
+    for (auto _ : state) {
+        std::atomic<bool> isPrepared(false), isUploaded(false);
+        MyJobHandle prepare = jobSystem.Submit([&isPrepared]() { isPrepared = true; });
+        MyJobHandle upload = jobSystem.SubmitToGLThread([&]() {
+            isUploaded = (bool) isPrepared;
+        }, std::vector<MyJobHandle>(1, prepare));
+        while (!jobSystem.IsDone(upload)) {
+            jobSystem.RunGLThreadJobs();
+        }
+        benchmark::DoNotOptimize(isUploaded.load());
+    }
+    ReportWorkerCounters(state);
+}
+BENCHMARK(BM_GLThread)->Name("JobSystem/GLThread")->UseRealTime();
@@ -0,0 +1,132 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Lighting tier benchmarks:
+//   Lighting/<tier>/<obj> -- one frame of the model drawn at the tier, unlit, vertex or pixel,
+//                            on a real GLES 2 context (Mesa llvmpipe on a Linux host) and
+//                            finished with glFinish; reports the pixels covered
+//   LightingScaler/SlowThenFast -- frame times well over the target and then under it, until
+//                            MyLightingScaler is back at pixel
+// the models are imported with the full profile, the only one that computes tangents. For
+// timing only; tests/lightingTest.cpp checks the frames and the scaler
+
+#include "assimpLoader.h"
+#include "hostGLContext.h"
+#include "myLightingScaler.h"
+#include "myModelPreloader.h"
+#include "myShaderVariants.h"
+#include <benchmark/benchmark.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <math.h>
+#include <vector>
+
+#define LIGHTING_FRAME_WIDTH    512
+#define LIGHTING_FRAME_HEIGHT   512
+
+static const ModelRequest gAndy = {"andy", "andy/andy.obj", {"andy/materials.mtl", "andy/andy.png"},
+                                   IMPORT_PROFILE_FULL, 0};
+// the MTL and textures are found from the OBJ
+static const ModelRequest gWonder = {"wonder", "wonder/wonderwoman.obj", {}, IMPORT_PROFILE_FULL,
+                                     0};
+
+/**
+ * Pixels that are not the white background
+ */
+static unsigned int CountCoveredPixels() {
+
+    std::vector<unsigned char> pixels(4 * LIGHTING_FRAME_WIDTH * LIGHTING_FRAME_HEIGHT);
+    glReadPixels(0, 0, LIGHTING_FRAME_WIDTH, LIGHTING_FRAME_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    unsigned int coveredPixels = 0;
+    for (size_t p = 0; p < pixels.size(); p += 4) {
+        if (pixels[p] != 255 || pixels[p + 1] != 255 || pixels[p + 2] != 255) {
+            coveredPixels++;
+        }
+    }
+    return coveredPixels;
+}
+
+static void BM_Lighting(benchmark::State &state, const ModelRequest *model,
+                        LightingTier lightingTier) {
+
+    if (!InitBenchmarkGLContext(LIGHTING_FRAME_WIDTH, LIGHTING_FRAME_HEIGHT)) {
+        state.SkipWithError("No GLES 2 context, see HostGLContext");
+        return;
+    }
+    AssimpLoader loader;
+    std::string objPath;
+    if (!ExtractModelAssets(*model, &loader, objPath) ||
+        !loader.Load3DModel(objPath, model->importProfile)) {
+        state.SkipWithError("Cannot load the model");
+        return;
+    }
+
+    // the model fills most of the frame, seen from the front
+    glm::vec3 boundsMin = loader.GetBoundsMin(), boundsMax = loader.GetBoundsMax();
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+    float radius = 0.5f * glm::length(boundsMax - boundsMin);
+    glm::mat4 mvpMat = glm::perspective(45.f * float(M_PI / 180), 1.f, 0.1f * radius,
+                                        10.f * radius) *
+                       glm::lookAt(center + glm::vec3(0, 0, 2.5f * radius), center,
+                                   glm::vec3(0, 1, 0));
+
+    // first frame outside the loop, the driver may still set up state for the tier's programs
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    loader.Render3DModel(&mvpMat, lightingTier);
+    glFinish();
+    unsigned int coveredPixels = CountCoveredPixels();
+
+    for (auto _ : state) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        loader.Render3DModel(&mvpMat, lightingTier);
+        glFinish();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["coveredPixels"] = coveredPixels;
+}
+
+static void BM_LightingScalerSlowThenFast(benchmark::State &state) {
+
+    unsigned int framesToUnlit = 0, framesToPixel = 0;
+    for (auto _ : state) {
+        MyLightingScaler lightingScaler;
+        framesToUnlit = framesToPixel = 0;
+        while (lightingScaler.AddFrameTime(40.) != LIGHTING_UNLIT && framesToUnlit < 10000) {
+            framesToUnlit++;
+        }
+        while (lightingScaler.AddFrameTime(12.) != LIGHTING_PER_PIXEL && framesToPixel < 10000) {
+            framesToPixel++;
+        }
+        benchmark::DoNotOptimize(lightingScaler.GetStats());
+    }
+    state.counters["framesToUnlit"] = framesToUnlit;
+    state.counters["framesToPixel"] = framesToPixel;
+}
+
+BENCHMARK_CAPTURE(BM_Lighting, andyUnlit, &gAndy, LIGHTING_UNLIT)
+        ->Name("Lighting/unlit/andy/andy.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Lighting, andyVertex, &gAndy, LIGHTING_PER_VERTEX)
+        ->Name("Lighting/vertex/andy/andy.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Lighting, andyPixel, &gAndy, LIGHTING_PER_PIXEL)
+        ->Name("Lighting/pixel/andy/andy.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Lighting, wonderUnlit, &gWonder, LIGHTING_UNLIT)
+        ->Name("Lighting/unlit/wonder/wonderwoman.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Lighting, wonderVertex, &gWonder, LIGHTING_PER_VERTEX)
+        ->Name("Lighting/vertex/wonder/wonderwoman.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_Lighting, wonderPixel, &gWonder, LIGHTING_PER_PIXEL)
+        ->Name("Lighting/pixel/wonder/wonderwoman.obj")->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LightingScalerSlowThenFast)->Name("LightingScaler/SlowThenFast");
@@ -0,0 +1,599 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Load-time benchmarks over every OBJ in assets, one benchmark per load stage:
+//   Extract/<obj>  -- copy the model's directory out of "assets"
+//   ReadFile/<profile>/<obj> -- Assimp::Importer::ReadFile with each import profile, with the
+//                               time of every post-process step as "ms:<step>" counters
+//   Decode/<obj>   -- OpenCV decode + RGB/flip conversion of all diffuse textures
+//   Pack/<obj>     -- conversion of faces and UVs into the arrays uploaded to GL
+//   Prepare/<obj>  -- AssimpLoader::PrepareModel given the OBJ and the catalog's MTL and
+//                     textures, as the app loads it; reports the bytes read and the textures
+//                     skipped, tests/loadTest.cpp checks what it reads
+//   PrepareCached/<obj> -- the same with a mesh cache key, reading the meshes an untimed
+//                     first load cached
+//   MeshCodec/Encode/<obj>, MeshCodec/Decode/<obj> -- EncodeScene and DecodeScene of the
+//                     imported scene, bytes/s counts the float arrays and indices decoded;
+//                     reports the size against the OBJ, tests/meshCacheTest.cpp checks the
+//                     decoded meshes and what a cached load reads
+//   Catalog/Scan   -- MyAssetCatalog::ScanDirectory over every model's directory, without the
+//                     textures CookAssetCatalog also hashes
+//   Catalog/Load   -- MyAssetCatalog::Load of the cooked catalog, as the app does at startup;
+//                     tests/catalogTest.cpp checks that it is up to date
+//   PostProcess/assimp/<obj>    -- Assimp's GenSmoothNormals, JoinIdenticalVertices and
+//                                  ImproveCacheLocality on a scene read with no other steps
+//   PostProcess/threads:<n>/<obj> -- the same steps with PostProcessMeshes on n threads,
+//                                  tests/postProcessTest.cpp checks them against Assimp's
+// Decode and Pack also run as DecodeArena/PackArena, staging in a MyArena like AssimpLoader
+// does, while Decode/Pack keep the old per-mesh new[]/imread path for comparison
+// the GLB loader is compared with these loads in glbBenchmark.cpp, over the same OBJs
+// every benchmark reports bytes/s, allocations per iteration (malloc and new) and how far it grew
+// the resident set (rssDeltaMB)
+
+#include "assimpLoader.h"
+#include "misc.h"
+#include "myAllocTracker.h"
+#include "myAssetCatalog.h"
+#include "myJNIHelper.h"
+#include "myMeshCodec.h"
+#include "myMeshPostProcess.h"
+#include "myModelPreloader.h"
+#include <assimp/DefaultLogger.hpp>
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <dirent.h>
+#include <set>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+// glbBenchmark.cpp
+void RegisterGLBBenchmarks(const std::string &assetDir, const std::vector<std::string> &objAssets);
+
+struct ModelAsset {
+    std::string                 objAsset;       // e.g. "andy/andy.obj"
+    std::vector<std::string>    directoryFiles; // every asset next to the OBJ
+    size_t                      objBytes;
+    size_t                      directoryBytes;
+};
+
+static std::string gAssetDir = MY_HOST_ASSET_DIR;
+
+static size_t GetFileSize(std::string path) {
+    struct stat fileStat;
+    return stat(path.c_str(), &fileStat) == 0 ? (size_t) fileStat.st_size : 0;
+}
+
+/**
+ * Walk the asset directory and collect every OBJ, together with the files in its directory
+ */
+static void FindModels(std::string relativeDir, std::vector<ModelAsset> &models) {
+
+    std::string fullDir = relativeDir.empty() ? gAssetDir : gAssetDir + "/" + relativeDir;
+    DIR *dir = opendir(fullDir.c_str());
+    if (!dir) {
+        return;
+    }
+
+    std::vector<std::string> files, objFiles, subDirs;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        std::string name = entry->d_name;
+        if (name[0] == '.') {
+            continue;
+        }
+        std::string relativeName = relativeDir.empty() ? name : relativeDir + "/" + name;
+        struct stat fileStat;
+        if (stat((gAssetDir + "/" + relativeName).c_str(), &fileStat) != 0) {
+            continue;
+        }
+        if (S_ISDIR(fileStat.st_mode)) {
+            subDirs.push_back(relativeName);
+        } else {
+            files.push_back(relativeName);
+            if (name.size() > 4 && strcasecmp(name.c_str() + name.size() - 4, ".obj") == 0) {
+                objFiles.push_back(relativeName);
+            }
+        }
+    }
+    closedir(dir);
+
+    for (unsigned int i = 0; i < objFiles.size(); ++i) {
+        ModelAsset model;
+        model.objAsset = objFiles[i];
+        model.directoryFiles = files;
+        model.objBytes = GetFileSize(gAssetDir + "/" + objFiles[i]);
+        model.directoryBytes = 0;
+        for (unsigned int f = 0; f < files.size(); ++f) {
+            model.directoryBytes += GetFileSize(gAssetDir + "/" + files[f]);
+        }
+        models.push_back(model);
+    }
+    for (unsigned int i = 0; i < subDirs.size(); ++i) {
+        FindModels(subDirs[i], models);
+    }
+}
+
+// where the memory counters of a benchmark start from
+struct MemoryBaseline {
+    MyAllocCounts   allocations;
+    long            rssKB;          // resident set when the benchmark started
+    bool            isPeakReset;    // the kernel's peak RSS was reset for this benchmark
+};
+
+/**
+ * A field of /proc/self/status in kB, -1 if it cannot be read
+ */
+static long ReadProcessStatusKB(const char *field) {
+
+    FILE *statusFile = fopen("/proc/self/status", "r");
+    if (!statusFile) {
+        return -1;
+    }
+    long valueKB = -1;
+    char line[256];
+    size_t fieldLength = strlen(field);
+    while (valueKB < 0 && fgets(line, sizeof(line), statusFile)) {
+        if (strncmp(line, field, fieldLength) == 0 && line[fieldLength] == ':') {
+            valueKB = strtol(line + fieldLength + 1, NULL, 10);
+        }
+    }
+    fclose(statusFile);
+    return valueKB;
+}
+
+/**
+ * Start counting allocations and reset the peak RSS (VmHWM) of the process, so that the peak
+ * seen at the end is this benchmark's and not that of the largest model benchmarked earlier
+ */
+static MemoryBaseline StartMemoryCounters() {
+
+    MemoryBaseline baseline;
+    FILE *clearRefsFile = fopen("/proc/self/clear_refs", "w");
+    baseline.isPeakReset = clearRefsFile && fputs("5", clearRefsFile) >= 0;
+    if (clearRefsFile) {
+        baseline.isPeakReset = fclose(clearRefsFile) == 0 && baseline.isPeakReset;
+    }
+    baseline.rssKB = ReadProcessStatusKB("VmRSS");
+    baseline.allocations = GetAllocCounts();
+    return baseline;
+}
+
+/**
+ * Attach allocation and memory counters to a finished benchmark. rssDeltaMB is how far the
+ * resident set grew over its size at the start, at its peak during the benchmark; it is left
+ * out where the kernel cannot reset the peak
+ */
+static void ReportMemoryCounters(benchmark::State &state, const MemoryBaseline &before) {
+
+    MyAllocCounts after = GetAllocCounts();
+    MyAllocCounts allocations = before.allocations;
+    state.counters["allocs"] = benchmark::Counter(after.allocations - allocations.allocations,
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["allocBytes"] = benchmark::Counter(after.bytes - allocations.bytes,
+                                                      benchmark::Counter::kAvgIterations);
+
+    long peakRssKB = ReadProcessStatusKB("VmHWM");
+    if (before.isPeakReset && before.rssKB >= 0 && peakRssKB >= 0) {
+        state.counters["rssDeltaMB"] = std::max(0L, peakRssKB - before.rssKB) / 1024.;
+    }
+}
+
+static void BM_Extract(benchmark::State &state, const ModelAsset *model) {
+
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        for (unsigned int f = 0; f < model->directoryFiles.size(); ++f) {
+            std::string extractedName;
+            gHelperObject->ExtractAssetReturnFilename(model->directoryFiles[f], extractedName);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * model->directoryBytes);
+    ReportMemoryCounters(state, memoryBefore);
+}
+
+static void BM_ReadFile(benchmark::State &state, const ModelAsset *model, ImportProfile profile) {
+
+    Assimp::Importer importer;
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    std::string objPath = gAssetDir + "/" + model->objAsset;
+
+    bool isImported = true;
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        isImported = importer.ReadFile(objPath, GetImportProfileFlags(profile)) != NULL;
+        if (!isImported) {
+            state.SkipWithError(importer.GetErrorString());
+            break;
+        }
+        importer.FreeScene();
+    }
+    state.SetBytesProcessed(state.iterations() * model->objBytes);
+    ReportMemoryCounters(state, memoryBefore);
+    if (!isImported) {
+        return;
+    }
+
+    // one more import outside the timed loop, the verbose logger would skew the iterations. The
+    // step timer attaches to a logger, which only this import has
+    Assimp::DefaultLogger::create("", Assimp::Logger::NORMAL, 0);
+    MyImportStepTimer stepTimer;
+    stepTimer.Start();
+    importer.ReadFile(objPath, GetImportProfileFlags(profile));
+    stepTimer.Stop();
+    Assimp::DefaultLogger::kill();
+    importer.FreeScene();
+    for (unsigned int i = 0; i < stepTimer.GetStepTimes().size(); ++i) {
+        const ImportStepTime &stepTime = stepTimer.GetStepTimes()[i];
+        state.counters["ms:" + stepTime.name] = stepTime.ms;
+    }
+}
+
+static void BM_Decode(benchmark::State &state, const ModelAsset *model, bool useArena) {
+
+    // collect diffuse textures the same way DecodeTextures does
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(gAssetDir + "/" + model->objAsset,
+                                             GetImportProfileFlags(DEFAULT_IMPORT_PROFILE));
+    if (!scene) {
+        state.SkipWithError(importer.GetErrorString());
+        return;
+    }
+    std::string modelDirectory = GetDirectoryName(gAssetDir + "/" + model->objAsset);
+    std::vector<std::string> texturePaths;
+    size_t textureBytes = 0;
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m) {
+        aiString textureFilename;
+        for (unsigned int t = 0; scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE, t,
+                                                          &textureFilename) == AI_SUCCESS; ++t) {
+            std::string path = modelDirectory + "/" + textureFilename.data;
+            if (GetFileSize(path) && std::find(texturePaths.begin(), texturePaths.end(), path)
+                                     == texturePaths.end()) {
+                texturePaths.push_back(path);
+                textureBytes += GetFileSize(path);
+            }
+        }
+    }
+    importer.FreeScene();
+    if (texturePaths.empty()) {
+        state.SkipWithError("model has no diffuse textures in assets");
+        return;
+    }
+
+    MyArena stagingArena;
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        for (unsigned int i = 0; i < texturePaths.size(); ++i) {
+            cv::Mat textureImage;
+            AssimpLoader::DecodeTexture(texturePaths[i], textureImage,
+                                        useArena ? &stagingArena : NULL);
+            benchmark::DoNotOptimize(textureImage.data);
+            textureImage.release();
+            stagingArena.Reset();
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * textureBytes);
+    ReportMemoryCounters(state, memoryBefore);
+}
+
+static void BM_Prepare(benchmark::State &state, const ModelAsset *model, bool useMeshCache) {
+
+    MyAssetCatalog catalog;
+    CatalogModel catalogModel;
+    if (!catalog.Load() || !catalog.FindModel(model->objAsset, catalogModel)) {
+        state.SkipWithError("Model is not in the cooked catalog, run CookAssetCatalog");
+        return;
+    }
+    ModelRequest modelRequest;
+    modelRequest.modelId = catalogModel.modelId;
+    modelRequest.objFileName = catalogModel.obj.assetName;
+    for (unsigned int m = 0; m < catalogModel.mtls.size(); ++m) {
+        modelRequest.assetNames.push_back(catalogModel.mtls[m].assetName);
+    }
+    for (unsigned int t = 0; t < catalogModel.textures.size(); ++t) {
+        modelRequest.assetNames.push_back(catalogModel.textures[t].assetName);
+    }
+    modelRequest.importProfile = DEFAULT_IMPORT_PROFILE;
+    modelRequest.sourceHash = useMeshCache ? catalogModel.obj.hash : 0;
+    if (useMeshCache) {
+        AssimpLoader loader;
+        std::string objPath;
+        if (!ExtractModelAssets(modelRequest, &loader, objPath) ||
+            !loader.PrepareModel(objPath, modelRequest.importProfile)) {
+            state.SkipWithError("PrepareModel failed");
+            return;
+        }
+    }
+
+    ModelReadStats readStats = {0, 0, 0, 0, 0};
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        AssimpLoader loader;
+        std::string objPath;
+        if (!ExtractModelAssets(modelRequest, &loader, objPath) ||
+            !loader.PrepareModel(objPath, modelRequest.importProfile)) {
+            state.SkipWithError("PrepareModel failed");
+            return;
+        }
+        readStats = loader.GetReadStats();
+    }
+    size_t bytesRead = readStats.modelBytes + readStats.meshCacheBytes + readStats.textureBytes;
+    state.SetBytesProcessed(state.iterations() * bytesRead);
+    ReportMemoryCounters(state, memoryBefore);
+    state.counters["readMB"] = bytesRead / 1048576.;
+    state.counters["directoryMB"] = model->directoryBytes / 1048576.;
+    state.counters["texturesSkipped"] = readStats.texturesSkipped;
+}
+
+static void BM_CatalogScan(benchmark::State &state, const std::vector<ModelAsset> *models) {
+
+    std::set<std::string> directories;
+    for (unsigned int m = 0; m < models->size(); ++m) {
+        std::string::size_type slashIndex = (*models)[m].objAsset.find_last_of('/');
+        directories.insert(slashIndex == std::string::npos ? "" :
+                           (*models)[m].objAsset.substr(0, slashIndex));
+    }
+    size_t catalogModels = 0;
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        MyAssetCatalog catalog;
+        for (std::set<std::string>::const_iterator directory = directories.begin();
+             directory != directories.end(); ++directory) {
+            catalog.ScanDirectory(*directory, false);
+        }
+        catalogModels = catalog.GetModels().size();
+    }
+    ReportMemoryCounters(state, memoryBefore);
+    state.counters["models"] = catalogModels;
+}
+
+static void BM_CatalogLoad(benchmark::State &state) {
+
+    MyAssetCatalog catalog;
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        if (!catalog.Load()) {
+            state.SkipWithError("No cooked catalog in the assets");
+            return;
+        }
+    }
+    ReportMemoryCounters(state, memoryBefore);
+    state.counters["models"] = catalog.GetModels().size();
+}
+
+static void BM_Pack(benchmark::State &state, const ModelAsset *model, bool useArena) {
+
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(gAssetDir + "/" + model->objAsset,
+                                             GetImportProfileFlags(DEFAULT_IMPORT_PROFILE));
+    if (!scene) {
+        state.SkipWithError(importer.GetErrorString());
+        return;
+    }
+
+    size_t packedBytes = 0;
+    MyArena stagingArena;
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        packedBytes = 0;
+        // same allocation pattern as AssimpLoader::GenerateGLBuffers, before and after the arena
+        for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+            const aiMesh *mesh = scene->mMeshes[n];
+            MyArenaMarker meshMarker = stagingArena.GetMarker();
+
+            unsigned int *faceArray = useArena ?
+                    stagingArena.AllocateArray<unsigned int>(mesh->mNumFaces * 3) :
+                    new unsigned int[mesh->mNumFaces * 3];
+            AssimpLoader::PackFaceIndices(mesh, faceArray);
+            benchmark::DoNotOptimize(faceArray);
+            if (!useArena) {
+                delete[] faceArray;
+            }
+            packedBytes += sizeof(unsigned int) * 3 * mesh->mNumFaces;
+
+            if (mesh->HasTextureCoords(0)) {
+                float *textureCoords = useArena ?
+                        stagingArena.AllocateArray<float>(2 * mesh->mNumVertices) :
+                        new float[2 * mesh->mNumVertices];
+                AssimpLoader::PackTextureCoords(mesh, textureCoords);
+                benchmark::DoNotOptimize(textureCoords);
+                if (!useArena) {
+                    delete[] textureCoords;
+                }
+                packedBytes += sizeof(float) * 2 * mesh->mNumVertices;
+            }
+            stagingArena.Rewind(meshMarker);
+        }
+        stagingArena.Reset();
+    }
+    state.SetBytesProcessed(state.iterations() * packedBytes);
+    ReportMemoryCounters(state, memoryBefore);
+}
+
+/**
+ * Bytes of the float arrays and indices of the scene's meshes, what a decode produces
+ */
+static size_t GetSceneMeshBytes(const aiScene *scene) {
+
+    size_t meshBytes = 0;
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+        const aiMesh *mesh = scene->mMeshes[n];
+        size_t vertexBytes = sizeof(aiVector3D) *
+                             (1 + mesh->HasTextureCoords(0) + mesh->HasNormals() +
+                              2 * mesh->HasTangentsAndBitangents()) +
+                             (mesh->HasVertexColors(0) ? sizeof(aiColor4D) : 0);
+        meshBytes += vertexBytes * mesh->mNumVertices + 3 * sizeof(unsigned int) * mesh->mNumFaces;
+    }
+    return meshBytes;
+}
+
+static void BM_MeshCodec(benchmark::State &state, const ModelAsset *model, bool isDecode) {
+
+    Assimp::Importer importer;
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    const aiScene *scene = importer.ReadFile(gAssetDir + "/" + model->objAsset,
+                                             GetImportProfileFlags(DEFAULT_IMPORT_PROFILE));
+    if (!scene) {
+        state.SkipWithError(importer.GetErrorString());
+        return;
+    }
+    std::vector<uint8_t> encoded;
+    if (!EncodeScene(scene, 1, encoded)) {
+        state.SkipWithError("EncodeScene refused the scene");
+        return;
+    }
+
+    MyArena arena;
+    std::vector<const unsigned int *> meshIndices;
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        if (isDecode) {
+            aiScene *decoded = DecodeScene(&encoded[0], encoded.size(), 1, arena, meshIndices);
+            if (!decoded) {
+                state.SkipWithError("DecodeScene failed");
+                return;
+            }
+            delete decoded;
+            arena.Reset();
+        } else {
+            encoded.clear();
+            EncodeScene(scene, 1, encoded);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * GetSceneMeshBytes(scene));
+    ReportMemoryCounters(state, memoryBefore);
+    state.counters["encodedKB"] = encoded.size() / 1024.;
+    state.counters["objRatio"] = (double) model->objBytes / encoded.size();
+    state.counters["meshRatio"] = (double) GetSceneMeshBytes(scene) / encoded.size();
+}
+
+// read flags that leave every step of MY_MESH_POSTPROCESS_STEPS to the benchmark
+#define POSTPROCESS_READ_FLAGS  (aiProcess_Triangulate | aiProcess_SortByPType)
+
+/**
+ * numberOfThreads 0 runs Assimp's own steps
+ */
+static void BM_PostProcess(benchmark::State &state, const ModelAsset *model,
+                           unsigned int numberOfThreads) {
+
+    Assimp::Importer importer;
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    std::string objPath = gAssetDir + "/" + model->objAsset;
+
+    MemoryBaseline memoryBefore = StartMemoryCounters();
+    for (auto _ : state) {
+        state.PauseTiming();
+        const aiScene *scene = importer.ReadFile(objPath, POSTPROCESS_READ_FLAGS);
+        state.ResumeTiming();
+        if (!scene) {
+            state.SkipWithError(importer.GetErrorString());
+            break;
+        }
+        if (numberOfThreads == 0) {
+            importer.ApplyPostProcessing(MY_MESH_POSTPROCESS_STEPS);
+        } else {
+            PostProcessMeshes(const_cast<aiScene *>(scene), MY_MESH_POSTPROCESS_STEPS,
+                              numberOfThreads);
+        }
+        state.PauseTiming();
+        importer.FreeScene();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(state.iterations() * model->objBytes);
+    ReportMemoryCounters(state, memoryBefore);
+}
+
+int main(int argc, char **argv) {
+
+    // strip our own --assets=<dir> before google benchmark parses the rest
+    int benchmarkArgc = 0;
+    for (int i = 0; i < argc; ++i) {
+        if (strncmp(argv[i], "--assets=", 9) == 0) {
+            gAssetDir = argv[i] + 9;
+        } else {
+            argv[benchmarkArgc++] = argv[i];
+        }
+    }
+    argc = benchmarkArgc;
+
+    std::string internalDir = "/tmp/ModelAssimpBenchmark";
+    mkdir(internalDir.c_str(), 0755);
+    gHelperObject = new MyJNIHelper(gAssetDir, internalDir);
+
+    static std::vector<ModelAsset> models;
+    FindModels("", models);
+    if (models.empty()) {
+        MyLOGE("No OBJ found under %s", gAssetDir.c_str());
+        return 1;
+    }
+
+    for (unsigned int i = 0; i < models.size(); ++i) {
+        const ModelAsset *model = &models[i];
+        benchmark::RegisterBenchmark(("Extract/" + model->objAsset).c_str(), BM_Extract, model)
+                ->Unit(benchmark::kMillisecond);
+        for (int profile = 0; profile < IMPORT_PROFILE_COUNT; ++profile) {
+            std::string name = std::string("ReadFile/") +
+                               GetImportProfileName((ImportProfile) profile) + "/" + model->objAsset;
+            benchmark::RegisterBenchmark(name.c_str(), BM_ReadFile, model, (ImportProfile) profile)
+                    ->Unit(benchmark::kMillisecond);
+        }
+        benchmark::RegisterBenchmark(("Decode/" + model->objAsset).c_str(), BM_Decode, model,
+                                     false)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DecodeArena/" + model->objAsset).c_str(), BM_Decode, model,
+                                     true)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("Pack/" + model->objAsset).c_str(), BM_Pack, model, false)
+                ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("PackArena/" + model->objAsset).c_str(), BM_Pack, model,
+                                     true)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("Prepare/" + model->objAsset).c_str(), BM_Prepare, model,
+                                     false)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("PrepareCached/" + model->objAsset).c_str(), BM_Prepare,
+                                     model, true)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("MeshCodec/Encode/" + model->objAsset).c_str(),
+                                     BM_MeshCodec, model, false)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("MeshCodec/Decode/" + model->objAsset).c_str(),
+                                     BM_MeshCodec, model, true)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("PostProcess/assimp/" + model->objAsset).c_str(),
+                                     BM_PostProcess, model, 0u)->Unit(benchmark::kMillisecond);
+        for (unsigned int threads = 1; threads <= 8; threads *= 2) {
+            std::string name = "PostProcess/threads:" + std::to_string(threads) + "/" +
+                               model->objAsset;
+            benchmark::RegisterBenchmark(name.c_str(), BM_PostProcess, model, threads)
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+        }
+    }
+
+    std::vector<std::string> objAssets;
+    for (unsigned int i = 0; i < models.size(); ++i) {
+        objAssets.push_back(models[i].objAsset);
+    }
+    RegisterGLBBenchmarks(gAssetDir, objAssets);
+
+    benchmark::RegisterBenchmark("Catalog/Scan", BM_CatalogScan, &models)
+            ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("Catalog/Load", BM_CatalogLoad)
+            ->Unit(benchmark::kMillisecond);
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    delete gHelperObject;
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// MySceneGraph benchmarks on a tree where every node has four children and draws the same mesh:
+//   SceneGraph/Update/none/<n>  -- nothing changed since the last update
+//   SceneGraph/Update/leaf/<n>  -- one leaf moved, only the leaf is recomputed
+//   SceneGraph/Update/root/<n>  -- the root moved, every node is recomputed
+// Each reports the nodes recomputed per update; tests/sceneGraphTest.cpp checks the matrices
+
+#include "mySceneGraph.h"
+#include <benchmark/benchmark.h>
+
+/**
+ * Depth-first like MySceneGraph, so node numbers match; every node uses mesh 0
+ */
+static aiNode * CreateTree(unsigned int depth, unsigned int &numberOfNodes) {
+
+    aiNode *node = new aiNode("node" + std::to_string(numberOfNodes));
+    aiMatrix4x4::Translation(aiVector3D(1.f, 0.5f * (numberOfNodes % 3), 0.f), node->mTransformation);
+    aiMatrix4x4 rotation;
+    node->mTransformation *= aiMatrix4x4::RotationZ(0.1f * (numberOfNodes % 5), rotation);
+    node->mNumMeshes = 1;
+    node->mMeshes = new unsigned int[1];
+    node->mMeshes[0] = 0;
+    ++numberOfNodes;
+    if (depth > 0) {
+        node->mNumChildren = 4;
+        node->mChildren = new aiNode *[4];
+        for (unsigned int c = 0; c < 4; ++c) {
+            node->mChildren[c] = CreateTree(depth - 1, numberOfNodes);
+            node->mChildren[c]->mParent = node;
+        }
+    }
+    return node;
+}
+
+enum ChangedNode { CHANGED_NONE, CHANGED_LEAF, CHANGED_ROOT };
+
+static void BM_Update(benchmark::State &state, ChangedNode changedNode) {
+
+    aiScene scene;
+    unsigned int numberOfNodes = 0;
+    scene.mRootNode = CreateTree(state.range(0), numberOfNodes);
+    MySceneGraph graph;
+    graph.Build(&scene);
+    graph.SetMeshBounds(0, glm::vec3(-0.5f), glm::vec3(0.5f));
+    unsigned int node = changedNode == CHANGED_LEAF ? graph.GetNumberOfNodes() - 1 : 0;
+
+    unsigned int numberOfUpdated = 0;
+    float angle = 0;
+    for (auto _ : state) {
+        if (changedNode != CHANGED_NONE) {
+            angle += 0.01f;
+            graph.SetLocalMatrix(node, glm::rotate(graph.GetLocalMatrix(node), angle,
+                                                   glm::vec3(0, 0, 1.f)));
+        }
+        numberOfUpdated = graph.UpdateWorldMatrices();
+    }
+
+    state.counters["nodes"] = graph.GetNumberOfNodes();
+    state.counters["nodesUpdated"] = numberOfUpdated;
+    state.SetItemsProcessed(state.iterations() * graph.GetNumberOfNodes());
+}
+
+// argument: depth of the tree, 85 to 5461 nodes
+BENCHMARK_CAPTURE(BM_Update, none, CHANGED_NONE)->Name("SceneGraph/Update/none")->DenseRange(3, 6, 3);
+BENCHMARK_CAPTURE(BM_Update, leaf, CHANGED_LEAF)->Name("SceneGraph/Update/leaf")->DenseRange(3, 6, 3);
+BENCHMARK_CAPTURE(BM_Update, root, CHANGED_ROOT)->Name("SceneGraph/Update/root")->DenseRange(3, 6, 3);
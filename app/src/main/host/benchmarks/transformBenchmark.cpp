@@ -0,0 +1,135 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// MyTransformBatch benchmarks, each for the SIMD and the scalar kernel and n transforms:
+//   Transform/MultiplyLeft/<kernel>/<n>     -- view-projection times n model matrices
+//   Transform/Multiply/<kernel>/<n>         -- parent times local, as a scene graph does
+//   Transform/TransformBounds/<kernel>/<n>  -- n boxes to world space
+//   Transform/Cull/<kernel>/<n>             -- n boxes against the six frustum planes
+// 63 leaves a partly filled group of four. For timing only; tests/transformTest.cpp checks
+// the kernels against glm
+
+#include "myTransformBatch.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+/**
+ * Rotated, scaled and translated matrices spread around the origin, same for every run
+ */
+static glm::mat4 GetTestMatrix(unsigned int i) {
+    float t = (float) i;
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(std::sin(t) * 20.f,
+                                                                 std::cos(t * 0.7f) * 20.f,
+                                                                 std::sin(t * 0.3f) * 20.f));
+    matrix = glm::rotate(matrix, t * 0.1f, glm::normalize(glm::vec3(1.f, t, 2.f)));
+    return glm::scale(matrix, glm::vec3(1.f + (i % 3) * 0.5f));
+}
+
+static void FillBatch(MyTransformBatch &batch, unsigned int count) {
+    batch.Resize(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        batch.SetMatrix(i, GetTestMatrix(i));
+        batch.SetBounds(i, glm::vec3(-1.f, -0.5f, -2.f), glm::vec3(1.f, 0.5f + i % 2, 2.f));
+    }
+}
+
+static glm::mat4 GetViewProjection() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 40.f), glm::vec3(0), glm::vec3(0, 1.f, 0));
+    return projection * view;
+}
+
+static TransformKernel GetKernel(benchmark::State &state) {
+    return state.range(1) ? TRANSFORM_KERNEL_SCALAR : TRANSFORM_KERNEL_SIMD;
+}
+
+static void SetLabel(benchmark::State &state) {
+    state.SetLabel(state.range(1) ? "scalar" : GetTransformBatchSIMD());
+}
+
+static void BM_MultiplyLeft(benchmark::State &state) {
+
+    unsigned int count = state.range(0);
+    MyTransformBatch models, result;
+    FillBatch(models, count);
+    glm::mat4 viewProjection = GetViewProjection();
+
+    for (auto _ : state) {
+        result.MultiplyLeft(viewProjection, models, GetKernel(state));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    SetLabel(state);
+}
+
+static void BM_Multiply(benchmark::State &state) {
+
+    unsigned int count = state.range(0);
+    MyTransformBatch parents, locals, result;
+    FillBatch(parents, count);
+    locals.Resize(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        locals.SetMatrix(i, GetTestMatrix(i + 7));
+    }
+
+    for (auto _ : state) {
+        result.Multiply(parents, locals, GetKernel(state));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    SetLabel(state);
+}
+
+static void BM_TransformBounds(benchmark::State &state) {
+
+    unsigned int count = state.range(0);
+    MyTransformBatch local, world;
+    FillBatch(local, count);
+
+    for (auto _ : state) {
+        world.TransformBounds(local, GetKernel(state));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    SetLabel(state);
+}
+
+static void BM_Cull(benchmark::State &state) {
+
+    unsigned int count = state.range(0);
+    MyTransformBatch local, world;
+    FillBatch(local, count);
+    world.TransformBounds(local, TRANSFORM_KERNEL_SCALAR);
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(GetViewProjection(), planes);
+    std::vector<unsigned char> visible(count);
+
+    unsigned int numberOfVisible = world.CullBounds(planes, &visible[0], GetKernel(state));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(world.CullBounds(planes, &visible[0], GetKernel(state)));
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["visible"] = numberOfVisible;
+    SetLabel(state);
+}
+
+// second argument: 0 for the SIMD kernel, 1 for scalar
+#define TRANSFORM_ARGS ->ArgNames({"n", "scalar"})->ArgsProduct({{63, 1024, 16384}, {0, 1}})
+BENCHMARK(BM_MultiplyLeft)->Name("Transform/MultiplyLeft") TRANSFORM_ARGS;
+BENCHMARK(BM_Multiply)->Name("Transform/Multiply") TRANSFORM_ARGS;
+BENCHMARK(BM_TransformBounds)->Name("Transform/TransformBounds") TRANSFORM_ARGS;
+BENCHMARK(BM_Cull)->Name("Transform/Cull") TRANSFORM_ARGS;
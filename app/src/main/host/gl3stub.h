@@ -14,14 +14,14 @@
  *    limitations under the License.
  */
 
-// shader associated with AssimpLoader
+// Host replacement for ndk_helper's gl3stub.h
+// Mesa exports the GLES 3 entry points directly, so there is nothing to look up at runtime
 
-precision mediump float; // required in GLSL ES 1.00
+#ifndef GL3STUB_H
+#define GL3STUB_H
 
-varying vec2      textureCoords;
-uniform sampler2D textureSampler;
+#include <GLES3/gl3.h>
 
-void main()
-{
-    gl_FragColor.xyz = texture2D( textureSampler, textureCoords ).xyz;
-}
+inline GLboolean gl3stubInit() { return GL_TRUE; }
+
+#endif //GL3STUB_H
@@ -0,0 +1,372 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "glbWriter.h"
+#include "misc.h"
+#include "myGLBFile.h"
+#include "myLogger.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <vector>
+
+static void AppendFormat(std::string &text, const char *format, ...) {
+    char buffer[256];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(buffer, sizeof(buffer), format, arguments);
+    va_end(arguments);
+    text += buffer;
+}
+
+/**
+ * JSON has no NaN or infinity, and round-trips floats with 9 digits
+ */
+static void AppendNumbers(std::string &text, const float *values, unsigned int count) {
+    text += "[";
+    for (unsigned int i = 0; i < count; ++i) {
+        AppendFormat(text, i ? ",%.9g" : "%.9g", isfinite(values[i]) ? values[i] : 0.f);
+    }
+    text += "]";
+}
+
+static void AppendString(std::string &text, const char *value) {
+    text += "\"";
+    for (const char *c = value; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            text += '\\';
+            text += *c;
+        } else if ((unsigned char) *c < 0x20) {
+            AppendFormat(text, "\\u%04x", *c);
+        } else {
+            text += *c;
+        }
+    }
+    text += "\"";
+}
+
+static bool ReadFile(const std::string &path, std::vector<uint8_t> &data) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    data.clear();
+    uint8_t chunk[BUFSIZ];
+    size_t readBytes;
+    while ((readBytes = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + readBytes);
+    }
+    bool isRead = !ferror(file);
+    fclose(file);
+    return isRead;
+}
+
+// the JSON arrays that refer into the BIN chunk, built up together with it
+struct GLBBuilder {
+    std::vector<uint8_t>    bin;
+    std::string             bufferViews, accessors, images;
+    unsigned int            viewCount, accessorCount, imageCount;
+    std::vector<std::string> imagePaths;
+
+    GLBBuilder() : viewCount(0), accessorCount(0), imageCount(0) {}
+
+    // views start 4-aligned, so that every accessor of up to 4-byte components is aligned
+    unsigned int AddView(const void *data, size_t bytes, unsigned int target) {
+        bin.resize((bin.size() + 3) & ~(size_t) 3, 0);
+        AppendFormat(bufferViews, "%s{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu",
+                     viewCount ? "," : "", bin.size(), bytes);
+        if (target) {
+            AppendFormat(bufferViews, ",\"target\":%u", target);
+        }
+        bufferViews += "}";
+        bin.insert(bin.end(), (const uint8_t *) data, (const uint8_t *) data + bytes);
+        return viewCount++;
+    }
+
+    unsigned int AddAccessor(const void *data, unsigned int count, unsigned int componentType,
+                             unsigned int components, unsigned int target,
+                             const float *boundsMin = NULL, const float *boundsMax = NULL) {
+        static const char *types[] = {"", "SCALAR", "VEC2", "VEC3", "VEC4"};
+        size_t bytes = (size_t) count * components * MyGLBFile::GetComponentSize(componentType);
+        unsigned int view = AddView(data, bytes, target);
+        AppendFormat(accessors, "%s{\"bufferView\":%u,\"componentType\":%u,\"count\":%u,"
+                     "\"type\":\"%s\"", accessorCount ? "," : "", view, componentType, count,
+                     types[components]);
+        if (boundsMin && boundsMax) {
+            accessors += ",\"min\":";
+            AppendNumbers(accessors, boundsMin, components);
+            accessors += ",\"max\":";
+            AppendNumbers(accessors, boundsMax, components);
+        }
+        accessors += "}";
+        return accessorCount++;
+    }
+
+    // the image of a texture file, -1 if it is missing or neither PNG nor JPEG
+    int AddImage(const std::string &textureDirectory, const std::string &textureName) {
+        std::string paths[] = {textureDirectory + "/" + textureName,
+                               textureDirectory + "/" + GetFileName(textureName)};
+        for (unsigned int p = 0; p < 2; ++p) {
+            for (unsigned int i = 0; i < imagePaths.size(); ++i) {
+                if (imagePaths[i] == paths[p]) {
+                    return i;
+                }
+            }
+            std::vector<uint8_t> data;
+            if (!ReadFile(paths[p], data)) {
+                continue;
+            }
+            const char *mimeType = NULL;
+            if (data.size() > 4 && memcmp(data.data(), "\x89PNG", 4) == 0) {
+                mimeType = "image/png";
+            } else if (data.size() > 3 && memcmp(data.data(), "\xff\xd8\xff", 3) == 0) {
+                mimeType = "image/jpeg";
+            } else {
+                MyLOGW("%s is neither PNG nor JPEG, it is not embedded", paths[p].c_str());
+                return -1;
+            }
+            unsigned int view = AddView(data.data(), data.size(), 0);
+            AppendFormat(images, "%s{\"bufferView\":%u,\"mimeType\":\"%s\"}",
+                         imageCount ? "," : "", view, mimeType);
+            imagePaths.push_back(paths[p]);
+            return imageCount++;
+        }
+        MyLOGW("Texture %s is missing, it is not embedded", textureName.c_str());
+        return -1;
+    }
+};
+
+/**
+ * One primitive of the mesh's attributes. glTF's UVs count v from the image's top row, Assimp's
+ * from the bottom; the tangent's w is the handedness of the bitangent
+ */
+static void AppendMesh(const aiMesh *mesh, GLBBuilder &builder, std::string &meshes) {
+
+    unsigned int numberOfVertices = mesh->mNumVertices;
+    float boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+    float boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (unsigned int v = 0; v < numberOfVertices; ++v) {
+        for (int c = 0; c < 3; ++c) {
+            boundsMin[c] = fminf(boundsMin[c], mesh->mVertices[v][c]);
+            boundsMax[c] = fmaxf(boundsMax[c], mesh->mVertices[v][c]);
+        }
+    }
+    std::string attributes;
+    AppendFormat(attributes, "\"POSITION\":%u",
+                 builder.AddAccessor(mesh->mVertices, numberOfVertices, GLB_FLOAT, 3,
+                                     GLB_ARRAY_BUFFER, boundsMin, boundsMax));
+
+    // glTF wants unit normals, a degenerate one points along z
+    std::vector<aiVector3D> normals;
+    if (mesh->HasNormals()) {
+        normals.assign(mesh->mNormals, mesh->mNormals + numberOfVertices);
+        for (unsigned int v = 0; v < numberOfVertices; ++v) {
+            float length = normals[v].Length();
+            normals[v] = length > 0 ? normals[v] / length : aiVector3D(0, 0, 1);
+        }
+        AppendFormat(attributes, ",\"NORMAL\":%u",
+                     builder.AddAccessor(normals.data(), numberOfVertices, GLB_FLOAT, 3,
+                                         GLB_ARRAY_BUFFER));
+    }
+    if (mesh->HasTextureCoords(0)) {
+        std::vector<float> textureCoords(2 * numberOfVertices);
+        for (unsigned int v = 0; v < numberOfVertices; ++v) {
+            textureCoords[2 * v] = mesh->mTextureCoords[0][v].x;
+            textureCoords[2 * v + 1] = 1.f - mesh->mTextureCoords[0][v].y;
+        }
+        AppendFormat(attributes, ",\"TEXCOORD_0\":%u",
+                     builder.AddAccessor(textureCoords.data(), numberOfVertices, GLB_FLOAT, 2,
+                                         GLB_ARRAY_BUFFER));
+    }
+    if (mesh->HasTangentsAndBitangents() && mesh->HasNormals()) {
+        std::vector<float> tangents(4 * numberOfVertices);
+        for (unsigned int v = 0; v < numberOfVertices; ++v) {
+            const aiVector3D &tangent = mesh->mTangents[v];
+            tangents[4 * v] = tangent.x;
+            tangents[4 * v + 1] = tangent.y;
+            tangents[4 * v + 2] = tangent.z;
+            tangents[4 * v + 3] = ((normals[v] ^ tangent) * mesh->mBitangents[v]) < 0 ? -1 : 1;
+        }
+        AppendFormat(attributes, ",\"TANGENT\":%u",
+                     builder.AddAccessor(tangents.data(), numberOfVertices, GLB_FLOAT, 4,
+                                         GLB_ARRAY_BUFFER));
+    }
+    if (mesh->HasVertexColors(0)) {
+        AppendFormat(attributes, ",\"COLOR_0\":%u",
+                     builder.AddAccessor(mesh->mColors[0], numberOfVertices, GLB_FLOAT, 4,
+                                         GLB_ARRAY_BUFFER));
+    }
+
+    // the import triangulated and dropped points and lines
+    std::vector<uint32_t> indices;
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        if (mesh->mFaces[f].mNumIndices == 3) {
+            indices.insert(indices.end(), mesh->mFaces[f].mIndices, mesh->mFaces[f].mIndices + 3);
+        }
+    }
+    unsigned int indexAccessor;
+    if (numberOfVertices <= 65536) {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        indexAccessor = builder.AddAccessor(shortIndices.data(), shortIndices.size(),
+                                            GLB_UNSIGNED_SHORT, 1, GLB_ELEMENT_ARRAY_BUFFER);
+    } else {
+        indexAccessor = builder.AddAccessor(indices.data(), indices.size(), GLB_UNSIGNED_INT, 1,
+                                            GLB_ELEMENT_ARRAY_BUFFER);
+    }
+
+    AppendFormat(meshes, "%s{\"primitives\":[{\"attributes\":{", meshes.empty() ? "" : ",");
+    meshes += attributes;
+    AppendFormat(meshes, "},\"indices\":%u,\"material\":%u}]}", indexAccessor,
+                 mesh->mMaterialIndex);
+}
+
+static void AppendMaterial(const aiMaterial *material, const std::string &textureDirectory,
+                           GLBBuilder &builder, std::string &materials) {
+
+    aiString name, texturePath;
+    aiColor4D diffuseColor(1.f, 1.f, 1.f, 1.f);
+    material->Get(AI_MATKEY_NAME, name);
+    material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+    float baseColorFactor[4] = {diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a};
+    for (int c = 0; c < 4; ++c) {
+        baseColorFactor[c] = fminf(fmaxf(baseColorFactor[c], 0.f), 1.f);
+    }
+
+    materials += materials.empty() ? "{\"name\":" : ",{\"name\":";
+    AppendString(materials, name.C_Str());
+    materials += ",\"pbrMetallicRoughness\":{\"baseColorFactor\":";
+    AppendNumbers(materials, baseColorFactor, 4);
+    if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
+        int image = builder.AddImage(textureDirectory, texturePath.C_Str());
+        if (image >= 0) {
+            AppendFormat(materials, ",\"baseColorTexture\":{\"index\":%d}", image);
+        }
+    }
+    materials += ",\"metallicFactor\":0}";
+    // OBJ's map_bump comes in as a height map, see GetNormalMapPath in assimpLoader.cpp
+    if (material->GetTexture(aiTextureType_NORMALS, 0, &texturePath) == AI_SUCCESS ||
+        material->GetTexture(aiTextureType_HEIGHT, 0, &texturePath) == AI_SUCCESS) {
+        int image = builder.AddImage(textureDirectory, texturePath.C_Str());
+        if (image >= 0) {
+            AppendFormat(materials, ",\"normalTexture\":{\"index\":%d}", image);
+        }
+    }
+    materials += "}";
+}
+
+/**
+ * Depth-first like MySceneGraph. A node with several meshes keeps the first and gets a child
+ * node for each of the others, glTF nodes have one mesh
+ */
+static unsigned int AppendNode(const aiNode *node, std::vector<std::string> &nodes) {
+
+    unsigned int index = nodes.size();
+    nodes.push_back(std::string());
+    std::string json = "{\"name\":";
+    AppendString(json, node->mName.C_Str());
+    if (!node->mTransformation.IsIdentity()) {
+        // aiMatrix4x4 is row-major, glTF's matrix column-major
+        aiMatrix4x4 columnMajor = node->mTransformation;
+        columnMajor.Transpose();
+        json += ",\"matrix\":";
+        AppendNumbers(json, columnMajor[0], 16);
+    }
+    if (node->mNumMeshes > 0) {
+        AppendFormat(json, ",\"mesh\":%u", node->mMeshes[0]);
+    }
+    std::string children;
+    for (unsigned int m = 1; m < node->mNumMeshes; ++m) {
+        AppendFormat(children, "%s%zu", children.empty() ? "" : ",", nodes.size());
+        nodes.push_back(std::string());
+        AppendFormat(nodes.back(), "{\"mesh\":%u}", node->mMeshes[m]);
+    }
+    for (unsigned int c = 0; c < node->mNumChildren; ++c) {
+        unsigned int child = AppendNode(node->mChildren[c], nodes);
+        AppendFormat(children, "%s%u", children.empty() ? "" : ",", child);
+    }
+    if (!children.empty()) {
+        json += ",\"children\":[" + children + "]";
+    }
+    nodes[index] = json + "}";
+    return index;
+}
+
+bool WriteGLB(const aiScene *scene, const std::string &textureDirectory,
+              const std::string &glbPath) {
+
+    GLBBuilder builder;
+    std::string meshes, materials;
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+        AppendMesh(scene->mMeshes[n], builder, meshes);
+    }
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m) {
+        AppendMaterial(scene->mMaterials[m], textureDirectory, builder, materials);
+    }
+    std::vector<std::string> nodes;
+    if (scene->mRootNode) {
+        AppendNode(scene->mRootNode, nodes);
+    } else {
+        // as MySceneGraph::Build does, a root that draws every mesh
+        std::string children;
+        nodes.push_back(std::string());
+        for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+            AppendFormat(children, "%s%zu", children.empty() ? "" : ",", nodes.size());
+            nodes.push_back(std::string());
+            AppendFormat(nodes.back(), "{\"mesh\":%u}", n);
+        }
+        nodes[0] = "{\"name\":\"root\",\"children\":[" + children + "]}";
+    }
+
+    std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"ConvertToGLB\"},"
+                       "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[";
+    for (unsigned int n = 0; n < nodes.size(); ++n) {
+        json += (n ? "," : "") + nodes[n];
+    }
+    json += "],\"meshes\":[" + meshes + "],\"materials\":[" + materials + "]";
+    if (builder.imageCount) {
+        json += ",\"images\":[" + builder.images + "],\"textures\":[";
+        for (unsigned int i = 0; i < builder.imageCount; ++i) {
+            AppendFormat(json, "%s{\"source\":%u}", i ? "," : "", i);
+        }
+        json += "]";
+    }
+    json += ",\"accessors\":[" + builder.accessors + "],\"bufferViews\":[" +
+            builder.bufferViews + "]";
+    AppendFormat(json, ",\"buffers\":[{\"byteLength\":%zu}]}", builder.bin.size());
+
+    // chunks are padded to 4 bytes, the JSON with spaces
+    json.resize((json.size() + 3) & ~(size_t) 3, ' ');
+    builder.bin.resize((builder.bin.size() + 3) & ~(size_t) 3, 0);
+    GLBHeader header = {GLB_MAGIC, GLB_VERSION, (uint32_t) (sizeof(GLBHeader) +
+                        2 * sizeof(GLBChunkHeader) + json.size() + builder.bin.size())};
+    GLBChunkHeader jsonChunk = {(uint32_t) json.size(), GLB_CHUNK_JSON};
+    GLBChunkHeader binChunk = {(uint32_t) builder.bin.size(), GLB_CHUNK_BIN};
+
+    FILE *out = fopen(glbPath.c_str(), "wb");
+    if (!out) {
+        MyLOGE("Cannot write %s", glbPath.c_str());
+        return false;
+    }
+    bool isWritten = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                     fwrite(&jsonChunk, sizeof(jsonChunk), 1, out) == 1 &&
+                     fwrite(json.data(), 1, json.size(), out) == json.size() &&
+                     fwrite(&binChunk, sizeof(binChunk), 1, out) == 1 &&
+                     fwrite(builder.bin.data(), 1, builder.bin.size(), out) == builder.bin.size();
+    return fclose(out) == 0 && isWritten;
+}
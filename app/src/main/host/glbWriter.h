@@ -0,0 +1,35 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Writes an imported scene as a glTF 2.0 binary, for ConvertToGLB and the GLB benchmarks.
+// Every aiMesh becomes a glTF mesh of one triangle primitive, in the same order, so the GLB has
+// the meshes the OBJ's import gives the loader. Attributes are written in the layouts the
+// loader uploads without a copy: float positions, normals and UVs, xyzw tangents and RGBA
+// colors; indices are 16-bit where they fit. Diffuse textures and normal maps that are PNG or
+// JPEG files are embedded, others are left out
+
+#ifndef GLB_WRITER_H
+#define GLB_WRITER_H
+
+#include <assimp/scene.h>
+#include <string>
+
+// textures are looked for by their path from textureDirectory, then by their file name in it
+bool WriteGLB(const aiScene *scene, const std::string &textureDirectory,
+              const std::string &glbPath);
+
+#endif //GLB_WRITER_H
@@ -0,0 +1,176 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "hostGLContext.h"
+#include "myLogger.h"
+#include "myShaderVariants.h"
+#include <EGL/eglext.h>
+#include <string.h>
+#include <vector>
+
+HostGLContext::HostGLContext() {
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    frameBuffer = colorTexture = depthBuffer = 0;
+    width = height = 0;
+}
+
+HostGLContext::~HostGLContext() {
+    Destroy();
+}
+
+/**
+ * Create a surfaceless GLES 2 context and an offscreen framebuffer of the given size
+ */
+bool HostGLContext::Init(int width, int height) {
+
+    this->width = width;
+    this->height = height;
+
+    // prefer Mesa's surfaceless platform, it does not need a display server
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint majorVersion, minorVersion;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &majorVersion, &minorVersion)) {
+        MyLOGE("Unable to initialize EGL display");
+        return false;
+    }
+    MyLOGI("EGL %d.%d", majorVersion, minorVersion);
+
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+        MyLOGE("EGL_KHR_surfaceless_context is not supported");
+        return false;
+    }
+
+    // colour and depth live in our own FBO, so the config only needs to support GLES 2
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_DONT_CARE,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+            EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs < 1) {
+        MyLOGE("No suitable EGL config");
+        return false;
+    }
+
+    // same client version that MyGLSurfaceView asks for
+    const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        MyLOGE("Unable to create EGL context");
+        return false;
+    }
+
+    // there is no default framebuffer, render into a texture + depth renderbuffer
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &frameBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        MyLOGE("Offscreen framebuffer is not complete");
+        return false;
+    }
+
+    MyLOGI("Host GL: %s, %s", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    CheckGLError("HostGLContext::Init");
+    return true;
+}
+
+/**
+ * Release the framebuffer and the EGL context
+ */
+void HostGLContext::Destroy() {
+
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+    if (context != EGL_NO_CONTEXT) {
+        glDeleteFramebuffers(1, &frameBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteTextures(1, &colorTexture);
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+}
+
+/**
+ * Read back the current frame and write it as a binary PPM
+ */
+bool HostGLContext::SaveFramePPM(std::string fileName) {
+
+    std::vector<unsigned char> pixels(4 * width * height);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+    CheckGLError("HostGLContext::SaveFramePPM");
+
+    FILE *out = fopen(fileName.c_str(), "wb");
+    if (!out) {
+        MyLOGE("Cannot open %s", fileName.c_str());
+        return false;
+    }
+    fprintf(out, "P6\n%d %d\n255\n", width, height);
+
+    // GL's origin is bottom-left, PPM's is top-left
+    for (int row = height - 1; row >= 0; --row) {
+        const unsigned char *rowPixels = &pixels[4 * width * row];
+        for (int col = 0; col < width; ++col) {
+            fwrite(&rowPixels[4 * col], 3, 1, out);
+        }
+    }
+    fclose(out);
+    return true;
+}
+
+bool InitBenchmarkGLContext(int width, int height) {
+
+    static HostGLContext glContext;
+    static int isInitialized = -1;
+    if (isInitialized < 0) {
+        isInitialized = glContext.Init(width, height) ? 1 : 0;
+        if (isInitialized) {
+            MyGLInits();
+            GetShaderVariants().Reset();
+            glViewport(0, 0, width, height);
+        }
+    }
+    return isInitialized == 1;
+}
@@ -0,0 +1,48 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef HOST_GL_CONTEXT_H
+#define HOST_GL_CONTEXT_H
+
+#include <EGL/egl.h>
+#include <string>
+#include "myGLFunctions.h"
+
+// Offscreen GLES 2 context for the host build
+// uses a surfaceless EGL display (Mesa llvmpipe) and renders into an FBO
+class HostGLContext {
+public:
+    HostGLContext();
+    ~HostGLContext();
+
+    bool    Init(int width, int height);
+    void    Destroy();
+    bool    SaveFramePPM(std::string fileName);
+    int     GetWidth() const { return width; }
+    int     GetHeight() const { return height; }
+
+private:
+    EGLDisplay  display;
+    EGLContext  context;
+    GLuint      frameBuffer, colorTexture, depthBuffer;
+    int         width, height;
+};
+
+// one context for every benchmark that draws, created by the first call together with the
+// shader variants, which stay compiled in it. False if there is no GLES 2
+bool InitBenchmarkGLContext(int width, int height);
+
+#endif //HOST_GL_CONTEXT_H
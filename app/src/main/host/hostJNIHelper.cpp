@@ -0,0 +1,222 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Host implementation of MyJNIHelper: "assets" are read from a directory instead of the APK
+
+#include "myJNIHelper.h"
+#include "misc.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MyJNIHelper::MyJNIHelper(std::string pathToAssetDir, std::string pathToInternalDir) {
+
+    hostAssetPath = pathToAssetDir;
+    apkInternalPath = pathToInternalDir;
+
+    //mutex for thread safety
+    pthread_mutex_init(&threadMutex, NULL );
+}
+
+MyJNIHelper::~MyJNIHelper()
+{
+    pthread_mutex_destroy( &threadMutex);
+}
+
+/**
+ * Copy a file from the asset directory to the internal directory, and return the new path
+ */
+bool MyJNIHelper::ExtractAssetReturnFilename(std::string assetName, std::string & filename,
+                                             bool checkIfFileIsAvailable) {
+
+    // construct the filename in internal storage by concatenating with path to internal storage
+    filename = apkInternalPath + "/" + GetFileName(assetName);
+
+    // check if the file was previously extracted and is available in internal dir
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file) {
+        fclose(file);
+        if (checkIfFileIsAvailable) {
+            MyLOGI("Found extracted file in assets: %s", filename.c_str());
+            return true;
+        }
+    }
+
+    // under the lock the loose assets are extracted with, two threads may extract one file
+    const ArchiveEntry *entry = archive.FindEntry(assetName);
+    if (entry) {
+        pthread_mutex_lock( &threadMutex);
+        bool isExtracted = archive.ExtractEntry(entry, filename);
+        pthread_mutex_unlock( &threadMutex);
+        return isExtracted;
+    }
+    bool result = false;
+    pthread_mutex_lock( &threadMutex);
+
+    std::string assetPath = hostAssetPath + "/" + assetName;
+    FILE* asset = fopen(assetPath.c_str(), "rb");
+
+    char buf[BUFSIZ];
+    size_t nb_read = 0;
+    if (asset != NULL)
+    {
+        FILE* out = fopen(filename.c_str(), "wb");
+        if (out) {
+            while ((nb_read = fread(buf, 1, BUFSIZ, asset)) > 0)
+            {
+                fwrite(buf, nb_read, 1, out);
+            }
+            fclose(out);
+            result = true;
+            MyLOGI("Asset extracted: %s", filename.c_str());
+        } else {
+            MyLOGE("Cannot write %s", filename.c_str());
+        }
+        fclose(asset);
+    }
+    else
+    {
+        MyLOGE("Asset not found: %s", assetPath.c_str());
+    }
+
+    pthread_mutex_unlock( &threadMutex);
+    return result;
+}
+
+/**
+ * There is no APK to map on the host, the file is always read into the buffer's copy
+ */
+bool MyJNIHelper::ReadAsset(const std::string &assetName, MyAssetBuffer &buffer) {
+
+    const ArchiveEntry *entry = archive.FindEntry(assetName);
+    if (entry) {
+        return archive.ReadEntry(entry, buffer);
+    }
+    buffer.Release();
+
+    std::string assetPath = hostAssetPath + "/" + assetName;
+    FILE* asset = fopen(assetPath.c_str(), "rb");
+    if (asset == NULL) {
+        MyLOGE("Asset not found: %s", assetPath.c_str());
+        return false;
+    }
+    fseek(asset, 0, SEEK_END);
+    long assetLength = ftell(asset);
+    fseek(asset, 0, SEEK_SET);
+    bool result = assetLength >= 0;
+    if (result) {
+        buffer.copy.resize(assetLength);
+        result = fread(buffer.copy.data(), 1, assetLength, asset) == (size_t) assetLength;
+    }
+    fclose(asset);
+    buffer.data = buffer.copy.data();
+    buffer.size = result ? assetLength : 0;
+    return result;
+}
+
+/**
+ * Files in the host's asset directory are never compressed
+ */
+bool MyJNIHelper::OpenAssetFileDescriptor(const std::string &assetName, int &fd,
+                                          int64_t &start, size_t &length) {
+
+    std::string assetPath = hostAssetPath + "/" + assetName;
+    fd = open(assetPath.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    start = 0;
+    length = fileStat.st_size;
+    return true;
+}
+
+bool MyJNIHelper::GetAssetSize(const std::string &assetName, size_t &assetSize) {
+
+    const ArchiveEntry *entry = archive.FindEntry(assetName);
+    if (entry) {
+        assetSize = entry->size;
+        return true;
+    }
+    struct stat assetStat;
+    if (stat((hostAssetPath + "/" + assetName).c_str(), &assetStat) != 0 ||
+        !S_ISREG(assetStat.st_mode)) {
+        return false;
+    }
+    assetSize = assetStat.st_size;
+    return true;
+}
+
+/**
+ * Files only, like AAssetManager_openDir
+ */
+bool MyJNIHelper::ListAssets(const std::string &directory, std::vector<std::string> &fileNames) {
+
+    if (archive.IsOpen()) {
+        archive.ListDirectory(directory, fileNames);
+        return true;
+    }
+    std::string directoryPath = directory.empty() ? hostAssetPath : hostAssetPath + "/" + directory;
+    DIR *dir = opendir(directoryPath.c_str());
+    if (!dir) {
+        return false;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat fileStat;
+        if (entry->d_name[0] != '.' &&
+            stat((directoryPath + "/" + entry->d_name).c_str(), &fileStat) == 0 &&
+            S_ISREG(fileStat.st_mode)) {
+            fileNames.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return true;
+}
+
+/**
+ * An archive named by a relative path is looked for in the asset directory
+ */
+bool MyJNIHelper::OpenArchive(const std::string &archiveName) {
+
+    std::string archivePath = archiveName[0] == '/' ? archiveName :
+                              hostAssetPath + "/" + archiveName;
+    if (!archive.OpenFile(archivePath)) {
+        MyLOGE("Cannot open the asset archive %s", archivePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MyJNIHelper::ReadFileFromAssetsToBuffer(const char *filename,
+                                             std::vector<uint8_t> *bufferRef) {
+
+    MyAssetBuffer buffer;
+    if (!bufferRef || !ReadAsset(filename, buffer)) {
+        return false;
+    }
+    bufferRef->assign(buffer.GetData(), buffer.GetData() + buffer.GetSize());
+    return true;
+}
+
+void MyAssetBuffer::Release() {
+    data = NULL;
+    size = 0;
+}
@@ -0,0 +1,458 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Headless driver: loads a model from assets, renders N frames along a scripted camera path
+// and reports load/frame timings as JSON, optionally saving the last frame as PPM
+
+#include "hostGLContext.h"
+#include "modelAssimp.h"
+#include "myAllocTracker.h"
+#include "myGLRecorder.h"
+#include "myJobSystem.h"
+#include "myJNIHelper.h"
+#include "myShader.h"
+#include "myShaderVariants.h"
+#include <assimp/DefaultLogger.hpp>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <thread>
+
+// same globals that the JNI layer defines on Android
+ModelAssimp *gAssimpObject = NULL;
+MyJNIHelper *gHelperObject = NULL;
+
+typedef std::chrono::steady_clock HostClock;
+
+static double ElapsedMs(HostClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(HostClock::now() - start).count();
+}
+
+static void PrintUsage() {
+    fprintf(stderr,
+            "usage: ModelAssimpHost --model <id|obj> [--assets <dir>] [--internal <dir>] [--frames <n>]\n"
+            "                       [--width <w>] [--height <h>] [--image <out.ppm>]\n"
+            "                       [--timing <out.json>] [--gl <real|record|mock>]\n"
+            "                       [--gl-trace <commands.txt>] [--max-upload-mb <mb>]\n"
+            "                       [--max-draws <draws per frame>]\n"
+            "                       [--max-frame-allocs <allocations per frame>] [--picking 1]\n"
+            "                       [--profile <minimal|lit|full>] [--postprocess-threads <n>]\n"
+            "                       [--add-models <id;...>] [--cache-budget-mb <mb>]\n"
+            "                       [--reload 1] [--preload <id;...>]\n"
+            "                       [--supersede <id>] [--supersede-ms <ms>]\n"
+            "                       [--lighting <auto|unlit|vertex|pixel>]\n"
+            "                       [--archive <assets.pak>] [--import-steps 1]\n"
+            "models are named by their ID in the asset catalog, e.g. --model andy, or by their\n"
+            "OBJ relative to --assets, e.g. --model andy/andy.obj; the catalog has their MTL\n"
+            "and textures\n"
+            "--archive reads the assets from an archive built by PackAssets, as the app reads\n"
+            "assets.pak when the APK has one; a relative path is taken from --assets\n"
+            "--gl record counts draws/state changes/uploads, --gl mock does the same without\n"
+            "a GPU; exceeding --max-upload-mb, --max-draws or --max-frame-allocs makes the run\n"
+            "exit with 2. --max-frame-allocs needs a build with MY_TRACK_ALLOCATIONS, use it\n"
+            "with --gl mock so that allocations made inside the GL driver are not counted; it\n"
+            "counts the render thread and leaves out the upload of a --preload, which\n"
+            "allocates in the frames that send up to PRELOAD_UPLOAD_BYTES_PER_FRAME of it.\n"
+            "--postprocess-threads 0 leaves normals, welding and cache ordering to Assimp\n"
+            "--add-models draws more models beside --model, --reload 1 switches back to --model\n"
+            "after the frames and reports the time, which the model cache makes a hit\n"
+            "--preload loads models in the background during the frames, then switches to each\n"
+            "of them and reports the switch times and the preload hit rate\n"
+            "--supersede starts loading a model and requests another one --supersede-ms later\n"
+            "(default 5), the way a second button press does, and reports loadCancel\n"
+            "--lighting fixes the lighting tier, auto (default) scales it by frame time\n"
+            "--import-steps 1 times every post-process step of the loads; Assimp logs them at\n"
+            "debug level, which slows the loads, so loadMs is not comparable with it\n");
+}
+
+/**
+ * Parts of an option, e.g. the models of --add-models; an empty option has none
+ */
+static std::vector<std::string> SplitOption(const std::string &option, char separator) {
+
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    while (!option.empty() && begin <= option.size()) {
+        size_t end = option.find(separator, begin);
+        if (end == std::string::npos) {
+            end = option.size();
+        }
+        parts.push_back(option.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return parts;
+}
+
+/**
+ * Deterministic camera path: spin around the vertical axis and slowly breathe in/out,
+ * queued as pixel-space gestures the same way the touch handlers do
+ */
+static void ApplyCameraPath(int frame, int numberOfFrames, int width, int height) {
+
+    // one full turn of the one-finger-drag rotation over the run, dragging through the center
+    GestureEvent scroll = {GESTURE_SCROLL, 2.f * width / numberOfFrames, 0.f,
+                           width / 2.f, height / 2.f, GetMonotonicTimeNs()};
+    gAssimpObject->PushGesture(scroll);
+
+    float phase = 2.f * (float) M_PI * frame / numberOfFrames;
+    GestureEvent scale = {GESTURE_SCALE, 1.f + 0.01f * sinf(phase), 0.f, 0.f, 0.f,
+                          GetMonotonicTimeNs()};
+    gAssimpObject->PushGesture(scale);
+}
+
+int main(int argc, char **argv) {
+
+    std::map<std::string, std::string> options;
+    options["--assets"]   = MY_HOST_ASSET_DIR;
+    options["--internal"] = "/tmp/ModelAssimpHost";
+    options["--frames"]   = "100";
+    options["--width"]    = "640";
+    options["--height"]   = "480";
+    options["--gl"]       = "real";
+    options["--profile"]  = GetImportProfileName(DEFAULT_IMPORT_PROFILE);
+    options["--lighting"] = "auto";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string key = argv[i];
+        if (key.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        options[key] = argv[++i];
+    }
+    if (options["--model"].empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    int numberOfFrames = std::max(1, atoi(options["--frames"].c_str()));
+    int width  = atoi(options["--width"].c_str());
+    int height = atoi(options["--height"].c_str());
+
+    std::string glMode = options["--gl"];
+    if (glMode == "real" && !options["--gl-trace"].empty()) {
+        glMode = "record";
+    }
+    bool useGPU = (glMode != "mock");
+    bool useRecorder = (glMode != "real");
+
+    ImportProfile importProfile;
+    if (!GetImportProfileByName(options["--profile"], importProfile)) {
+        PrintUsage();
+        return 1;
+    }
+    LightingTier lightingTier = LIGHTING_PER_PIXEL;
+    bool isLightingAutomatic = (options["--lighting"] == "auto");
+    if (!isLightingAutomatic && !GetLightingTierByName(options["--lighting"], lightingTier)) {
+        PrintUsage();
+        return 1;
+    }
+
+#ifndef MY_TRACK_ALLOCATIONS
+    if (!options["--max-frame-allocs"].empty()) {
+        MyLOGE("--max-frame-allocs needs a build with -DMY_TRACK_ALLOCATIONS=ON");
+        return 1;
+    }
+#endif
+
+    mkdir(options["--internal"].c_str(), 0755);
+    gHelperObject = new MyJNIHelper(options["--assets"], options["--internal"]);
+    if (!options["--archive"].empty() && !gHelperObject->OpenArchive(options["--archive"])) {
+        return 1;
+    }
+    gAssimpObject = new ModelAssimp();
+    gAssimpObject->SetKeepPickingData(options["--picking"] == "1");
+    // the step timer listens to Assimp's logger, which is verbose while it does
+    bool isMeasuringImportSteps = (options["--import-steps"] == "1");
+    if (isMeasuringImportSteps) {
+        Assimp::DefaultLogger::create("", Assimp::Logger::NORMAL, 0);
+        gAssimpObject->SetMeasureImportSteps(true);
+    }
+    if (!isLightingAutomatic) {
+        gAssimpObject->SetLightingTier(lightingTier);
+    }
+    if (!options["--postprocess-threads"].empty()) {
+        gAssimpObject->SetPostProcessThreads(atoi(options["--postprocess-threads"].c_str()));
+    }
+    if (!options["--cache-budget-mb"].empty()) {
+        gAssimpObject->SetModelCacheBudgetBytes(
+                (size_t) (atof(options["--cache-budget-mb"].c_str()) * (1 << 20)));
+    }
+
+    HostGLContext glContext;
+    if (useGPU && !glContext.Init(width, height)) {
+        return 1;
+    }
+
+    // install after the context so that its FBO setup is not counted
+    MyGLRecorder glRecorder;
+    if (useRecorder) {
+        glRecorder.Install(useGPU, !options["--gl-trace"].empty());
+    }
+
+    // same sequence as MyGLRenderer: onSurfaceCreated, onSurfaceChanged, then frames
+    HostClock::time_point start = HostClock::now();
+    gAssimpObject->PerformGLInits();
+    double initMs = ElapsedMs(start);
+
+    start = HostClock::now();
+    gAssimpObject->ResetModel(options["--model"], importProfile);
+    glFinish();
+    double loadMs = ElapsedMs(start);
+
+    // further models in a row to the right of the first, one model width apart
+    std::vector<std::string> addedModels = SplitOption(options["--add-models"], ';');
+    for (unsigned int i = 0; i < addedModels.size(); ++i) {
+        int modelIndex = gAssimpObject->AddModel(addedModels[i], importProfile);
+        if (modelIndex < 0) {
+            MyLOGE("Cannot load %s", addedModels[i].c_str());
+            return 1;
+        }
+        gAssimpObject->SetModelTransform(modelIndex, glm::translate(glm::mat4(1.0f),
+                                                                    glm::vec3(1.5f * (i + 1), 0, 0)));
+    }
+
+    ModelMemoryStats memoryStats = gAssimpObject->GetModelMemoryStats();
+    ModelReadStats readStats = gAssimpObject->GetModelReadStats();
+    gAssimpObject->SetViewport(width, height);
+
+    // what AssimpActivity does after showing a model: queue the ones its buttons lead to
+    std::vector<std::string> preloadModels = SplitOption(options["--preload"], ';');
+    gAssimpObject->PreloadModels(preloadModels, importProfile);
+
+    std::vector<double> frameMs(numberOfFrames);
+    std::vector<unsigned long> frameAllocations(numberOfFrames, 0);
+    for (int frame = 0; frame < numberOfFrames; ++frame) {
+        ApplyCameraPath(frame, numberOfFrames, width, height);
+        glRecorder.BeginFrame();
+#ifdef MY_TRACK_ALLOCATIONS
+        // the GL thread's only, jobs allocate on workers; a preload's upload is left out
+        MyAllocCounts allocationsBefore = GetThreadAllocCounts();
+        MyAllocCounts uploadBefore = GetScopeAllocCounts("MyModelPreloader::Update");
+#endif
+        start = HostClock::now();
+        gAssimpObject->Render();
+        glFinish();
+        frameMs[frame] = ElapsedMs(start);
+#ifdef MY_TRACK_ALLOCATIONS
+        frameAllocations[frame] = GetThreadAllocCounts().allocations -
+                                  allocationsBefore.allocations -
+                                  (GetScopeAllocCounts("MyModelPreloader::Update").allocations -
+                                   uploadBefore.allocations);
+#endif
+        glRecorder.EndFrame();
+    }
+
+    if (useGPU && !options["--image"].empty()) {
+        glContext.SaveFramePPM(options["--image"]);
+    }
+    if (!options["--gl-trace"].empty()) {
+        glRecorder.SaveCommandStream(options["--gl-trace"]);
+    }
+
+    // what pressing the model's button again costs
+    double reloadMs = -1;
+    if (options["--reload"] == "1") {
+        start = HostClock::now();
+        gAssimpObject->ResetModel(options["--model"], importProfile);
+        glFinish();
+        reloadMs = ElapsedMs(start);
+    }
+
+    std::vector<double> preloadSwitchMs;
+    for (unsigned int i = 0; i < preloadModels.size(); ++i) {
+        start = HostClock::now();
+        gAssimpObject->ResetModel(preloadModels[i], importProfile);
+        glFinish();
+        preloadSwitchMs.push_back(ElapsedMs(start));
+    }
+
+    // a model picked and then replaced by another pick while it loads
+    if (!options["--supersede"].empty()) {
+        double supersedeMs = options["--supersede-ms"].empty() ? 5 :
+                             atof(options["--supersede-ms"].c_str());
+        unsigned int modelRequest = gAssimpObject->RequestModel();
+        std::thread nextPick([supersedeMs]() {
+            std::this_thread::sleep_for(std::chrono::microseconds((long long) (supersedeMs * 1000)));
+            gAssimpObject->RequestModel();
+        });
+        gAssimpObject->ResetModel(options["--supersede"], importProfile, modelRequest);
+        nextPick.join();
+    }
+
+    std::vector<double> sortedMs(frameMs);
+    std::sort(sortedMs.begin(), sortedMs.end());
+    double totalMs = 0;
+    for (unsigned int i = 0; i < frameMs.size(); ++i) {
+        totalMs += frameMs[i];
+    }
+
+    FILE *out = stdout;
+    if (!options["--timing"].empty()) {
+        out = fopen(options["--timing"].c_str(), "w");
+        if (!out) {
+            MyLOGE("Cannot open %s", options["--timing"].c_str());
+            return 1;
+        }
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"model\": \"%s\",\n", options["--model"].c_str());
+    fprintf(out, "  \"renderer\": \"%s\",\n", (const char *) glGetString(GL_RENDERER));
+    fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", width, height);
+    fprintf(out, "  \"glInitMs\": %.3f,\n", initMs);
+    fprintf(out, "  \"loadMs\": %.3f,\n", loadMs);
+    fprintf(out, "  \"import\": {\"profile\": \"%s\", \"stepsMs\": {",
+            GetImportProfileName(importProfile));
+    const std::vector<ImportStepTime> &stepTimes = gAssimpObject->GetImportStepTimes();
+    for (unsigned int i = 0; i < stepTimes.size(); ++i) {
+        fprintf(out, "%s\"%s\": %.3f", i ? ", " : "", stepTimes[i].name.c_str(), stepTimes[i].ms);
+    }
+    fprintf(out, "}},\n");
+    fprintf(out, "  \"memory\": {\"cpuBytes\": %zu, \"gpuBufferBytes\": %zu, "
+                 "\"gpuTextureBytes\": %zu},\n", memoryStats.cpuBytes, memoryStats.gpuBufferBytes,
+            memoryStats.gpuTextureBytes);
+    fprintf(out, "  \"read\": {\"modelBytes\": %zu, \"meshCacheBytes\": %zu, "
+                 "\"textureBytes\": %zu, \"textures\": %u, \"texturesSkipped\": %u},\n",
+            readStats.modelBytes, readStats.meshCacheBytes, readStats.textureBytes,
+            readStats.texturesRead, readStats.texturesSkipped);
+    const MyAssetCatalog &assetCatalog = gAssimpObject->GetAssetCatalog();
+    fprintf(out, "  \"catalog\": {\"cooked\": %s, \"models\": %zu},\n",
+            assetCatalog.IsCooked() ? "true" : "false", assetCatalog.GetModels().size());
+    const MyAssetArchive &assetArchive = gHelperObject->GetArchive();
+    if (assetArchive.IsOpen()) {
+        fprintf(out, "  \"archive\": {\"entries\": %u},\n", assetArchive.GetEntryCount());
+    }
+    ModelCacheStats cacheStats = gAssimpObject->GetModelCacheStats();
+    fprintf(out, "  \"modelCache\": {\"models\": %u, \"residentBytes\": %zu, "
+                 "\"budgetBytes\": %zu, \"hits\": %lu, \"misses\": %lu, \"evictions\": %lu},\n",
+            cacheStats.residentModels, cacheStats.residentBytes, cacheStats.budgetBytes,
+            cacheStats.hits, cacheStats.misses, cacheStats.evictions);
+    if (reloadMs >= 0) {
+        fprintf(out, "  \"reloadMs\": %.3f,\n", reloadMs);
+    }
+    if (!preloadModels.empty()) {
+        PreloadStats preloadStats = gAssimpObject->GetPreloadStats();
+        fprintf(out, "  \"preload\": {\"requested\": %lu, \"prepared\": %lu, \"uploaded\": %lu, "
+                     "\"cancelled\": %lu, \"hits\": %lu, \"misses\": %lu, \"hitRate\": %.3f, "
+                     "\"switchMs\": [", preloadStats.requested, preloadStats.prepared,
+                preloadStats.uploaded, preloadStats.cancelled, preloadStats.hits,
+                preloadStats.misses, preloadStats.hitRate);
+        for (unsigned int i = 0; i < preloadSwitchMs.size(); ++i) {
+            fprintf(out, "%s%.3f", i ? ", " : "", preloadSwitchMs[i]);
+        }
+        fprintf(out, "]},\n");
+    }
+    if (!options["--supersede"].empty()) {
+        ModelLoadCancelStats cancelStats = gAssimpObject->GetModelLoadCancelStats();
+        fprintf(out, "  \"loadCancel\": {\"requests\": %lu, \"dropped\": %lu, \"cancelled\": %lu, "
+                     "\"wastedMs\": %.3f, \"maxCancelMs\": %.3f},\n", cancelStats.requests,
+                cancelStats.dropped, cancelStats.cancelled, cancelStats.wastedMs,
+                cancelStats.maxCancelMs);
+    }
+    ProgramCacheStats programStats = GetProgramCacheStats();
+    fprintf(out, "  \"programCache\": {\"hits\": %lu, \"misses\": %lu, \"rejected\": %lu, "
+                 "\"loadMs\": %.3f, \"compileMs\": %.3f, \"savedMs\": %.3f},\n",
+            programStats.hits, programStats.misses, programStats.rejected, programStats.loadMs,
+            programStats.compileMs, programStats.savedMs);
+    ShaderVariantStats variantStats = GetShaderVariants().GetStats();
+    fprintf(out, "  \"shaderVariants\": {\"precompiled\": %u, \"finishedInUpdate\": %u, "
+                 "\"waited\": %u, \"compiledOnUse\": %u, \"waitMs\": %.3f},\n",
+            variantStats.precompiled, variantStats.finishedInUpdate, variantStats.waited,
+            variantStats.compiledOnUse, variantStats.waitMs);
+    LightingScalerStats lightingStats = gAssimpObject->GetLightingStats();
+    fprintf(out, "  \"lighting\": {\"mode\": \"%s\", \"tier\": \"%s\", \"stepsDown\": %lu, "
+                 "\"stepsUp\": %lu, \"meanFrameMs\": %.3f},\n", options["--lighting"].c_str(),
+            GetLightingTierName(lightingStats.tier), lightingStats.stepsDown, lightingStats.stepsUp,
+            lightingStats.meanFrameMs);
+    std::vector<MyJobWorkerStats> workerStats = GetJobSystem().GetWorkerStats();
+    fprintf(out, "  \"jobWorkers\": [");
+    for (unsigned int i = 0; i < workerStats.size(); ++i) {
+        fprintf(out, "%s{\"jobsRun\": %lu, \"jobsStolen\": %lu, \"busyMs\": %.3f, "
+                     "\"utilization\": %.4f}", i ? ", " : "", workerStats[i].jobsRun,
+                workerStats[i].jobsStolen, workerStats[i].busyMs, workerStats[i].utilization);
+    }
+    fprintf(out, "],\n");
+    GestureLatencyStats latencyStats = gAssimpObject->GetGestureLatencyStats();
+    fprintf(out, "  \"gestureLatencyMs\": {\"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, "
+                 "\"max\": %.3f, \"applied\": %lu, \"coalesced\": %lu, \"dropped\": %lu},\n",
+            latencyStats.meanMs, latencyStats.p50Ms, latencyStats.p95Ms, latencyStats.maxMs,
+            latencyStats.eventsApplied, latencyStats.eventsCoalesced, latencyStats.eventsDropped);
+    fprintf(out, "  \"frames\": %d,\n", numberOfFrames);
+    fprintf(out, "  \"frameMs\": {\"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, "
+                 "\"p95\": %.3f, \"max\": %.3f}",
+            totalMs / numberOfFrames, sortedMs.front(), sortedMs[numberOfFrames / 2],
+            sortedMs[(numberOfFrames * 95) / 100], sortedMs.back());
+    if (useRecorder) {
+        fprintf(out, ",\n  \"gl\": ");
+        glRecorder.PrintSummary(out);
+    }
+#ifdef MY_TRACK_ALLOCATIONS
+    fprintf(out, ",\n  \"maxFrameAllocs\": %lu",
+            *std::max_element(frameAllocations.begin(), frameAllocations.end()));
+    fprintf(out, ",\n  \"allocScopes\": ");
+    PrintAllocScopes(out);
+#endif
+    fprintf(out, "\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    // budgets: fail the run if the model uploads or draws more than allowed
+    int exitCode = 0;
+    if (useRecorder) {
+        const MyGLRecorderStats &glStats = glRecorder.GetStats();
+        double uploadMB = (glStats.bufferBytesUploaded + glStats.textureBytesUploaded) / 1048576.;
+        if (!options["--max-upload-mb"].empty() &&
+            uploadMB > atof(options["--max-upload-mb"].c_str())) {
+            MyLOGE("Uploaded %.2f MB, budget is %s MB", uploadMB, options["--max-upload-mb"].c_str());
+            exitCode = 2;
+        }
+        for (unsigned int i = 0; i < glStats.frames.size(); ++i) {
+            if (!options["--max-draws"].empty() &&
+                glStats.frames[i].drawCalls > strtoul(options["--max-draws"].c_str(), NULL, 10)) {
+                MyLOGE("Frame %u issued %lu draws, budget is %s", i, glStats.frames[i].drawCalls,
+                       options["--max-draws"].c_str());
+                exitCode = 2;
+                break;
+            }
+        }
+        glRecorder.Uninstall();
+    }
+    if (!options["--max-frame-allocs"].empty()) {
+        unsigned long allowedAllocations = strtoul(options["--max-frame-allocs"].c_str(), NULL, 10);
+        for (int frame = 0; frame < numberOfFrames; ++frame) {
+            if (frameAllocations[frame] > allowedAllocations) {
+                MyLOGE("Frame %d made %lu allocations, budget is %lu", frame,
+                       frameAllocations[frame], allowedAllocations);
+                exitCode = 2;
+                break;
+            }
+        }
+    }
+
+    delete gAssimpObject;
+    gAssimpObject = NULL;
+    glContext.Destroy();
+    delete gHelperObject;
+    gHelperObject = NULL;
+    if (isMeasuringImportSteps) {
+        Assimp::DefaultLogger::kill();
+    }
+    return exitCode;
+}
@@ -0,0 +1,193 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of the asset archive, over a PackAssets archive of the assets:
+//   every asset reads the same from the archive as loose, stored entries are aligned and LZ4
+//   entries decompress to their hash, and directories list the same
+//   a file extracted from the archive is never seen partly written, also while threads extract
+//   it again at once
+//   a truncated archive does not open
+
+#include "hostTest.h"
+#include "myAssetArchive.h"
+#include "myJNIHelper.h"
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+
+#define ARCHIVE_TEST_DIR    "/tmp/ModelAssimpTest"
+#define ARCHIVE_TEST_PATH   ARCHIVE_TEST_DIR "/" MY_ASSET_ARCHIVE
+
+MyJNIHelper *gHelperObject = NULL;
+
+static uint64_t HashAsset(const uint8_t *bytes, size_t size) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool ReadFile(const std::string &path, std::vector<uint8_t> &data) {
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    data.clear();
+    uint8_t buffer[BUFSIZ];
+    size_t bytesRead;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + bytesRead);
+    }
+    fclose(file);
+    return true;
+}
+
+static void CheckEntries(MyJNIHelper &packedHelper, MyJNIHelper &looseHelper) {
+
+    const MyAssetArchive &archive = packedHelper.GetArchive();
+    MyAssetBuffer packedBuffer, looseBuffer;
+    unsigned int lz4Entries = 0;
+    for (unsigned int e = 0; e < archive.GetEntryCount(); ++e) {
+        const ArchiveEntry *entry = archive.GetEntry(e);
+        std::string assetName = archive.GetEntryName(entry);
+        if (!MY_CHECK(packedHelper.ReadAsset(assetName, packedBuffer) &&
+                      looseHelper.ReadAsset(assetName, looseBuffer) &&
+                      packedBuffer.GetSize() == entry->size &&
+                      looseBuffer.GetSize() == entry->size &&
+                      memcmp(packedBuffer.GetData(), looseBuffer.GetData(), entry->size) == 0 &&
+                      HashAsset(packedBuffer.GetData(), entry->size) == entry->hash)) {
+            MyLOGE("%s reads differently from the archive", assetName.c_str());
+        }
+        if (entry->compression == ARCHIVE_STORE) {
+            MY_CHECK(entry->offset % ARCHIVE_ALIGNMENT == 0 && archive.GetEntryView(entry));
+        } else {
+            lz4Entries++;
+        }
+    }
+    MY_CHECK(archive.GetEntryCount() > 0 && lz4Entries > 0);
+
+    const char *directories[] = {"", "andy", "wonder", "shaders"};
+    for (unsigned int d = 0; d < sizeof(directories) / sizeof(directories[0]); ++d) {
+        std::vector<std::string> packedNames, looseNames;
+        MY_CHECK(packedHelper.ListAssets(directories[d], packedNames) &&
+                 looseHelper.ListAssets(directories[d], looseNames));
+        std::sort(packedNames.begin(), packedNames.end());
+        std::sort(looseNames.begin(), looseNames.end());
+        // the loose root also has the archive itself
+        looseNames.erase(std::remove(looseNames.begin(), looseNames.end(),
+                                     std::string(MY_ASSET_ARCHIVE)), looseNames.end());
+        if (!MY_CHECK(packedNames == looseNames)) {
+            MyLOGE("Directory \"%s\" lists differently from the archive", directories[d]);
+        }
+    }
+}
+
+static void CheckExtraction(MyJNIHelper &packedHelper, MyJNIHelper &looseHelper) {
+
+    const char *assetName = "andy/andy.obj";
+    MyAssetBuffer looseBuffer;
+    if (!MY_CHECK(looseHelper.ReadAsset(assetName, looseBuffer))) {
+        return;
+    }
+    std::vector<uint8_t> asset(looseBuffer.GetData(),
+                               looseBuffer.GetData() + looseBuffer.GetSize());
+
+    std::string extractedPath;
+    if (!MY_CHECK(packedHelper.ExtractAssetReturnFilename(assetName, extractedPath))) {
+        return;
+    }
+
+    // while threads extract the asset again, a reader never finds a partial file; the checks
+    // count failures without a lock, the threads only record theirs
+    std::atomic<unsigned int> extractingThreads(4);
+    unsigned int failedExtractions[4] = {0, 0, 0, 0};
+    unsigned int partialReads = 0, reads = 0;
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < 4; ++t) {
+        unsigned int *failed = &failedExtractions[t];
+        threads.push_back(std::thread([&packedHelper, &extractingThreads, assetName, failed]() {
+            for (unsigned int i = 0; i < 16; ++i) {
+                std::string path;
+                *failed += packedHelper.ExtractAssetReturnFilename(assetName, path) ? 0 : 1;
+            }
+            extractingThreads--;
+        }));
+    }
+    std::vector<uint8_t> extracted;
+    while (extractingThreads > 0) {
+        partialReads += ReadFile(extractedPath, extracted) && extracted == asset ? 0 : 1;
+        reads++;
+    }
+    for (unsigned int t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+        MY_CHECK(failedExtractions[t] == 0);
+    }
+    if (!MY_CHECK(partialReads == 0)) {
+        MyLOGE("%u of %u reads found a partial %s", partialReads, reads, extractedPath.c_str());
+    }
+    MY_CHECK(ReadFile(extractedPath, extracted) && extracted == asset);
+    struct stat tempStat;
+    MY_CHECK(stat((extractedPath + ".tmp").c_str(), &tempStat) != 0);
+}
+
+static void CheckTruncatedArchive() {
+
+    std::vector<uint8_t> archiveData;
+    if (!MY_CHECK(ReadFile(ARCHIVE_TEST_PATH, archiveData))) {
+        return;
+    }
+    std::string truncatedPath = ARCHIVE_TEST_DIR "/truncated.pak";
+    FILE *truncated = fopen(truncatedPath.c_str(), "wb");
+    if (!MY_CHECK(truncated)) {
+        return;
+    }
+    fwrite(archiveData.data(), 1, archiveData.size() / 2, truncated);
+    fclose(truncated);
+    MyAssetArchive archive;
+    MY_CHECK(!archive.OpenFile(truncatedPath));
+    remove(truncatedPath.c_str());
+}
+
+int main() {
+
+    mkdir(ARCHIVE_TEST_DIR, 0755);
+    MyAssetArchiveWriter writer;
+    if (!MY_CHECK(writer.AddDirectory(MY_HOST_ASSET_DIR, MY_ASSET_ARCHIVE) &&
+                  writer.Write(ARCHIVE_TEST_PATH))) {
+        return GetTestExitCode("ArchiveTest");
+    }
+
+    // reads only from the archive: its asset directory does not exist, so an asset missing
+    // from the archive fails instead of being read loose
+    MyJNIHelper packedHelper("/nonexistent", ARCHIVE_TEST_DIR);
+    MyJNIHelper looseHelper(MY_HOST_ASSET_DIR, ARCHIVE_TEST_DIR);
+    gHelperObject = &looseHelper;
+    if (MY_CHECK(packedHelper.OpenArchive(ARCHIVE_TEST_PATH))) {
+        CheckEntries(packedHelper, looseHelper);
+        CheckExtraction(packedHelper, looseHelper);
+    }
+    CheckTruncatedArchive();
+
+    gHelperObject = NULL;
+    return GetTestExitCode("ArchiveTest");
+}
@@ -0,0 +1,111 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of MyGLCamera:
+//   100k small rotations keep the rotation orthonormal
+//   gestures only mark the camera dirty; the published snapshot changes in UpdateSnapshot, and
+//   one UpdateSnapshot after a burst gives the same matrices as one after every gesture
+
+#include "hostTest.h"
+#include "myGLCamera.h"
+#include <algorithm>
+#include <math.h>
+
+/**
+ * Largest entry of |R^T R - I| for the upper 3x3 of a model matrix
+ */
+static float GetOrthonormalityError(const glm::mat4 &matrix) {
+    glm::mat3 rotation(matrix);
+    glm::mat3 product = glm::transpose(rotation) * rotation;
+    float error = 0;
+    for (int c = 0; c < 3; ++c) {
+        for (int r = 0; r < 3; ++r) {
+            error = std::max(error, fabsf(product[c][r] - (c == r ? 1.f : 0.f)));
+        }
+    }
+    return error;
+}
+
+static float GetLargestDifference(const glm::mat4 &first, const glm::mat4 &second) {
+    float difference = 0;
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            difference = std::max(difference, fabsf(first[c][r] - second[c][r]));
+        }
+    }
+    return difference;
+}
+
+static void ApplyGesture(MyGLCamera &camera, int i) {
+    switch (i % 4) {
+        case 0:
+        case 1:
+            camera.RotateModel(0.01f, 0.002f, 0.2f, -0.1f);
+            break;
+        case 2:
+            camera.ScaleModel(1.001f);
+            break;
+        default:
+            camera.TranslateModel(0.001f, -0.001f);
+            break;
+    }
+}
+
+static void CheckRotationDrift() {
+
+    MyGLCamera camera;
+    camera.SetAspectRatio(1.f);
+    for (int i = 0; i < 100000; ++i) {
+        camera.RotateModel(0.01f, 0.002f, 0.2f, -0.1f);
+    }
+    camera.UpdateSnapshot();
+    float error = GetOrthonormalityError(camera.GetSnapshot().modelMat);
+    if (!MY_CHECK(error < 1e-5f)) {
+        MyLOGE("rotation is %g from orthonormal", error);
+    }
+}
+
+static void CheckSnapshots() {
+
+    MyGLCamera lazyCamera, eagerCamera;
+    lazyCamera.SetAspectRatio(16.f / 9.f);
+    eagerCamera.SetAspectRatio(16.f / 9.f);
+    MY_CHECK(lazyCamera.UpdateSnapshot());
+    MY_CHECK(!lazyCamera.UpdateSnapshot());
+    eagerCamera.UpdateSnapshot();
+
+    glm::mat4 publishedMVP = lazyCamera.GetSnapshot().mvpMat;
+    for (int i = 0; i < 64; ++i) {
+        ApplyGesture(lazyCamera, i);
+        ApplyGesture(eagerCamera, i);
+        eagerCamera.UpdateSnapshot();
+    }
+    MY_CHECK(GetLargestDifference(lazyCamera.GetSnapshot().mvpMat, publishedMVP) == 0);
+    MY_CHECK(lazyCamera.UpdateSnapshot());
+    MY_CHECK(GetLargestDifference(lazyCamera.GetSnapshot().mvpMat, publishedMVP) > 0);
+    MY_CHECK(GetLargestDifference(lazyCamera.GetSnapshot().mvpMat,
+                                  eagerCamera.GetSnapshot().mvpMat) < 1e-5f);
+    MY_CHECK(GetLargestDifference(lazyCamera.GetSnapshot().modelMat,
+                                  eagerCamera.GetSnapshot().modelMat) < 1e-5f);
+}
+
+int main() {
+
+    CheckRotationDrift();
+    CheckSnapshots();
+    return GetTestExitCode("CameraTest");
+}
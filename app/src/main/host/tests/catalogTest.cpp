@@ -0,0 +1,115 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of the asset catalog:
+//   the cooked assets/catalog.txt is what CookAssetCatalog writes for the assets now, run
+//   CookAssetCatalog again if not
+//   FindModel only answers from the catalog, and LocateModel finds every cooked model by its ID
+//   and by its OBJ from the directory listing alone
+
+#include "hostTest.h"
+#include "myAssetCatalog.h"
+#include "myJNIHelper.h"
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+/**
+ * The directory and its subdirectories in the order CookAssetCatalog scans them
+ */
+static void ScanAssetTree(MyAssetCatalog &catalog, const std::string &directory) {
+
+    catalog.ScanDirectory(directory, true);
+
+    std::string fullDir = directory.empty() ? MY_HOST_ASSET_DIR :
+                          std::string(MY_HOST_ASSET_DIR) + "/" + directory;
+    DIR *dir = opendir(fullDir.c_str());
+    if (!dir) {
+        return;
+    }
+    std::vector<std::string> subDirs;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat fileStat;
+        if (entry->d_name[0] != '.' &&
+            stat((fullDir + "/" + entry->d_name).c_str(), &fileStat) == 0 &&
+            S_ISDIR(fileStat.st_mode)) {
+            subDirs.push_back(directory.empty() ? entry->d_name :
+                              directory + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(subDirs.begin(), subDirs.end());
+    for (unsigned int d = 0; d < subDirs.size(); ++d) {
+        ScanAssetTree(catalog, subDirs[d]);
+    }
+}
+
+static void CheckCookedCatalog(const MyAssetCatalog &cookedCatalog) {
+
+    MyAssetCatalog scannedCatalog;
+    ScanAssetTree(scannedCatalog, "");
+    std::string cooked = cookedCatalog.Serialize(), scanned = scannedCatalog.Serialize();
+    if (!MY_CHECK(cooked == scanned)) {
+        size_t difference = 0;
+        while (difference < cooked.size() && difference < scanned.size() &&
+               cooked[difference] == scanned[difference]) {
+            difference++;
+        }
+        size_t lineBegin = cooked.rfind('\n', difference) + 1;
+        MyLOGE("The cooked catalog differs from the assets at \"%s\", run CookAssetCatalog",
+               cooked.substr(lineBegin, cooked.find('\n', lineBegin) - lineBegin).c_str());
+    }
+}
+
+static void CheckLocateModel(const MyAssetCatalog &cookedCatalog) {
+
+    MyAssetCatalog emptyCatalog;
+    CatalogModel model;
+    MY_CHECK(!emptyCatalog.FindModel("andy", model));
+    MY_CHECK(!emptyCatalog.LocateModel("notAModel", model));
+
+    const std::vector<CatalogModel> &cookedModels = cookedCatalog.GetModels();
+    for (unsigned int m = 0; m < cookedModels.size(); ++m) {
+        const CatalogModel &cookedModel = cookedModels[m];
+        const std::string *names[] = {&cookedModel.modelId, &cookedModel.obj.assetName};
+        for (unsigned int n = 0; n < 2; ++n) {
+            if (!MY_CHECK(emptyCatalog.LocateModel(*names[n], model) &&
+                          model.modelId == cookedModel.modelId &&
+                          model.obj.assetName == cookedModel.obj.assetName &&
+                          model.obj.size == cookedModel.obj.size)) {
+                MyLOGE("LocateModel(%s)", names[n]->c_str());
+            }
+        }
+    }
+}
+
+int main() {
+
+    gHelperObject = new MyJNIHelper(MY_HOST_ASSET_DIR, "/tmp");
+
+    MyAssetCatalog cookedCatalog;
+    if (MY_CHECK(cookedCatalog.Load() && cookedCatalog.IsCooked())) {
+        CheckCookedCatalog(cookedCatalog);
+        CheckLocateModel(cookedCatalog);
+    }
+
+    delete gHelperObject;
+    return GetTestExitCode("CatalogTest");
+}
@@ -0,0 +1,287 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+
+// Checks of the GLB path:
+//   glb/googlepoly.glb, bundled in the assets and converted with WriteGLB from d/googlepoly.obj,
+//   has the meshes, triangles, nodes and materials of the OBJ's import, and loads from the
+//   assets and from an asset archive entry without a copy in internal storage
+//   andy and wonder, converted with WriteGLB, read back with every mesh and triangle
+//   on a GLES 2 context, each GLB loads with the meshes, instances, bounds and textures of its
+//   OBJ and draws the same frame, within GLB_PIXEL_TOLERANCE of the pixels covered
+// The frames are skipped when there is no GLES 2 context
+
+#include "assimpLoader.h"
+#include "glbWriter.h"
+#include "hostGLContext.h"
+#include "hostTest.h"
+#include "misc.h"
+#include "myAssetArchive.h"
+#include "myGLBFile.h"
+#include "myJNIHelper.h"
+#include "myModelPreloader.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GLB_TEST_DIR            "/tmp/ModelAssimpTest"
+#define GLB_BUNDLED_NAME        "glb/googlepoly.glb"
+#define GLB_BUNDLED_OBJ         "d/googlepoly.obj"
+#define GLB_FRAME_WIDTH         256
+#define GLB_FRAME_HEIGHT        256
+#define GLB_PIXEL_TOLERANCE     0.02f   // of the pixels covered, may differ between the frames
+
+MyJNIHelper *gHelperObject = NULL;
+
+struct GLBModel {
+    std::string objAsset;           // e.g. "andy/andy.obj"
+    std::string glbName;            // an asset name or a path
+};
+
+/**
+ * The OBJ as WriteGLB converts it, with the default import profile
+ */
+static const aiScene * ImportOBJ(Assimp::Importer &importer, const std::string &objAsset) {
+
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    return importer.ReadFile(std::string(MY_HOST_ASSET_DIR) + "/" + objAsset,
+                             GetImportProfileFlags(DEFAULT_IMPORT_PROFILE));
+}
+
+/**
+ * Nodes of the GLB written for the subtree, where a node with several meshes gets a child node
+ * for each mesh after the first
+ */
+static unsigned int CountGLBNodes(const aiNode *node) {
+
+    unsigned int nodeCount = 1 + (node->mNumMeshes > 1 ? node->mNumMeshes - 1 : 0);
+    for (unsigned int c = 0; c < node->mNumChildren; ++c) {
+        nodeCount += CountGLBNodes(node->mChildren[c]);
+    }
+    return nodeCount;
+}
+
+/**
+ * The GLB has a primitive with the triangles of each mesh of the scene
+ */
+static bool CheckPrimitives(const MyGLBFile &glbFile, const aiScene *scene) {
+
+    if (!MY_CHECK(glbFile.GetPrimitives().size() == scene->mNumMeshes)) {
+        return false;
+    }
+    bool hasTriangles = true;
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+        const GLBPrimitive &primitive = glbFile.GetPrimitives()[m];
+        int countAccessor = primitive.indices >= 0 ? primitive.indices : primitive.positions;
+        hasTriangles &= MY_CHECK(countAccessor >= 0 &&
+                                 glbFile.GetAccessors()[countAccessor].count ==
+                                 3 * scene->mMeshes[m]->mNumFaces);
+    }
+    return hasTriangles;
+}
+
+static bool IsExtracted(const std::string &glbName) {
+    struct stat fileStat;
+    return stat((gHelperObject->GetInternalPath() + "/" + GetFileName(glbName)).c_str(),
+                &fileStat) == 0;
+}
+
+/**
+ * Prepare a GLB the way the preloader does, which maps it and never copies it out
+ */
+static bool PrepareBundledGLB(const std::string &glbName, AssimpLoader &loader) {
+
+    ModelRequest glbRequest = {"glb", glbName, {}, DEFAULT_IMPORT_PROFILE, 0};
+    std::string glbPath;
+    if (!MY_CHECK(ExtractModelAssets(glbRequest, &loader, glbPath) && glbPath == glbName &&
+                  loader.PrepareModel(glbPath))) {
+        return false;
+    }
+    ModelReadStats readStats = loader.GetReadStats();
+    MY_CHECK(readStats.modelBytes > 0 && readStats.textureBytes > 0);
+    return MY_CHECK(!IsExtracted(glbName));
+}
+
+static void CheckBundledGLB() {
+
+    Assimp::Importer importer;
+    const aiScene *scene = ImportOBJ(importer, GLB_BUNDLED_OBJ);
+    if (!MY_CHECK(scene != NULL)) {
+        return;
+    }
+    MyGLBFile glbFile;
+    if (!MY_CHECK(glbFile.Open(std::string(MY_HOST_ASSET_DIR) + "/" + GLB_BUNDLED_NAME))) {
+        return;
+    }
+    CheckPrimitives(glbFile, scene);
+    MY_CHECK(glbFile.GetNodes().size() == CountGLBNodes(scene->mRootNode));
+    MY_CHECK(glbFile.GetMaterials().size() == scene->mNumMaterials);
+    MY_CHECK(glbFile.GetImages().size() == 1);
+
+    AssimpLoader loader;
+    PrepareBundledGLB(GLB_BUNDLED_NAME, loader);
+}
+
+/**
+ * A GLB packed into the asset archive is stored, and is mapped from there: its name is not
+ * in the loose assets. Run last, the helper keeps the archive open
+ */
+static void CheckArchivedGLB() {
+
+    std::vector<uint8_t> glbData;
+    if (!MY_CHECK(gHelperObject->ReadFileFromAssetsToBuffer(GLB_BUNDLED_NAME, &glbData))) {
+        return;
+    }
+    std::string archivedName = "archived/googlepoly.glb";
+    std::string archivePath = std::string(GLB_TEST_DIR) + "/glbTest.pak";
+    MyAssetArchiveWriter archiveWriter;
+    MY_CHECK(archiveWriter.AddEntry(archivedName, glbData,
+                                    GetDefaultArchiveCompression(archivedName)) ==
+             ARCHIVE_STORE);
+    if (!MY_CHECK(archiveWriter.Write(archivePath) &&
+                  gHelperObject->OpenArchive(archivePath))) {
+        return;
+    }
+    AssimpLoader loader;
+    if (PrepareBundledGLB(archivedName, loader)) {
+        MY_CHECK(loader.GetReadStats().modelBytes + loader.GetReadStats().textureBytes ==
+                 glbData.size());
+    }
+}
+
+/**
+ * Convert the model's OBJ and check that the GLB reads back with every mesh and triangle
+ */
+static bool ConvertModel(GLBModel &model) {
+
+    std::string glbName = model.objAsset;
+    std::replace(glbName.begin(), glbName.end(), '/', '_');
+    model.glbName = std::string(GLB_TEST_DIR) + "/" + glbName + ".glb";
+
+    Assimp::Importer importer;
+    const aiScene *scene = ImportOBJ(importer, model.objAsset);
+    if (!MY_CHECK(scene != NULL &&
+                  WriteGLB(scene, GetDirectoryName(std::string(MY_HOST_ASSET_DIR) + "/" +
+                                                   model.objAsset), model.glbName))) {
+        return false;
+    }
+    MyGLBFile glbFile;
+    return MY_CHECK(glbFile.Open(model.glbName)) && CheckPrimitives(glbFile, scene);
+}
+
+/**
+ * Draw the model from the front, filling most of the frame, and read the frame back
+ */
+static void DrawModel(AssimpLoader &loader, std::vector<unsigned char> &pixels) {
+
+    glm::vec3 boundsMin = loader.GetBoundsMin(), boundsMax = loader.GetBoundsMax();
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+    float radius = std::max(0.5f * glm::length(boundsMax - boundsMin), 1e-6f);
+    glm::mat4 mvpMat = glm::perspective(45.f * float(M_PI / 180), 1.f, 0.1f * radius,
+                                        10.f * radius) *
+                       glm::lookAt(center + glm::vec3(0, 0, 2.5f * radius), center,
+                                   glm::vec3(0, 1, 0));
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    loader.Render3DModel(&mvpMat);
+    pixels.resize(4 * GLB_FRAME_WIDTH * GLB_FRAME_HEIGHT);
+    glReadPixels(0, 0, GLB_FRAME_WIDTH, GLB_FRAME_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+}
+
+static unsigned int CountTexturedMaterials(const AssimpLoader &loader) {
+    unsigned int texturedMaterials = 0;
+    for (unsigned int m = 0; m < loader.GetMaterials().size(); ++m) {
+        texturedMaterials += loader.GetMaterials()[m].textureName != 0;
+    }
+    return texturedMaterials;
+}
+
+/**
+ * The GLB's model matches the OBJ's: meshes, instances, bounds, textures, and a frame in which
+ * at most GLB_PIXEL_TOLERANCE of the pixels covered by either differ noticeably
+ */
+static void CompareWithOBJ(const GLBModel &model) {
+
+    ModelRequest objRequest = {model.objAsset, model.objAsset, {}, DEFAULT_IMPORT_PROFILE, 0};
+    std::string objPath;
+    AssimpLoader objLoader, glbLoader;
+    if (!MY_CHECK(ExtractModelAssets(objRequest, &objLoader, objPath) &&
+                  objLoader.Load3DModel(objPath, objRequest.importProfile)) ||
+        !MY_CHECK(glbLoader.Load3DModel(model.glbName))) {
+        MyLOGE("Cannot load %s or %s", model.objAsset.c_str(), model.glbName.c_str());
+        return;
+    }
+    MY_CHECK(glbLoader.GetNumberOfMeshes() == objLoader.GetNumberOfMeshes());
+    MY_CHECK(glbLoader.GetSceneGraph().GetNumberOfInstances() ==
+             objLoader.GetSceneGraph().GetNumberOfInstances());
+    glm::vec3 minError = glm::abs(glbLoader.GetBoundsMin() - objLoader.GetBoundsMin());
+    glm::vec3 maxError = glm::abs(glbLoader.GetBoundsMax() - objLoader.GetBoundsMax());
+    glm::vec3 boundsError = glm::max(minError, maxError);
+    float extent = glm::length(objLoader.GetBoundsMax() - objLoader.GetBoundsMin());
+    MY_CHECK(std::max(boundsError.x, std::max(boundsError.y, boundsError.z)) <= 1e-4f * extent);
+    MY_CHECK(CountTexturedMaterials(glbLoader) == CountTexturedMaterials(objLoader));
+
+    std::vector<unsigned char> objPixels, glbPixels;
+    DrawModel(objLoader, objPixels);
+    DrawModel(glbLoader, glbPixels);
+    MY_CHECK(glGetError() == GL_NO_ERROR);
+    unsigned int coveredPixels = 0, differentPixels = 0;
+    for (size_t p = 0; p < objPixels.size(); p += 4) {
+        bool isCovered = false, isDifferent = false;
+        for (int c = 0; c < 3; ++c) {
+            isCovered |= objPixels[p + c] != 255 || glbPixels[p + c] != 255;
+            isDifferent |= abs(objPixels[p + c] - glbPixels[p + c]) > 8;
+        }
+        coveredPixels += isCovered;
+        differentPixels += isDifferent;
+    }
+    if (!MY_CHECK(coveredPixels > 0 &&
+                  differentPixels <= GLB_PIXEL_TOLERANCE * coveredPixels)) {
+        MyLOGE("%s: %u of %u covered pixels differ from the OBJ's", model.glbName.c_str(),
+               differentPixels, coveredPixels);
+    }
+}
+
+int main() {
+
+    mkdir(GLB_TEST_DIR, 0755);
+    gHelperObject = new MyJNIHelper(MY_HOST_ASSET_DIR, GLB_TEST_DIR);
+
+    CheckBundledGLB();
+    std::vector<GLBModel> models(3);
+    models[0].objAsset = GLB_BUNDLED_OBJ;
+    models[0].glbName = GLB_BUNDLED_NAME;
+    models[1].objAsset = "andy/andy.obj";
+    models[2].objAsset = "wonder/wonderwoman.obj";
+    bool isConverted = ConvertModel(models[1]) & ConvertModel(models[2]);
+
+    if (!InitBenchmarkGLContext(GLB_FRAME_WIDTH, GLB_FRAME_HEIGHT)) {
+        printf("GLBTest: no GLES 2 context, frames not compared\n");
+    } else if (isConverted) {
+        for (unsigned int m = 0; m < models.size(); ++m) {
+            CompareWithOBJ(models[m]);
+        }
+    }
+    CheckArchivedGLB();
+
+    delete gHelperObject;
+    return GetTestExitCode("GLBTest");
+}
@@ -0,0 +1,58 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks for the host tests that ctest runs. MY_CHECK logs a condition that does not hold and
+// counts it, so that a test goes on to report every failure; main returns GetTestExitCode,
+// which is 1 after any failed check
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include "myLogger.h"
+#include <stdio.h>
+
+inline unsigned int & GetFailedCheckCount() {
+    static unsigned int failedChecks = 0;
+    return failedChecks;
+}
+
+inline bool CheckCondition(bool condition, const char *conditionText, const char *fileName,
+                           int line) {
+    if (!condition) {
+        MyLOGE("%s:%d: check failed: %s", fileName, line, conditionText);
+        GetFailedCheckCount()++;
+    }
+    return condition;
+}
+
+// exit code of a test that cannot run here, e.g. without a GLES 2 context; ctest reports it as
+// skipped rather than passed
+#define HOST_TEST_SKIPPED   77
+
+// true if the condition holds, so that a test can stop at a check later ones depend on
+#define MY_CHECK(condition) CheckCondition((condition), #condition, __FILE__, __LINE__)
+
+inline int GetTestExitCode(const char *testName) {
+    if (GetFailedCheckCount() > 0) {
+        MyLOGE("%s: %u checks failed", testName, GetFailedCheckCount());
+        return 1;
+    }
+    printf("%s: all checks passed\n", testName);
+    return 0;
+}
+
+#endif //HOST_TEST_H
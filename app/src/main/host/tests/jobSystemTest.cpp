@@ -0,0 +1,256 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of MyJobSystem, on a pool of its own:
+//   ParallelFor runs every index exactly once, for any grain size and thread limit, and on no
+//   more threads than the limit; nested ParallelFor calls cover their ranges too
+//   Wait returns once the job has run, a job starts after all of its dependencies, and a thread
+//   in Wait with nothing to run sleeps instead of spinning
+//   Wait with a cancel token returns within milliseconds of Cancel while the job runs on
+//   jobs for the GL thread run only in RunGLThreadJobs, on the thread that calls it
+//   a worker in Wait leaves low-priority jobs alone and only runs them once it is idle
+
+#include "hostTest.h"
+#include "myJobSystem.h"
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <sys/resource.h>
+
+static void CheckParallelForCoverage(MyJobSystem &jobSystem) {
+
+    const unsigned int counts[] = {0, 1, 63, 64, 65, 10007};
+    const unsigned int grainSizes[] = {0, 1, 7, 64, 1000};
+    const unsigned int threadLimits[] = {0, 1, 2};
+    for (unsigned int count : counts) {
+        for (unsigned int grainSize : grainSizes) {
+            for (unsigned int maxThreads : threadLimits) {
+                std::unique_ptr<std::atomic<unsigned int>[]> hits(
+                        new std::atomic<unsigned int>[count + 1]);
+                for (unsigned int i = 0; i <= count; ++i) {
+                    hits[i] = 0;
+                }
+                std::mutex threadsMutex;
+                std::set<std::thread::id> threads;
+                std::atomic<bool> isRangeValid(true);
+                jobSystem.ParallelFor(count, grainSize, [&](unsigned int begin, unsigned int end) {
+                    if (begin > end || end > count) {
+                        isRangeValid = false;
+                        return;
+                    }
+                    for (unsigned int i = begin; i < end; ++i) {
+                        hits[i]++;
+                    }
+                    std::lock_guard<std::mutex> lock(threadsMutex);
+                    threads.insert(std::this_thread::get_id());
+                }, maxThreads);
+
+                MY_CHECK(isRangeValid);
+                unsigned int missed = 0;
+                for (unsigned int i = 0; i < count; ++i) {
+                    missed += hits[i] != 1;
+                }
+                if (!MY_CHECK(missed == 0)) {
+                    MyLOGE("ParallelFor(%u, %u, %u) ran %u indices other than once", count,
+                           grainSize, maxThreads, missed);
+                }
+                MY_CHECK(maxThreads == 0 || threads.size() <= maxThreads);
+            }
+        }
+    }
+}
+
+static void CheckNestedParallelFor(MyJobSystem &jobSystem) {
+
+    const unsigned int outerCount = 64, innerCount = 1000;
+    std::unique_ptr<std::atomic<unsigned int>[]> hits(
+            new std::atomic<unsigned int>[outerCount * innerCount]);
+    for (unsigned int i = 0; i < outerCount * innerCount; ++i) {
+        hits[i] = 0;
+    }
+    jobSystem.ParallelFor(outerCount, 1, [&](unsigned int outerBegin, unsigned int outerEnd) {
+        for (unsigned int outer = outerBegin; outer < outerEnd; ++outer) {
+            jobSystem.ParallelFor(innerCount, 16, [&](unsigned int begin, unsigned int end) {
+                for (unsigned int inner = begin; inner < end; ++inner) {
+                    hits[outer * innerCount + inner]++;
+                }
+            });
+        }
+    });
+    unsigned int missed = 0;
+    for (unsigned int i = 0; i < outerCount * innerCount; ++i) {
+        missed += hits[i] != 1;
+    }
+    MY_CHECK(missed == 0);
+}
+
+/**
+ * Layers of jobs, each depending on every job of the layer above, the first layer also on a
+ * job that finished before they were submitted
+ */
+static void CheckDependencies(MyJobSystem &jobSystem) {
+
+    const unsigned int layers = 8, jobsPerLayer = 16;
+    std::unique_ptr<std::atomic<bool>[]> isRun(new std::atomic<bool>[layers * jobsPerLayer]);
+    std::atomic<unsigned int> earlyJobs(0);
+    MyJobHandle finishedJob = jobSystem.Submit([]() {});
+    jobSystem.Wait(finishedJob);
+
+    std::vector<MyJobHandle> above(1, finishedJob), jobs;
+    for (unsigned int layer = 0; layer < layers; ++layer) {
+        std::vector<MyJobHandle> layerJobs;
+        for (unsigned int j = 0; j < jobsPerLayer; ++j) {
+            unsigned int index = layer * jobsPerLayer + j;
+            isRun[index] = false;
+            layerJobs.push_back(jobSystem.Submit([&isRun, &earlyJobs, layer, index]() {
+                for (unsigned int i = 0; layer > 0 && i < jobsPerLayer; ++i) {
+                    earlyJobs += !isRun[(layer - 1) * jobsPerLayer + i];
+                }
+                isRun[index] = true;
+            }, above));
+        }
+        above = layerJobs;
+        jobs.insert(jobs.end(), layerJobs.begin(), layerJobs.end());
+    }
+    for (unsigned int i = 0; i < jobs.size(); ++i) {
+        jobSystem.Wait(jobs[i]);
+        MY_CHECK(jobSystem.IsDone(jobs[i]) && isRun[i]);
+    }
+    MY_CHECK(earlyJobs == 0);
+}
+
+static double GetThreadCpuMs() {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+/**
+ * Wait on a job that a worker runs for 200 ms: the waiting thread must not burn that time
+ */
+static void CheckWaitSleeps(MyJobSystem &jobSystem) {
+
+    std::atomic<bool> isStarted(false), isFinished(false);
+    MyJobHandle slowJob = jobSystem.Submit([&isStarted, &isFinished]() {
+        isStarted = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        isFinished = true;
+    });
+    while (!isStarted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double cpuMsBefore = GetThreadCpuMs();
+    jobSystem.Wait(slowJob);
+    double waitCpuMs = GetThreadCpuMs() - cpuMsBefore;
+    MY_CHECK(isFinished && jobSystem.IsDone(slowJob));
+    if (!MY_CHECK(waitCpuMs < 50)) {
+        MyLOGE("Wait used %.1f ms of CPU while the job ran for 200 ms", waitCpuMs);
+    }
+}
+
+/**
+ * Cancel 20 ms into a 200 ms job: the wait gives up long before the job is done
+ */
+static void CheckWaitCancelled(MyJobSystem &jobSystem) {
+
+    std::atomic<bool> isFinished(false);
+    MyJobHandle slowJob = jobSystem.Submit([&isFinished]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        isFinished = true;
+    });
+    MyCancelToken cancelToken;
+    std::thread canceller([&cancelToken]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        cancelToken.Cancel();
+    });
+    bool isDone = jobSystem.Wait(slowJob, &cancelToken);
+    double waitAfterCancelMs = cancelToken.GetMsSinceCancel();
+    canceller.join();
+    MY_CHECK(!isDone && !isFinished && cancelToken.IsCancelled());
+    if (!MY_CHECK(waitAfterCancelMs < 50)) {
+        MyLOGE("Wait returned %.1f ms after Cancel", waitAfterCancelMs);
+    }
+
+    MyCancelToken otherToken;
+    MY_CHECK(jobSystem.Wait(slowJob, &otherToken) && isFinished);
+    MY_CHECK(jobSystem.Wait(slowJob, &cancelToken));
+}
+
+static void CheckGLThreadJobs(MyJobSystem &jobSystem) {
+
+    std::atomic<bool> isWorkerJobRun(false), isGLJobRun(false);
+    std::thread::id glJobThread;
+    MyJobHandle workerJob = jobSystem.Submit([&isWorkerJobRun]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        isWorkerJobRun = true;
+    });
+    MyJobHandle glJob = jobSystem.SubmitToGLThread([&]() {
+        MY_CHECK(isWorkerJobRun);
+        glJobThread = std::this_thread::get_id();
+        isGLJobRun = true;
+    }, std::vector<MyJobHandle>(1, workerJob));
+
+    jobSystem.Wait(workerJob);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    MY_CHECK(!isGLJobRun && !jobSystem.IsDone(glJob));
+    jobSystem.RunGLThreadJobs();
+    MY_CHECK(isGLJobRun && jobSystem.IsDone(glJob));
+    MY_CHECK(glJobThread == std::this_thread::get_id());
+}
+
+/**
+ * The only worker submits a low-priority job and waits for a GL thread job: it must sleep
+ * instead of running the low-priority job, which would delay the frame by a whole preload
+ */
+static void CheckLowPriorityNotRunInWait() {
+
+    MyJobSystem jobSystem(1);
+    std::atomic<bool> isGLJobDone(false), isLowPriorityRunInWait(false);
+    std::atomic<bool> isLowPriorityRun(false);
+    MyJobHandle lowPriorityJob;
+    MyJobHandle workerJob = jobSystem.Submit([&]() {
+        lowPriorityJob = jobSystem.SubmitLowPriority([&]() {
+            isLowPriorityRunInWait = !isGLJobDone;
+            isLowPriorityRun = true;
+        });
+        MyJobHandle glJob = jobSystem.SubmitToGLThread([&isGLJobDone]() { isGLJobDone = true; });
+        jobSystem.Wait(glJob);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    while (!jobSystem.IsDone(workerJob)) {
+        jobSystem.RunGLThreadJobs();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    jobSystem.Wait(lowPriorityJob);
+    MY_CHECK(isLowPriorityRun);
+    MY_CHECK(!isLowPriorityRunInWait);
+}
+
+int main() {
+
+    CheckLowPriorityNotRunInWait();
+    MyJobSystem jobSystem(3);
+    CheckParallelForCoverage(jobSystem);
+    CheckNestedParallelFor(jobSystem);
+    CheckDependencies(jobSystem);
+    CheckWaitSleeps(jobSystem);
+    CheckWaitCancelled(jobSystem);
+    CheckGLThreadJobs(jobSystem);
+    return GetTestExitCode("JobSystemTest");
+}
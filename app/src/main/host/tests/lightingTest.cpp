@@ -0,0 +1,145 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of the lighting tiers, on a real GLES 2 context (Mesa llvmpipe on a Linux host):
+//   andy and wonder, imported with the full profile, the only one that computes tangents, draw
+//   a frame at every tier without GL errors, and wonder's normal maps are drawn at the pixel
+//   tier only
+//   MyLightingScaler steps down to unlit under slow frames and back up to pixel under fast ones
+// Skipped when there is no GLES 2 context
+
+#include "assimpLoader.h"
+#include "hostGLContext.h"
+#include "hostTest.h"
+#include "myJNIHelper.h"
+#include "myLightingScaler.h"
+#include "myModelPreloader.h"
+#include <math.h>
+#include <sys/stat.h>
+#include <vector>
+
+#define LIGHTING_FRAME_WIDTH    256
+#define LIGHTING_FRAME_HEIGHT   256
+
+MyJNIHelper *gHelperObject = NULL;
+
+static bool IsNormalMapUsed(const AssimpLoader &loader, LightingTier lightingTier) {
+
+    unsigned int usedVariants = loader.GetUsedShaderVariants(lightingTier);
+    for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; ++v) {
+        if ((usedVariants & (1u << v)) && (v & SHADER_VARIANT_NORMAL_MAP)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Pixels that are not the white background
+ */
+static unsigned int CountCoveredPixels() {
+
+    std::vector<unsigned char> pixels(4 * LIGHTING_FRAME_WIDTH * LIGHTING_FRAME_HEIGHT);
+    glReadPixels(0, 0, LIGHTING_FRAME_WIDTH, LIGHTING_FRAME_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    unsigned int coveredPixels = 0;
+    for (size_t p = 0; p < pixels.size(); p += 4) {
+        if (pixels[p] != 255 || pixels[p + 1] != 255 || pixels[p + 2] != 255) {
+            coveredPixels++;
+        }
+    }
+    return coveredPixels;
+}
+
+static void CheckTiers(const ModelRequest &model, bool hasNormalMaps) {
+
+    AssimpLoader loader;
+    std::string objPath;
+    if (!MY_CHECK(ExtractModelAssets(model, &loader, objPath) &&
+                  loader.Load3DModel(objPath, model.importProfile))) {
+        MyLOGE("Cannot load %s", model.modelId.c_str());
+        return;
+    }
+
+    // the model fills most of the frame, seen from the front
+    glm::vec3 boundsMin = loader.GetBoundsMin(), boundsMax = loader.GetBoundsMax();
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+    float radius = 0.5f * glm::length(boundsMax - boundsMin);
+    glm::mat4 mvpMat = glm::perspective(45.f * float(M_PI / 180), 1.f, 0.1f * radius,
+                                        10.f * radius) *
+                       glm::lookAt(center + glm::vec3(0, 0, 2.5f * radius), center,
+                                   glm::vec3(0, 1, 0));
+
+    for (int tier = 0; tier < LIGHTING_TIER_COUNT; ++tier) {
+        LightingTier lightingTier = (LightingTier) tier;
+        bool isNormalMapExpected = hasNormalMaps && lightingTier == LIGHTING_PER_PIXEL;
+        if (!MY_CHECK(IsNormalMapUsed(loader, lightingTier) == isNormalMapExpected)) {
+            MyLOGE("%s at the %s tier", model.modelId.c_str(), GetLightingTierName(lightingTier));
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        loader.Render3DModel(&mvpMat, lightingTier);
+        glFinish();
+        unsigned int coveredPixels = CountCoveredPixels();
+        GLenum error = glGetError();
+        if (!MY_CHECK(error == GL_NO_ERROR && coveredPixels > 0)) {
+            MyLOGE("%s at the %s tier: GL error 0x%x, %u pixels covered",
+                   model.modelId.c_str(), GetLightingTierName(lightingTier), error,
+                   coveredPixels);
+        }
+    }
+    loader.Delete3DModel();
+}
+
+static void CheckScaler() {
+
+    MyLightingScaler lightingScaler;
+    unsigned int framesToUnlit = 0, framesToPixel = 0;
+    while (lightingScaler.AddFrameTime(40.) != LIGHTING_UNLIT && framesToUnlit < 10000) {
+        framesToUnlit++;
+    }
+    while (lightingScaler.AddFrameTime(12.) != LIGHTING_PER_PIXEL && framesToPixel < 10000) {
+        framesToPixel++;
+    }
+    // two windows to step down twice, a window and a probe wait for each step up
+    MY_CHECK(framesToUnlit <= 2 * LIGHTING_WINDOW_FRAMES);
+    MY_CHECK(framesToPixel <= 2 * (LIGHTING_PROBE_FRAMES + LIGHTING_WINDOW_FRAMES));
+    MY_CHECK(lightingScaler.GetStats().stepsDown == 2 && lightingScaler.GetStats().stepsUp == 2);
+}
+
+int main() {
+
+    CheckScaler();
+
+    if (!InitBenchmarkGLContext(LIGHTING_FRAME_WIDTH, LIGHTING_FRAME_HEIGHT)) {
+        printf("LightingTest: no GLES 2 context, skipped\n");
+        return HOST_TEST_SKIPPED;
+    }
+    std::string internalDir = "/tmp/ModelAssimpTest";
+    mkdir(internalDir.c_str(), 0755);
+    gHelperObject = new MyJNIHelper(MY_HOST_ASSET_DIR, internalDir);
+
+    ModelRequest andy = {"andy", "andy/andy.obj", {"andy/materials.mtl", "andy/andy.png"},
+                         IMPORT_PROFILE_FULL, 0};
+    // the MTL and textures are found from the OBJ
+    ModelRequest wonder = {"wonder", "wonder/wonderwoman.obj", {}, IMPORT_PROFILE_FULL, 0};
+    CheckTiers(andy, false);
+    CheckTiers(wonder, true);
+
+    delete gHelperObject;
+    return GetTestExitCode("LightingTest");
+}
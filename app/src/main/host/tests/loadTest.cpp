@@ -0,0 +1,159 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of how a model is read:
+//   PrepareModel reads no more than the model's directory, and the normal maps only when the
+//   profile computes tangents; those are the textures a material names but no mesh draws
+//   MyAssetIOSystem reads a file from the assets even when internal storage has an older copy,
+//   and from internal storage only when the assets do not have it
+
+#include "assimpLoader.h"
+#include "hostTest.h"
+#include "myAssetIOSystem.h"
+#include "myJNIHelper.h"
+#include "myModelPreloader.h"
+#include <assimp/IOStream.hpp>
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+static std::string gInternalDir = "/tmp/ModelAssimpTest";
+
+/**
+ * Bytes of the files in a directory of the assets, not counting subdirectories
+ */
+static size_t GetAssetDirectoryBytes(const std::string &assetDirectory) {
+
+    std::string fullDir = std::string(MY_HOST_ASSET_DIR) + "/" + assetDirectory;
+    DIR *dir = opendir(fullDir.c_str());
+    if (!dir) {
+        return 0;
+    }
+    size_t directoryBytes = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat fileStat;
+        if (stat((fullDir + "/" + entry->d_name).c_str(), &fileStat) == 0 &&
+            S_ISREG(fileStat.st_mode)) {
+            directoryBytes += fileStat.st_size;
+        }
+    }
+    closedir(dir);
+    return directoryBytes;
+}
+
+static bool PrepareModel(ModelRequest model, ImportProfile importProfile,
+                         ModelReadStats &readStats) {
+
+    AssimpLoader loader;
+    std::string objPath;
+    model.importProfile = importProfile;
+    if (!ExtractModelAssets(model, &loader, objPath) ||
+        !loader.PrepareModel(objPath, model.importProfile)) {
+        MyLOGE("Cannot prepare %s", model.modelId.c_str());
+        return false;
+    }
+    readStats = loader.GetReadStats();
+    return true;
+}
+
+static void CheckReads(const ModelRequest &model, const std::string &assetDirectory,
+                       bool hasNormalMaps) {
+
+    ModelReadStats fullStats, litStats;
+    if (!MY_CHECK(PrepareModel(model, IMPORT_PROFILE_FULL, fullStats)) ||
+        !MY_CHECK(PrepareModel(model, IMPORT_PROFILE_LIT, litStats))) {
+        return;
+    }
+    size_t bytesRead = fullStats.modelBytes + fullStats.meshCacheBytes + fullStats.textureBytes;
+    if (!MY_CHECK(bytesRead <= GetAssetDirectoryBytes(assetDirectory))) {
+        MyLOGE("%s read %zu bytes", model.modelId.c_str(), bytesRead);
+    }
+    MY_CHECK(fullStats.modelBytes > 0 && fullStats.texturesRead > 0);
+
+    // the lit profile computes normals but no tangents, so its meshes draw no normal maps
+    MY_CHECK(litStats.texturesRead + litStats.texturesSkipped ==
+             fullStats.texturesRead + fullStats.texturesSkipped);
+    if (hasNormalMaps) {
+        MY_CHECK(litStats.texturesSkipped > fullStats.texturesSkipped);
+        MY_CHECK(litStats.textureBytes < fullStats.textureBytes);
+    } else {
+        MY_CHECK(litStats.texturesSkipped == fullStats.texturesSkipped);
+    }
+}
+
+static size_t GetOpenedSize(MyAssetIOSystem &ioSystem, const std::string &fileName) {
+
+    Assimp::IOStream *stream = ioSystem.Open(fileName.c_str());
+    if (!stream) {
+        return 0;
+    }
+    size_t fileSize = stream->FileSize();
+    ioSystem.Close(stream);
+    return fileSize;
+}
+
+static bool WriteFile(const std::string &fileName, const char *contents) {
+
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool isWritten = fputs(contents, file) >= 0;
+    return fclose(file) == 0 && isWritten;
+}
+
+static void CheckAssetsWinOverInternalStorage() {
+
+    MyAssetIOSystem ioSystem;
+    ioSystem.SetAssetDirectory("andy");
+
+    // left behind by an older version of the app
+    std::string stalePath = gInternalDir + "/andy.obj";
+    size_t assetSize = 0;
+    if (!MY_CHECK(WriteFile(stalePath, "o stale\n")) ||
+        !MY_CHECK(gHelperObject->GetAssetSize("andy/andy.obj", assetSize))) {
+        return;
+    }
+    MY_CHECK(GetOpenedSize(ioSystem, stalePath) == assetSize);
+
+    std::string internalPath = gInternalDir + "/notAnAsset.txt";
+    if (MY_CHECK(WriteFile(internalPath, "internal\n"))) {
+        MY_CHECK(GetOpenedSize(ioSystem, internalPath) == strlen("internal\n"));
+    }
+    remove(internalPath.c_str());
+}
+
+int main() {
+
+    mkdir(gInternalDir.c_str(), 0755);
+    gHelperObject = new MyJNIHelper(MY_HOST_ASSET_DIR, gInternalDir);
+
+    CheckAssetsWinOverInternalStorage();
+
+    ModelRequest andy = {"andy", "andy/andy.obj", {"andy/materials.mtl", "andy/andy.png"},
+                         IMPORT_PROFILE_FULL, 0};
+    // the MTL and textures are found from the OBJ
+    ModelRequest wonder = {"wonder", "wonder/wonderwoman.obj", {}, IMPORT_PROFILE_FULL, 0};
+    CheckReads(andy, "andy", false);
+    CheckReads(wonder, "wonder", true);
+
+    delete gHelperObject;
+    return GetTestExitCode("LoadTest");
+}
@@ -0,0 +1,351 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of the mesh cache:
+//   EncodeScene and DecodeScene keep every triangle corner of andy and wonder within half a
+//   quantization step, and the handedness of the tangent frames
+//   vertices that meshes share decode to the same position, and mirrored tangent frames keep
+//   their bitangents
+//   a scene does not decode with another key or cut short
+//   PrepareModel writes the cache on the first load, reads it instead of the OBJ on the next,
+//   imports again if the entry is corrupt and removes the entries of other versions
+
+#include "assimpLoader.h"
+#include "hostTest.h"
+#include "myJNIHelper.h"
+#include "myMeshCodec.h"
+#include "myModelPreloader.h"
+#include <assimp/config.h>
+#include <algorithm>
+#include <dirent.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+static std::string gInternalDir = "/tmp/ModelAssimpMeshCacheTest";
+
+/**
+ * Bounds of the positions of all the meshes, which the codec quantizes over
+ */
+static void GetSceneBounds(const aiScene *scene, aiVector3D &positionMin,
+                           aiVector3D &positionMax) {
+
+    positionMin = positionMax = scene->mMeshes[0]->mVertices[0];
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+        const aiMesh *mesh = scene->mMeshes[n];
+        for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+            for (unsigned int c = 0; c < 3; ++c) {
+                positionMin[c] = std::min(positionMin[c], mesh->mVertices[v][c]);
+                positionMax[c] = std::max(positionMax[c], mesh->mVertices[v][c]);
+            }
+        }
+    }
+}
+
+static bool IsUnitVector(const aiVector3D &vector) {
+    return fabsf(vector.Length() - 1) < 1e-3f;
+}
+
+/**
+ * Every triangle corner of the decoded scene has to match the imported one: positions within
+ * half a quantization step of the scene, UVs within half of theirs, normals and tangents
+ * within about half a degree and bitangents on the same side of normal x tangent
+ */
+static void CheckDecodedScene(const char *modelName, const aiScene *scene,
+                              const aiScene *decoded,
+                              const std::vector<const unsigned int *> &meshIndices) {
+
+    if (!MY_CHECK(decoded->mNumMeshes == scene->mNumMeshes)) {
+        return;
+    }
+    aiVector3D positionMin, positionMax;
+    GetSceneBounds(scene, positionMin, positionMax);
+    unsigned int mismatches = 0;
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+        const aiMesh *mesh = scene->mMeshes[n], *decodedMesh = decoded->mMeshes[n];
+        if (!MY_CHECK(decodedMesh->mNumFaces == mesh->mNumFaces &&
+                      decodedMesh->mNumVertices == mesh->mNumVertices &&
+                      decodedMesh->HasTextureCoords(0) == mesh->HasTextureCoords(0) &&
+                      decodedMesh->HasNormals() == mesh->HasNormals() &&
+                      decodedMesh->HasTangentsAndBitangents() ==
+                      mesh->HasTangentsAndBitangents())) {
+            continue;
+        }
+        aiVector3D uvMin, uvMax;
+        if (mesh->HasTextureCoords(0)) {
+            uvMin = uvMax = mesh->mTextureCoords[0][0];
+        }
+        for (unsigned int v = 0; v < mesh->mNumVertices && mesh->HasTextureCoords(0); ++v) {
+            for (unsigned int c = 0; c < 2; ++c) {
+                uvMin[c] = std::min(uvMin[c], mesh->mTextureCoords[0][v][c]);
+                uvMax[c] = std::max(uvMax[c], mesh->mTextureCoords[0][v][c]);
+            }
+        }
+        aiVector3D uvRange = uvMax - uvMin;
+        float uvSteps = std::max(uvRange.x, uvRange.y) > MESH_CODEC_WIDE_UV_RANGE ?
+                        16777215 : 65535;
+        for (unsigned int i = 0; i < 3 * mesh->mNumFaces; ++i) {
+            unsigned int vertex = mesh->mFaces[i / 3].mIndices[i % 3];
+            unsigned int decodedVertex = meshIndices[n][i];
+            for (unsigned int c = 0; c < 3; ++c) {
+                float value = mesh->mVertices[vertex][c];
+                float tolerance = (positionMax[c] - positionMin[c]) / 65535 * 0.51f +
+                                  1e-6f * fabsf(value);
+                mismatches += fabsf(decodedMesh->mVertices[decodedVertex][c] - value) > tolerance;
+            }
+            for (unsigned int c = 0; c < 2 && mesh->HasTextureCoords(0); ++c) {
+                float value = mesh->mTextureCoords[0][vertex][c];
+                float tolerance = (uvMax[c] - uvMin[c]) / uvSteps * 0.51f + 1e-6f * fabsf(value);
+                mismatches += fabsf(decodedMesh->mTextureCoords[0][decodedVertex][c] - value) >
+                              tolerance;
+            }
+            // the import may leave zero normals and tangents on degenerate triangles
+            if (mesh->HasNormals() && IsUnitVector(mesh->mNormals[vertex])) {
+                mismatches += mesh->mNormals[vertex] * decodedMesh->mNormals[decodedVertex] <
+                              0.9999f;
+            }
+            if (!mesh->HasTangentsAndBitangents() || !IsUnitVector(mesh->mNormals[vertex]) ||
+                !IsUnitVector(mesh->mTangents[vertex])) {
+                continue;
+            }
+            const aiVector3D &decodedNormal = decodedMesh->mNormals[decodedVertex];
+            const aiVector3D &decodedTangent = decodedMesh->mTangents[decodedVertex];
+            mismatches += mesh->mTangents[vertex] * decodedTangent < 0.9999f;
+            float handedness = (mesh->mNormals[vertex] ^ mesh->mTangents[vertex]) *
+                               mesh->mBitangents[vertex];
+            float decodedHandedness = (decodedNormal ^ decodedTangent) *
+                                      decodedMesh->mBitangents[decodedVertex];
+            mismatches += fabsf(handedness) > 0.5f && (handedness < 0) != (decodedHandedness < 0);
+        }
+    }
+    if (!MY_CHECK(mismatches == 0)) {
+        MyLOGE("%s: %u decoded values differ from the imported ones", modelName, mismatches);
+    }
+}
+
+static void CheckRoundTrip(const std::string &objAsset, ImportProfile importProfile) {
+
+    Assimp::Importer importer;
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    const aiScene *scene = importer.ReadFile(std::string(MY_HOST_ASSET_DIR) + "/" + objAsset,
+                                             GetImportProfileFlags(importProfile));
+    std::vector<uint8_t> encoded;
+    if (!MY_CHECK(scene != NULL) || !MY_CHECK(EncodeScene(scene, 1, encoded))) {
+        return;
+    }
+    MyArena arena;
+    std::vector<const unsigned int *> meshIndices;
+    aiScene *decoded = DecodeScene(&encoded[0], encoded.size(), 1, arena, meshIndices);
+    if (MY_CHECK(decoded != NULL)) {
+        CheckDecodedScene(objAsset.c_str(), scene, decoded, meshIndices);
+    }
+    delete decoded;
+}
+
+/**
+ * A mesh of one triangle per three positions, with every frame's normal +z and tangent +x
+ */
+static aiMesh * NewMesh(const aiVector3D *positions, const aiVector3D *bitangents,
+                        unsigned int vertexCount) {
+
+    aiMesh *mesh = new aiMesh();
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mNumVertices = vertexCount;
+    mesh->mVertices = new aiVector3D[vertexCount];
+    mesh->mNormals = new aiVector3D[vertexCount];
+    mesh->mTangents = new aiVector3D[vertexCount];
+    mesh->mBitangents = new aiVector3D[vertexCount];
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        mesh->mVertices[v] = positions[v];
+        mesh->mNormals[v] = aiVector3D(0, 0, 1);
+        mesh->mTangents[v] = aiVector3D(1, 0, 0);
+        mesh->mBitangents[v] = bitangents[v];
+    }
+    mesh->mNumFaces = vertexCount / 3;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        mesh->mFaces[f].mNumIndices = 3;
+        mesh->mFaces[f].mIndices = new unsigned int[3];
+        for (unsigned int k = 0; k < 3; ++k) {
+            mesh->mFaces[f].mIndices[k] = 3 * f + k;
+        }
+    }
+    return mesh;
+}
+
+static aiScene * NewScene(aiMesh **meshes, unsigned int meshCount) {
+
+    aiScene *scene = new aiScene();
+    scene->mNumMeshes = meshCount;
+    scene->mMeshes = new aiMesh *[meshCount];
+    for (unsigned int n = 0; n < meshCount; ++n) {
+        scene->mMeshes[n] = meshes[n];
+    }
+    scene->mNumMaterials = 1;
+    scene->mMaterials = new aiMaterial *[1];
+    scene->mMaterials[0] = new aiMaterial();
+    return scene;
+}
+
+/**
+ * A small mesh and a large one that share an edge, and frames whose bitangents point either
+ * way, as they do on either side of a mirrored UV seam
+ */
+static void CheckSharedEdgeAndMirroredFrames() {
+
+    const aiVector3D up(0, 1, 0), down(0, -1, 0);
+    const aiVector3D smallPositions[] = {aiVector3D(0.1234567f, 0.2345678f, 0.3456789f),
+                                         aiVector3D(0.7654321f, 0.4567891f, 0.0123457f),
+                                         aiVector3D(0.5f, 0.9f, 0.1f)};
+    const aiVector3D largePositions[] = {smallPositions[1], smallPositions[0],
+                                         aiVector3D(97.3f, -41.9f, 12.7f)};
+    const aiVector3D smallBitangents[] = {up, down, up};
+    const aiVector3D largeBitangents[] = {down, up, down};
+    aiMesh *meshes[] = {NewMesh(smallPositions, smallBitangents, 3),
+                        NewMesh(largePositions, largeBitangents, 3)};
+    aiScene *scene = NewScene(meshes, 2);
+
+    std::vector<uint8_t> encoded;
+    MyArena arena;
+    std::vector<const unsigned int *> meshIndices;
+    aiScene *decoded = NULL;
+    if (MY_CHECK(EncodeScene(scene, 1, encoded))) {
+        decoded = DecodeScene(&encoded[0], encoded.size(), 1, arena, meshIndices);
+    }
+    if (MY_CHECK(decoded != NULL)) {
+        const aiMesh *small = decoded->mMeshes[0], *large = decoded->mMeshes[1];
+        MY_CHECK(small->mVertices[meshIndices[0][0]] == large->mVertices[meshIndices[1][1]]);
+        MY_CHECK(small->mVertices[meshIndices[0][1]] == large->mVertices[meshIndices[1][0]]);
+        for (unsigned int n = 0; n < 2; ++n) {
+            for (unsigned int i = 0; i < 3; ++i) {
+                const aiVector3D &bitangent = decoded->mMeshes[n]->mBitangents[meshIndices[n][i]];
+                MY_CHECK(bitangent * scene->mMeshes[n]->mBitangents[i] > 0.9999f);
+            }
+        }
+        CheckDecodedScene("shared edge", scene, decoded, meshIndices);
+    }
+    delete decoded;
+
+    // a corrupt cache entry is imported again rather than read
+    if (!encoded.empty()) {
+        arena.Reset();
+        MY_CHECK(DecodeScene(&encoded[0], encoded.size(), 2, arena, meshIndices) == NULL);
+        MY_CHECK(DecodeScene(&encoded[0], encoded.size() - 1, 1, arena, meshIndices) == NULL);
+        MY_CHECK(DecodeScene(&encoded[0], encoded.size() / 2, 1, arena, meshIndices) == NULL);
+    }
+    delete scene;
+}
+
+/**
+ * Names of the mesh cache entries in the internal directory
+ */
+static std::vector<std::string> GetMeshCacheNames() {
+
+    std::vector<std::string> names;
+    DIR *dir = opendir(gInternalDir.c_str());
+    if (!dir) {
+        return names;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "mesh_", 5) == 0) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    return names;
+}
+
+static bool WriteFile(const std::string &fileName, const char *contents) {
+
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool isWritten = fputs(contents, file) >= 0;
+    return fclose(file) == 0 && isWritten;
+}
+
+static bool PrepareModel(const ModelRequest &model, ModelReadStats &readStats) {
+
+    AssimpLoader loader;
+    std::string objPath;
+    if (!ExtractModelAssets(model, &loader, objPath) ||
+        !loader.PrepareModel(objPath, model.importProfile)) {
+        MyLOGE("Cannot prepare %s", model.modelId.c_str());
+        return false;
+    }
+    readStats = loader.GetReadStats();
+    return true;
+}
+
+static void CheckPrepareCached(const ModelRequest &model) {
+
+    std::vector<std::string> names = GetMeshCacheNames();
+    for (unsigned int n = 0; n < names.size(); ++n) {
+        remove((gInternalDir + "/" + names[n]).c_str());
+    }
+    // an entry named before the names had versions and one of another version
+    const char *staleNames[] = {"mesh_0123456789abcdef.bin", "mesh_00000000_0123456789abcdef.bin"};
+    for (unsigned int n = 0; n < 2; ++n) {
+        MY_CHECK(WriteFile(gInternalDir + "/" + staleNames[n], "stale\n"));
+    }
+
+    ModelReadStats readStats;
+    if (!MY_CHECK(PrepareModel(model, readStats))) {
+        return;
+    }
+    MY_CHECK(readStats.modelBytes > 0 && readStats.meshCacheBytes == 0);
+    names = GetMeshCacheNames();
+    if (!MY_CHECK(names.size() == 1)) {
+        for (unsigned int n = 0; n < names.size(); ++n) {
+            MyLOGE("Mesh cache entry %s", names[n].c_str());
+        }
+        return;
+    }
+    MY_CHECK(PrepareModel(model, readStats));
+    MY_CHECK(readStats.modelBytes == 0 && readStats.meshCacheBytes > 0);
+
+    MY_CHECK(WriteFile(gInternalDir + "/" + names[0], "MYMC corrupt\n"));
+    MY_CHECK(PrepareModel(model, readStats));
+    MY_CHECK(readStats.modelBytes > 0 && readStats.meshCacheBytes == 0);
+    MY_CHECK(PrepareModel(model, readStats));
+    MY_CHECK(readStats.modelBytes == 0 && readStats.meshCacheBytes > 0);
+}
+
+int main() {
+
+    mkdir(gInternalDir.c_str(), 0755);
+    gHelperObject = new MyJNIHelper(MY_HOST_ASSET_DIR, gInternalDir);
+
+    CheckSharedEdgeAndMirroredFrames();
+    // of the profiles only the full one computes tangents
+    for (unsigned int p = 0; p < IMPORT_PROFILE_COUNT; ++p) {
+        CheckRoundTrip("andy/andy.obj", (ImportProfile) p);
+        CheckRoundTrip("wonder/wonderwoman.obj", (ImportProfile) p);
+    }
+
+    ModelRequest wonder = {"wonder", "wonder/wonderwoman.obj", {}, IMPORT_PROFILE_FULL,
+                           0x5eed};
+    CheckPrepareCached(wonder);
+
+    delete gHelperObject;
+    return GetTestExitCode("MeshCacheTest");
+}
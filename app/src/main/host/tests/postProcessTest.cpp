@@ -0,0 +1,122 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+
+// Checks of PostProcessMeshes against Assimp, over every OBJ in the cooked catalog:
+//   smooth normals and welding on one thread give Assimp's vertex counts and indices, and its
+//   normals to within float rounding
+// the cache orders differ by design, so they are only reported, as the ACMR of each
+
+#include "assimpLoader.h"
+#include "hostTest.h"
+#include "myAssetCatalog.h"
+#include "myJNIHelper.h"
+#include "myMeshPostProcess.h"
+#include <algorithm>
+#include <string.h>
+
+// read flags that leave every step of MY_MESH_POSTPROCESS_STEPS to the test
+#define POSTPROCESS_READ_FLAGS  (aiProcess_Triangulate | aiProcess_SortByPType)
+#define NORMAL_TOLERANCE        1e-3f
+
+MyJNIHelper *gHelperObject = NULL;
+
+static float GetSceneACMR(const aiScene *scene) {
+    double misses = 0, faces = 0;
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+        misses += ComputeACMR(scene->mMeshes[m]) * scene->mMeshes[m]->mNumFaces;
+        faces += scene->mMeshes[m]->mNumFaces;
+    }
+    return faces > 0 ? misses / faces : 0.f;
+}
+
+/**
+ * Run normals and welding through Assimp and through PostProcessMeshes and compare the meshes,
+ * then the cache order of each on top of its own welded meshes
+ */
+static void CompareWithAssimp(const std::string &objAsset) {
+
+    std::string objPath = std::string(MY_HOST_ASSET_DIR) + "/" + objAsset;
+    Assimp::Importer assimpImporter, ourImporter;
+    assimpImporter.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                      aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    ourImporter.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                   aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    unsigned int steps = aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices;
+    const aiScene *assimpScene = assimpImporter.ReadFile(objPath,
+                                                         POSTPROCESS_READ_FLAGS | steps);
+    const aiScene *ourScene = ourImporter.ReadFile(objPath, POSTPROCESS_READ_FLAGS);
+    if (!MY_CHECK(assimpScene && ourScene &&
+                  assimpScene->mNumMeshes == ourScene->mNumMeshes)) {
+        MyLOGE("Cannot import %s", objAsset.c_str());
+        return;
+    }
+    PostProcessMeshes(const_cast<aiScene *>(ourScene), steps, 1);
+
+    float maxNormalError = 0;
+    unsigned int vertexMismatches = 0, indexMismatches = 0;
+    for (unsigned int m = 0; m < ourScene->mNumMeshes; ++m) {
+        const aiMesh *assimpMesh = assimpScene->mMeshes[m];
+        const aiMesh *ourMesh = ourScene->mMeshes[m];
+        if (assimpMesh->mNumVertices != ourMesh->mNumVertices ||
+            assimpMesh->mNumFaces != ourMesh->mNumFaces) {
+            vertexMismatches++;
+            continue;
+        }
+        for (unsigned int v = 0; v < ourMesh->mNumVertices; ++v) {
+            maxNormalError = std::max(maxNormalError, (assimpMesh->mNormals[v] -
+                                                       ourMesh->mNormals[v]).Length());
+        }
+        for (unsigned int f = 0; f < ourMesh->mNumFaces; ++f) {
+            if (memcmp(assimpMesh->mFaces[f].mIndices, ourMesh->mFaces[f].mIndices,
+                       3 * sizeof(unsigned int)) != 0) {
+                indexMismatches++;
+            }
+        }
+    }
+    if (!MY_CHECK(vertexMismatches == 0 && indexMismatches == 0 &&
+                  maxNormalError <= NORMAL_TOLERANCE)) {
+        MyLOGE("%s: %u meshes with other vertex counts, %u faces with other indices, "
+               "normals off by up to %f", objAsset.c_str(), vertexMismatches, indexMismatches,
+               maxNormalError);
+    }
+
+    assimpImporter.ApplyPostProcessing(aiProcess_ImproveCacheLocality);
+    for (unsigned int m = 0; m < ourScene->mNumMeshes; ++m) {
+        OptimizeVertexCache(ourScene->mMeshes[m]);
+    }
+    printf("%s: ACMR %.3f with Assimp, %.3f with PostProcessMeshes\n", objAsset.c_str(),
+           GetSceneACMR(assimpImporter.GetScene()), GetSceneACMR(ourScene));
+}
+
+int main() {
+
+    gHelperObject = new MyJNIHelper(MY_HOST_ASSET_DIR, "/tmp");
+
+    MyAssetCatalog catalog;
+    if (MY_CHECK(catalog.Load())) {
+        const std::vector<CatalogModel> &models = catalog.GetModels();
+        for (unsigned int m = 0; m < models.size(); ++m) {
+            if (!IsGLBFileName(models[m].obj.assetName)) {
+                CompareWithAssimp(models[m].obj.assetName);
+            }
+        }
+    }
+
+    delete gHelperObject;
+    return GetTestExitCode("PostProcessTest");
+}
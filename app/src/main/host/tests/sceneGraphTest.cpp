@@ -0,0 +1,167 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of MySceneGraph on a tree where every node has four children and draws mesh 0:
+//   every world matrix is the product of the local matrices up to the root, after building and
+//   after moving a leaf or the root, and an update recomputes only the changed subtree
+//   a node list builds the same graph as the aiNode tree, an empty list a graph without nodes,
+//   and a scene without nodes a single root that draws every mesh
+
+#include "hostTest.h"
+#include "mySceneGraph.h"
+#include <cmath>
+
+/**
+ * Depth-first like MySceneGraph, so node numbers match
+ */
+static aiNode * CreateTree(unsigned int depth, unsigned int &numberOfNodes) {
+
+    aiNode *node = new aiNode("node" + std::to_string(numberOfNodes));
+    aiMatrix4x4::Translation(aiVector3D(1.f, 0.5f * (numberOfNodes % 3), 0.f),
+                             node->mTransformation);
+    aiMatrix4x4 rotation;
+    node->mTransformation *= aiMatrix4x4::RotationZ(0.1f * (numberOfNodes % 5), rotation);
+    node->mNumMeshes = 1;
+    node->mMeshes = new unsigned int[1];
+    node->mMeshes[0] = 0;
+    ++numberOfNodes;
+    if (depth > 0) {
+        node->mNumChildren = 4;
+        node->mChildren = new aiNode *[4];
+        for (unsigned int c = 0; c < 4; ++c) {
+            node->mChildren[c] = CreateTree(depth - 1, numberOfNodes);
+            node->mChildren[c]->mParent = node;
+        }
+    }
+    return node;
+}
+
+static bool IsClose(const glm::mat4 &a, const glm::mat4 &b) {
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            if (std::fabs(a[c][r] - b[c][r]) > 1e-3f * (1.f + std::fabs(b[c][r]))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool AreWorldMatricesCorrect(const MySceneGraph &graph) {
+    for (unsigned int n = 0; n < graph.GetNumberOfNodes(); ++n) {
+        glm::mat4 expected = graph.GetLocalMatrix(n);
+        for (int p = graph.GetParent(n); p >= 0; p = graph.GetParent(p)) {
+            expected = graph.GetLocalMatrix(p) * expected;
+        }
+        if (!IsClose(graph.GetWorldMatrix(n), expected)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void CheckUpdates() {
+
+    aiScene scene;
+    unsigned int numberOfNodes = 0;
+    scene.mRootNode = CreateTree(3, numberOfNodes);
+    MySceneGraph graph;
+    graph.Build(&scene);
+    graph.SetMeshBounds(0, glm::vec3(-0.5f), glm::vec3(0.5f));
+    if (!MY_CHECK(graph.GetNumberOfNodes() == numberOfNodes)) {
+        return;
+    }
+    MY_CHECK(graph.GetNumberOfInstances() == numberOfNodes);
+    MY_CHECK(graph.GetParent(0) == -1);
+    MY_CHECK(AreWorldMatricesCorrect(graph));
+
+    MY_CHECK(graph.UpdateWorldMatrices() == 0);
+    unsigned int leaf = numberOfNodes - 1;
+    graph.SetLocalMatrix(leaf, glm::rotate(graph.GetLocalMatrix(leaf), 0.3f,
+                                           glm::vec3(0, 0, 1.f)));
+    MY_CHECK(graph.UpdateWorldMatrices() == 1);
+    MY_CHECK(AreWorldMatricesCorrect(graph));
+
+    // the leaf moved again and its root with it: the root's subtree covers it
+    graph.SetLocalMatrix(leaf, glm::translate(graph.GetLocalMatrix(leaf), glm::vec3(1.f)));
+    graph.SetLocalMatrix(0, glm::rotate(graph.GetLocalMatrix(0), 0.2f, glm::vec3(0, 1.f, 0)));
+    MY_CHECK(graph.UpdateWorldMatrices() == numberOfNodes);
+    MY_CHECK(AreWorldMatricesCorrect(graph));
+}
+
+static void CheckNodeList() {
+
+    aiScene scene;
+    unsigned int numberOfNodes = 0;
+    scene.mRootNode = CreateTree(2, numberOfNodes);
+    MySceneGraph treeGraph;
+    treeGraph.Build(&scene);
+
+    std::vector<MySceneNode> nodes(treeGraph.GetNumberOfNodes());
+    for (unsigned int n = 0; n < nodes.size(); ++n) {
+        nodes[n].name = treeGraph.GetName(n);
+        nodes[n].parent = treeGraph.GetParent(n);
+        nodes[n].localMatrix = treeGraph.GetLocalMatrix(n);
+        nodes[n].meshes.push_back(0);
+    }
+    MySceneGraph listGraph;
+    listGraph.Build(nodes);
+    if (!MY_CHECK(listGraph.GetNumberOfNodes() == treeGraph.GetNumberOfNodes())) {
+        return;
+    }
+    MY_CHECK(listGraph.GetNumberOfInstances() == treeGraph.GetNumberOfInstances());
+    bool isSame = true;
+    for (unsigned int n = 0; n < nodes.size(); ++n) {
+        isSame = isSame && IsClose(listGraph.GetWorldMatrix(n), treeGraph.GetWorldMatrix(n));
+    }
+    MY_CHECK(isSame);
+    MY_CHECK(listGraph.FindNode(nodes.back().name) == (int) nodes.size() - 1);
+
+    // a subtree that ends in the middle of the list: moving node 1 leaves its siblings alone
+    listGraph.SetLocalMatrix(1, glm::translate(listGraph.GetLocalMatrix(1), glm::vec3(2.f)));
+    MY_CHECK(listGraph.UpdateWorldMatrices() == 5);
+    MY_CHECK(AreWorldMatricesCorrect(listGraph));
+
+    listGraph.Build(std::vector<MySceneNode>());
+    MY_CHECK(listGraph.GetNumberOfNodes() == 0);
+    MY_CHECK(listGraph.GetNumberOfInstances() == 0);
+    MY_CHECK(listGraph.UpdateWorldMatrices() == 0);
+}
+
+static void CheckSceneWithoutNodes() {
+
+    aiScene scene;
+    scene.mNumMeshes = 3;
+    scene.mMeshes = new aiMesh *[3];
+    for (unsigned int m = 0; m < 3; ++m) {
+        scene.mMeshes[m] = new aiMesh();
+    }
+    MySceneGraph graph;
+    graph.Build(&scene);
+    MY_CHECK(graph.GetNumberOfNodes() == 1);
+    if (MY_CHECK(graph.GetNumberOfInstances() == 3)) {
+        MY_CHECK(graph.GetInstanceMesh(2) == 2 && graph.GetInstanceNode(2) == 0);
+    }
+}
+
+int main() {
+
+    CheckUpdates();
+    CheckNodeList();
+    CheckSceneWithoutNodes();
+    return GetTestExitCode("SceneGraphTest");
+}
@@ -0,0 +1,162 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Checks of MyTransformBatch, for the SIMD and the scalar kernel and batch sizes that fill
+// groups of four partly and completely:
+//   MultiplyLeft and Multiply match glm
+//   TransformBounds gives a box around all eight transformed corners
+//   CullBounds gives the same visibility with both kernels, keeps a box at the origin and drops
+//   one behind the camera
+
+#include "hostTest.h"
+#include "myTransformBatch.h"
+#include <cmath>
+#include <vector>
+
+/**
+ * Rotated, scaled and translated matrices spread around the origin, same for every run
+ */
+static glm::mat4 GetTestMatrix(unsigned int i) {
+    float t = (float) i;
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), glm::vec3(std::sin(t) * 20.f,
+                                                                 std::cos(t * 0.7f) * 20.f,
+                                                                 std::sin(t * 0.3f) * 20.f));
+    matrix = glm::rotate(matrix, t * 0.1f, glm::normalize(glm::vec3(1.f, t, 2.f)));
+    return glm::scale(matrix, glm::vec3(1.f + (i % 3) * 0.5f));
+}
+
+static void FillBatch(MyTransformBatch &batch, unsigned int count) {
+    batch.Resize(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        batch.SetMatrix(i, GetTestMatrix(i));
+        batch.SetBounds(i, glm::vec3(-1.f, -0.5f, -2.f), glm::vec3(1.f, 0.5f + i % 2, 2.f));
+    }
+}
+
+static glm::mat4 GetViewProjection() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 100.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 40.f), glm::vec3(0), glm::vec3(0, 1.f, 0));
+    return projection * view;
+}
+
+static bool IsClose(const glm::mat4 &a, const glm::mat4 &b) {
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            if (std::fabs(a[c][r] - b[c][r]) > 1e-3f * (1.f + std::fabs(b[c][r]))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void CheckMultiply(unsigned int count, TransformKernel kernel) {
+
+    MyTransformBatch models, locals, result;
+    FillBatch(models, count);
+    locals.Resize(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        locals.SetMatrix(i, GetTestMatrix(i + 7));
+    }
+    glm::mat4 viewProjection = GetViewProjection();
+
+    result.MultiplyLeft(viewProjection, models, kernel);
+    bool isLeftClose = true;
+    for (unsigned int i = 0; i < count; ++i) {
+        isLeftClose = isLeftClose &&
+                      IsClose(result.GetMatrix(i), viewProjection * GetTestMatrix(i));
+    }
+    MY_CHECK(isLeftClose);
+
+    result.Multiply(models, locals, kernel);
+    bool isClose = true;
+    for (unsigned int i = 0; i < count; ++i) {
+        isClose = isClose && IsClose(result.GetMatrix(i), GetTestMatrix(i) * GetTestMatrix(i + 7));
+    }
+    MY_CHECK(isClose);
+}
+
+static void CheckTransformBounds(unsigned int count, TransformKernel kernel) {
+
+    MyTransformBatch local, world;
+    FillBatch(local, count);
+    world.TransformBounds(local, kernel);
+    bool isEveryCornerInside = true;
+    for (unsigned int i = 0; i < count; ++i) {
+        glm::vec3 localMin, localMax, worldMin, worldMax;
+        local.GetBounds(i, localMin, localMax);
+        world.GetBounds(i, worldMin, worldMax);
+        for (int corner = 0; corner < 8; ++corner) {
+            glm::vec4 point(corner & 1 ? localMax.x : localMin.x,
+                            corner & 2 ? localMax.y : localMin.y,
+                            corner & 4 ? localMax.z : localMin.z, 1.f);
+            glm::vec3 worldPoint(GetTestMatrix(i) * point);
+            if (glm::any(glm::lessThan(worldPoint, worldMin - 1e-3f)) ||
+                glm::any(glm::greaterThan(worldPoint, worldMax + 1e-3f))) {
+                isEveryCornerInside = false;
+            }
+        }
+    }
+    MY_CHECK(isEveryCornerInside);
+}
+
+static void CheckCull(unsigned int count) {
+
+    MyTransformBatch local, world;
+    FillBatch(local, count);
+    world.TransformBounds(local, TRANSFORM_KERNEL_SCALAR);
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(GetViewProjection(), planes);
+    std::vector<unsigned char> visible(count + 1), expected(count + 1);
+
+    unsigned int numberOfVisible = world.CullBounds(planes, &visible[0], TRANSFORM_KERNEL_SIMD);
+    unsigned int expectedVisible = world.CullBounds(planes, &expected[0],
+                                                    TRANSFORM_KERNEL_SCALAR);
+    MY_CHECK(numberOfVisible == expectedVisible);
+    MY_CHECK(visible == expected);
+}
+
+static void CheckCullKnownBoxes(TransformKernel kernel) {
+
+    MyTransformBatch boxes;
+    boxes.Resize(2);
+    boxes.SetBounds(0, glm::vec3(-1.f), glm::vec3(1.f));
+    boxes.SetBounds(1, glm::vec3(-1.f, -1.f, 50.f), glm::vec3(1.f, 1.f, 52.f));
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(GetViewProjection(), planes);
+    unsigned char visible[2] = {0, 1};
+    MY_CHECK(boxes.CullBounds(planes, visible, kernel) == 1);
+    MY_CHECK(visible[0] == 1 && visible[1] == 0);
+}
+
+int main() {
+
+    const unsigned int counts[] = {0, 1, 3, 4, 5, 63, 1024};
+    const TransformKernel kernels[] = {TRANSFORM_KERNEL_SIMD, TRANSFORM_KERNEL_SCALAR};
+    printf("TransformTest: SIMD kernel is %s\n", GetTransformBatchSIMD());
+    for (TransformKernel kernel : kernels) {
+        for (unsigned int count : counts) {
+            CheckMultiply(count, kernel);
+            CheckTransformBounds(count, kernel);
+        }
+        CheckCullKnownBoxes(kernel);
+    }
+    for (unsigned int count : counts) {
+        CheckCull(count);
+    }
+    return GetTestExitCode("TransformTest");
+}
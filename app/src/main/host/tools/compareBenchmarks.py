@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+#    Copyright 2016 Anand Muralidhar
+#
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License.
+
+"""Compare two --benchmark_out JSON files and fail if any benchmark regressed.
+
+    compareBenchmarks.py baseline.json current.json [--time 0.10] [--allocs 0] [--rss 0.10]
+
+Thresholds are relative increases, e.g. --time 0.10 allows a benchmark to be 10% slower.
+When the files contain repetitions, only the "mean" aggregate is compared.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(fileName):
+    with open(fileName) as f:
+        benchmarks = json.load(f)["benchmarks"]
+    hasAggregates = any(b.get("run_type") == "aggregate" for b in benchmarks)
+    result = {}
+    for b in benchmarks:
+        if b.get("error_occurred"):
+            continue
+        if hasAggregates and b.get("aggregate_name") != "mean":
+            continue
+        result[b.get("run_name", b["name"])] = b
+    return result
+
+
+def relativeChange(old, new):
+    if old == 0:
+        return 0.0 if new == 0 else float("inf")
+    return (new - old) / old
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--time", type=float, default=0.10, help="allowed real_time increase")
+    parser.add_argument("--allocs", type=float, default=0.0, help="allowed allocs increase")
+    parser.add_argument("--rss", type=float, default=0.10, help="allowed rssDeltaMB increase")
+    args = parser.parse_args()
+
+    baseline, current = load(args.baseline), load(args.current)
+    checks = [("real_time", args.time), ("allocs", args.allocs), ("rssDeltaMB", args.rss)]
+
+    regressions = 0
+    print("%-50s %-10s %12s %12s %8s" % ("benchmark", "metric", "baseline", "current", "change"))
+    for name in sorted(set(baseline) & set(current)):
+        for metric, threshold in checks:
+            if metric not in baseline[name] or metric not in current[name]:
+                continue
+            old, new = baseline[name][metric], current[name][metric]
+            change = relativeChange(old, new)
+            regressed = change > threshold
+            regressions += regressed
+            print("%-50s %-10s %12.3f %12.3f %+7.1f%%%s" % (name, metric, old, new, 100 * change,
+                                                            "  REGRESSION" if regressed else ""))
+
+    for name in sorted(set(baseline) - set(current)):
+        print("%-50s missing from %s" % (name, args.current))
+
+    print("%d regression(s)" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
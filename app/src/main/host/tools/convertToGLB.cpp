@@ -0,0 +1,99 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Converts an OBJ into the GLB that AssimpLoader maps and uploads without copies, see
+// glbWriter.h. The OBJ is imported with the profile the GLB is meant to stand in for, so the GLB
+// has the normals and tangents that profile computes; the GLB is then read back and checked:
+//   ConvertToGLB --model <obj> [--out <glb>] [--profile minimal|lit|full]
+// the GLB goes next to the OBJ by default, with the profile the app uses when none is given
+
+#include "assimpLoader.h"
+#include "glbWriter.h"
+#include "misc.h"
+#include "myGLBFile.h"
+#include "myJNIHelper.h"
+#include <stdio.h>
+#include <string.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+int main(int argc, char **argv) {
+
+    std::string objPath, glbPath;
+    ImportProfile importProfile = DEFAULT_IMPORT_PROFILE;
+    bool isUsage = true;
+    for (int i = 1; i + 1 < argc && isUsage; i += 2) {
+        if (strcmp(argv[i], "--model") == 0) {
+            objPath = argv[i + 1];
+        } else if (strcmp(argv[i], "--out") == 0) {
+            glbPath = argv[i + 1];
+        } else {
+            isUsage = strcmp(argv[i], "--profile") == 0 &&
+                      GetImportProfileByName(argv[i + 1], importProfile);
+        }
+    }
+    if (!isUsage || argc % 2 == 0 || objPath.empty()) {
+        fprintf(stderr, "usage: ConvertToGLB --model <obj> [--out <glb>] "
+                        "[--profile minimal|lit|full]\n");
+        return 1;
+    }
+    if (glbPath.empty()) {
+        std::string::size_type dotIndex = objPath.find_last_of('.');
+        glbPath = objPath.substr(0, dotIndex == std::string::npos ? objPath.size() : dotIndex) +
+                  ".glb";
+    }
+
+    Assimp::Importer importer;
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    const aiScene *scene = importer.ReadFile(objPath, GetImportProfileFlags(importProfile));
+    if (!scene) {
+        fprintf(stderr, "Cannot import %s: %s\n", objPath.c_str(), importer.GetErrorString());
+        return 1;
+    }
+    if (!WriteGLB(scene, GetDirectoryName(objPath), glbPath)) {
+        fprintf(stderr, "Cannot write %s\n", glbPath.c_str());
+        return 1;
+    }
+
+    // read it back the way the loader will
+    MyGLBFile glbFile;
+    if (!glbFile.Open(glbPath)) {
+        fprintf(stderr, "Cannot read back %s\n", glbPath.c_str());
+        return 1;
+    }
+    unsigned int triangles = 0;
+    for (unsigned int p = 0; p < glbFile.GetPrimitives().size(); ++p) {
+        const GLBPrimitive &primitive = glbFile.GetPrimitives()[p];
+        triangles += (primitive.indices >= 0 ? glbFile.GetAccessors()[primitive.indices].count :
+                      glbFile.GetAccessors()[primitive.positions].count) / 3;
+    }
+    unsigned int sceneTriangles = 0;
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+        sceneTriangles += scene->mMeshes[m]->mNumFaces;
+    }
+    if (glbFile.GetPrimitives().size() != scene->mNumMeshes || triangles != sceneTriangles) {
+        fprintf(stderr, "%s has %zu meshes and %u triangles, the OBJ %u and %u\n",
+                glbPath.c_str(), glbFile.GetPrimitives().size(), triangles, scene->mNumMeshes,
+                sceneTriangles);
+        return 1;
+    }
+    printf("%u meshes, %u triangles, %zu materials and %zu images, %zu bytes written to %s\n",
+           scene->mNumMeshes, triangles, glbFile.GetMaterials().size(),
+           glbFile.GetImages().size(), glbFile.GetFileSize(), glbPath.c_str());
+    return 0;
+}
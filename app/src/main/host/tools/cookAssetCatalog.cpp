@@ -0,0 +1,107 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Cooks the asset catalog: scans every directory under the assets for OBJs, hashes the OBJs,
+// their MTLs and textures, and writes the catalog that MyAssetCatalog::Load reads at startup.
+// Run it after adding or changing a model:
+//   CookAssetCatalog [--assets <dir>] [--out <catalog.txt>]
+// the catalog goes to <dir>/catalog.txt by default
+
+#include "misc.h"
+#include "myAssetCatalog.h"
+#include "myJNIHelper.h"
+#include <algorithm>
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+/**
+ * The directory and its subdirectories, depth-first in name order so the catalog is stable
+ */
+static void ScanAssetTree(MyAssetCatalog &catalog, const std::string &assetDir,
+                          const std::string &directory) {
+
+    catalog.ScanDirectory(directory, true);
+
+    std::string fullDir = directory.empty() ? assetDir : assetDir + "/" + directory;
+    DIR *dir = opendir(fullDir.c_str());
+    if (!dir) {
+        return;
+    }
+    std::vector<std::string> subDirs;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat fileStat;
+        if (entry->d_name[0] != '.' &&
+            stat((fullDir + "/" + entry->d_name).c_str(), &fileStat) == 0 &&
+            S_ISDIR(fileStat.st_mode)) {
+            subDirs.push_back(directory.empty() ? entry->d_name :
+                              directory + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(subDirs.begin(), subDirs.end());
+    for (unsigned int d = 0; d < subDirs.size(); ++d) {
+        ScanAssetTree(catalog, assetDir, subDirs[d]);
+    }
+}
+
+int main(int argc, char **argv) {
+
+    std::string assetDir = MY_HOST_ASSET_DIR;
+    std::string outPath;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--assets") == 0) {
+            assetDir = argv[i + 1];
+        } else if (strcmp(argv[i], "--out") == 0) {
+            outPath = argv[i + 1];
+        } else {
+            fprintf(stderr, "usage: CookAssetCatalog [--assets <dir>] [--out <catalog.txt>]\n");
+            return 1;
+        }
+    }
+    if (outPath.empty()) {
+        outPath = assetDir + "/" + MY_ASSET_CATALOG;
+    }
+
+    gHelperObject = new MyJNIHelper(assetDir, "/tmp");
+    MyAssetCatalog catalog;
+    ScanAssetTree(catalog, assetDir, "");
+    std::string catalogText = catalog.Serialize();
+    delete gHelperObject;
+
+    FILE *out = fopen(outPath.c_str(), "w");
+    if (!out || fwrite(catalogText.data(), 1, catalogText.size(), out) != catalogText.size()) {
+        fprintf(stderr, "Cannot write %s\n", outPath.c_str());
+        if (out) {
+            fclose(out);
+        }
+        return 1;
+    }
+    fclose(out);
+
+    size_t totalBytes = 0;
+    for (unsigned int m = 0; m < catalog.GetModels().size(); ++m) {
+        totalBytes += catalog.GetModels()[m].totalBytes;
+    }
+    printf("%zu models, %zu bytes of assets, written to %s\n", catalog.GetModels().size(),
+           totalBytes, outPath.c_str());
+    return 0;
+}
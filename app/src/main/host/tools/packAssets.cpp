@@ -0,0 +1,76 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Packs the assets into one archive that the app maps instead of opening every asset, see
+// myAssetArchive.h. By default images are stored, 4 KB-aligned so they are read in place, and
+// everything else is LZ4-compressed when that saves at least an eighth:
+//   PackAssets [--assets <dir>] [--out <assets.pak>] [--compression auto|store|lz4]
+// the archive goes to <dir>/assets.pak by default, leaving out the archive already there
+
+#include "myAssetArchive.h"
+#include "myJNIHelper.h"
+#include <stdio.h>
+#include <string.h>
+
+MyJNIHelper *gHelperObject = NULL;
+
+static ArchiveCompression GetStoreCompression(const std::string &) { return ARCHIVE_STORE; }
+static ArchiveCompression GetLZ4Compression(const std::string &) { return ARCHIVE_LZ4; }
+
+int main(int argc, char **argv) {
+
+    std::string assetDir = MY_HOST_ASSET_DIR;
+    std::string outPath;
+    ArchiveCompression (*getCompression)(const std::string &) = GetDefaultArchiveCompression;
+    bool isUsage = true;
+    for (int i = 1; i + 1 < argc && isUsage; i += 2) {
+        if (strcmp(argv[i], "--assets") == 0) {
+            assetDir = argv[i + 1];
+        } else if (strcmp(argv[i], "--out") == 0) {
+            outPath = argv[i + 1];
+        } else if (strcmp(argv[i], "--compression") == 0 && strcmp(argv[i + 1], "store") == 0) {
+            getCompression = GetStoreCompression;
+        } else if (strcmp(argv[i], "--compression") == 0 && strcmp(argv[i + 1], "lz4") == 0) {
+            getCompression = GetLZ4Compression;
+        } else {
+            isUsage = strcmp(argv[i], "--compression") == 0 && strcmp(argv[i + 1], "auto") == 0;
+        }
+    }
+    if (!isUsage || argc % 2 == 0) {
+        fprintf(stderr, "usage: PackAssets [--assets <dir>] [--out <assets.pak>] "
+                        "[--compression auto|store|lz4]\n");
+        return 1;
+    }
+    if (outPath.empty()) {
+        outPath = assetDir + "/" + MY_ASSET_ARCHIVE;
+    }
+
+    MyAssetArchiveWriter writer;
+    if (!writer.AddDirectory(assetDir, MY_ASSET_ARCHIVE, getCompression)) {
+        fprintf(stderr, "Cannot read %s\n", assetDir.c_str());
+        return 1;
+    }
+    if (!writer.Write(outPath)) {
+        fprintf(stderr, "Cannot write %s\n", outPath.c_str());
+        return 1;
+    }
+    printf("%u assets, %u stored and %u LZ4, %zu bytes packed into %zu, written to %s\n",
+           writer.GetEntryCount(), writer.GetEntryCount(ARCHIVE_STORE),
+           writer.GetEntryCount(ARCHIVE_LZ4), writer.GetSize(), writer.GetStoredSize(),
+           outPath.c_str());
+    return 0;
+}
@@ -22,8 +22,22 @@ import android.os.Bundle;
 import android.view.View;
 import android.widget.Button;
 
+import java.util.Arrays;
+
 
 public class AssimpActivity extends Activity{
+    // IDs of the first model, then of buttons 1 to 5, in the native asset catalog; a model's ID
+    // is its directory in the assets, the catalog knows its OBJ, MTL and textures
+    private static final String[] MODELS = {
+            "b",
+            "andy",
+//            "n",
+            "wonder",
+            "d",
+            "q",
+            "w"
+    };
+
     private MyGLSurfaceView mGLView = null;
     private native void CreateObjectNative(AssetManager assetManager, String pathToInternalDir);
     private native void DeleteObjectNative();
@@ -43,60 +57,44 @@ public class AssimpActivity extends Activity{
         setContentView(R.layout.assimp_layout);
 
         mGLView = (MyGLSurfaceView) findViewById (R.id.gl_surface_view);
-        mGLView.setModel("b/Plane.obj", "b/Plane.mtl", "b/color.png");
-
-        Button btn1 = (Button) findViewById(R.id.btn1);
-        btn1.setOnClickListener(new View.OnClickListener() {
-            @Override
-            public void onClick(View v) {
-                mGLView.setModel("andy/andy.obj", "andy/materials.mtl", "andy/andy.png");
-            }
-        });
-
-        Button btn2 = (Button) findViewById(R.id.btn2);
-        btn2.setOnClickListener(new View.OnClickListener() {
-            @Override
-            public void onClick(View v) {
-//                mGLView.setModel("n/googlepoly.obj", "n/googlepoly.mtl", "n/M03601.jpg");
-
-                String texFileNames = "wonder/WW_Cine1_D_Low.png&wonder/WW_Cine1_N.png&" +
-                        "wonder/WW_Cine1_Shield_D_Low.png&wonder/WW_Cine1_Shield_N.png&" +
-                        "wonder/WW_Cine1_Sword_A.png&wonder/WW_Cine1_Sword_N.png&" +
-                        "wonder/lasso_d.png&wonder/lasso_n.png";
-
-                mGLView.setModel("wonder/wonderwoman.obj", "wonder/wonderwoman.mtl", texFileNames);
-            }
-        });
-
-        Button btn3 = (Button) findViewById(R.id.btn3);
-        btn3.setOnClickListener(new View.OnClickListener() {
-            @Override
-            public void onClick(View v) {
-                mGLView.setModel("d/googlepoly.obj", "d/googlepoly.mtl", "d/b16.jpg");
-            }
-        });
-
-        Button btn4 = (Button) findViewById(R.id.btn4);
-        btn4.setOnClickListener(new View.OnClickListener() {
-            @Override
-            public void onClick(View v) {
-                mGLView.setModel("q/googlepolyred.obj", "q/googlepolyred.mtl", "q/BoaBoaYellowBlueLines.jpg");
-            }
-        });
-
-        Button btn5 = (Button) findViewById(R.id.btn5);
-        btn5.setOnClickListener(new View.OnClickListener() {
-            @Override
-            public void onClick(View v) {
-                mGLView.setModel("w/we.obj", "r/we.mtl", "");
-            }
-        });
+        showModel(0);
+
+        int[] buttonIds = {R.id.btn1, R.id.btn2, R.id.btn3, R.id.btn4, R.id.btn5};
+        for (int i = 0; i < buttonIds.length; ++i) {
+            final int modelIndex = i + 1;
+            Button button = (Button) findViewById(buttonIds[i]);
+            button.setOnClickListener(new View.OnClickListener() {
+                @Override
+                public void onClick(View v) {
+                    showModel(modelIndex);
+                }
+            });
+        }
 
         // mGestureObject will handle touch gestures on the screen
         mGestureObject = new GestureClass(this);
         mGLView.setOnTouchListener(mGestureObject.TwoFingerGestureListener);
     }
 
+    /**
+     * Show a model and preload the buttons' other models, nearest buttons first since those
+     * are the likeliest to be pressed next. The neighbours are those of the new model
+     */
+    private void showModel(int modelIndex) {
+        String[] modelIds = new String[MODELS.length];
+        int preloadIndex = 0;
+        for (int distance = 1; distance < MODELS.length; ++distance) {
+            int[] neighbours = {modelIndex + distance, modelIndex - distance};
+            for (int neighbour : neighbours) {
+                // the first model has no button
+                if (neighbour >= 1 && neighbour < MODELS.length) {
+                    modelIds[preloadIndex++] = MODELS[neighbour];
+                }
+            }
+        }
+        mGLView.setModel(MODELS[modelIndex], Arrays.copyOf(modelIds, preloadIndex));
+    }
+
     @Override
     protected void onResume() {
 
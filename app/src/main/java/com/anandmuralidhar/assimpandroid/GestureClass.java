@@ -29,10 +29,11 @@ public class GestureClass {
 
    private GestureDetectorCompat mTapScrollDetector;
     private ScaleGestureDetector mScaleDetector;
-    private native void DoubleTapNative();
-    private native void ScrollNative(float distanceX, float distanceY, float positionX, float positionY);
-    private native void ScaleNative(float scaleFactor);
-    private native void MoveNative(float distanceX, float distanceY);
+    private native void DoubleTapNative(long eventTimeMs);
+    private native void ScrollNative(float distanceX, float distanceY, float positionX, float positionY,
+                                     long eventTimeMs);
+    private native void ScaleNative(float scaleFactor, long eventTimeMs);
+    private native void MoveNative(float distanceX, float distanceY, long eventTimeMs);
 
     public GestureClass(Activity activity) {
 
@@ -78,7 +79,7 @@ public class GestureClass {
                         // Remember this touch position for the next move event
                         mLastTouchX = x;
                         mLastTouchY = y;
-                        MoveNative(dx, dy);
+                        MoveNative(dx, dy, event.getEventTime());
                     }
                     break;
                 }
@@ -119,7 +120,7 @@ public class GestureClass {
     class MyTapScrollListener extends GestureDetector.SimpleOnGestureListener {
 
         public boolean onDoubleTap (MotionEvent event) {
-            DoubleTapNative();
+            DoubleTapNative(event.getEventTime());
             return true;
         }
 
@@ -129,7 +130,7 @@ public class GestureClass {
                                  float distanceX, float distanceY) {
 
             if(mTwoFingerPointerId == INVALID_POINTER_ID) {
-                ScrollNative(distanceX, distanceY, e2.getX(), e2.getY());
+                ScrollNative(distanceX, distanceY, e2.getX(), e2.getY(), e2.getEventTime());
             }
             return true;
         }
@@ -141,7 +142,7 @@ public class GestureClass {
         @Override
         public boolean onScale(ScaleGestureDetector detector) {
             Log.e("onScale", detector.getScaleFactor() + "");
-            ScaleNative(detector.getScaleFactor());
+            ScaleNative(detector.getScaleFactor(), detector.getEventTime());
             return true;
         }
     }
@@ -30,9 +30,26 @@ class MyGLRenderer implements GLSurfaceView.Renderer {
 
     private native void SurfaceChangedNative(int width, int height);
 
-    private native void ResetModelNative(String objFileName, String mtlFileName, String texFileName);
+    // any thread: cancels the load of the previous request, returns the new request's number
+    private native int RequestModelNative();
 
-    private String objFileName, mtlFileName, texFileName;
+    // importProfile is "minimal", "lit" or "full", see ImportProfile in assimpLoader.h
+    // the load is skipped or cancelled once a newer request than modelRequest exists
+    private native void ResetModelNative(String modelId, String importProfile, int modelRequest);
+
+    // {CPU bytes, GPU buffer bytes, GPU texture bytes} held by the loaded model
+    private native long[] GetModelMemoryStatsNative();
+
+    // models likely to be shown next, most likely first; replaces the previous list
+    private native void PreloadModelsNative(String[] modelIds, String importProfile);
+
+    // {requested, prepared, uploaded, cancelled, hits, misses} of the preloads
+    private native long[] GetPreloadStatsNative();
+
+    private String modelId, importProfile;
+    private int modelRequest;
+    private String[] preloadModelIds;   // picked for modelId, preloaded once it has loaded
+    private boolean isSurfaceCreated = false;
 
 
     public MyGLRenderer() {
@@ -43,7 +60,33 @@ class MyGLRenderer implements GLSurfaceView.Renderer {
         // create (or recreate) native objects that are required for rendering
         Log.d("MyGLRenderer", "onSurfaceCreated");
         SurfaceCreatedNative();
-        ResetModelNative(objFileName, mtlFileName, texFileName);
+        isSurfaceCreated = true;
+        loadModel();
+    }
+
+    private void loadModel() {
+        if (modelId == null) {
+            return;
+        }
+        ResetModelNative(modelId, importProfile, modelRequest);
+
+        long[] memoryStats = GetModelMemoryStatsNative();
+        Log.d("MyGLRenderer", "model memory: cpu " + memoryStats[0] + " B, gpu buffers "
+                + memoryStats[1] + " B, gpu textures " + memoryStats[2] + " B");
+
+        long[] preloadStats = GetPreloadStatsNative();
+        long loads = preloadStats[4] + preloadStats[5];
+        Log.d("MyGLRenderer", "preload hits " + preloadStats[4] + " of " + loads + " loads, "
+                + preloadStats[1] + " prepared, " + preloadStats[2] + " uploaded, "
+                + preloadStats[3] + " cancelled");
+        preload();
+    }
+
+    private void preload() {
+        if (preloadModelIds == null) {
+            return;
+        }
+        PreloadModelsNative(preloadModelIds, importProfile);
     }
 
     public void onDrawFrame(GL10 unused) {
@@ -64,10 +107,22 @@ class MyGLRenderer implements GLSurfaceView.Renderer {
 
     }
 
-    public void setModel(String objFileName, String mtlFileName, String texFileName) {
-        this.objFileName = objFileName;
-        this.mtlFileName = mtlFileName;
-        this.texFileName = texFileName;
+    // called on the UI thread when a model is picked, before setModel is queued
+    public int requestModel() {
+        return RequestModelNative();
+    }
+
+    // preloadModelIds are the models likely to follow this one, with the same import profile
+    public void setModel(String modelId, String importProfile, int modelRequest,
+                         String[] preloadModelIds) {
+        this.modelRequest = modelRequest;
+        this.modelId = modelId;
+        this.importProfile = importProfile;
+        this.preloadModelIds = preloadModelIds;
+        // called on the GL thread once the surface exists, see MyGLSurfaceView.setModel
+        if (isSurfaceCreated) {
+            loadModel();
+        }
     }
 
 }
\ No newline at end of file
@@ -16,6 +16,7 @@
 
 package com.anandmuralidhar.assimpandroid;
 
+import android.app.ActivityManager;
 import android.content.Context;
 import android.opengl.GLSurfaceView;
 import android.util.AttributeSet;
@@ -24,6 +25,7 @@ import android.util.Log;
 class MyGLSurfaceView extends GLSurfaceView {
 
     private MyGLRenderer mRenderer;
+    private String mImportProfile;
 
     public MyGLSurfaceView(Context context, AttributeSet attrs) {
         super(context, attrs);
@@ -35,11 +37,15 @@ class MyGLSurfaceView extends GLSurfaceView {
             // Create GLES context. Even though we are specifying OpenGL ES 2, it will try to
             // create the highest possible context on a phone
             setEGLContextClientVersion(2);
+            mImportProfile = selectImportProfile();
 
             // set our custom Renderer for drawing on the created SurfaceView
             mRenderer = new MyGLRenderer();
             setRenderer(mRenderer);
 
+            // keep the context, and the models cached in it, while the activity is paused
+            setPreserveEGLContextOnPause(true);
+
             // calls onDrawFrame(...) continuously
             setRenderMode(GLSurfaceView.RENDERMODE_CONTINUOUSLY);
         } catch (Exception e) {
@@ -48,11 +54,41 @@ class MyGLSurfaceView extends GLSurfaceView {
         }
     }
 
-    public void setModel(String objFileName, String mtlFileName, String texFileName) {
+    // the most the device affords: normals for the lighting tiers unless memory is scarce, and
+    // the tangents of the full profile for normal maps on GLES 3 devices with a large heap
+    private String selectImportProfile() {
+        ActivityManager activityManager =
+                (ActivityManager) getContext().getSystemService(Context.ACTIVITY_SERVICE);
+        String importProfile = "lit";
+        if (activityManager.isLowRamDevice()) {
+            importProfile = "minimal";
+        } else if (activityManager.getDeviceConfigurationInfo().reqGlEsVersion >= 0x30000
+                && activityManager.getMemoryClass() >= 256) {
+            importProfile = "full";
+        }
+        Log.d("MyGLSurfaceView", "import profile " + importProfile);
+        return importProfile;
+    }
+
+    public void setModel(String modelId, String[] preloadModelIds) {
+        setModel(modelId, mImportProfile, preloadModelIds);
+    }
+
+    // loads on the GL thread without recreating the context, so models viewed before come
+    // from the native model cache. A load still running for an earlier call is cancelled
+    // right away, from this thread, rather than finishing before this one starts.
+    // preloadModelIds, most likely first, load in the background once this model has loaded;
+    // they travel with the model so that no preload is started for the previous one's list
+    public void setModel(final String modelId, final String importProfile,
+                         final String[] preloadModelIds) {
         if (mRenderer != null) {
-            onPause();
-            mRenderer.setModel(objFileName, mtlFileName, texFileName);
-            onResume();
+            final int modelRequest = mRenderer.requestModel();
+            queueEvent(new Runnable() {
+                @Override
+                public void run() {
+                    mRenderer.setModel(modelId, importProfile, modelRequest, preloadModelIds);
+                }
+            });
         }
     }
 
@@ -24,72 +24,68 @@ extern "C" {
 
 extern ModelAssimp *gAssimpObject;
 
-JNIEXPORT void JNICALL
-Java_com_anandmuralidhar_assimpandroid_GestureClass_DoubleTapNative(JNIEnv *env, jobject instance) {
+/**
+ * Gestures arrive on the UI thread; they are queued and applied by ModelAssimp::Render on the
+ * GL thread. eventTimeMs is MotionEvent.getEventTime(), i.e. SystemClock.uptimeMillis
+ */
+static void PushGesture(GestureType type, float x, float y, float positionX, float positionY,
+                        jlong eventTimeMs) {
 
     if (gAssimpObject == NULL) {
         return;
     }
-    gAssimpObject->DoubleTapAction();
+    GestureEvent gestureEvent;
+    gestureEvent.type = type;
+    gestureEvent.x = x;
+    gestureEvent.y = y;
+    gestureEvent.positionX = positionX;
+    gestureEvent.positionY = positionY;
+    gestureEvent.timestampNs = eventTimeMs > 0 ? eventTimeMs * 1000000LL : GetMonotonicTimeNs();
+    if (!gAssimpObject->PushGesture(gestureEvent)) {
+        MyLOGD("Gesture queue full, dropped a gesture");
+    }
+}
 
+JNIEXPORT void JNICALL
+Java_com_anandmuralidhar_assimpandroid_GestureClass_DoubleTapNative(JNIEnv *env, jobject instance,
+                                                                    jlong eventTimeMs) {
+
+    PushGesture(GESTURE_DOUBLE_TAP, 0, 0, 0, 0, eventTimeMs);
 }
 
 /**
- * one finger drag - compute normalized current position and normalized displacement
- * from previous position
+ * one finger drag - distance moved and current position in pixels, normalized on the GL thread
  */
 JNIEXPORT void JNICALL
 Java_com_anandmuralidhar_assimpandroid_GestureClass_ScrollNative(JNIEnv *env, jobject instance,
                                                                jfloat distanceX, jfloat distanceY,
-                                                               jfloat positionX, jfloat positionY) {
-
-    if (gAssimpObject == NULL) {
-        return;
-    }
-    // normalize movements on the screen wrt GL surface dimensions
-    // invert dY to be consistent with GLES conventions
-    float dX = (float) distanceX / gAssimpObject->GetScreenWidth();
-    float dY = -(float) distanceY / gAssimpObject->GetScreenHeight();
-    float posX = 2*positionX/ gAssimpObject->GetScreenWidth() - 1.;
-    float posY = -2*positionY / gAssimpObject->GetScreenHeight() + 1.;
-    posX = fmax(-1., fmin(1., posX));
-    posY = fmax(-1., fmin(1., posY));
-    gAssimpObject->ScrollAction(dX, dY, posX, posY);
+                                                               jfloat positionX, jfloat positionY,
+                                                               jlong eventTimeMs) {
 
+    PushGesture(GESTURE_SCROLL, distanceX, distanceY, positionX, positionY, eventTimeMs);
 }
 
 /**
- * Pinch-and-zoom gesture: pass the change in scale to class' method
+ * Pinch-and-zoom gesture: pass the change in scale
  */
 JNIEXPORT void JNICALL
 Java_com_anandmuralidhar_assimpandroid_GestureClass_ScaleNative(JNIEnv *env, jobject instance,
-                                                              jfloat scaleFactor) {
-
-    if (gAssimpObject == NULL) {
-        return;
-    }
-    gAssimpObject->ScaleAction((float) scaleFactor);
+                                                              jfloat scaleFactor,
+                                                              jlong eventTimeMs) {
 
+    PushGesture(GESTURE_SCALE, scaleFactor, 0, 0, 0, eventTimeMs);
 }
 
 
 /**
- * Two-finger drag - normalize the distance moved wrt GLES surface size
+ * Two-finger drag - distance moved in pixels, normalized on the GL thread
  */
 JNIEXPORT void JNICALL
 Java_com_anandmuralidhar_assimpandroid_GestureClass_MoveNative(JNIEnv *env, jobject instance,
-                                                               jfloat distanceX, jfloat distanceY) {
-
-    if (gAssimpObject == NULL) {
-        return;
-    }
-
-    // normalize movements on the screen wrt GL surface dimensions
-    // invert dY to be consistent with GLES conventions
-    float dX = distanceX / gAssimpObject->GetScreenWidth();
-    float dY = -distanceY / gAssimpObject->GetScreenHeight();
-    gAssimpObject->MoveAction(dX, dY);
+                                                               jfloat distanceX, jfloat distanceY,
+                                                               jlong eventTimeMs) {
 
+    PushGesture(GESTURE_MOVE, distanceX, distanceY, 0, 0, eventTimeMs);
 }
 
 #ifdef __cplusplus
@@ -46,17 +46,108 @@ Java_com_anandmuralidhar_assimpandroid_MyGLRenderer_SurfaceCreatedNative(JNIEnv
 
 }
 
+JNIEXPORT jint JNICALL
+Java_com_anandmuralidhar_assimpandroid_MyGLRenderer_RequestModelNative(JNIEnv *env,
+                                                                       jobject instance) {
+
+    if (gAssimpObject == NULL) {
+        return 0;
+    }
+    return gAssimpObject->RequestModel();
+
+}
+
 JNIEXPORT void JNICALL
 Java_com_anandmuralidhar_assimpandroid_MyGLRenderer_ResetModelNative(JNIEnv *env,
                                                                      jobject instance,
-                                                                     jstring objFileName,
-                                                                     jstring mtlFileName,
-                                                                     jstring texFileName) {
+                                                                     jstring modelId,
+                                                                     jstring importProfile,
+                                                                     jint modelRequest) {
+
+    if (gAssimpObject == NULL) {
+        return;
+    }
+
+    const char *cModelId = env->GetStringUTFChars(modelId, NULL);
+    const char *cImportProfile = env->GetStringUTFChars(importProfile, NULL);
+
+    ImportProfile profile = DEFAULT_IMPORT_PROFILE;
+    if (!GetImportProfileByName(cImportProfile, profile)) {
+        MyLOGE("Unknown import profile %s, using %s", cImportProfile,
+               GetImportProfileName(profile));
+    }
+    gAssimpObject->ResetModel(std::string(cModelId), profile, modelRequest);
+    env->ReleaseStringUTFChars(modelId, cModelId);
+    env->ReleaseStringUTFChars(importProfile, cImportProfile);
+
+}
+
+JNIEXPORT void JNICALL
+Java_com_anandmuralidhar_assimpandroid_MyGLRenderer_PreloadModelsNative(JNIEnv *env,
+                                                                        jobject instance,
+                                                                        jobjectArray modelIds,
+                                                                        jstring importProfile) {
 
     if (gAssimpObject == NULL) {
         return;
     }
-    gAssimpObject->ResetModel(env, instance, objFileName, mtlFileName, texFileName);
+
+    const char *cImportProfile = env->GetStringUTFChars(importProfile, NULL);
+    ImportProfile profile = DEFAULT_IMPORT_PROFILE;
+    if (!GetImportProfileByName(cImportProfile, profile)) {
+        MyLOGE("Unknown import profile %s, using %s", cImportProfile,
+               GetImportProfileName(profile));
+    }
+    env->ReleaseStringUTFChars(importProfile, cImportProfile);
+
+    std::vector<std::string> ids(env->GetArrayLength(modelIds));
+    for (unsigned int m = 0; m < ids.size(); ++m) {
+        jstring modelId = (jstring) env->GetObjectArrayElement(modelIds, m);
+        const char *cModelId = env->GetStringUTFChars(modelId, NULL);
+        ids[m] = cModelId;
+        env->ReleaseStringUTFChars(modelId, cModelId);
+        env->DeleteLocalRef(modelId);
+    }
+    gAssimpObject->PreloadModels(ids, profile);
+
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_anandmuralidhar_assimpandroid_MyGLRenderer_GetPreloadStatsNative(JNIEnv *env,
+                                                                          jobject instance) {
+
+    // {requested, prepared, uploaded, cancelled, hits, misses}
+    jlong statsArray[6] = {0, 0, 0, 0, 0, 0};
+    if (gAssimpObject != NULL) {
+        PreloadStats stats = gAssimpObject->GetPreloadStats();
+        statsArray[0] = stats.requested;
+        statsArray[1] = stats.prepared;
+        statsArray[2] = stats.uploaded;
+        statsArray[3] = stats.cancelled;
+        statsArray[4] = stats.hits;
+        statsArray[5] = stats.misses;
+    }
+    jlongArray result = env->NewLongArray(6);
+    env->SetLongArrayRegion(result, 0, 6, statsArray);
+    return result;
+
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_anandmuralidhar_assimpandroid_MyGLRenderer_GetModelMemoryStatsNative(JNIEnv *env,
+                                                                              jobject instance) {
+
+    // {CPU bytes, GPU buffer bytes, GPU texture bytes}
+    jlong statsArray[3] = {0, 0, 0};
+    if (gAssimpObject != NULL) {
+        ModelMemoryStats stats = gAssimpObject->GetModelMemoryStats();
+        statsArray[0] = stats.cpuBytes;
+        statsArray[1] = stats.gpuBufferBytes;
+        statsArray[2] = stats.gpuTextureBytes;
+    }
+    jlongArray result = env->NewLongArray(3);
+    env->SetLongArrayRegion(result, 0, 3, statsArray);
+    return result;
 
 }
 
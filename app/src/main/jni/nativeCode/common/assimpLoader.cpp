@@ -15,29 +15,115 @@
  */
 
 #include "assimpLoader.h"
-#include "myShader.h"
+#include "myAllocTracker.h"
+#include "myAssetIOSystem.h"
+#include "myJNIHelper.h"
+#include "myJobSystem.h"
+#include "myMeshCodec.h"
+#include "myMeshPostProcess.h"
+#include "myShaderVariants.h"
 #include "misc.h"
+#include <assimp/ProgressHandler.hpp>
+#include <assimp/version.h>
+#include <dirent.h>
+#include <float.h>
+#include <math.h>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <stdint.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+// bump it when a change to the import or our post-processing changes the meshes it makes
+#define MESH_CACHE_PIPELINE_VERSION     1
 
 /**
- * Class constructor, loads shaders & gets locations of variables in them
+ * Asks ReadFile to stop once the load is cancelled. Assimp 3.0 only calls Update at the start
+ * and the end of the file parsing and ignores the answer there, so with it a cancelled
+ * ReadFile still runs to the end; later versions poll it during parsing too
+ */
+class MyImportProgress : public Assimp::ProgressHandler {
+public:
+    MyImportProgress() : cancelToken(NULL) {}
+
+    bool Update(float percentage) {
+        return !IsCancelled(cancelToken);
+    }
+
+    const MyCancelToken *   cancelToken;        // of the ReadFile running now
+};
+
+
+// for the lit variants, in model space
+static const glm::vec3 gLightDirection = glm::normalize(glm::vec3(0.3f, 0.5f, 0.8f));
+
+static const char *gImportProfileNames[IMPORT_PROFILE_COUNT] = {"minimal", "lit", "full"};
+
+/**
+ * Post-processing flags of a profile. Every profile sorts by primitive type, so that the
+ * points and lines dropped by AI_CONFIG_PP_SBP_REMOVE never reach the triangle-only renderer
+ */
+unsigned int GetImportProfileFlags(ImportProfile profile) {
+
+    unsigned int minimalFlags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices |
+                                aiProcess_SortByPType;
+    switch (profile) {
+        case IMPORT_PROFILE_MINIMAL_TEXTURED:
+            return minimalFlags;
+        case IMPORT_PROFILE_LIT:
+            return minimalFlags | aiProcess_GenSmoothNormals | aiProcess_ImproveCacheLocality |
+                   aiProcess_RemoveRedundantMaterials;
+        default:
+            return aiProcessPreset_TargetRealtime_Quality;
+    }
+}
+
+const char * GetImportProfileName(ImportProfile profile) {
+    return profile < IMPORT_PROFILE_COUNT ? gImportProfileNames[profile] : "unknown";
+}
+
+/**
+ * Look up a profile by the names used on the Java side and on the host command line
+ */
+bool GetImportProfileByName(std::string profileName, ImportProfile &profile) {
+    for (int i = 0; i < IMPORT_PROFILE_COUNT; ++i) {
+        if (profileName == gImportProfileNames[i]) {
+            profile = (ImportProfile) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Class constructor, does not touch GL
  */
 AssimpLoader::AssimpLoader() {
     importerPtr = new Assimp::Importer;
+    importProgress = new MyImportProgress;
+    importerPtr->SetProgressHandler(importProgress);
+    assetIOSystem = new MyAssetIOSystem;
+    importerPtr->SetIOHandler(assetIOSystem);
+    importerPtr->SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
+                                    aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    measureImportSteps = false;
+    postProcessThreads = GetDefaultPostProcessThreads();
     scene = NULL;
+    decodedScene = NULL;
+    glbFile = NULL;
+    meshCacheKey = 0;
     isObjectLoaded = false;
-
-    // shader related setup -- loading, attribute and uniform locations
-    std::string vertexShader    = "shaders/modelTextured.vsh";
-    std::string fragmentShader  = "shaders/modelTextured.fsh";
-    shaderProgramID         = LoadShaders(vertexShader, fragmentShader);
-    vertexAttribute         = GetAttributeLocation(shaderProgramID, "vertexPosition");
-    vertexUVAttribute       = GetAttributeLocation(shaderProgramID, "vertexUV");
-    mvpLocation             = GetUniformLocation(shaderProgramID, "mvpMat");
-    textureSamplerLocation  = GetUniformLocation(shaderProgramID, "textureSampler");
-
-    CheckGLError("AssimpLoader::AssimpLoader");
+    boundsMin = boundsMax = glm::vec3(0);
+    gpuBufferBytes = gpuTextureBytes = 0;
+    visibleInstances = 0;
+    memset(usedShaderVariants, 0, sizeof(usedShaderVariants));
+    memset(&readStats, 0, sizeof(readStats));
+    mappedUploadBytes = 0;
+    isUploading = false;
+    uploadedTextures = uploadedMeshes = 0;
 }
 
 /**
@@ -45,223 +131,604 @@ AssimpLoader::AssimpLoader() {
  */
 AssimpLoader::~AssimpLoader() {
     Delete3DModel();
+    FreeScene();
     if(importerPtr) {
         delete importerPtr;
         importerPtr = NULL;
     }
-    scene = NULL; // gets deleted along with importerPtr
 }
 
 /**
- * Generate buffers for vertex positions, texture coordinates, faces -- and load data into them
+ * Drop a prepared scene, whether the importer or the mesh cache made it, or unmap a GLB
  */
-void AssimpLoader::GenerateGLBuffers() {
+void AssimpLoader::FreeScene() {
+
+    if (glbFile) {
+        delete glbFile;
+        glbFile = NULL;
+    } else if (decodedScene) {
+        delete decodedScene;
+        decodedScene = NULL;
+        decodedIndices.clear();     // the arena memory goes with the next reset
+    } else if (importerPtr) {
+        importerPtr->FreeScene();
+    }
+    scene = NULL;
+}
 
-    struct MeshInfo newMeshInfo; // this struct is updated for each mesh in the model
-    GLuint buffer;
+/**
+ * Convert Assimp's faces (triangulated by the import) to a flat index array for GLES
+ */
+void AssimpLoader::PackFaceIndices(const aiMesh *mesh, unsigned int *faceArray) {
 
-    // For every mesh -- load face indices, vertex positions, vertex texture coords
-    // also copy texture index for mesh into newMeshInfo.textureIndex
+    unsigned int faceIndex = 0;
+    for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
 
-    MyLOGE("scene->mNumMeshes %d=", scene->mNumMeshes);
+        // read a face from assimp's mesh and copy it into faceArray
+        const aiFace *face = &mesh->mFaces[t];
+        memcpy(&faceArray[faceIndex], face->mIndices, 3 * sizeof(unsigned int));
+        faceIndex += 3;
 
-    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+    }
+}
 
-        const aiMesh *mesh = scene->mMeshes[n]; // read the n-th mesh
+/**
+ * Copy the first UV channel into a tightly packed (u,v) array
+ */
+void AssimpLoader::PackTextureCoords(const aiMesh *mesh, float *textureCoords) {
 
-        // create array with faces
-        // convert from Assimp's format to array for GLES
-        unsigned int *faceArray = new unsigned int[mesh->mNumFaces * 3];
-        unsigned int faceIndex = 0;
-        for (unsigned int t = 0; t < mesh->mNumFaces; ++t) {
+    for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
+        textureCoords[k * 2] = mesh->mTextureCoords[0][k].x;
+        textureCoords[k * 2 + 1] = mesh->mTextureCoords[0][k].y;
+    }
+}
 
-            // read a face from assimp's mesh and copy it into faceArray
-            const aiFace *face = &mesh->mFaces[t];
-            memcpy(&faceArray[faceIndex], face->mIndices, 3 * sizeof(unsigned int));
-            faceIndex += 3;
+/**
+ * Read the whole file into the arena, returns an empty Mat on failure
+ */
+static cv::Mat ReadFileToArena(std::string fileName, MyArena *arena) {
 
-        }
-        newMeshInfo.numberOfFaces = scene->mMeshes[n]->mNumFaces;
+    FILE *file = fopen(fileName.c_str(), "rb");
+    if (!file) {
+        return cv::Mat();
+    }
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char *fileBuffer = NULL;
+    if (fileSize > 0) {
+        fileBuffer = arena->AllocateArray<unsigned char>(fileSize);
+    }
+    bool isRead = fileBuffer && fread(fileBuffer, 1, fileSize, file) == (size_t) fileSize;
+    fclose(file);
+    return isRead ? cv::Mat(1, (int) fileSize, CV_8UC1, fileBuffer) : cv::Mat();
+}
 
-        // buffer for faces
-        if (newMeshInfo.numberOfFaces) {
+/**
+ * Decode an encoded image, into the arena if there is one
+ */
+static void DecodeImage(const cv::Mat &encodedImage, cv::Mat &textureImage,
+                        MyArena *stagingArena) {
+    textureImage.release();
+    if (stagingArena) {
+        // imdecode creates the image through the destination's allocator
+        textureImage.allocator = stagingArena->GetMatAllocator();
+        cv::imdecode(encodedImage, cv::IMREAD_COLOR, &textureImage);
+    } else {
+        textureImage = cv::imdecode(encodedImage, cv::IMREAD_COLOR);
+    }
+}
 
-            glGenBuffers(1, &buffer);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                         sizeof(unsigned int) * mesh->mNumFaces * 3, faceArray,
-                         GL_STATIC_DRAW);
-            newMeshInfo.faceBuffer = buffer;
+/**
+ * Read a texture with OpenCV and convert it to the RGB, bottom-left origin layout GL expects
+ * With stagingArena the encoded file and the decoded pixels are kept in the arena, so
+ * textureImage must be released before the arena is rewound
+ */
+bool AssimpLoader::DecodeTexture(std::string textureFullPath, cv::Mat &textureImage,
+                                 MyArena *stagingArena) {
 
+    if (stagingArena) {
+        cv::Mat encodedImage = ReadFileToArena(textureFullPath, stagingArena);
+        if (encodedImage.empty()) {
+            return false;
         }
-        delete[] faceArray;
+        DecodeImage(encodedImage, textureImage, stagingArena);
+    } else {
+        textureImage = cv::imread(textureFullPath);
+    }
+    return FlipTextureForGL(textureImage);
+}
 
-        // buffer for vertex positions
-        if (mesh->HasPositions()) {
+/**
+ * Same for a texture already in memory, e.g. read by MyJNIHelper::ReadAsset
+ */
+bool AssimpLoader::DecodeTexture(const uint8_t *encodedData, size_t encodedSize,
+                                 cv::Mat &textureImage, MyArena *stagingArena, bool isFlipped) {
+
+    if (!encodedSize) {
+        return false;
+    }
+    // imdecode only reads its input
+    cv::Mat encodedImage(1, (int) encodedSize, CV_8UC1, const_cast<uint8_t *>(encodedData));
+    DecodeImage(encodedImage, textureImage, stagingArena);
+    return FlipTextureForGL(textureImage, isFlipped);
+}
+
+/**
+ * Convert a decoded texture to RGB with a bottom-left origin. glTF's UVs already count from
+ * the top row, so its images are only converted to RGB
+ */
+bool AssimpLoader::FlipTextureForGL(cv::Mat &textureImage, bool isFlipped) {
+
+    if (textureImage.empty()) {
+        return false;
+    }
+
+    // opencv reads textures in BGR format, change to RGB for GL
+    cv::cvtColor(textureImage, textureImage, CV_BGR2RGB);
+    // opencv reads image from top-left, while GL expects it from bottom-left
+    // vertically flip the image
+    if (isFlipped) {
+        cv::flip(textureImage, textureImage, 0);
+    }
+    return true;
+}
+
+/**
+ * OBJ's map_bump comes in as a height map, other formats name normal maps as such
+ */
+static bool GetNormalMapPath(const aiMaterial *material, aiString &texturePath) {
+    return material->GetTexture(aiTextureType_NORMALS, 0, &texturePath) == AI_SUCCESS ||
+           material->GetTexture(aiTextureType_HEIGHT, 0, &texturePath) == AI_SUCCESS;
+}
+
+/**
+ * Generate buffers for vertex positions, texture coordinates, faces of the n-th mesh -- and
+ * load data into them. The textures are in GL already, the mesh takes its texture names
+ */
+void AssimpLoader::GenerateGLBuffers(unsigned int n, bool keepPickingData) {
+
+    struct MeshInfo newMeshInfo; // this struct is updated for each mesh in the model
+    GLuint buffer;
+
+    // load face indices, vertex positions, vertex texture coords
+    // also copy texture index for mesh into newMeshInfo.textureIndex
+    const aiMesh *mesh = scene->mMeshes[n]; // read the n-th mesh
+    memset(&newMeshInfo, 0, sizeof(newMeshInfo));
+    newMeshInfo.indexType = GL_UNSIGNED_INT;
+    newMeshInfo.materialIndex = mesh->mMaterialIndex;
+    newMeshInfo.shaderVariant = GetMeshShaderVariant(mesh);
+    for (int tier = 0; tier < LIGHTING_TIER_COUNT; ++tier) {
+        usedShaderVariants[tier] |= 1u << ApplyLightingTier(newMeshInfo.shaderVariant,
+                                                            (LightingTier) tier);
+    }
 
-            glGenBuffers(1, &buffer);
-            glBindBuffer(GL_ARRAY_BUFFER, buffer);
-            glBufferData(GL_ARRAY_BUFFER,
-                         sizeof(float) * 3 * mesh->mNumVertices, mesh->mVertices,
-                         GL_STATIC_DRAW);
-            newMeshInfo.vertexBuffer = buffer;
+    // staging arrays only live until glBufferData, reuse the same arena memory for every mesh
+    MyArenaMarker meshMarker = stagingArena.GetMarker();
 
+    if (keepPickingData) {
+        pickingData.firstIndices.push_back(pickingData.indices.size());
+    }
+
+    // create array with faces
+    // convert from Assimp's format to array for GLES
+    // a scene from the mesh cache has no aiFaces, its indices were decoded into the arena
+    const unsigned int *faceArray = decodedScene ? decodedIndices[n] : NULL;
+    if (!faceArray) {
+        unsigned int *packedFaces =
+                stagingArena.AllocateArray<unsigned int>(mesh->mNumFaces * 3);
+        PackFaceIndices(mesh, packedFaces);
+        faceArray = packedFaces;
+    }
+    newMeshInfo.numberOfFaces = scene->mMeshes[n]->mNumFaces;
+
+    // buffer for faces
+    if (newMeshInfo.numberOfFaces) {
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     sizeof(unsigned int) * mesh->mNumFaces * 3, faceArray,
+                     GL_STATIC_DRAW);
+        newMeshInfo.faceBuffer = buffer;
+        gpuBufferBytes += sizeof(unsigned int) * mesh->mNumFaces * 3;
+
+        // picking needs the triangles once the scene is freed
+        if (keepPickingData) {
+            unsigned int firstVertex = pickingData.positions.size();
+            for (unsigned int i = 0; i < mesh->mNumFaces * 3; ++i) {
+                pickingData.indices.push_back(firstVertex + faceArray[i]);
+            }
         }
 
-        // buffer for vertex texture coordinates
-        // ***ASSUMPTION*** -- handle only one texture for each mesh
-        if (mesh->HasTextureCoords(0)) {
+    }
 
-            float * textureCoords = new float[2 * mesh->mNumVertices];
-            for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
-                textureCoords[k * 2] = mesh->mTextureCoords[0][k].x;
-                textureCoords[k * 2 + 1] = mesh->mTextureCoords[0][k].y;
+    // buffer for vertex positions
+    if (mesh->HasPositions()) {
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER,
+                     sizeof(float) * 3 * mesh->mNumVertices, mesh->mVertices,
+                     GL_STATIC_DRAW);
+        newMeshInfo.vertexBuffer = buffer;
+        gpuBufferBytes += sizeof(float) * 3 * mesh->mNumVertices;
+
+        glm::vec3 meshMin(FLT_MAX), meshMax(-FLT_MAX);
+        for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
+            glm::vec3 position(mesh->mVertices[k].x, mesh->mVertices[k].y,
+                               mesh->mVertices[k].z);
+            meshMin = glm::min(meshMin, position);
+            meshMax = glm::max(meshMax, position);
+            if (keepPickingData) {
+                pickingData.positions.push_back(position);
             }
-            glGenBuffers(1, &buffer);
-            glBindBuffer(GL_ARRAY_BUFFER, buffer);
-            glBufferData(GL_ARRAY_BUFFER,
-                         sizeof(float) * 2 * mesh->mNumVertices, textureCoords,
-                         GL_STATIC_DRAW);
-            newMeshInfo.textureCoordBuffer = buffer;
-            delete[] textureCoords;
-
-        }
-
-        // unbind buffers
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        // copy texture index (= texture name in GL) for the mesh from textureNameMap
-        aiMaterial *mtl = scene->mMaterials[mesh->mMaterialIndex];
-        aiString texturePath;	//contains filename of texture
-        if (AI_SUCCESS == mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath)) {
-            unsigned int textureId = textureNameMap[texturePath.data];
-            newMeshInfo.textureIndex = textureId;
-            MyLOGE("newMeshInfo.textureIndex= %d", textureId);
-        } else {
-            newMeshInfo.textureIndex = 0;
         }
+        sceneGraph.SetMeshBounds(n, meshMin, meshMax);
+
+    }
+
+    // buffer for vertex texture coordinates, only read by textured variants
+    // ***ASSUMPTION*** -- handle only one texture for each mesh
+    if (newMeshInfo.shaderVariant & SHADER_VARIANT_TEXTURED) {
+
+        float * textureCoords = stagingArena.AllocateArray<float>(2 * mesh->mNumVertices);
+        PackTextureCoords(mesh, textureCoords);
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER,
+                     sizeof(float) * 2 * mesh->mNumVertices, textureCoords,
+                     GL_STATIC_DRAW);
+        newMeshInfo.textureCoordBuffer = buffer;
+        gpuBufferBytes += sizeof(float) * 2 * mesh->mNumVertices;
+
+    }
+
+    // the first color set, RGBA floats like Assimp keeps it
+    if (newMeshInfo.shaderVariant & SHADER_VARIANT_VERTEX_COLOR) {
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * mesh->mNumVertices,
+                     mesh->mColors[0], GL_STATIC_DRAW);
+        newMeshInfo.colorBuffer = buffer;
+        gpuBufferBytes += sizeof(float) * 4 * mesh->mNumVertices;
 
-        modelMeshes.push_back(newMeshInfo);
     }
+
+    if (newMeshInfo.shaderVariant & SHADER_VARIANT_LIT) {
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * mesh->mNumVertices,
+                     mesh->mNormals, GL_STATIC_DRAW);
+        newMeshInfo.normalBuffer = buffer;
+        gpuBufferBytes += sizeof(float) * 3 * mesh->mNumVertices;
+
+    }
+
+    // xyzw like a GLB's, w is -1 where the bitangent is -cross(normal, tangent), as on
+    // mirrored UVs
+    if (newMeshInfo.shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+
+        float *tangents = stagingArena.AllocateArray<float>(4 * mesh->mNumVertices);
+        for (unsigned int k = 0; k < mesh->mNumVertices; ++k) {
+            const aiVector3D &tangent = mesh->mTangents[k];
+            tangents[4 * k] = tangent.x;
+            tangents[4 * k + 1] = tangent.y;
+            tangents[4 * k + 2] = tangent.z;
+            tangents[4 * k + 3] =
+                    ((mesh->mNormals[k] ^ tangent) * mesh->mBitangents[k]) < 0 ? -1.f : 1.f;
+        }
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * mesh->mNumVertices, tangents,
+                     GL_STATIC_DRAW);
+        newMeshInfo.tangentBuffer = buffer;
+        gpuBufferBytes += sizeof(float) * 4 * mesh->mNumVertices;
+
+    }
+    stagingArena.Rewind(meshMarker);
+
+    // unbind buffers
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // copy texture index (= texture name in GL) for the mesh from textureNameMap
+    aiMaterial *mtl = scene->mMaterials[mesh->mMaterialIndex];
+    aiString texturePath;	//contains filename of texture
+    if ((newMeshInfo.shaderVariant & SHADER_VARIANT_TEXTURED) &&
+        AI_SUCCESS == mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath)) {
+        unsigned int textureId = textureNameMap[texturePath.data];
+        newMeshInfo.textureIndex = textureId;
+        MyLOGE("newMeshInfo.textureIndex= %d", textureId);
+    } else {
+        newMeshInfo.textureIndex = 0;
+    }
+    if (newMeshInfo.shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+        GetNormalMapPath(mtl, texturePath);
+        newMeshInfo.normalMapIndex = textureNameMap[texturePath.data];
+    }
+
+    modelMeshes.push_back(newMeshInfo);
 }
 
 /**
- * Read textures associated with all materials and load images to GL
+ * After the last mesh: close the picking data and take the bounds of every instance of every
+ * mesh, a model without vertices has empty bounds at the origin
  */
-bool AssimpLoader::LoadTexturesToGL(std::string modelFilename) {
+void AssimpLoader::FinishGLBuffers(bool keepPickingData) {
 
-    // read names of textures associated with all materials
-    textureNameMap.clear();
+    if (keepPickingData) {
+        pickingData.firstIndices.push_back(pickingData.indices.size());
+    }
+    sceneGraph.UpdateWorldMatrices();
+    sceneGraph.GetWorldBounds(boundsMin, boundsMax);
+    if (boundsMin.x > boundsMax.x) {
+        boundsMin = boundsMax = glm::vec3(0);
+    }
+}
 
+/**
+ * Keep the diffuse texture and color of every material, everything else is dropped with the scene
+ */
+void AssimpLoader::BuildMaterialTable() {
+
+    materials.resize(scene->mNumMaterials);
     for (unsigned int m = 0; m < scene->mNumMaterials; ++m) {
 
-        int textureIndex = 0;
-        aiString textureFilename;
-        aiReturn isTexturePresent = scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE,
-                                                                     textureIndex,
-                                                                     &textureFilename);
+        // textures no mesh draws were not loaded and have no GL name
+        aiString texturePath;
+        std::map<std::string, GLuint>::const_iterator found = textureNameMap.end();
+        if (AI_SUCCESS == scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath)) {
+            materials[m].diffuseTextureName = texturePath.data;
+            found = textureNameMap.find(texturePath.data);
+        } else {
+            materials[m].diffuseTextureName.clear();
+        }
+        materials[m].textureName = found != textureNameMap.end() ? found->second : 0;
+        found = textureNameMap.end();
+        if (GetNormalMapPath(scene->mMaterials[m], texturePath)) {
+            found = textureNameMap.find(texturePath.data);
+        }
+        materials[m].normalMapName = found != textureNameMap.end() ? found->second : 0;
 
-        MyLOGE("LoadTexturesToGL=== %s", textureFilename.data);
-        MyLOGE("LoadTexturesToGL=== textureIndex %d", textureIndex);
+        aiColor4D diffuseColor(1.f, 1.f, 1.f, 1.f);
+        scene->mMaterials[m]->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+        materials[m].diffuseColor = glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b,
+                                              diffuseColor.a);
+    }
+}
 
-        while (isTexturePresent == AI_SUCCESS) {
-            //fill map with textures, OpenGL image ids set to 0
-            textureNameMap.insert(std::pair<std::string, GLuint>(textureFilename.data, 0));
+/**
+ * Read and decode the textures the meshes are drawn with, GL names are assigned on upload.
+ * Which ones those are comes from the materials, not from the textures the model was given,
+ * so a texture no mesh draws is never read
+ */
+bool AssimpLoader::DecodeTextures(std::string modelFilename,
+                                  const MyCancelToken *cancelToken) {
 
-            // more textures? more than one texture could be associated with a material
-            textureIndex++;
-            isTexturePresent = scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE,
-                                                                textureIndex, &textureFilename);
+    textureNameMap.clear();
+    preparedTextures.clear();
 
-            MyLOGE("LoadTexturesToGL %s", textureFilename.C_Str());
-            MyLOGE("LoadTexturesToGL textureIndex %d", textureIndex);
-        }
+    // the diffuse texture of textured meshes and the normal map of meshes with tangents for it,
+    // OpenGL image ids set to 0
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
 
+        const aiMesh *mesh = scene->mMeshes[n];
+        unsigned int shaderVariant = GetMeshShaderVariant(mesh);
+        aiString textureFilename;
+        if (shaderVariant & SHADER_VARIANT_TEXTURED) {
+            scene->mMaterials[mesh->mMaterialIndex]->GetTexture(aiTextureType_DIFFUSE, 0,
+                                                                &textureFilename);
+            textureNameMap.insert(std::pair<std::string, GLuint>(textureFilename.data, 0));
+        }
+        if (shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+            GetNormalMapPath(scene->mMaterials[mesh->mMaterialIndex], textureFilename);
+            textureNameMap.insert(std::pair<std::string, GLuint>(textureFilename.data, 0));
+        }
+    }
 
-//        int textureIndex = 0;
-//        aiString textureFilename;
-//
-//        while (scene->mMaterials[m]->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
-//            aiReturn isTexturePresent = scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE,
-//                                                                         textureIndex,
-//                                                                         &textureFilename);
-//            if (isTexturePresent == AI_SUCCESS) {
-//                //fill map with textures, OpenGL image ids set to 0
-//                textureNameMap.insert(std::pair<std::string, GLuint>(textureFilename.data, 0));
-//                // more textures? more than one texture could be associated with a material
-//                textureIndex++;
-//            }
-//        }
+    // everything else the materials name, e.g. normal maps of a model imported without tangents
+    std::set<std::string> skippedTextures;
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m) {
+        aiString textureFilename;
+        for (unsigned int t = 0; scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE, t,
+                                                          &textureFilename) == AI_SUCCESS; ++t) {
+            skippedTextures.insert(textureFilename.data);
+        }
+        if (GetNormalMapPath(scene->mMaterials[m], textureFilename)) {
+            skippedTextures.insert(textureFilename.data);
+        }
+    }
+    std::map<std::string, GLuint>::iterator textureIterator = textureNameMap.begin();
+    for (; textureIterator != textureNameMap.end(); ++textureIterator) {
+        skippedTextures.erase(textureIterator->first);
     }
+    readStats.texturesSkipped = skippedTextures.size();
 
     int numTextures = (int) textureNameMap.size();
-    MyLOGI("Total number of textures is %d ", numTextures);
-
-    // create and fill array with texture names in GL
-    GLuint * textureGLNames = new GLuint[numTextures];
-    glGenTextures(numTextures, textureGLNames);
+    MyLOGI("Total number of textures is %d, %u more are not drawn", numTextures,
+           readStats.texturesSkipped);
 
     // Extract the directory part from the file name
     // will be used to read the texture
     std::string modelDirectoryName = GetDirectoryName(modelFilename);
 
-    // iterate over the textures, read them using OpenCV, load into GL
-    std::map<std::string, GLuint>::iterator textureIterator = textureNameMap.begin();
+    // iterate over the textures and read them using OpenCV, into the staging arena where they
+    // stay until the upload. Textures mapped to an asset are decoded straight from its memory,
+    // all of them through the same buffer
+    MyAssetBuffer textureBuffer;
+    preparedTextures.resize(numTextures);
+    textureIterator = textureNameMap.begin();
     int i = 0;
     for (; textureIterator != textureNameMap.end(); ++i, ++textureIterator) {
 
+        if (IsCancelled(cancelToken)) {
+            preparedTextures.clear();
+            return false;
+        }
         std::string textureFilename = (*textureIterator).first;  // get filename
         std::string textureFullPath = modelDirectoryName + "/" + textureFilename;
-        (*textureIterator).second = textureGLNames[i];	  // save texture id for filename in map
+        std::string textureAssetName;
+        bool isDecoded;
 
         // load the texture using OpenCV
-        MyLOGI("Loading texture %s", textureFullPath.c_str());
-        cv::Mat textureImage = cv::imread(textureFullPath);
-        if (!textureImage.empty()) {
-            // 加载纹理数据
-
-            // opencv reads textures in BGR format, change to RGB for GL
-            cv::cvtColor(textureImage, textureImage, CV_BGR2RGB);
-            // opencv reads image from top-left, while GL expects it from bottom-left
-            // vertically flip the image
-            cv::flip(textureImage, textureImage, 0);
-
-            // bind the texture
-            glBindTexture(GL_TEXTURE_2D, textureGLNames[i]);
-            // specify linear filtering 指定放大，缩小滤波
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            // load the OpenCV Mat into GLES
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureImage.cols,
-                         textureImage.rows, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                         textureImage.data);
-            CheckGLError("AssimpLoader::loadGLTexGen");
-
+        if (assetIOSystem->FindAsset(textureFilename, textureAssetName)) {
+            MyLOGI("Loading texture %s from memory", textureAssetName.c_str());
+            isDecoded = gHelperObject->ReadAsset(textureAssetName, textureBuffer) &&
+                        DecodeTexture(textureBuffer.GetData(), textureBuffer.GetSize(),
+                                      preparedTextures[i], &stagingArena);
+            readStats.textureBytes += textureBuffer.GetSize();
         } else {
-
+            MyLOGI("Loading texture %s", textureFullPath.c_str());
+            isDecoded = DecodeTexture(textureFullPath, preparedTextures[i], &stagingArena);
+            struct stat textureStat;
+            if (stat(textureFullPath.c_str(), &textureStat) == 0) {
+                readStats.textureBytes += textureStat.st_size;
+            }
+        }
+        readStats.texturesRead++;
+        if (!isDecoded) {
             MyLOGE("Couldn't load texture %s", textureFilename.c_str());
-
-            //Cleanup and return
-            delete[] textureGLNames;
+            preparedTextures.clear();
             return false;
-
         }
     }
 
-    //Cleanup and return
-    delete[] textureGLNames;
     return true;
 }
 
+/**
+ * Load the next decoded texture into GL, in textureNameMap order
+ */
+void AssimpLoader::LoadTextureToGL() {
+
+    GLuint textureGLName;
+    glGenTextures(1, &textureGLName);
+    uploadTextureIterator->second = textureGLName;	  // save texture id for filename in map
+    const cv::Mat &textureImage = preparedTextures[uploadedTextures];
+
+    // 加载纹理数据
+
+    // bind the texture
+    glBindTexture(GL_TEXTURE_2D, textureGLName);
+    // specify linear filtering 指定放大，缩小滤波
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // load the OpenCV Mat into GLES
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureImage.cols,
+                 textureImage.rows, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                 textureImage.data);
+    gpuTextureBytes += textureImage.total() * textureImage.elemSize();
+    CheckGLError("AssimpLoader::loadGLTexGen");
+    ++uploadTextureIterator;
+    uploadedTextures++;
+}
+
+bool IsGLBFileName(const std::string &fileName) {
+    return fileName.size() > 4 && strcasecmp(fileName.c_str() + fileName.size() - 4, ".glb") == 0;
+}
+
 /**
  * Loads a general OBJ with many meshes -- assumes texture is associated with each mesh
  * does not handle material properties (like diffuse, specular, etc.)
  */
-bool AssimpLoader::Load3DModel(std::string modelFilename) {
+bool AssimpLoader::Load3DModel(std::string modelFilename, ImportProfile importProfile,
+                               bool keepPickingData) {
+
+    if (!PrepareModel(modelFilename, importProfile)) {
+        return false;
+    }
+    return UploadModel(keepPickingData);
+}
 
-    MyLOGI("Scene will be imported now");
-    scene = importerPtr->ReadFile(modelFilename, aiProcessPreset_TargetRealtime_Quality);
+/**
+ * Import the scene and decode its textures, no GL calls
+ * The token is checked before and after ReadFile, between our post-processing steps and
+ * meshes, and between textures. A model with a mesh cache key reads the meshes from the cache
+ * when an earlier load wrote them, and writes them after its import otherwise
+ */
+bool AssimpLoader::PrepareModel(std::string modelFilename, ImportProfile importProfile,
+                                const MyCancelToken *cancelToken) {
+
+    if (IsCancelled(cancelToken)) {
+        return false;
+    }
+    memset(&readStats, 0, sizeof(readStats));
+    if (IsGLBFileName(modelFilename)) {
+        return PrepareGLB(modelFilename, cancelToken);
+    }
+    uint64_t cacheKey = meshCacheKey ? GetMeshCacheKey(importProfile) : 0;
+    if (cacheKey && ReadMeshCache(cacheKey)) {
+        MyLOGI("Read %s from the mesh cache", modelFilename.c_str());
+    } else if (!ImportScene(modelFilename, importProfile, cancelToken)) {
+        return false;
+    } else if (cacheKey && !IsCancelled(cancelToken)) {
+        WriteMeshCache(cacheKey);
+    }
+
+    if (IsCancelled(cancelToken) || !DecodeTextures(modelFilename, cancelToken)) {
+        if (IsCancelled(cancelToken)) {
+            MyLOGI("Load of %s cancelled", modelFilename.c_str());
+        } else {
+            MyLOGE("Unable to load textures");
+        }
+        FreeScene();
+        stagingArena.Reset();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * ReadFile and our parallel post-processing steps
+ */
+bool AssimpLoader::ImportScene(std::string modelFilename, ImportProfile importProfile,
+                               const MyCancelToken *cancelToken) {
+
+    MyLOGI("Scene will be imported now with profile %s", GetImportProfileName(importProfile));
+    unsigned int importFlags = GetImportProfileFlags(importProfile);
+
+    // Assimp runs its steps on one thread; take over the per-mesh ones that we have a parallel
+    // version of. Tangents are computed from the normals inside ReadFile, so leave those alone
+    unsigned int parallelSteps = 0;
+    if (postProcessThreads > 0 && !(importFlags & aiProcess_CalcTangentSpace)) {
+        parallelSteps = importFlags & MY_MESH_POSTPROCESS_STEPS;
+        importFlags &= ~MY_MESH_POSTPROCESS_STEPS;
+    }
+
+    bool isTimingSteps = measureImportSteps && importStepTimer.Start();
+    assetIOSystem->ResetBytesRead();
+    importProgress->cancelToken = cancelToken;
+    scene = importerPtr->ReadFile(modelFilename, importFlags);
+    importProgress->cancelToken = NULL;
+    readStats.modelBytes = assetIOSystem->GetBytesRead();
+    if (isTimingSteps) {
+        importStepTimer.Stop();
+    }
+    if (scene && parallelSteps && !IsCancelled(cancelToken)) {
+        // the importer still owns the scene, as with ApplyPostProcessing
+        MeshPostProcessStats postProcessStats;
+        PostProcessMeshes(const_cast<aiScene *>(scene), parallelSteps, postProcessThreads,
+                          &postProcessStats, cancelToken);
+        if (measureImportSteps && (parallelSteps & aiProcess_GenSmoothNormals)) {
+            importStepTimer.AddStepTime("ParallelGenNormals", postProcessStats.normalsMs);
+        }
+        if (measureImportSteps && (parallelSteps & aiProcess_JoinIdenticalVertices)) {
+            importStepTimer.AddStepTime("ParallelJoinVertices", postProcessStats.weldMs);
+        }
+        if (measureImportSteps && (parallelSteps & aiProcess_ImproveCacheLocality)) {
+            importStepTimer.AddStepTime("ParallelCacheLocality", postProcessStats.cacheMs);
+        }
+    }
+    if (measureImportSteps) {
+        const std::vector<ImportStepTime> &stepTimes = importStepTimer.GetStepTimes();
+        for (unsigned int i = 0; i < stepTimes.size(); ++i) {
+            MyLOGI("Import step %s: %.3f ms", stepTimes[i].name.c_str(), stepTimes[i].ms);
+        }
+    }
 
     // Check if import failed
     if (!scene) {
@@ -269,94 +736,906 @@ bool AssimpLoader::Load3DModel(std::string modelFilename) {
         MyLOGE("Scene import failed: %s", errorString.c_str());
         return false;
     }
-    MyLOGI("Imported %s successfully.", modelFilename.c_str());
+    if (!IsCancelled(cancelToken)) {
+        MyLOGI("Imported %s successfully.", modelFilename.c_str());
+    }
+    return true;
+}
 
-    if(!LoadTexturesToGL(modelFilename)) {
-        MyLOGE("Unable to load textures");
+/**
+ * Of the code that makes a cache entry: our pipeline, the codec and the Assimp library. Every
+ * entry's name starts with it, so that entries of other versions can be told apart and removed
+ */
+static uint32_t GetMeshCacheVersion() {
+
+    const uint32_t parts[] = {MESH_CACHE_PIPELINE_VERSION, MESH_CODEC_VERSION,
+                              aiGetVersionMajor(), aiGetVersionMinor(), aiGetVersionRevision()};
+    uint32_t version = 2166136261u;
+    for (unsigned int p = 0; p < sizeof(parts) / sizeof(parts[0]); ++p) {
+        version = (version ^ parts[p]) * 16777619u;
+    }
+    return version;
+}
+
+/**
+ * The catalog's hash of the sources, and what else changes the imported meshes: the versions
+ * of the code, the profile and whether our post-processing steps replaced Assimp's
+ */
+uint64_t AssimpLoader::GetMeshCacheKey(ImportProfile importProfile) const {
+
+    uint64_t cacheKey = (meshCacheKey ^ GetMeshCacheVersion()) * 1099511628211ULL;
+    cacheKey = (cacheKey ^ (uint64_t) importProfile) * 1099511628211ULL;
+    return (cacheKey ^ (postProcessThreads > 0 ? 1 : 0)) * 1099511628211ULL;
+}
+
+static std::string GetMeshCachePrefix() {
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "mesh_%08x_", GetMeshCacheVersion());
+    return prefix;
+}
+
+static std::string GetMeshCacheFileName(uint64_t cacheKey) {
+
+    char cacheName[32];
+    snprintf(cacheName, sizeof(cacheName), "%016llx.bin", (unsigned long long) cacheKey);
+    return gHelperObject->GetInternalPath() + "/" + GetMeshCachePrefix() + cacheName;
+}
+
+/**
+ * Entries and unfinished writes of other versions are never read again, so they are removed
+ * instead of filling the internal storage with every version the app had
+ */
+static void RemoveStaleMeshCaches() {
+
+    std::string internalPath = gHelperObject->GetInternalPath();
+    DIR *dir = opendir(internalPath.c_str());
+    if (!dir) {
+        return;
+    }
+    std::string prefix = GetMeshCachePrefix();
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dir)) != NULL) {
+        std::string name = dirEntry->d_name;
+        if (name.compare(0, 5, "mesh_") == 0 && name.compare(0, prefix.size(), prefix) != 0) {
+            MyLOGI("Removing stale mesh cache %s", name.c_str());
+            remove((internalPath + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * The scene an earlier import wrote for the key. False if there is none or it does not decode,
+ * e.g. it was written by another version of the codec, and the model is imported again
+ */
+bool AssimpLoader::ReadMeshCache(uint64_t cacheKey) {
+
+    std::string cacheFileName = GetMeshCacheFileName(cacheKey);
+    FILE *cacheFile = fopen(cacheFileName.c_str(), "rb");
+    if (!cacheFile) {
         return false;
     }
-    MyLOGI("Loaded textures successfully");
+    std::vector<uint8_t> encoded;
+    bool isRead = fseek(cacheFile, 0, SEEK_END) == 0;
+    long cacheBytes = isRead ? ftell(cacheFile) : 0;
+    if (cacheBytes > 0 && fseek(cacheFile, 0, SEEK_SET) == 0) {
+        encoded.resize(cacheBytes);
+        isRead = fread(&encoded[0], 1, encoded.size(), cacheFile) == encoded.size();
+    }
+    fclose(cacheFile);
+    if (isRead && !encoded.empty()) {
+        decodedScene = DecodeScene(&encoded[0], encoded.size(), cacheKey, stagingArena,
+                                   decodedIndices);
+    }
+    if (!decodedScene) {
+        MyLOGI("Mesh cache %s is stale, importing", cacheFileName.c_str());
+        stagingArena.Reset();
+        return false;
+    }
+    scene = decodedScene;
+    readStats.meshCacheBytes = encoded.size();
+    return true;
+}
+
+/**
+ * Loads of the same model may write the same entry at once, so each writes its own file and
+ * renames it over the entry. Entries of other versions are removed after a write
+ */
+void AssimpLoader::WriteMeshCache(uint64_t cacheKey) const {
+
+    std::vector<uint8_t> encoded;
+    if (!EncodeScene(scene, cacheKey, encoded)) {
+        MyLOGI("Mesh cache cannot hold this scene");
+        return;
+    }
+    std::string cacheFileName = GetMeshCacheFileName(cacheKey);
+    char writerSuffix[32];
+    snprintf(writerSuffix, sizeof(writerSuffix), ".%p", (const void *) this);
+    std::string writerFileName = cacheFileName + writerSuffix;
+    FILE *cacheFile = fopen(writerFileName.c_str(), "wb");
+    if (!cacheFile) {
+        MyLOGE("Cannot write %s", writerFileName.c_str());
+        return;
+    }
+    bool isWritten = fwrite(&encoded[0], 1, encoded.size(), cacheFile) == encoded.size();
+    isWritten = fclose(cacheFile) == 0 && isWritten;
+    if (!isWritten || rename(writerFileName.c_str(), cacheFileName.c_str()) != 0) {
+        remove(writerFileName.c_str());
+        return;
+    }
+    MyLOGI("Cached %u meshes in %zu bytes", scene->mNumMeshes, encoded.size());
+    RemoveStaleMeshCaches();
+}
+
+/**
+ * A GLB in the assets is never copied: a stored entry of the asset archive is used where the
+ * archive is mapped, and a loose one is mapped from the APK, which stores GLBs uncompressed
+ * (see noCompress in build.gradle). Any other name is a file, e.g. one the host tools wrote
+ */
+static bool OpenGLB(MyGLBFile *glbFile, const std::string &glbName) {
+
+    const MyAssetArchive &archive = gHelperObject->GetArchive();
+    const ArchiveEntry *entry = archive.FindEntry(glbName);
+    if (entry) {
+        const uint8_t *view = archive.GetEntryView(entry);
+        if (!view) {
+            MyLOGE("%s is compressed in the asset archive and cannot be mapped", glbName.c_str());
+            return false;
+        }
+        return glbFile->Open(view, entry->size);
+    }
+    int fd;
+    int64_t start;
+    size_t length;
+    if (gHelperObject->OpenAssetFileDescriptor(glbName, fd, start, length)) {
+        bool isOpen = glbFile->Open(fd, start, length);
+        close(fd);
+        return isOpen;
+    }
+    return glbFile->Open(glbName);
+}
+
+/**
+ * A GLB is not imported: the file is mapped and checked, and only its images are decoded. The
+ * import profile does not apply, the meshes are drawn as the file has them
+ */
+bool AssimpLoader::PrepareGLB(std::string modelFilename, const MyCancelToken *cancelToken) {
+
+    glbFile = new MyGLBFile;
+    if (!OpenGLB(glbFile, modelFilename) || !DecodeGLBImages(cancelToken)) {
+        if (IsCancelled(cancelToken)) {
+            MyLOGI("Load of %s cancelled", modelFilename.c_str());
+        }
+        FreeScene();
+        stagingArena.Reset();
+        return false;
+    }
+    readStats.modelBytes = glbFile->GetFileSize() - readStats.textureBytes;
+    return true;
+}
+
+static std::string GetGLBImageName(int image) {
+    char imageName[32];
+    snprintf(imageName, sizeof(imageName), "image%d", image);
+    return imageName;
+}
+
+/**
+ * The images drawn by some primitive, decoded in parallel straight from the mapping, one job
+ * per image. The arena is not thread-safe, so the pixels are allocated by OpenCV
+ */
+bool AssimpLoader::DecodeGLBImages(const MyCancelToken *cancelToken) {
+
+    textureNameMap.clear();
+    preparedTextures.clear();
+
+    const std::vector<GLBMaterial> &glbMaterials = glbFile->GetMaterials();
+    std::map<std::string, int> drawnImages;
+    for (unsigned int n = 0; n < glbFile->GetPrimitives().size(); ++n) {
+        const GLBPrimitive &primitive = glbFile->GetPrimitives()[n];
+        unsigned int shaderVariant = GetPrimitiveShaderVariant(primitive);
+        int image = glbMaterials[primitive.material].baseColorImage;
+        if (shaderVariant & SHADER_VARIANT_TEXTURED) {
+            drawnImages[GetGLBImageName(image)] = image;
+        }
+        image = glbMaterials[primitive.material].normalImage;
+        if (shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+            drawnImages[GetGLBImageName(image)] = image;
+        }
+    }
+    std::set<int> skippedImages;
+    for (unsigned int m = 0; m < glbMaterials.size(); ++m) {
+        for (int image : {glbMaterials[m].baseColorImage, glbMaterials[m].normalImage}) {
+            if (image >= 0 && !drawnImages.count(GetGLBImageName(image))) {
+                skippedImages.insert(image);
+            }
+        }
+    }
+    readStats.texturesSkipped = skippedImages.size();
+
+    // in textureNameMap order, which LoadTextureToGL uploads them in
+    std::vector<const GLBImage *> images;
+    std::map<std::string, int>::const_iterator imageIterator = drawnImages.begin();
+    for (; imageIterator != drawnImages.end(); ++imageIterator) {
+        textureNameMap.insert(std::pair<std::string, GLuint>(imageIterator->first, 0));
+        images.push_back(&glbFile->GetImages()[imageIterator->second]);
+        readStats.textureBytes += images.back()->size;
+    }
+    readStats.texturesRead = images.size();
+    MyLOGI("Decoding %zu images, %u more are not drawn", images.size(),
+           readStats.texturesSkipped);
+
+    preparedTextures.resize(images.size());
+    std::atomic<bool> isFailed(false);
+    GetJobSystem().ParallelFor(images.size(), 1, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end && !isFailed; ++i) {
+            if (IsCancelled(cancelToken) ||
+                !DecodeTexture(images[i]->data, images[i]->size, preparedTextures[i], NULL,
+                               false)) {
+                isFailed = true;
+            }
+        }
+    });
+    if (isFailed) {
+        if (!IsCancelled(cancelToken)) {
+            MyLOGE("Couldn't decode an image of the GLB");
+        }
+        preparedTextures.clear();
+        return false;
+    }
+    return true;
+}
 
-    GenerateGLBuffers();
-    MyLOGI("Loaded vertices and texture coords successfully");
+/**
+ * As for an aiMesh: the base color texture needs TEXCOORD_0, the normal map tangents too
+ */
+unsigned int AssimpLoader::GetPrimitiveShaderVariant(const GLBPrimitive &primitive) const {
+
+    const GLBMaterial &material = glbFile->GetMaterials()[primitive.material];
+    bool isTextured = primitive.textureCoords >= 0 && material.baseColorImage >= 0;
+    return SelectShaderVariant(isTextured, primitive.colors >= 0, primitive.normals >= 0,
+                               material.normalImage >= 0, primitive.tangents >= 0);
+}
 
+/**
+ * An accessor as packed floats: its data in the mapping if it already is, a copy in the
+ * staging arena otherwise
+ */
+const float * AssimpLoader::GetGLBFloats(const GLBAccessor &accessor, unsigned int components) {
+
+    if (MyGLBFile::IsPackedFloats(accessor, components)) {
+        return (const float *) accessor.data;
+    }
+    float *values = stagingArena.AllocateArray<float>(components * accessor.count);
+    MyGLBFile::ReadFloats(accessor, components, values);
+    return values;
+}
+
+static GLuint CreateBuffer(GLenum target, size_t bytes, const void *data) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferData(target, bytes, data, GL_STATIC_DRAW);
+    return buffer;
+}
+
+/**
+ * Same as GenerateGLBuffers for the n-th primitive of a GLB. Indices are drawn in the file's type,
+ * and attributes that are packed floats of the sizes the shaders read go to glBufferData from
+ * the mapping without a copy; the rest is converted in the staging arena first
+ */
+void AssimpLoader::GenerateGLBBuffers(unsigned int n, bool keepPickingData) {
+
+    const std::vector<GLBAccessor> &accessors = glbFile->GetAccessors();
+    const GLBPrimitive &primitive = glbFile->GetPrimitives()[n];
+    const GLBAccessor &positions = accessors[primitive.positions];
+    unsigned int numberOfVertices = positions.count;
+    struct MeshInfo newMeshInfo;
+    memset(&newMeshInfo, 0, sizeof(newMeshInfo));
+    newMeshInfo.materialIndex = primitive.material;
+    newMeshInfo.shaderVariant = GetPrimitiveShaderVariant(primitive);
+    for (int tier = 0; tier < LIGHTING_TIER_COUNT; ++tier) {
+        usedShaderVariants[tier] |= 1u << ApplyLightingTier(newMeshInfo.shaderVariant,
+                                                            (LightingTier) tier);
+    }
+    MyArenaMarker meshMarker = stagingArena.GetMarker();
+
+    // indices were checked to be packed and in range when the file was opened
+    size_t indexBytes;
+    const void *indexData;
+    if (primitive.indices >= 0) {
+        const GLBAccessor &indices = accessors[primitive.indices];
+        newMeshInfo.indexType = indices.componentType;
+        newMeshInfo.numberOfFaces = indices.count / 3;
+        indexBytes = MyGLBFile::GetComponentSize(indices.componentType) * indices.count;
+        indexData = indices.data;
+        mappedUploadBytes += indexBytes;
+    } else {
+        unsigned int *vertexOrder = stagingArena.AllocateArray<unsigned int>(numberOfVertices);
+        for (unsigned int i = 0; i < numberOfVertices; ++i) {
+            vertexOrder[i] = i;
+        }
+        newMeshInfo.indexType = GL_UNSIGNED_INT;
+        newMeshInfo.numberOfFaces = numberOfVertices / 3;
+        indexBytes = sizeof(unsigned int) * numberOfVertices;
+        indexData = vertexOrder;
+    }
+    if (newMeshInfo.numberOfFaces) {
+        newMeshInfo.faceBuffer = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData);
+        gpuBufferBytes += indexBytes;
+    }
+
+    const float *vertices = GetGLBFloats(positions, 3);
+    newMeshInfo.vertexBuffer = CreateBuffer(GL_ARRAY_BUFFER,
+                                            sizeof(float) * 3 * numberOfVertices, vertices);
+    gpuBufferBytes += sizeof(float) * 3 * numberOfVertices;
+    if (vertices == (const float *) positions.data) {
+        mappedUploadBytes += sizeof(float) * 3 * numberOfVertices;
+    }
+    glm::vec3 meshMin(FLT_MAX), meshMax(-FLT_MAX);
+    if (positions.hasBounds) {
+        meshMin = glm::vec3(positions.boundsMin[0], positions.boundsMin[1],
+                            positions.boundsMin[2]);
+        meshMax = glm::vec3(positions.boundsMax[0], positions.boundsMax[1],
+                            positions.boundsMax[2]);
+    } else {
+        for (unsigned int k = 0; k < numberOfVertices; ++k) {
+            glm::vec3 position(vertices[3 * k], vertices[3 * k + 1], vertices[3 * k + 2]);
+            meshMin = glm::min(meshMin, position);
+            meshMax = glm::max(meshMax, position);
+        }
+    }
+    sceneGraph.SetMeshBounds(n, meshMin, meshMax);
+
+    if (keepPickingData) {
+        unsigned int firstVertex = pickingData.positions.size();
+        pickingData.firstIndices.push_back(pickingData.indices.size());
+        for (unsigned int k = 0; k < numberOfVertices; ++k) {
+            pickingData.positions.push_back(glm::vec3(vertices[3 * k], vertices[3 * k + 1],
+                                                      vertices[3 * k + 2]));
+        }
+        for (unsigned int i = 0; i < 3 * (unsigned int) newMeshInfo.numberOfFaces; ++i) {
+            unsigned int index;
+            if (newMeshInfo.indexType == GL_UNSIGNED_BYTE) {
+                index = ((const uint8_t *) indexData)[i];
+            } else if (newMeshInfo.indexType == GL_UNSIGNED_SHORT) {
+                index = ((const uint16_t *) indexData)[i];
+            } else {
+                index = ((const uint32_t *) indexData)[i];
+            }
+            pickingData.indices.push_back(firstVertex + index);
+        }
+    }
+
+    // the attributes the variant reads, as the number of floats per vertex it reads
+    struct {
+        int         accessor;
+        unsigned int components;
+        GLuint *    buffer;
+        unsigned int variantBit;
+    } attributes[] = {
+        {primitive.textureCoords, 2, &newMeshInfo.textureCoordBuffer, SHADER_VARIANT_TEXTURED},
+        {primitive.colors, 4, &newMeshInfo.colorBuffer, SHADER_VARIANT_VERTEX_COLOR},
+        {primitive.normals, 3, &newMeshInfo.normalBuffer, SHADER_VARIANT_LIT},
+        {primitive.tangents, 4, &newMeshInfo.tangentBuffer, SHADER_VARIANT_NORMAL_MAP}
+    };
+    for (unsigned int a = 0; a < sizeof(attributes) / sizeof(attributes[0]); ++a) {
+        if (!(newMeshInfo.shaderVariant & attributes[a].variantBit)) {
+            continue;
+        }
+        const GLBAccessor &accessor = accessors[attributes[a].accessor];
+        size_t bytes = sizeof(float) * attributes[a].components * numberOfVertices;
+        const float *values = GetGLBFloats(accessor, attributes[a].components);
+        *attributes[a].buffer = CreateBuffer(GL_ARRAY_BUFFER, bytes, values);
+        gpuBufferBytes += bytes;
+        if (values == (const float *) accessor.data) {
+            mappedUploadBytes += bytes;
+        }
+    }
+    stagingArena.Rewind(meshMarker);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    modelMeshes.push_back(newMeshInfo);
+}
+
+/**
+ * Texture names of the meshes and the material table, once the images are in GL
+ */
+void AssimpLoader::BuildGLBMaterialTable() {
+
+    const std::vector<GLBMaterial> &glbMaterials = glbFile->GetMaterials();
+    materials.resize(glbMaterials.size());
+    for (unsigned int m = 0; m < glbMaterials.size(); ++m) {
+        int image = glbMaterials[m].baseColorImage;
+        materials[m].diffuseTextureName = image >= 0 ? GetGLBImageName(image) : std::string();
+        std::map<std::string, GLuint>::const_iterator found =
+                textureNameMap.find(materials[m].diffuseTextureName);
+        materials[m].textureName = found != textureNameMap.end() ? found->second : 0;
+        found = textureNameMap.find(GetGLBImageName(glbMaterials[m].normalImage));
+        materials[m].normalMapName = glbMaterials[m].normalImage >= 0 &&
+                                     found != textureNameMap.end() ? found->second : 0;
+        materials[m].diffuseColor = glbMaterials[m].baseColorFactor;
+    }
+    for (unsigned int n = 0; n < modelMeshes.size(); ++n) {
+        const MaterialInfo &material = materials[modelMeshes[n].materialIndex];
+        if (modelMeshes[n].shaderVariant & SHADER_VARIANT_TEXTURED) {
+            modelMeshes[n].textureIndex = material.textureName;
+        }
+        if (modelMeshes[n].shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+            modelMeshes[n].normalMapIndex = material.normalMapName;
+        }
+    }
+}
+
+/**
+ * Send a prepared model to GL, GL thread only
+ * A cancelled upload deletes whatever it had sent and drops the prepared model. Finishes an
+ * upload that UploadModelStep began
+ */
+bool AssimpLoader::UploadModel(bool keepPickingData, const MyCancelToken *cancelToken) {
+
+    bool isUploaded = false;
+    while (!isUploaded) {
+        if (!UploadModelStep(keepPickingData, SIZE_MAX, isUploaded, cancelToken)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Textures first, one at a time, then the meshes, whose materials name the textures. The
+ * scene is kept until the last mesh is in GL
+ */
+bool AssimpLoader::UploadModelStep(bool keepPickingData, size_t byteBudget, bool &isUploaded,
+                                   const MyCancelToken *cancelToken) {
+
+    isUploaded = false;
+    if (!scene && !glbFile) {
+        return false;
+    }
+    if (IsCancelled(cancelToken)) {
+        CancelUpload();
+        return false;
+    }
+    if (!isUploading) {
+        isUploading = true;
+        mappedUploadBytes = 0;
+        uploadedTextures = uploadedMeshes = 0;
+        uploadTextureIterator = textureNameMap.begin();
+        if (glbFile) {
+            sceneGraph.Build(glbFile->GetNodes());
+        } else {
+            sceneGraph.Build(scene);
+        }
+        instanceVisibility.assign(sceneGraph.GetNumberOfInstances(), 1);
+    }
+
+    size_t budgetEnd = gpuBufferBytes + gpuTextureBytes + std::max<size_t>(byteBudget, 1);
+    while (uploadedTextures < preparedTextures.size() &&
+           gpuBufferBytes + gpuTextureBytes < budgetEnd) {
+        LoadTextureToGL();
+    }
+    if (uploadedTextures < preparedTextures.size()) {
+        return true;
+    }
+    if (IsCancelled(cancelToken)) {
+        CancelUpload();
+        return false;
+    }
+    unsigned int numberOfMeshes = glbFile ? glbFile->GetPrimitives().size() : scene->mNumMeshes;
+    while (uploadedMeshes < numberOfMeshes && gpuBufferBytes + gpuTextureBytes < budgetEnd) {
+        if (glbFile) {
+            GenerateGLBBuffers(uploadedMeshes, keepPickingData);
+        } else {
+            GenerateGLBuffers(uploadedMeshes, keepPickingData);
+        }
+        uploadedMeshes++;
+    }
+    if (uploadedMeshes < numberOfMeshes) {
+        return true;
+    }
+
+    MyLOGI("Loaded %u textures, vertices and texture coords of %u meshes successfully",
+           uploadedTextures, uploadedMeshes);
+    FinishGLBuffers(keepPickingData);
+    if (glbFile) {
+        BuildGLBMaterialTable();
+    } else {
+        BuildMaterialTable();
+    }
+    FinishShaderVariants();
+
+    // everything is uploaded, the GL buffers are the only copy of the geometry from now on,
+    // and the pixels of the textures went with the arena
+    preparedTextures.clear();
+    FreeScene();
+    MyLOGI("Staging arena peak %zu bytes", stagingArena.GetPeakBytes());
+    stagingArena.Reset();
+
+    isUploading = false;
     isObjectLoaded = true;
+    isUploaded = true;
     return true;
 }
 
+/**
+ * Delete whatever the upload sent and drop the prepared model
+ */
+void AssimpLoader::CancelUpload() {
+
+    MyLOGI("Upload cancelled");
+    Delete3DModel();
+    preparedTextures.clear();
+    FreeScene();
+    stagingArena.Reset();
+    isUploading = false;
+}
+
+/**
+ * Wait for the programs of every variant the model draws with at any lighting tier, while the
+ * upload is stalling the GL thread anyway. Precompile began them, so most are picked up
+ * finished; Render only draws with finished programs and never waits for the compiler
+ */
+void AssimpLoader::FinishShaderVariants() const {
+
+    unsigned int variantMask = 0;
+    for (int tier = 0; tier < LIGHTING_TIER_COUNT; ++tier) {
+        variantMask |= usedShaderVariants[tier];
+    }
+    for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; ++v) {
+        if (variantMask & (1u << v)) {
+            GetShaderVariants().GetVariant(v);
+        }
+    }
+}
+
+/**
+ * GPU bytes of a prepared model, the same sizes that UploadModel counts
+ */
+size_t AssimpLoader::GetPreparedBytes() const {
+
+    size_t bytes = 0;
+    for (unsigned int i = 0; i < preparedTextures.size(); ++i) {
+        bytes += preparedTextures[i].total() * preparedTextures[i].elemSize();
+    }
+    if (scene) {
+        for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+            const aiMesh *mesh = scene->mMeshes[n];
+            bytes += sizeof(unsigned int) * 3 * mesh->mNumFaces + sizeof(float) * 3 * mesh->mNumVertices;
+            unsigned int shaderVariant = GetMeshShaderVariant(mesh);
+            if (shaderVariant & SHADER_VARIANT_TEXTURED) {
+                bytes += sizeof(float) * 2 * mesh->mNumVertices;
+            }
+            if (shaderVariant & SHADER_VARIANT_VERTEX_COLOR) {
+                bytes += sizeof(float) * 4 * mesh->mNumVertices;
+            }
+            if (shaderVariant & SHADER_VARIANT_LIT) {
+                bytes += sizeof(float) * 3 * mesh->mNumVertices;
+            }
+            if (shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+                bytes += sizeof(float) * 4 * mesh->mNumVertices;
+            }
+        }
+    }
+    if (glbFile) {
+        const std::vector<GLBAccessor> &accessors = glbFile->GetAccessors();
+        for (unsigned int n = 0; n < glbFile->GetPrimitives().size(); ++n) {
+            const GLBPrimitive &primitive = glbFile->GetPrimitives()[n];
+            size_t numberOfVertices = accessors[primitive.positions].count;
+            if (primitive.indices >= 0) {
+                const GLBAccessor &indices = accessors[primitive.indices];
+                bytes += MyGLBFile::GetComponentSize(indices.componentType) * indices.count;
+            } else {
+                bytes += sizeof(unsigned int) * numberOfVertices;
+            }
+            bytes += sizeof(float) * 3 * numberOfVertices;
+            unsigned int shaderVariant = GetPrimitiveShaderVariant(primitive);
+            if (shaderVariant & SHADER_VARIANT_TEXTURED) {
+                bytes += sizeof(float) * 2 * numberOfVertices;
+            }
+            if (shaderVariant & SHADER_VARIANT_VERTEX_COLOR) {
+                bytes += sizeof(float) * 4 * numberOfVertices;
+            }
+            if (shaderVariant & SHADER_VARIANT_LIT) {
+                bytes += sizeof(float) * 3 * numberOfVertices;
+            }
+            if (shaderVariant & SHADER_VARIANT_NORMAL_MAP) {
+                bytes += sizeof(float) * 4 * numberOfVertices;
+            }
+        }
+    }
+    return bytes;
+}
+
+/**
+ * Textured needs both UVs and a diffuse texture, which DecodeTextures made sure is loaded;
+ * a normal map also needs the tangents that only aiProcess_CalcTangentSpace computes
+ */
+unsigned int AssimpLoader::GetMeshShaderVariant(const aiMesh *mesh) const {
+
+    aiString texturePath;
+    const aiMaterial *material = mesh->mMaterialIndex < scene->mNumMaterials ?
+                                 scene->mMaterials[mesh->mMaterialIndex] : NULL;
+    bool isTextured = mesh->HasTextureCoords(0) && material &&
+                      material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS;
+    bool hasNormalMap = material && GetNormalMapPath(material, texturePath);
+    return SelectShaderVariant(isTextured, mesh->HasVertexColors(0), mesh->HasNormals(),
+                               hasNormalMap, mesh->HasTangentsAndBitangents());
+}
+
+void AssimpLoader::MapAsset(const std::string &assetName) {
+    assetIOSystem->MapAsset(assetName);
+}
+
+void AssimpLoader::SetAssetDirectory(const std::string &assetDirectory) {
+    assetIOSystem->SetAssetDirectory(assetDirectory);
+}
+
 /**
  * Clears memory associated with the 3D model
  */
 void AssimpLoader::Delete3DModel() {
-    if (isObjectLoaded) {
-        // clear modelMeshes stuff
-//        for (unsigned int i = 0; i < modelMeshes.size(); ++i) {
-//            glDeleteTextures(1, &(modelMeshes[i].textureIndex));
-//        }
-        modelMeshes.clear();
 
+    // a failed load can leave textures in GL, so this runs even if the model is not loaded
+    for (unsigned int i = 0; i < modelMeshes.size(); ++i) {
+        GLuint buffers[] = {modelMeshes[i].faceBuffer, modelMeshes[i].vertexBuffer,
+                            modelMeshes[i].textureCoordBuffer, modelMeshes[i].colorBuffer,
+                            modelMeshes[i].normalBuffer, modelMeshes[i].tangentBuffer};
+        glDeleteBuffers(6, buffers); // zeros are ignored
+    }
+    std::map<std::string, GLuint>::iterator textureIterator = textureNameMap.begin();
+    for (; textureIterator != textureNameMap.end(); ++textureIterator) {
+        glDeleteTextures(1, &textureIterator->second);
+    }
+
+    modelMeshes.clear();
+    memset(usedShaderVariants, 0, sizeof(usedShaderVariants));
+    textureNameMap.clear();
+    materials.clear();
+    sceneGraph.Clear();
+    instanceVisibility.clear();
+    visibleInstances = 0;
+    pickingData.positions.clear();
+    pickingData.indices.clear();
+    pickingData.firstIndices.clear();
+    boundsMin = boundsMax = glm::vec3(0);
+    gpuBufferBytes = gpuTextureBytes = 0;
+
+    if (isObjectLoaded) {
         MyLOGI("Deleted Assimp object");
         isObjectLoaded = false;
     }
 }
 
 /**
- * Renders the 3D model by rendering every mesh in the object
+ * Nearest intersection of a ray with the model's triangles (Moller-Trumbore), in model space
+ * Needs a load with keepPickingData, returns false if nothing is hit
+ * The ray is moved into each instance's mesh space instead of moving the triangles; the
+ * distance along the ray is the same in both
  */
-void AssimpLoader::Render3DModel(glm::mat4 *mvpMat) {
+bool AssimpLoader::PickRay(glm::vec3 rayOrigin, glm::vec3 rayDirection,
+                           float &hitDistance) const {
+
+    bool isHit = false;
+    hitDistance = FLT_MAX;
+    if (pickingData.firstIndices.empty()) {
+        return false;
+    }
+    for (unsigned int instance = 0; instance < sceneGraph.GetNumberOfInstances(); ++instance) {
+
+        glm::mat4 worldToMesh = glm::inverse(
+                sceneGraph.GetWorldMatrix(sceneGraph.GetInstanceNode(instance)));
+        glm::vec3 origin(worldToMesh * glm::vec4(rayOrigin, 1.f));
+        glm::vec3 direction(worldToMesh * glm::vec4(rayDirection, 0.f));
+        unsigned int mesh = sceneGraph.GetInstanceMesh(instance);
+
+        for (unsigned int t = pickingData.firstIndices[mesh];
+             t + 2 < pickingData.firstIndices[mesh + 1]; t += 3) {
+
+            const glm::vec3 &v0 = pickingData.positions[pickingData.indices[t]];
+            glm::vec3 edge1 = pickingData.positions[pickingData.indices[t + 1]] - v0;
+            glm::vec3 edge2 = pickingData.positions[pickingData.indices[t + 2]] - v0;
+
+            glm::vec3 p = glm::cross(direction, edge2);
+            float determinant = glm::dot(edge1, p);
+            if (fabsf(determinant) < 1e-8f) {
+                continue; // ray is parallel to the triangle
+            }
+            float inverseDeterminant = 1.f / determinant;
+            glm::vec3 s = origin - v0;
+            float u = glm::dot(s, p) * inverseDeterminant;
+            if (u < 0.f || u > 1.f) {
+                continue;
+            }
+            glm::vec3 q = glm::cross(s, edge1);
+            float v = glm::dot(direction, q) * inverseDeterminant;
+            if (v < 0.f || u + v > 1.f) {
+                continue;
+            }
+            float distance = glm::dot(edge2, q) * inverseDeterminant;
+            if (distance > 0.f && distance < hitDistance) {
+                hitDistance = distance;
+                isHit = true;
+            }
+        }
+    }
+    return isHit;
+}
+
+/**
+ * Resident memory of the loaded model. CPU bytes count containers at their capacity and
+ * the blocks the staging arena keeps for the next load
+ */
+ModelMemoryStats AssimpLoader::GetMemoryStats() const {
+
+    ModelMemoryStats stats;
+    stats.cpuBytes = modelMeshes.capacity() * sizeof(MeshInfo) +
+                     materials.capacity() * sizeof(MaterialInfo) +
+                     pickingData.positions.capacity() * sizeof(glm::vec3) +
+                     pickingData.indices.capacity() * sizeof(unsigned int) +
+                     pickingData.firstIndices.capacity() * sizeof(unsigned int) +
+                     sceneGraph.GetMemoryBytes() + instanceVisibility.capacity() +
+                     stagingArena.GetReservedBytes();
+    for (unsigned int m = 0; m < materials.size(); ++m) {
+        stats.cpuBytes += materials[m].diffuseTextureName.capacity();
+    }
+    std::map<std::string, GLuint>::const_iterator textureIterator = textureNameMap.begin();
+    for (; textureIterator != textureNameMap.end(); ++textureIterator) {
+        // map nodes carry three pointers and a color on top of the pair
+        stats.cpuBytes += sizeof(*textureIterator) + 4 * sizeof(void *) +
+                          textureIterator->first.capacity();
+    }
+    stats.gpuBufferBytes = gpuBufferBytes;
+    stats.gpuTextureBytes = gpuTextureBytes;
+    return stats;
+}
+
+/**
+ * Renders the 3D model by rendering every instance of a mesh in the scene graph
+ * The lighting tier caps what each mesh's variant does, see ApplyLightingTier
+ * Runs every frame and must not allocate
+ */
+void AssimpLoader::Render3DModel(glm::mat4 *mvpMat, LightingTier lightingTier) {
+
+    MyAllocScope allocScope("AssimpLoader::Render3DModel");
 
     if (!isObjectLoaded) {
         return;
     }
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // skip instances outside the view; the planes come from the MVP, so they are in model space
+    // like the instances' world bounds
+    sceneGraph.UpdateWorldMatrices();
+    glm::vec4 frustumPlanes[6];
+    ExtractFrustumPlanes(*mvpMat, frustumPlanes);
+    visibleInstances = sceneGraph.CullInstances(frustumPlanes, instanceVisibility.data());
 
-    glUseProgram(shaderProgramID);
-    glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, (const GLfloat *) mvpMat);
+    // ModelAssimp::Render clears once for all the models it draws
+    // one pass per shader variant the model uses, so each program is bound once
+    for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; ++v) {
 
-    glActiveTexture(GL_TEXTURE0);
-    glUniform1i(textureSamplerLocation, 0); // 0: 纹理阶段
+        if (!(usedShaderVariants[lightingTier] & (1u << v))) {
+            continue;
+        }
+        // finished by UploadModel, NULL only if the variant failed to build
+        const ShaderVariant *variant = GetShaderVariants().GetReadyVariant(v);
+        if (!variant) {
+            continue;
+        }
+        glUseProgram(variant->programID);
+        if (variant->textureSamplerLocation >= 0) {
+            glActiveTexture(GL_TEXTURE0);
+            glUniform1i(variant->textureSamplerLocation, 0); // 0: 纹理阶段
+        }
+        if (variant->normalSamplerLocation >= 0) {
+            glUniform1i(variant->normalSamplerLocation, 1);
+        }
+        if (variant->lightDirectionLocation >= 0) {
+            glUniform3f(variant->lightDirectionLocation, gLightDirection.x, gLightDirection.y,
+                        gLightDirection.z);
+        }
 
-    unsigned int numberOfLoadedMeshes = modelMeshes.size();
-    MyLOGI("numberOfLoadedMeshes is %d ", numberOfLoadedMeshes);
+        // render every visible instance of every mesh drawn with this variant
+        for (unsigned int instance = 0; instance < sceneGraph.GetNumberOfInstances(); ++instance) {
 
-    // render all meshes
-    for (unsigned int n = 0; n < numberOfLoadedMeshes; ++n) {
+            unsigned int n = sceneGraph.GetInstanceMesh(instance);
+            if (!instanceVisibility[instance] ||
+                ApplyLightingTier(modelMeshes[n].shaderVariant, lightingTier) != v) {
+                continue;
+            }
+            const glm::mat4 &worldMat =
+                    sceneGraph.GetWorldMatrix(sceneGraph.GetInstanceNode(instance));
+            glm::mat4 instanceMVP = *mvpMat * worldMat;
+            glUniformMatrix4fv(variant->mvpLocation, 1, GL_FALSE, (const GLfloat *) &instanceMVP);
+            // normals and tangents into the model space of the light, whatever the node's scale
+            if (variant->normalMatLocation >= 0) {
+                glm::mat3 normalMat = glm::transpose(glm::inverse(glm::mat3(worldMat)));
+                glUniformMatrix3fv(variant->normalMatLocation, 1, GL_FALSE,
+                                   (const GLfloat *) &normalMat);
+            }
+            if (variant->worldMatLocation >= 0) {
+                glm::mat3 tangentMat(worldMat);
+                glUniformMatrix3fv(variant->worldMatLocation, 1, GL_FALSE,
+                                   (const GLfloat *) &tangentMat);
+            }
 
-//        MyLOGE("modelMeshes[n].textureIndex= %d", modelMeshes[n].textureIndex);
+            // Texture, or the material's color for the untextured variants
+            if (variant->normalSamplerLocation >= 0) {
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, modelMeshes[n].normalMapIndex);
+                glActiveTexture(GL_TEXTURE0);
+            }
+            if (variant->textureSamplerLocation >= 0) {
+                glBindTexture( GL_TEXTURE_2D, modelMeshes[n].textureIndex);
+            } else if (variant->diffuseColorLocation >= 0 &&
+                       modelMeshes[n].materialIndex < materials.size()) {
+                const glm::vec4 &diffuseColor = materials[modelMeshes[n].materialIndex].diffuseColor;
+                glUniform4f(variant->diffuseColorLocation, diffuseColor.r, diffuseColor.g,
+                            diffuseColor.b, diffuseColor.a);
+            }
 
-        // Texture
-        if (modelMeshes[n].textureIndex) {
-            glBindTexture( GL_TEXTURE_2D, modelMeshes[n].textureIndex);
-        }
+            // Faces
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelMeshes[n].faceBuffer);
+
+            // Vertices
+            glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].vertexBuffer);
+            glEnableVertexAttribArray(variant->vertexAttribute);
+    /*
+            第一个参数指定我们要配置的顶点属性。还记得我们在顶点着色器中使用layout(location = 0)定义了position顶点属性的位置值(Location)吗？它可以把顶点属性的位置值设置为0。因为我们希望把数据传递到这一个顶点属性中，所以这里我们传入0。
+            第二个参数指定顶点属性的大小。顶点属性是一个vec3，它由3个值组成，所以大小是3。
+            第三个参数指定数据的类型，这里是GL_FLOAT(GLSL中vec*都是由浮点数值组成的)。
+            下个参数定义我们是否希望数据被标准化(Normalize)。如果我们设置为GL_TRUE，所有数据都会被映射到0（对于有符号型signed数据是-1）到1之间。我们把它设置为GL_FALSE。
+            第五个参数叫做步长(Stride)，它告诉我们在连续的顶点属性组之间的间隔。由于下个组位置数据在3个GLfloat之后，我们把步长设置为3 * sizeof(GLfloat)。要注意的是由于我们知道这个数组是紧密排列的（在两个顶点属性之间没有空隙）我们也可以设置为0来让OpenGL决定具体步长是多少（只有当数值是紧密排列时才可用）。一旦我们有更多的顶点属性，我们就必须更小心地定义每个顶点属性之间的间隔，我们在后面会看到更多的例子(译注: 这个参数的意思简单说就是从这个属性第二次出现的地方到整个数组0位置之间有多少字节)。
+            最后一个参数的类型是GLvoid*，所以需要我们进行这个奇怪的强制类型转换。它表示位置数据在缓冲中起始位置的偏移量(Offset)。由于位置数据在数组的开头，所以这里是0。我们会在后面详细解释这个参数
+    */
+            glVertexAttribPointer(variant->vertexAttribute, 3, GL_FLOAT, 0, 0, 0);
+
+            // Texture coords
+            if (variant->vertexUVAttribute >= 0) {
+                glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].textureCoordBuffer);
+                glEnableVertexAttribArray(variant->vertexUVAttribute);
+                glVertexAttribPointer(variant->vertexUVAttribute, 2, GL_FLOAT, 0, 0, 0);
+            }
+            if (variant->vertexColorAttribute >= 0) {
+                glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].colorBuffer);
+                glEnableVertexAttribArray(variant->vertexColorAttribute);
+                glVertexAttribPointer(variant->vertexColorAttribute, 4, GL_FLOAT, 0, 0, 0);
+            }
+            if (variant->vertexNormalAttribute >= 0) {
+                glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].normalBuffer);
+                glEnableVertexAttribArray(variant->vertexNormalAttribute);
+                glVertexAttribPointer(variant->vertexNormalAttribute, 3, GL_FLOAT, 0, 0, 0);
+            }
+            if (variant->vertexTangentAttribute >= 0) {
+                glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].tangentBuffer);
+                glEnableVertexAttribArray(variant->vertexTangentAttribute);
+                glVertexAttribPointer(variant->vertexTangentAttribute, 4, GL_FLOAT, 0, 0, 0);
+            }
 
-        // Faces
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelMeshes[n].faceBuffer);
+            glDrawElements(GL_TRIANGLES, modelMeshes[n].numberOfFaces * 3, modelMeshes[n].indexType,
+                           0);
 
-        // Vertices
-        glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].vertexBuffer);
-        glEnableVertexAttribArray(vertexAttribute);
-/*
-        第一个参数指定我们要配置的顶点属性。还记得我们在顶点着色器中使用layout(location = 0)定义了position顶点属性的位置值(Location)吗？它可以把顶点属性的位置值设置为0。因为我们希望把数据传递到这一个顶点属性中，所以这里我们传入0。
-        第二个参数指定顶点属性的大小。顶点属性是一个vec3，它由3个值组成，所以大小是3。
-        第三个参数指定数据的类型，这里是GL_FLOAT(GLSL中vec*都是由浮点数值组成的)。
-        下个参数定义我们是否希望数据被标准化(Normalize)。如果我们设置为GL_TRUE，所有数据都会被映射到0（对于有符号型signed数据是-1）到1之间。我们把它设置为GL_FALSE。
-        第五个参数叫做步长(Stride)，它告诉我们在连续的顶点属性组之间的间隔。由于下个组位置数据在3个GLfloat之后，我们把步长设置为3 * sizeof(GLfloat)。要注意的是由于我们知道这个数组是紧密排列的（在两个顶点属性之间没有空隙）我们也可以设置为0来让OpenGL决定具体步长是多少（只有当数值是紧密排列时才可用）。一旦我们有更多的顶点属性，我们就必须更小心地定义每个顶点属性之间的间隔，我们在后面会看到更多的例子(译注: 这个参数的意思简单说就是从这个属性第二次出现的地方到整个数组0位置之间有多少字节)。
-        最后一个参数的类型是GLvoid*，所以需要我们进行这个奇怪的强制类型转换。它表示位置数据在缓冲中起始位置的偏移量(Offset)。由于位置数据在数组的开头，所以这里是0。我们会在后面详细解释这个参数
-*/
-        glVertexAttribPointer(vertexAttribute, 3, GL_FLOAT, 0, 0, 0);
-
-        // Texture coords
-        glBindBuffer(GL_ARRAY_BUFFER, modelMeshes[n].textureCoordBuffer);
-        glEnableVertexAttribArray(vertexUVAttribute);
-        glVertexAttribPointer(vertexUVAttribute, 2, GL_FLOAT, 0, 0, 0);
-
-        glDrawElements(GL_TRIANGLES, modelMeshes[n].numberOfFaces * 3, GL_UNSIGNED_INT, 0);
-
-        // unbind buffers
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-//        glBindTexture(GL_TEXTURE_2D, 0);
+            // unbind buffers
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+
+        // the next variant may not have these inputs, leave no array enabled without a buffer
+        if (variant->vertexUVAttribute >= 0) {
+            glDisableVertexAttribArray(variant->vertexUVAttribute);
+        }
+        if (variant->vertexColorAttribute >= 0) {
+            glDisableVertexAttribArray(variant->vertexColorAttribute);
+        }
+        if (variant->vertexNormalAttribute >= 0) {
+            glDisableVertexAttribArray(variant->vertexNormalAttribute);
+        }
+        if (variant->vertexTangentAttribute >= 0) {
+            glDisableVertexAttribArray(variant->vertexTangentAttribute);
+        }
     }
 
     CheckGLError("AssimpLoader::renderObject() ");
@@ -18,12 +18,41 @@
 #define ASSIMPLOADER_H
 
 #include <map>
+#include <string>
+#include <vector>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "myArena.h"
+#include "myCancelToken.h"
 #include "myGLM.h"
 #include "myGLFunctions.h"
+#include "myGLBFile.h"
+#include "myImportStepTimer.h"
+#include "mySceneGraph.h"
+#include "myShaderVariants.h"
+
+namespace cv {
+    class Mat;
+}
+class MyAssetIOSystem;
+class MyImportProgress;
+
+// named sets of post-processing steps, pick the cheapest one that still renders a model correctly
+enum ImportProfile {
+    IMPORT_PROFILE_MINIMAL_TEXTURED,    // triangles with UVs, all the textured variant reads
+    IMPORT_PROFILE_LIT,                 // adds smooth normals and vertex cache ordering
+    IMPORT_PROFILE_FULL,                // aiProcessPreset_TargetRealtime_Quality, the old default
+    IMPORT_PROFILE_COUNT
+};
+#define DEFAULT_IMPORT_PROFILE  IMPORT_PROFILE_MINIMAL_TEXTURED
+
+unsigned int    GetImportProfileFlags(ImportProfile profile);
+const char *    GetImportProfileName(ImportProfile profile);
+bool            GetImportProfileByName(std::string profileName, ImportProfile &profile);
+// a .glb is mapped and drawn as it is, see AssimpLoader::PrepareGLB
+bool            IsGLBFileName(const std::string &fileName);
 
 // info used to render a mesh
 struct MeshInfo {
@@ -32,6 +61,44 @@ struct MeshInfo {
     GLuint  faceBuffer;
     GLuint  vertexBuffer;
     GLuint  textureCoordBuffer;
+    GLuint  colorBuffer;                            // only uploaded if the variant reads it
+    GLuint  normalBuffer;
+    GLuint  tangentBuffer;                          // xyzw, w is the bitangent's handedness
+    GLenum  indexType;                              // GL_UNSIGNED_INT but for some GLBs
+    GLuint  normalMapIndex;                         // texture name in GL, 0 if none
+    unsigned int materialIndex;                     // index into the model's material table
+    unsigned int shaderVariant;                     // see myShaderVariants.h
+};
+
+// what is kept of an aiMaterial once the scene is freed
+struct MaterialInfo {
+    std::string diffuseTextureName;                 // empty if the material has no texture
+    GLuint      textureName;                        // texture name in GL, 0 if none
+    GLuint      normalMapName;                      // same for the normal map
+    glm::vec4   diffuseColor;
+};
+
+// all triangles of the model on the CPU, only kept if a load asks for it
+struct PickingData {
+    std::vector<glm::vec3>      positions;
+    std::vector<unsigned int>   indices;            // three per triangle
+    std::vector<unsigned int>   firstIndices;       // per mesh, and one past the last mesh
+};
+
+// memory held by a loaded model
+struct ModelMemoryStats {
+    size_t  cpuBytes;                               // bookkeeping, picking data, staging arena
+    size_t  gpuBufferBytes;                         // index and vertex buffers
+    size_t  gpuTextureBytes;                        // texture images, at the size uploaded
+};
+
+// what the last load read to prepare the model
+struct ModelReadStats {
+    size_t          modelBytes;                     // OBJ and MTL
+    size_t          meshCacheBytes;                 // encoded meshes read instead of those
+    size_t          textureBytes;                   // encoded texture files
+    unsigned int    texturesRead;
+    unsigned int    texturesSkipped;                // named by a material, drawn by no mesh
 };
 
 class AssimpLoader {
@@ -40,24 +107,135 @@ public:
     AssimpLoader();
     ~AssimpLoader();
 
-    void Render3DModel(glm::mat4 *MVP);
-    bool Load3DModel(std::string modelFilename);
+    void Render3DModel(glm::mat4 *MVP, LightingTier lightingTier = LIGHTING_PER_PIXEL);
+    // PrepareModel and then UploadModel
+    bool Load3DModel(std::string modelFilename, ImportProfile importProfile = DEFAULT_IMPORT_PROFILE,
+                     bool keepPickingData = false);
     void Delete3DModel();
 
+    // the two halves of a load: import and texture decode on any thread, then the GL uploads
+    // on the GL thread. A prepared model holds its scene and decoded textures until uploaded.
+    // Both return false soon after cancelToken is cancelled, leaving nothing prepared or loaded
+    bool PrepareModel(std::string modelFilename,
+                      ImportProfile importProfile = DEFAULT_IMPORT_PROFILE,
+                      const MyCancelToken *cancelToken = NULL);
+    bool UploadModel(bool keepPickingData = false, const MyCancelToken *cancelToken = NULL);
+    // UploadModel spread over frames: sends textures and then meshes until about byteBudget
+    // bytes went to GL, at least one of them, and sets isUploaded with the last. UploadModel
+    // sends the rest of an upload begun this way
+    bool UploadModelStep(bool keepPickingData, size_t byteBudget, bool &isUploaded,
+                         const MyCancelToken *cancelToken = NULL);
+    bool IsPrepared() const { return scene != NULL || glbFile != NULL; }
+    bool IsLoaded() const { return isObjectLoaded; }
+    size_t GetPreparedBytes() const;                // what UploadModel will send to the GPU
+    // the import reads files named like the asset, e.g. the MTL and textures, from the assets
+    // in memory instead of the model's directory
+    void MapAsset(const std::string &assetName);
+    // the model's directory in the assets, where files that were not mapped are looked for
+    void SetAssetDirectory(const std::string &assetDirectory);
+    // content hash of the files the import reads, see ModelRequest::sourceHash. If not 0, the
+    // imported meshes are cached in the internal directory and later loads decode them instead
+    // of running ReadFile
+    void SetMeshCacheKey(uint64_t sourceHash) { meshCacheKey = sourceHash; }
+    ModelReadStats GetReadStats() const { return readStats; }
+    // GPU bytes the last upload sent straight from a GLB's mapping, without staging copies
+    size_t GetMappedUploadBytes() const { return mappedUploadBytes; }
+
+    bool PickRay(glm::vec3 rayOrigin, glm::vec3 rayDirection, float &hitDistance) const;
+    ModelMemoryStats GetMemoryStats() const;
+    glm::vec3 GetBoundsMin() const { return boundsMin; }
+    glm::vec3 GetBoundsMax() const { return boundsMax; }
+    const std::vector<MaterialInfo> & GetMaterials() const { return materials; }
+    unsigned int GetVisibleInstances() const { return visibleInstances; }   // in the last frame
+    unsigned int GetNumberOfMeshes() const { return modelMeshes.size(); }
+    // a bit per shader variant the meshes are drawn with at the tier
+    unsigned int GetUsedShaderVariants(LightingTier lightingTier) const {
+        return usedShaderVariants[lightingTier];
+    }
+    const MySceneGraph & GetSceneGraph() const { return sceneGraph; }
+    MySceneGraph & GetSceneGraph() { return sceneGraph; }
+
+    // time ReadFile per post-process step on the next loads. Needs an Assimp DefaultLogger, made
+    // verbose during ReadFile, which slows the import down
+    void SetMeasureImportSteps(bool measureImportSteps) {
+        this->measureImportSteps = measureImportSteps;
+    }
+    const std::vector<ImportStepTime> & GetImportStepTimes() const {
+        return importStepTimer.GetStepTimes();
+    }
+
+    // threads for our own normals/weld/cache steps, 0 leaves them to Assimp
+    void SetPostProcessThreads(unsigned int postProcessThreads) {
+        this->postProcessThreads = postProcessThreads;
+    }
+
+    // CPU-side stages of a load, exposed so that host benchmarks can time them separately
+    static void PackFaceIndices(const aiMesh *mesh, unsigned int *faceArray);
+    static void PackTextureCoords(const aiMesh *mesh, float *textureCoords);
+    static bool DecodeTexture(std::string textureFullPath, cv::Mat &textureImage,
+                              MyArena *stagingArena = NULL);
+    static bool DecodeTexture(const uint8_t *encodedData, size_t encodedSize,
+                              cv::Mat &textureImage, MyArena *stagingArena = NULL,
+                              bool isFlipped = true);
+
 private:
-    void GenerateGLBuffers();
-    bool LoadTexturesToGL(std::string modelFilename);
+    static bool FlipTextureForGL(cv::Mat &textureImage, bool isFlipped = true);
+    unsigned int GetMeshShaderVariant(const aiMesh *mesh) const;
+    void GenerateGLBuffers(unsigned int n, bool keepPickingData);
+    void FinishGLBuffers(bool keepPickingData);
+    bool DecodeTextures(std::string modelFilename, const MyCancelToken *cancelToken);
+    void LoadTextureToGL();
+    void CancelUpload();
+    void BuildMaterialTable();
+    bool ImportScene(std::string modelFilename, ImportProfile importProfile,
+                     const MyCancelToken *cancelToken);
+    uint64_t GetMeshCacheKey(ImportProfile importProfile) const;
+    bool ReadMeshCache(uint64_t cacheKey);
+    void WriteMeshCache(uint64_t cacheKey) const;
+    void FreeScene();
+    bool PrepareGLB(std::string modelFilename, const MyCancelToken *cancelToken);
+    bool DecodeGLBImages(const MyCancelToken *cancelToken);
+    unsigned int GetPrimitiveShaderVariant(const GLBPrimitive &primitive) const;
+    const float * GetGLBFloats(const GLBAccessor &accessor, unsigned int components);
+    void GenerateGLBBuffers(unsigned int n, bool keepPickingData);
+    void BuildGLBMaterialTable();
+    void FinishShaderVariants() const;
 
     std::vector<struct MeshInfo> modelMeshes;       // contains one struct for every mesh in model
     Assimp::Importer *importerPtr;
-    const aiScene* scene;                           // assimp's output data structure
+    MyImportProgress *importProgress;               // owned by the importer
+    MyAssetIOSystem *assetIOSystem;                 // owned by the importer
+    const aiScene* scene;                           // assimp's output data structure, only
+                                                    // valid from PrepareModel to UploadModel
+    aiScene *decodedScene;                          // scene read from the mesh cache, owned
+    std::vector<const unsigned int *> decodedIndices;   // its faces, per mesh in stagingArena
+    MyGLBFile *glbFile;                             // mapped instead of a scene for a .glb model
+    uint64_t meshCacheKey;
     bool isObjectLoaded;
 
-    std::map<std::string, GLuint> textureNameMap;   // (texture filename, texture name in GL)
+    // compact CPU-side record of the loaded model
+    glm::vec3 boundsMin, boundsMax;                 // axis-aligned bounds of all vertices
+    std::vector<MaterialInfo> materials;
+    PickingData pickingData;
+    MySceneGraph sceneGraph;                        // nodes of the scene, drawing modelMeshes
+    std::vector<unsigned char> instanceVisibility;  // frustum test of the last frame
+    unsigned int visibleInstances;
+    size_t gpuBufferBytes, gpuTextureBytes;
+    ModelReadStats readStats;
+    size_t mappedUploadBytes;
 
-    GLuint  vertexAttribute, vertexUVAttribute;     // attributes for shader variables
-    GLuint  shaderProgramID;
-    GLint   mvpLocation, textureSamplerLocation;    // location of MVP in the shader
+    bool measureImportSteps;
+    unsigned int postProcessThreads;
+    MyImportStepTimer importStepTimer;
+    MyArena stagingArena;                           // scratch memory of a load, reset after upload
+
+    std::map<std::string, GLuint> textureNameMap;   // (texture filename, texture name in GL)
+    std::vector<cv::Mat> preparedTextures;          // decoded, in textureNameMap order
+    bool isUploading;                               // between the first and last UploadModelStep
+    unsigned int uploadedTextures;                  // of preparedTextures so far
+    unsigned int uploadedMeshes;                    // of the scene's meshes or GLB primitives
+    std::map<std::string, GLuint>::iterator uploadTextureIterator;  // the next texture's entry
+    unsigned int usedShaderVariants[LIGHTING_TIER_COUNT];   // a bit per variant drawn at a tier
 };
 
 #endif //ASSIMPLOADER_H
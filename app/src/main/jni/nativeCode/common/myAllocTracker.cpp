@@ -0,0 +1,213 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myAllocTracker.h"
+
+#ifdef MY_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <errno.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// the hooks below must not allocate, so scopes live in a fixed table
+#define MAX_ALLOC_SCOPES    64
+
+struct AllocScopeSlot {
+    std::atomic<const char *>   name;
+    std::atomic<unsigned long>  allocations;
+    std::atomic<unsigned long>  bytes;
+};
+
+static AllocScopeSlot               gScopes[MAX_ALLOC_SCOPES];
+static std::atomic<int>             gNumberOfScopes(0);
+static std::atomic<unsigned long>   gTotalAllocations(0);
+static std::atomic<unsigned long>   gTotalBytes(0);
+static __thread int                 gCurrentScope = -1;
+static __thread unsigned long       gThreadAllocations = 0;
+static __thread unsigned long       gThreadBytes = 0;
+
+static inline void CountAllocation(size_t size) {
+
+    gTotalAllocations.fetch_add(1, std::memory_order_relaxed);
+    gTotalBytes.fetch_add(size, std::memory_order_relaxed);
+    gThreadAllocations++;
+    gThreadBytes += size;
+    int scope = gCurrentScope;
+    if (scope >= 0) {
+        gScopes[scope].allocations.fetch_add(1, std::memory_order_relaxed);
+        gScopes[scope].bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Find the slot of a scope, or claim a new one. Returns -1 if the table is full
+ */
+static int FindScope(const char *name, bool createIfMissing) {
+
+    int numberOfScopes = gNumberOfScopes.load();
+    for (int i = 0; i < numberOfScopes; ++i) {
+        const char *slotName = gScopes[i].name.load();
+        if (slotName && strcmp(slotName, name) == 0) {
+            return i;
+        }
+    }
+    if (!createIfMissing) {
+        return -1;
+    }
+    int slot = gNumberOfScopes.fetch_add(1);
+    if (slot >= MAX_ALLOC_SCOPES) {
+        gNumberOfScopes = MAX_ALLOC_SCOPES;
+        return -1;
+    }
+    gScopes[slot].name = name;
+    return slot;
+}
+
+MyAllocScope::MyAllocScope(const char *name) {
+    previousScope = gCurrentScope;
+    gCurrentScope = FindScope(name, true);
+}
+
+MyAllocScope::~MyAllocScope() {
+    gCurrentScope = previousScope;
+}
+
+MyAllocCounts GetAllocCounts() {
+    MyAllocCounts counts;
+    counts.allocations = gTotalAllocations.load();
+    counts.bytes = gTotalBytes.load();
+    return counts;
+}
+
+MyAllocCounts GetThreadAllocCounts() {
+    MyAllocCounts counts;
+    counts.allocations = gThreadAllocations;
+    counts.bytes = gThreadBytes;
+    return counts;
+}
+
+MyAllocCounts GetScopeAllocCounts(const char *name) {
+    MyAllocCounts counts = {0, 0};
+    int scope = FindScope(name, false);
+    if (scope >= 0) {
+        counts.allocations = gScopes[scope].allocations.load();
+        counts.bytes = gScopes[scope].bytes.load();
+    }
+    return counts;
+}
+
+void PrintAllocScopes(FILE *out) {
+    fprintf(out, "{");
+    int numberOfScopes = gNumberOfScopes.load();
+    for (int i = 0; i < numberOfScopes; ++i) {
+        fprintf(out, "%s\"%s\": {\"allocs\": %lu, \"bytes\": %lu}", i ? ", " : "",
+                gScopes[i].name.load(), gScopes[i].allocations.load(), gScopes[i].bytes.load());
+    }
+    fprintf(out, "}");
+}
+
+// ---- hooks ----
+
+#ifdef __GLIBC__
+
+// glibc lets us interpose malloc and still reach the real allocator
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+    CountAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    CountAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    CountAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer) {
+    __libc_free(pointer);
+}
+
+// OpenCV's fastMalloc uses posix_memalign
+void *memalign(size_t alignment, size_t size) {
+    CountAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size) {
+    CountAllocation(size);
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer ? 0 : ENOMEM;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    CountAllocation(size);
+    return __libc_memalign(alignment, size);
+}
+}
+
+#define RAW_MALLOC  __libc_malloc
+#define RAW_FREE    __libc_free
+
+#else
+
+#define RAW_MALLOC  malloc
+#define RAW_FREE    free
+
+#endif //__GLIBC__
+
+void *operator new(size_t size) {
+    CountAllocation(size);
+    void *pointer = RAW_MALLOC(size ? size : 1);
+    if (!pointer) {
+        abort();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    CountAllocation(size);
+    return RAW_MALLOC(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *pointer) noexcept {
+    RAW_FREE(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    RAW_FREE(pointer);
+}
+
+#endif //MY_TRACK_ALLOCATIONS
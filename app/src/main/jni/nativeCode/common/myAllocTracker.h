@@ -0,0 +1,59 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Opt-in allocation tracking. When MY_TRACK_ALLOCATIONS is defined, myAllocTracker.cpp
+// replaces operator new/delete (and the malloc family with glibc) and counts every
+// allocation, both process-wide and for the innermost MyAllocScope active on the thread.
+// Without the define, MyAllocScope compiles to nothing.
+
+#ifndef MY_ALLOC_TRACKER_H
+#define MY_ALLOC_TRACKER_H
+
+#include <stdio.h>
+
+struct MyAllocCounts {
+    unsigned long   allocations;
+    unsigned long   bytes;
+};
+
+#ifdef MY_TRACK_ALLOCATIONS
+
+// attributes allocations on this thread to a named scope until it is destroyed
+// name must be a string literal, scopes can be nested
+class MyAllocScope {
+public:
+    MyAllocScope(const char *name);
+    ~MyAllocScope();
+
+private:
+    int     previousScope;
+};
+
+MyAllocCounts   GetAllocCounts();                       // all allocations in the process
+MyAllocCounts   GetThreadAllocCounts();                 // allocations on this thread
+MyAllocCounts   GetScopeAllocCounts(const char *name);  // allocations inside a scope
+void            PrintAllocScopes(FILE *out);            // JSON object with every scope
+
+#else
+
+class MyAllocScope {
+public:
+    MyAllocScope(const char *name) {}
+};
+
+#endif //MY_TRACK_ALLOCATIONS
+
+#endif //MY_ALLOC_TRACKER_H
@@ -0,0 +1,200 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myArena.h"
+#include "myLogger.h"
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+
+// blocks form a list in allocation order, the data follows the header
+struct MyArenaBlock {
+    MyArenaBlock    *next;
+    size_t          size;
+    size_t          used;
+};
+
+static inline unsigned char * BlockData(MyArenaBlock *block) {
+    return (unsigned char *) (block + 1);
+}
+
+MyArena::MyArena(size_t blockSize, size_t retainedSize) : matAllocator(this) {
+    firstBlock      = NULL;
+    currentBlock    = NULL;
+    this->blockSize     = blockSize;
+    this->retainedSize  = retainedSize;
+    reservedBytes   = 0;
+    peakBytes       = 0;
+}
+
+MyArena::~MyArena() {
+    Release();
+}
+
+/**
+ * Bump-allocate from the current block, moving on to the next block or appending a new one
+ * when it does not fit. Returns NULL only if malloc fails
+ */
+void * MyArena::Allocate(size_t size, size_t alignment) {
+
+    MyArenaBlock *block = currentBlock;
+    while (block) {
+        uintptr_t start = (uintptr_t) (BlockData(block) + block->used);
+        uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t) (alignment - 1);
+        size_t end = block->used + (aligned - start) + size;
+        if (end <= block->size) {
+            block->used = end;
+            currentBlock = block;
+            size_t usedBytes = GetUsedBytes();
+            if (usedBytes > peakBytes) {
+                peakBytes = usedBytes;
+            }
+            return (void *) aligned;
+        }
+
+        // blocks after the current one hold nothing live
+        if (!block->next) {
+            break;
+        }
+        block = block->next;
+        block->used = 0;
+    }
+
+    // oversized requests get a block of their own
+    size_t newBlockSize = size + alignment > blockSize ? size + alignment : blockSize;
+    MyArenaBlock *newBlock = (MyArenaBlock *) malloc(sizeof(MyArenaBlock) + newBlockSize);
+    if (!newBlock) {
+        MyLOGE("MyArena: cannot reserve %zu bytes", newBlockSize);
+        return NULL;
+    }
+    newBlock->next = NULL;
+    newBlock->size = newBlockSize;
+    newBlock->used = 0;
+    reservedBytes += newBlockSize;
+
+    if (block) {
+        block->next = newBlock;
+    } else {
+        firstBlock = newBlock;
+    }
+    currentBlock = newBlock;
+    return Allocate(size, alignment);
+}
+
+MyArenaMarker MyArena::GetMarker() const {
+    MyArenaMarker marker;
+    marker.block = currentBlock;
+    marker.used = currentBlock ? currentBlock->used : 0;
+    return marker;
+}
+
+/**
+ * Free everything allocated after marker was taken, blocks are kept for reuse
+ */
+void MyArena::Rewind(MyArenaMarker marker) {
+    currentBlock = marker.block ? marker.block : firstBlock;
+    if (currentBlock) {
+        currentBlock->used = marker.block ? marker.used : 0;
+    }
+}
+
+/**
+ * Free every allocation. Keeps the blocks unless they add up to more than retainedSize,
+ * so that one large texture does not pin its staging memory after the load
+ */
+void MyArena::Reset() {
+    if (reservedBytes > retainedSize) {
+        Release();
+    } else {
+        Rewind(MyArenaMarker());
+    }
+    peakBytes = 0;
+}
+
+/**
+ * Give all blocks back to the heap
+ */
+void MyArena::Release() {
+    MyArenaBlock *block = firstBlock;
+    while (block) {
+        MyArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    firstBlock      = NULL;
+    currentBlock    = NULL;
+    reservedBytes   = 0;
+    peakBytes       = 0;
+}
+
+/**
+ * Bytes from the start of the arena up to the bump pointer, including tails that were skipped
+ */
+size_t MyArena::GetUsedBytes() const {
+    size_t usedBytes = 0;
+    for (MyArenaBlock *block = firstBlock; block; block = block->next) {
+        if (block == currentBlock) {
+            return usedBytes + block->used;
+        }
+        usedBytes += block->size;
+    }
+    return usedBytes;
+}
+
+/**
+ * Same layout as OpenCV's StdMatAllocator, but the pixels and the UMatData come from the arena
+ */
+cv::UMatData * MyArenaMatAllocator::allocate(int dims, const int *sizes, int type, void *data,
+                                             size_t *step, int flags,
+                                             cv::UMatUsageFlags usageFlags) const {
+
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data && step[i] != CV_AUTOSTEP) {
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    void *header = arena->Allocate(sizeof(cv::UMatData));
+    unsigned char *pixels = data ? (unsigned char *) data : (unsigned char *) arena->Allocate(total);
+    if (!header || !pixels) {
+        return NULL;
+    }
+    cv::UMatData *matData = new (header) cv::UMatData(this);
+    matData->data = matData->origdata = pixels;
+    matData->size = total;
+    if (data) {
+        matData->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    return matData;
+}
+
+bool MyArenaMatAllocator::allocate(cv::UMatData *data, int accessFlags,
+                                   cv::UMatUsageFlags usageFlags) const {
+    return data != NULL;
+}
+
+void MyArenaMatAllocator::deallocate(cv::UMatData *data) const {
+    // memory returns to the arena on Rewind/Reset, only run the destructor here
+    if (data && data->refcount == 0) {
+        data->~UMatData();
+    }
+}
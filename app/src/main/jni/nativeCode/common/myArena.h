@@ -0,0 +1,89 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef MY_ARENA_H
+#define MY_ARENA_H
+
+#include <stddef.h>
+#include <opencv2/core/core.hpp>
+
+#define MY_ARENA_DEFAULT_BLOCK_SIZE     (1 << 20)
+#define MY_ARENA_DEFAULT_RETAINED_SIZE  (4 << 20)
+
+struct MyArenaBlock;
+class MyArena;
+
+// lets cv::Mat place its pixels (and bookkeeping) in an arena, assign MyArena::GetMatAllocator
+// to Mat::allocator before the Mat is created; memory returns when the arena is rewound/reset
+class MyArenaMatAllocator : public cv::MatAllocator {
+public:
+    MyArenaMatAllocator(MyArena *arena) : arena(arena) {}
+
+    cv::UMatData *  allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                             int flags, cv::UMatUsageFlags usageFlags) const;
+    bool            allocate(cv::UMatData *data, int accessFlags,
+                             cv::UMatUsageFlags usageFlags) const;
+    void            deallocate(cv::UMatData *data) const;
+
+private:
+    MyArena *arena;
+};
+
+// position in an arena, everything allocated after it is freed by Rewind
+struct MyArenaMarker {
+    MyArenaBlock    *block;
+    size_t          used;
+};
+
+// Linear allocator for load-time scratch memory. Allocations are bumped out of large blocks
+// and never freed individually; Rewind drops everything after a marker and Reset drops
+// everything, keeping the blocks for the next load unless they exceed retainedSize
+class MyArena {
+public:
+    MyArena(size_t blockSize = MY_ARENA_DEFAULT_BLOCK_SIZE,
+            size_t retainedSize = MY_ARENA_DEFAULT_RETAINED_SIZE);
+    ~MyArena();
+
+    void *  Allocate(size_t size, size_t alignment = 16);
+    template <typename T> T * AllocateArray(size_t count) {
+        return (T *) Allocate(count * sizeof(T));
+    }
+
+    MyArenaMarker   GetMarker() const;
+    void            Rewind(MyArenaMarker marker);
+    void            Reset();
+    void            Release();
+
+    cv::MatAllocator *  GetMatAllocator() { return &matAllocator; }
+    size_t  GetReservedBytes() const { return reservedBytes; }
+    size_t  GetPeakBytes() const { return peakBytes; }    // most bytes in use since last Reset
+
+private:
+    MyArena(const MyArena &);
+    MyArena & operator=(const MyArena &);
+
+    size_t  GetUsedBytes() const;
+
+    MyArenaBlock    *firstBlock;
+    MyArenaBlock    *currentBlock;
+    size_t          blockSize;
+    size_t          retainedSize;
+    size_t          reservedBytes;
+    size_t          peakBytes;
+    MyArenaMatAllocator matAllocator;
+};
+
+#endif //MY_ARENA_H
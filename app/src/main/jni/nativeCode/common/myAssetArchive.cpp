@@ -0,0 +1,462 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myAssetArchive.h"
+#include "myJNIHelper.h"
+#include "myLogger.h"
+#include "myLZ4.h"
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader is written as is");
+static_assert(sizeof(ArchiveEntry) == 40, "ArchiveEntry is written as is");
+
+static uint64_t HashBytes(const uint8_t *bytes, size_t size,
+                          uint64_t hash = 14695981039346656037ULL) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int CompareName(const char *name, size_t nameLength, const std::string &assetName) {
+    int result = memcmp(name, assetName.data(), std::min(nameLength, assetName.size()));
+    if (result != 0) {
+        return result;
+    }
+    return nameLength < assetName.size() ? -1 : (nameLength > assetName.size() ? 1 : 0);
+}
+
+MyAssetArchive::MyAssetArchive() {
+    mapping = NULL;
+    mappingSize = 0;
+    data = NULL;
+    header = NULL;
+    entries = NULL;
+    names = NULL;
+}
+
+/**
+ * mmap wants a page-aligned offset, and the archive need not start on a page inside the APK
+ */
+bool MyAssetArchive::Open(int fd, int64_t start, size_t length) {
+
+    Close();
+    int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t mappingStart = start - start % pageSize;
+    mappingSize = length + (size_t) (start - mappingStart);
+    mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, (off_t) mappingStart);
+    if (mapping == MAP_FAILED) {
+        MyLOGE("Cannot map the asset archive");
+        mapping = NULL;
+        return false;
+    }
+    if (!Validate((const uint8_t *) mapping + (start - mappingStart), length)) {
+        MyLOGE("Asset archive is malformed");
+        Close();
+        return false;
+    }
+    MyLOGI("Asset archive: %u entries, %zu bytes", header->entryCount, length);
+    return true;
+}
+
+bool MyAssetArchive::OpenFile(const std::string &path) {
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    bool isOpen = fstat(fd, &fileStat) == 0 && Open(fd, 0, fileStat.st_size);
+    close(fd);
+    return isOpen;
+}
+
+void MyAssetArchive::Close() {
+
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = NULL;
+    mappingSize = 0;
+    data = NULL;
+    header = NULL;
+    entries = NULL;
+    names = NULL;
+}
+
+/**
+ * Everything an entry points at is checked once here, so reads can trust the index
+ */
+bool MyAssetArchive::Validate(const uint8_t *archiveData, size_t archiveSize) {
+
+    if (archiveSize < sizeof(ArchiveHeader)) {
+        return false;
+    }
+    const ArchiveHeader *archiveHeader = (const ArchiveHeader *) archiveData;
+    uint64_t indexSize = (uint64_t) archiveHeader->entryCount * sizeof(ArchiveEntry) +
+                         archiveHeader->namesSize;
+    if (archiveHeader->magic != ARCHIVE_MAGIC || archiveHeader->version != ARCHIVE_VERSION ||
+        archiveHeader->dataOffset < sizeof(ArchiveHeader) + indexSize ||
+        archiveHeader->dataOffset > archiveSize) {
+        return false;
+    }
+    const uint8_t *index = archiveData + sizeof(ArchiveHeader);
+    if (HashBytes(index, indexSize) != archiveHeader->indexHash) {
+        return false;
+    }
+
+    const ArchiveEntry *archiveEntries = (const ArchiveEntry *) index;
+    const char *archiveNames = (const char *) index +
+                               archiveHeader->entryCount * sizeof(ArchiveEntry);
+    for (unsigned int e = 0; e < archiveHeader->entryCount; ++e) {
+        const ArchiveEntry &entry = archiveEntries[e];
+        if ((uint64_t) entry.nameOffset + entry.nameLength > archiveHeader->namesSize ||
+            entry.offset < archiveHeader->dataOffset || entry.offset > archiveSize ||
+            entry.storedSize > archiveSize - entry.offset ||
+            (entry.compression == ARCHIVE_STORE && entry.storedSize != entry.size)) {
+            return false;
+        }
+        if (e > 0) {
+            const ArchiveEntry &previous = archiveEntries[e - 1];
+            std::string name(archiveNames + entry.nameOffset, entry.nameLength);
+            if (CompareName(archiveNames + previous.nameOffset, previous.nameLength, name) >= 0) {
+                return false;
+            }
+        }
+    }
+
+    data = archiveData;
+    header = archiveHeader;
+    entries = archiveEntries;
+    names = archiveNames;
+    return true;
+}
+
+const ArchiveEntry * MyAssetArchive::FindEntry(const std::string &assetName) const {
+
+    if (!header) {
+        return NULL;
+    }
+    unsigned int low = 0, high = header->entryCount;
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        int result = CompareName(names + entries[middle].nameOffset, entries[middle].nameLength,
+                                 assetName);
+        if (result == 0) {
+            return &entries[middle];
+        }
+        if (result < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return NULL;
+}
+
+const uint8_t * MyAssetArchive::GetEntryView(const ArchiveEntry *entry) const {
+    return entry->compression == ARCHIVE_STORE ? data + entry->offset : NULL;
+}
+
+bool MyAssetArchive::ReadEntry(const ArchiveEntry *entry, std::vector<uint8_t> &entryData) const {
+
+    if (entry->compression == ARCHIVE_STORE) {
+        entryData.assign(data + entry->offset, data + entry->offset + entry->size);
+        return true;
+    }
+    if (entry->compression != ARCHIVE_LZ4) {
+        MyLOGE("Asset %s has compression %u, which this build cannot read",
+               GetEntryName(entry).c_str(), entry->compression);
+        return false;
+    }
+    entryData.resize(entry->size);
+    if (!LZ4Decompress(data + entry->offset, entry->storedSize, entryData.data(), entry->size)) {
+        MyLOGE("Asset %s is corrupt", GetEntryName(entry).c_str());
+        entryData.clear();
+        return false;
+    }
+    return true;
+}
+
+bool MyAssetArchive::ReadEntry(const ArchiveEntry *entry, MyAssetBuffer &buffer) const {
+
+    buffer.Release();
+    const uint8_t *view = GetEntryView(entry);
+    if (view) {
+        buffer.data = view;
+        buffer.size = entry->size;
+        return true;
+    }
+    if (!ReadEntry(entry, buffer.copy)) {
+        return false;
+    }
+    buffer.data = buffer.copy.data();
+    buffer.size = entry->size;
+    return true;
+}
+
+/**
+ * The entry goes to a temporary file that replaces path once it is complete, a process killed
+ * halfway leaves no truncated file behind for the next start to find
+ */
+bool MyAssetArchive::ExtractEntry(const ArchiveEntry *entry, const std::string &path) const {
+
+    std::vector<uint8_t> decompressed;
+    const uint8_t *entryData = GetEntryView(entry);
+    if (!entryData) {
+        if (!ReadEntry(entry, decompressed)) {
+            return false;
+        }
+        entryData = decompressed.data();
+    }
+    std::string tempPath = path + ".tmp";
+    FILE *out = fopen(tempPath.c_str(), "wb");
+    if (!out) {
+        MyLOGE("Cannot write %s", tempPath.c_str());
+        return false;
+    }
+    bool isWritten = fwrite(entryData, 1, entry->size, out) == entry->size;
+    isWritten = fclose(out) == 0 && isWritten;
+    if (!isWritten || rename(tempPath.c_str(), path.c_str()) != 0) {
+        MyLOGE("Cannot write %s", path.c_str());
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The names are sorted, so a directory's assets are together, right after its own name
+ */
+void MyAssetArchive::ListDirectory(const std::string &directory,
+                                   std::vector<std::string> &fileNames) const {
+
+    std::string prefix = directory.empty() ? "" : directory + "/";
+    unsigned int low = 0, high = GetEntryCount();
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        if (CompareName(names + entries[middle].nameOffset, entries[middle].nameLength,
+                        prefix) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (unsigned int e = low; e < GetEntryCount(); ++e) {
+        const char *name = names + entries[e].nameOffset;
+        size_t nameLength = entries[e].nameLength;
+        if (nameLength < prefix.size() || memcmp(name, prefix.data(), prefix.size()) != 0) {
+            break;
+        }
+        if (!memchr(name + prefix.size(), '/', nameLength - prefix.size())) {
+            fileNames.push_back(std::string(name + prefix.size(), nameLength - prefix.size()));
+        }
+    }
+}
+
+ArchiveCompression GetDefaultArchiveCompression(const std::string &assetName) {
+
+    const char *storedExtensions[] = {".png", ".jpg", ".jpeg", ".glb", NULL};
+    for (unsigned int e = 0; storedExtensions[e]; ++e) {
+        size_t length = strlen(storedExtensions[e]);
+        if (assetName.size() > length &&
+            strcasecmp(assetName.c_str() + assetName.size() - length, storedExtensions[e]) == 0) {
+            return ARCHIVE_STORE;
+        }
+    }
+    return ARCHIVE_LZ4;
+}
+
+ArchiveCompression MyAssetArchiveWriter::AddEntry(const std::string &assetName,
+                                                  const std::vector<uint8_t> &entryData,
+                                                  ArchiveCompression compression) {
+
+    PendingEntry entry;
+    entry.assetName = assetName;
+    entry.size = entryData.size();
+    entry.hash = HashBytes(entryData.data(), entryData.size());
+    entry.compression = ARCHIVE_STORE;
+    if (compression == ARCHIVE_LZ4 && !entryData.empty()) {
+        entry.storedData.resize(LZ4CompressBound(entryData.size()));
+        size_t storedSize = LZ4Compress(entryData.data(), entryData.size(),
+                                        entry.storedData.data(), entry.storedData.size());
+        if (storedSize && storedSize <= entryData.size() - entryData.size() / 8) {
+            entry.storedData.resize(storedSize);
+            entry.compression = ARCHIVE_LZ4;
+        }
+    }
+    if (entry.compression == ARCHIVE_STORE) {
+        entry.storedData = entryData;
+    }
+    pendingEntries.push_back(entry);
+    return entry.compression;
+}
+
+bool MyAssetArchiveWriter::AddDirectory(const std::string &rootDirectory,
+                                        const std::string &skipName,
+                                        ArchiveCompression (*getCompression)(const std::string &),
+                                        const std::string &directory) {
+
+    std::string fullDirectory = directory.empty() ? rootDirectory :
+                                rootDirectory + "/" + directory;
+    DIR *dir = opendir(fullDirectory.c_str());
+    if (!dir) {
+        return false;
+    }
+    std::vector<std::string> fileNames, subDirectories;
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir(dir)) != NULL) {
+        std::string name = dirEntry->d_name;
+        std::string assetName = directory.empty() ? name : directory + "/" + name;
+        struct stat fileStat;
+        if (name[0] == '.' || assetName == skipName ||
+            stat((rootDirectory + "/" + assetName).c_str(), &fileStat) != 0) {
+            continue;
+        }
+        if (S_ISDIR(fileStat.st_mode)) {
+            subDirectories.push_back(assetName);
+        } else if (S_ISREG(fileStat.st_mode)) {
+            fileNames.push_back(assetName);
+        }
+    }
+    closedir(dir);
+
+    bool isAdded = true;
+    for (unsigned int f = 0; f < fileNames.size() && isAdded; ++f) {
+        FILE *file = fopen((rootDirectory + "/" + fileNames[f]).c_str(), "rb");
+        if (!file) {
+            isAdded = false;
+            break;
+        }
+        std::vector<uint8_t> fileData;
+        uint8_t chunk[BUFSIZ];
+        size_t chunkSize;
+        while ((chunkSize = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            fileData.insert(fileData.end(), chunk, chunk + chunkSize);
+        }
+        isAdded = !ferror(file);
+        fclose(file);
+        AddEntry(fileNames[f], fileData, getCompression(fileNames[f]));
+    }
+    for (unsigned int d = 0; d < subDirectories.size() && isAdded; ++d) {
+        isAdded = AddDirectory(rootDirectory, skipName, getCompression, subDirectories[d]);
+    }
+    return isAdded;
+}
+
+static bool WritePadding(FILE *out, uint64_t padding) {
+    static const uint8_t zeros[ARCHIVE_ALIGNMENT] = {0};
+    return padding < ARCHIVE_ALIGNMENT && fwrite(zeros, 1, padding, out) == padding;
+}
+
+bool MyAssetArchiveWriter::Write(const std::string &path) const {
+
+    std::vector<const PendingEntry *> sortedEntries;
+    for (unsigned int e = 0; e < pendingEntries.size(); ++e) {
+        sortedEntries.push_back(&pendingEntries[e]);
+    }
+    std::sort(sortedEntries.begin(), sortedEntries.end(),
+              [](const PendingEntry *a, const PendingEntry *b) {
+                  return a->assetName < b->assetName;
+              });
+
+    std::string names;
+    std::vector<ArchiveEntry> entries(sortedEntries.size());
+    for (unsigned int e = 0; e < sortedEntries.size(); ++e) {
+        memset(&entries[e], 0, sizeof(ArchiveEntry));
+        entries[e].nameOffset = names.size();
+        entries[e].nameLength = sortedEntries[e]->assetName.size();
+        names += sortedEntries[e]->assetName;
+    }
+
+    // stored entries go on the next page boundary, compressed ones right after the previous
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.entryCount = entries.size();
+    header.namesSize = names.size();
+    header.dataOffset = sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry) +
+                        names.size();
+    uint64_t offset = header.dataOffset;
+    for (unsigned int e = 0; e < sortedEntries.size(); ++e) {
+        const PendingEntry *entry = sortedEntries[e];
+        if (entry->compression == ARCHIVE_STORE) {
+            offset += (ARCHIVE_ALIGNMENT - offset % ARCHIVE_ALIGNMENT) % ARCHIVE_ALIGNMENT;
+        }
+        entries[e].offset = offset;
+        entries[e].storedSize = entry->storedData.size();
+        entries[e].size = entry->size;
+        entries[e].hash = entry->hash;
+        entries[e].compression = entry->compression;
+        offset += entry->storedData.size();
+    }
+    header.indexHash = HashBytes((const uint8_t *) names.data(), names.size(),
+                                 HashBytes((const uint8_t *) entries.data(),
+                                           entries.size() * sizeof(ArchiveEntry)));
+
+    FILE *out = fopen(path.c_str(), "wb");
+    if (!out) {
+        MyLOGE("Cannot write %s", path.c_str());
+        return false;
+    }
+    bool isWritten = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                     fwrite(entries.data(), sizeof(ArchiveEntry), entries.size(), out) ==
+                     entries.size() &&
+                     fwrite(names.data(), 1, names.size(), out) == names.size();
+    uint64_t position = header.dataOffset;
+    for (unsigned int e = 0; e < sortedEntries.size() && isWritten; ++e) {
+        const std::vector<uint8_t> &storedData = sortedEntries[e]->storedData;
+        isWritten = WritePadding(out, entries[e].offset - position) &&
+                    fwrite(storedData.data(), 1, storedData.size(), out) == storedData.size();
+        position = entries[e].offset + storedData.size();
+    }
+    return fclose(out) == 0 && isWritten;
+}
+
+unsigned int MyAssetArchiveWriter::GetEntryCount(ArchiveCompression compression) const {
+    unsigned int entryCount = 0;
+    for (unsigned int e = 0; e < pendingEntries.size(); ++e) {
+        entryCount += pendingEntries[e].compression == compression;
+    }
+    return entryCount;
+}
+
+size_t MyAssetArchiveWriter::GetSize() const {
+    size_t size = 0;
+    for (unsigned int e = 0; e < pendingEntries.size(); ++e) {
+        size += pendingEntries[e].size;
+    }
+    return size;
+}
+
+size_t MyAssetArchiveWriter::GetStoredSize() const {
+    size_t storedSize = 0;
+    for (unsigned int e = 0; e < pendingEntries.size(); ++e) {
+        storedSize += pendingEntries[e].storedData.size();
+    }
+    return storedSize;
+}
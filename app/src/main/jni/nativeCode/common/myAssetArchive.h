@@ -0,0 +1,148 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Every asset packed into one file, which the app maps once instead of opening each asset
+// through the asset manager. An index sorted by name follows the header; entries stored
+// uncompressed start on a 4 KB boundary and are read in place from the mapping, the others
+// are decoded on read. PackAssets builds the archive, MyJNIHelper::OpenArchive reads from it.
+// Layout, little-endian:
+//   ArchiveHeader
+//   ArchiveEntry[entryCount]   sorted by name
+//   names                      entryCount names, not NUL-terminated
+//   entry data
+
+#ifndef MY_ASSET_ARCHIVE_H
+#define MY_ASSET_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define MY_ASSET_ARCHIVE        "assets.pak"
+#define ARCHIVE_MAGIC           0x4b50594d      // "MYPK"
+#define ARCHIVE_VERSION         1
+#define ARCHIVE_ALIGNMENT       4096            // of entries stored uncompressed
+
+enum ArchiveCompression {
+    ARCHIVE_STORE   = 0,
+    ARCHIVE_LZ4     = 1,        // LZ4 block, see myLZ4.h
+    ARCHIVE_ZSTD    = 2         // reserved, entries with it are rejected until we have a decoder
+};
+
+struct ArchiveHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    entryCount;
+    uint32_t    namesSize;
+    uint64_t    dataOffset;     // end of the index and names
+    uint64_t    indexHash;      // FNV-1a of the entries and the names
+};
+
+struct ArchiveEntry {
+    uint64_t    offset;         // from the start of the archive
+    uint64_t    storedSize;
+    uint64_t    size;           // decompressed
+    uint64_t    hash;           // FNV-1a of the decompressed bytes
+    uint32_t    nameOffset;     // into the names
+    uint16_t    nameLength;
+    uint8_t     compression;    // ArchiveCompression
+    uint8_t     reserved;
+};
+
+class MyAssetBuffer;
+
+class MyAssetArchive {
+public:
+    MyAssetArchive();
+    ~MyAssetArchive() { Close(); }
+
+    // maps length bytes of fd from start, e.g. the archive inside the APK; fd may be closed
+    // afterwards. False if the archive is malformed
+    bool            Open(int fd, int64_t start, size_t length);
+    bool            OpenFile(const std::string &path);
+    void            Close();
+    bool            IsOpen() const { return header != NULL; }
+
+    // NULL if the archive does not have the asset
+    const ArchiveEntry * FindEntry(const std::string &assetName) const;
+    unsigned int    GetEntryCount() const { return header ? header->entryCount : 0; }
+    const ArchiveEntry * GetEntry(unsigned int index) const { return &entries[index]; }
+    std::string     GetEntryName(const ArchiveEntry *entry) const {
+        return std::string(names + entry->nameOffset, entry->nameLength);
+    }
+    // a stored entry in place, valid while the archive is open; NULL if it is compressed
+    const uint8_t * GetEntryView(const ArchiveEntry *entry) const;
+    // the view of a stored entry, a decompressed copy in the buffer's memory otherwise
+    bool            ReadEntry(const ArchiveEntry *entry, MyAssetBuffer &buffer) const;
+    bool            ReadEntry(const ArchiveEntry *entry, std::vector<uint8_t> &data) const;
+    // not thread safe for one path, MyJNIHelper extracts under its lock
+    bool            ExtractEntry(const ArchiveEntry *entry, const std::string &path) const;
+    // names of the assets directly in a directory, like MyJNIHelper::ListAssets
+    void            ListDirectory(const std::string &directory,
+                                  std::vector<std::string> &fileNames) const;
+
+private:
+    MyAssetArchive(const MyAssetArchive &);
+    MyAssetArchive & operator=(const MyAssetArchive &);
+
+    bool            Validate(const uint8_t *archiveData, size_t archiveSize);
+
+    void *                  mapping;
+    size_t                  mappingSize;
+    const uint8_t *         data;           // the archive's start inside the mapping
+    const ArchiveHeader *   header;         // NULL when closed
+    const ArchiveEntry *    entries;
+    const char *            names;
+};
+
+// images are compressed already and are decoded from a view, and GLBs are mapped as they are
+// (see AssimpLoader::PrepareGLB); everything else is LZ4
+ArchiveCompression GetDefaultArchiveCompression(const std::string &assetName);
+
+// builds an archive in memory and writes it, for the host tools
+class MyAssetArchiveWriter {
+public:
+    // copies the asset; an LZ4 entry that does not shrink by an eighth is stored instead, and
+    // ARCHIVE_ZSTD is stored too for now. Returns the compression used
+    ArchiveCompression AddEntry(const std::string &assetName, const std::vector<uint8_t> &data,
+                                ArchiveCompression compression);
+    // every file under rootDirectory except skipName, named by its path from rootDirectory.
+    // False if a directory or a file cannot be read
+    bool            AddDirectory(const std::string &rootDirectory, const std::string &skipName,
+                                 ArchiveCompression (*getCompression)(const std::string &) =
+                                         GetDefaultArchiveCompression,
+                                 const std::string &directory = "");
+    bool            Write(const std::string &path) const;
+
+    unsigned int    GetEntryCount() const { return pendingEntries.size(); }
+    unsigned int    GetEntryCount(ArchiveCompression compression) const;
+    size_t          GetSize() const;            // of the assets before packing
+    size_t          GetStoredSize() const;      // of the entry data after
+
+private:
+    struct PendingEntry {
+        std::string             assetName;
+        ArchiveCompression      compression;
+        size_t                  size;
+        uint64_t                hash;
+        std::vector<uint8_t>    storedData;
+    };
+    std::vector<PendingEntry>   pendingEntries;
+};
+
+#endif //MY_ASSET_ARCHIVE_H
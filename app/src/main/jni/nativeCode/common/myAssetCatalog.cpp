@@ -0,0 +1,397 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myAssetCatalog.h"
+#include "myJNIHelper.h"
+#include "misc.h"
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+// MTL keys followed by a texture's name, which is the last token after any options
+static const char * const TEXTURE_KEYWORDS[] = {"map_Kd", "map_Ka", "map_Ks", "map_Ns", "map_d",
+                                                "map_bump", "bump", "norm", "map_disp", "disp",
+                                                NULL};
+static const char * const MATERIAL_LIB_KEYWORDS[] = {"mtllib", NULL};
+
+static uint64_t HashBytes(const std::vector<uint8_t> &bytes) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * "./" is dropped, the asset manager does not resolve it
+ */
+static std::string JoinAssetPath(const std::string &directory, const std::string &name) {
+    std::string relativeName = name;
+    while (relativeName.compare(0, 2, "./") == 0) {
+        relativeName.erase(0, 2);
+    }
+    return directory.empty() ? relativeName : directory + "/" + relativeName;
+}
+
+static bool HasExtension(const std::string &fileName, const char *extension) {
+    size_t length = strlen(extension);
+    return fileName.size() > length &&
+           strcasecmp(fileName.c_str() + fileName.size() - length, extension) == 0;
+}
+
+static bool IsModelFile(const std::string &fileName) {
+    return HasExtension(fileName, ".obj") || HasExtension(fileName, ".glb");
+}
+
+/**
+ * Values of the lines that start with one of the keywords: the rest of the line, or its last
+ * token if asked
+ */
+static void GetKeywordValues(const std::vector<uint8_t> &buffer, const char * const *keywords,
+                             bool lastToken, std::vector<std::string> &values) {
+
+    size_t lineBegin = 0;
+    while (lineBegin < buffer.size()) {
+        size_t lineEnd = lineBegin;
+        while (lineEnd < buffer.size() && buffer[lineEnd] != '\n') {
+            lineEnd++;
+        }
+        std::string line((const char *) &buffer[lineBegin], lineEnd - lineBegin);
+        lineBegin = lineEnd + 1;
+
+        size_t keyBegin = line.find_first_not_of(" \t");
+        if (keyBegin == std::string::npos) {
+            continue;
+        }
+        for (unsigned int k = 0; keywords[k]; ++k) {
+            size_t keyLength = strlen(keywords[k]);
+            if (line.size() <= keyBegin + keyLength ||
+                strncasecmp(line.c_str() + keyBegin, keywords[k], keyLength) != 0 ||
+                (line[keyBegin + keyLength] != ' ' && line[keyBegin + keyLength] != '\t')) {
+                continue;
+            }
+            size_t valueEnd = line.find_last_not_of(" \t\r");
+            size_t valueBegin = lastToken ? line.find_last_of(" \t", valueEnd) + 1 :
+                                line.find_first_not_of(" \t", keyBegin + keyLength);
+            if (valueEnd > keyBegin + keyLength && valueBegin <= valueEnd) {
+                values.push_back(line.substr(valueBegin, valueEnd - valueBegin + 1));
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Like MyAssetIOSystem::FindAsset: the name as a path from the directory, then the file name
+ * alone in the directory
+ */
+static bool ResolveAsset(const std::string &directory, const std::string &name,
+                         CatalogAsset &asset) {
+
+    std::vector<std::string> candidates;
+    if (name[0] != '/') {
+        candidates.push_back(JoinAssetPath(directory, name));
+    }
+    candidates.push_back(JoinAssetPath(directory, GetFileName(name)));
+    for (unsigned int c = 0; c < candidates.size(); ++c) {
+        if (gHelperObject->GetAssetSize(candidates[c], asset.size)) {
+            asset.assetName = candidates[c];
+            asset.hash = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ReadAndHashAsset(CatalogAsset &asset, std::vector<uint8_t> &buffer) {
+
+    buffer.clear();
+    if (!gHelperObject->ReadFileFromAssetsToBuffer(asset.assetName.c_str(), &buffer)) {
+        return false;
+    }
+    asset.size = buffer.size();
+    asset.hash = HashBytes(buffer);
+    return true;
+}
+
+/**
+ * A model is added even if its MTLs or textures are missing, the import gets by without them.
+ * A GLB has everything inside, there is nothing else to look for
+ */
+bool MyAssetCatalog::AddModel(const std::string &directory, const std::string &objName,
+                              const std::string &modelId, bool hashTextures) {
+
+    CatalogModel model;
+    model.modelId = modelId;
+    model.obj.assetName = JoinAssetPath(directory, objName);
+    if (modelIndices.find(model.obj.assetName) != modelIndices.end() ||
+        modelIndices.find(modelId) != modelIndices.end()) {
+        return false;
+    }
+    std::vector<uint8_t> buffer;
+    if (!ReadAndHashAsset(model.obj, buffer)) {
+        MyLOGE("Catalog could not read %s", model.obj.assetName.c_str());
+        return false;
+    }
+    model.totalBytes = model.obj.size;
+
+    std::vector<std::string> mtlNames;
+    if (!HasExtension(objName, ".glb")) {
+        GetKeywordValues(buffer, MATERIAL_LIB_KEYWORDS, false, mtlNames);
+    }
+    std::set<std::string> assetNames;
+    for (unsigned int m = 0; m < mtlNames.size(); ++m) {
+
+        CatalogAsset mtl;
+        if (!ResolveAsset(directory, mtlNames[m], mtl) || !assetNames.insert(mtl.assetName).second ||
+            !ReadAndHashAsset(mtl, buffer)) {
+            continue;
+        }
+        model.mtls.push_back(mtl);
+        model.totalBytes += mtl.size;
+
+        std::vector<std::string> textureNames;
+        GetKeywordValues(buffer, TEXTURE_KEYWORDS, true, textureNames);
+        std::vector<uint8_t> textureBuffer;
+        for (unsigned int t = 0; t < textureNames.size(); ++t) {
+            CatalogAsset texture;
+            if (!ResolveAsset(directory, textureNames[t], texture) ||
+                !assetNames.insert(texture.assetName).second ||
+                (hashTextures && !ReadAndHashAsset(texture, textureBuffer))) {
+                continue;
+            }
+            model.textures.push_back(texture);
+            model.totalBytes += texture.size;
+        }
+    }
+
+    models.push_back(model);
+    IndexModel(models.size() - 1);
+    MyLOGD("Catalog: model %s, %zu bytes", modelId.c_str(), model.totalBytes);
+    return true;
+}
+
+void MyAssetCatalog::IndexModel(unsigned int index) {
+    modelIndices[models[index].modelId] = index;
+    modelIndices[models[index].obj.assetName] = index;
+}
+
+/**
+ * The OBJs and GLBs of an asset directory in name order, so that IDs do not depend on the
+ * order the asset manager lists them in
+ */
+static void ListModelFiles(const std::string &directory, std::vector<std::string> &objNames) {
+
+    std::vector<std::string> fileNames;
+    if (!gHelperObject->ListAssets(directory, fileNames)) {
+        return;
+    }
+    for (unsigned int f = 0; f < fileNames.size(); ++f) {
+        if (IsModelFile(fileNames[f])) {
+            objNames.push_back(fileNames[f]);
+        }
+    }
+    std::sort(objNames.begin(), objNames.end());
+}
+
+/**
+ * A GLB keeps its extension, e.g. next to the OBJ it was converted from
+ */
+static std::string GetModelId(const std::string &directory, const std::string &objName,
+                              size_t objCount) {
+
+    if (objCount == 1 && !directory.empty()) {
+        return directory;
+    }
+    std::string stem = HasExtension(objName, ".obj") ? objName.substr(0, objName.size() - 4) :
+                       objName;
+    return JoinAssetPath(directory, stem);
+}
+
+unsigned int MyAssetCatalog::ScanDirectory(const std::string &directory, bool hashTextures) {
+
+    std::vector<std::string> objNames;
+    ListModelFiles(directory, objNames);
+    unsigned int numberOfAdded = 0;
+    for (unsigned int o = 0; o < objNames.size(); ++o) {
+        if (AddModel(directory, objNames[o], GetModelId(directory, objNames[o], objNames.size()),
+                     hashTextures)) {
+            numberOfAdded++;
+        }
+    }
+    return numberOfAdded;
+}
+
+bool MyAssetCatalog::FindModel(const std::string &modelIdOrObj, CatalogModel &model) const {
+
+    std::map<std::string, unsigned int>::const_iterator found = modelIndices.find(modelIdOrObj);
+    if (found == modelIndices.end()) {
+        return false;
+    }
+    model = models[found->second];
+    return true;
+}
+
+/**
+ * An ID is a directory or a directory and an OBJ's name, an OBJ is in its directory. Only the
+ * directories are listed, so a frame is not held up reading and hashing every OBJ in them
+ */
+bool MyAssetCatalog::LocateModel(const std::string &modelIdOrObj, CatalogModel &model) const {
+
+    std::string::size_type slashIndex = modelIdOrObj.find_last_of('/');
+    std::vector<std::string> directories;
+    if (!IsModelFile(modelIdOrObj)) {
+        directories.push_back(modelIdOrObj);
+    }
+    directories.push_back(slashIndex == std::string::npos ? "" :
+                          modelIdOrObj.substr(0, slashIndex));
+    for (unsigned int d = 0; d < directories.size(); ++d) {
+        std::vector<std::string> objNames;
+        ListModelFiles(directories[d], objNames);
+        for (unsigned int o = 0; o < objNames.size(); ++o) {
+            std::string modelId = GetModelId(directories[d], objNames[o], objNames.size());
+            std::string objAsset = JoinAssetPath(directories[d], objNames[o]);
+            if ((modelId != modelIdOrObj && objAsset != modelIdOrObj) ||
+                !gHelperObject->GetAssetSize(objAsset, model.obj.size)) {
+                continue;
+            }
+            model.modelId = modelId;
+            model.obj.assetName = objAsset;
+            model.obj.hash = 0;
+            model.mtls.clear();
+            model.textures.clear();
+            model.totalBytes = model.obj.size;
+            return true;
+        }
+    }
+    MyLOGE("Model %s is not in the assets", modelIdOrObj.c_str());
+    return false;
+}
+
+/**
+ * One line per model and per asset: "model <ID>" followed by "obj|mtl|tex <size> <hash> <name>"
+ * for its assets. Names are last so that they may have spaces
+ */
+std::string MyAssetCatalog::Serialize() const {
+
+    std::string catalog = "# asset catalog, written by CookAssetCatalog\n";
+    char line[64];
+    for (unsigned int m = 0; m < models.size(); ++m) {
+        catalog += "model " + models[m].modelId + "\n";
+        std::vector<std::pair<const char *, const CatalogAsset *> > assets;
+        assets.push_back(std::make_pair("obj", &models[m].obj));
+        for (unsigned int a = 0; a < models[m].mtls.size(); ++a) {
+            assets.push_back(std::make_pair("mtl", &models[m].mtls[a]));
+        }
+        for (unsigned int a = 0; a < models[m].textures.size(); ++a) {
+            assets.push_back(std::make_pair("tex", &models[m].textures[a]));
+        }
+        for (unsigned int a = 0; a < assets.size(); ++a) {
+            snprintf(line, sizeof(line), "%s %lu %016llx ", assets[a].first,
+                     (unsigned long) assets[a].second->size,
+                     (unsigned long long) assets[a].second->hash);
+            catalog += line + assets[a].second->assetName + "\n";
+        }
+    }
+    return catalog;
+}
+
+bool MyAssetCatalog::Load(const std::string &catalogAsset) {
+
+    std::vector<uint8_t> buffer;
+    if (!gHelperObject->ReadFileFromAssetsToBuffer(catalogAsset.c_str(), &buffer)) {
+        MyLOGI("No asset catalog %s, run CookAssetCatalog", catalogAsset.c_str());
+        return false;
+    }
+    Clear();
+
+    std::string text(buffer.begin(), buffer.end());
+    size_t lineBegin = 0;
+    bool isValid = true;
+    while (isValid && lineBegin < text.size()) {
+        size_t lineEnd = text.find('\n', lineBegin);
+        if (lineEnd == std::string::npos) {
+            lineEnd = text.size();
+        }
+        std::string line = text.substr(lineBegin, lineEnd - lineBegin);
+        lineBegin = lineEnd + 1;
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        if (line.compare(0, 6, "model ") == 0) {
+            if (!models.empty()) {
+                IndexModel(models.size() - 1);
+            }
+            models.push_back(CatalogModel());
+            models.back().modelId = line.substr(6);
+            models.back().totalBytes = 0;
+            continue;
+        }
+
+        char kind[4];
+        unsigned long size;
+        unsigned long long hash;
+        int nameBegin = 0;
+        if (models.empty() ||
+            sscanf(line.c_str(), "%3s %lu %llx %n", kind, &size, &hash, &nameBegin) != 3 ||
+            nameBegin == 0 || (size_t) nameBegin >= line.size()) {
+            isValid = false;
+            break;
+        }
+        CatalogAsset asset;
+        asset.assetName = line.substr(nameBegin);
+        asset.size = size;
+        asset.hash = hash;
+        CatalogModel &model = models.back();
+        if (strcmp(kind, "obj") == 0) {
+            model.obj = asset;
+        } else if (strcmp(kind, "mtl") == 0) {
+            model.mtls.push_back(asset);
+        } else if (strcmp(kind, "tex") == 0) {
+            model.textures.push_back(asset);
+        } else {
+            isValid = false;
+        }
+        model.totalBytes += asset.size;
+    }
+    if (!models.empty()) {
+        IndexModel(models.size() - 1);
+    }
+
+    if (!isValid) {
+        MyLOGE("Asset catalog %s is malformed, run CookAssetCatalog", catalogAsset.c_str());
+        Clear();
+        return false;
+    }
+    isCooked = true;
+    MyLOGI("Asset catalog %s: %zu models", catalogAsset.c_str(), models.size());
+    return true;
+}
+
+void MyAssetCatalog::Clear() {
+    models.clear();
+    modelIndices.clear();
+    isCooked = false;
+}
@@ -0,0 +1,83 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Maps model IDs to the assets a model is made of: its OBJ, the MTLs the OBJ names and the
+// textures those name, with their sizes and content hashes. The catalog is cooked into the
+// assets by CookAssetCatalog and loaded once at startup. Scanning reads and hashes every OBJ
+// of a directory and is left to CookAssetCatalog; a model the cooked catalog does not have is
+// only located by listing its directory.
+// A model's ID is its directory, e.g. "andy", or the directory and the OBJ's name without the
+// extension if the directory has more than one model. A GLB is a model of its own file, with
+// nothing else to catalog; its ID keeps the extension when it has company
+
+#ifndef MY_ASSET_CATALOG_H
+#define MY_ASSET_CATALOG_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define MY_ASSET_CATALOG    "catalog.txt"
+
+struct CatalogAsset {
+    std::string     assetName;
+    size_t          size;
+    uint64_t        hash;           // FNV-1a of the contents, 0 if not hashed
+};
+
+struct CatalogModel {
+    std::string                 modelId;
+    CatalogAsset                obj;        // or the GLB
+    std::vector<CatalogAsset>   mtls;
+    std::vector<CatalogAsset>   textures;   // that the MTLs name and the assets have
+    size_t                      totalBytes;
+};
+
+class MyAssetCatalog {
+public:
+    MyAssetCatalog() : isCooked(false) {}
+
+    // read the cooked catalog from the assets; false if it is missing or malformed
+    bool            Load(const std::string &catalogAsset = MY_ASSET_CATALOG);
+    // add the models of the OBJs and GLBs in an asset directory, not its subdirectories.
+    // Textures are only hashed if asked, that reads all of them. Returns the number of models
+    // added
+    unsigned int    ScanDirectory(const std::string &directory, bool hashTextures);
+    // by ID or by the OBJ's asset name
+    bool            FindModel(const std::string &modelIdOrObj, CatalogModel &model) const;
+    // a model the catalog does not have, by listing its directory: the OBJ without a hash and
+    // no MTLs or textures, the import finds those next to the OBJ
+    bool            LocateModel(const std::string &modelIdOrObj, CatalogModel &model) const;
+    // the cooked form Load reads
+    std::string     Serialize() const;
+    void            Clear();
+
+    const std::vector<CatalogModel> & GetModels() const { return models; }
+    bool            IsCooked() const { return isCooked; }
+
+private:
+    bool            AddModel(const std::string &directory, const std::string &objName,
+                             const std::string &modelId, bool hashTextures);
+    void            IndexModel(unsigned int index);
+
+    std::vector<CatalogModel>           models;
+    std::map<std::string, unsigned int> modelIndices;       // by ID and by OBJ
+    bool                                isCooked;
+};
+
+#endif //MY_ASSET_CATALOG_H
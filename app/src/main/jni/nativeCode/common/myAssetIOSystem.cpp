@@ -0,0 +1,191 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myAssetIOSystem.h"
+#include "myJNIHelper.h"
+#include "misc.h"
+#include <algorithm>
+#include <assimp/IOStream.hpp>
+#include <string.h>
+
+/**
+ * An asset read into memory, which is where Assimp's importers copy their files anyway
+ */
+class MyAssetIOStream : public Assimp::IOStream {
+public:
+    MyAssetIOStream() : position(0) {}
+
+    size_t Read(void *pvBuffer, size_t pSize, size_t pCount) {
+        if (!pSize) {
+            return 0;
+        }
+        size_t count = std::min(pCount, (assetBuffer.GetSize() - position) / pSize);
+        memcpy(pvBuffer, assetBuffer.GetData() + position, count * pSize);
+        position += count * pSize;
+        return count;
+    }
+
+    size_t Write(const void *pvBuffer, size_t pSize, size_t pCount) {
+        return 0;
+    }
+
+    aiReturn Seek(size_t pOffset, aiOrigin pOrigin) {
+        size_t newPosition = pOffset;
+        if (pOrigin == aiOrigin_CUR) {
+            newPosition += position;
+        } else if (pOrigin == aiOrigin_END) {
+            newPosition = assetBuffer.GetSize() - pOffset;
+        }
+        if (newPosition > assetBuffer.GetSize()) {
+            return aiReturn_FAILURE;
+        }
+        position = newPosition;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const { return position; }
+    size_t FileSize() const { return assetBuffer.GetSize(); }
+    void Flush() {}
+
+    MyAssetBuffer   assetBuffer;
+    size_t          position;
+};
+
+/**
+ * A file that was not mapped, read as Assimp's default IO system would
+ */
+class MyFileIOStream : public Assimp::IOStream {
+public:
+    MyFileIOStream(FILE *file) : file(file) {}
+    ~MyFileIOStream() { fclose(file); }
+
+    size_t Read(void *pvBuffer, size_t pSize, size_t pCount) {
+        return fread(pvBuffer, pSize, pCount, file);
+    }
+
+    size_t Write(const void *pvBuffer, size_t pSize, size_t pCount) {
+        return 0;
+    }
+
+    aiReturn Seek(size_t pOffset, aiOrigin pOrigin) {
+        int origin = pOrigin == aiOrigin_CUR ? SEEK_CUR : pOrigin == aiOrigin_END ? SEEK_END :
+                     SEEK_SET;
+        return fseek(file, (long) pOffset, origin) ? aiReturn_FAILURE : aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const { return ftell(file); }
+
+    size_t FileSize() const {
+        long position = ftell(file);
+        fseek(file, 0, SEEK_END);
+        long fileSize = ftell(file);
+        fseek(file, position, SEEK_SET);
+        return fileSize;
+    }
+
+    void Flush() {}
+
+private:
+    FILE *  file;
+};
+
+void MyAssetIOSystem::MapAsset(const std::string &assetName) {
+    if (!assetName.empty()) {
+        assetNames[GetFileName(assetName)] = assetName;
+    }
+}
+
+bool MyAssetIOSystem::GetAssetName(const std::string &fileName, std::string &assetName) const {
+
+    std::map<std::string, std::string>::const_iterator found =
+            assetNames.find(GetFileName(fileName));
+    if (found == assetNames.end()) {
+        return false;
+    }
+    assetName = found->second;
+    return true;
+}
+
+/**
+ * Textures in MTL files are relative to the model, e.g. "textures/a.png", or absolute paths on
+ * the machine the model was made on, of which only the file name is any use
+ */
+bool MyAssetIOSystem::FindAsset(const std::string &fileName, std::string &assetName) const {
+
+    if (GetAssetName(fileName, assetName)) {
+        return true;
+    }
+    std::string prefix = assetDirectory.empty() ? "" : assetDirectory + "/";
+    size_t assetSize;
+    if (fileName[0] != '/' && gHelperObject->GetAssetSize(prefix + fileName, assetSize)) {
+        assetName = prefix + fileName;
+        return true;
+    }
+    if (gHelperObject->GetAssetSize(prefix + GetFileName(fileName), assetSize)) {
+        assetName = prefix + GetFileName(fileName);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * A mapped file is assumed to be in the assets, opening it tells for sure
+ */
+bool MyAssetIOSystem::Exists(const char *pFile) const {
+
+    std::string assetName;
+    if (GetAssetName(pFile, assetName)) {
+        return true;
+    }
+    FILE *file = fopen(pFile, "rb");
+    if (!file) {
+        return FindAsset(pFile, assetName);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * Read-only, the importers never write. The assets win over the file system: a copy in internal
+ * storage may have been extracted by an older version of the app
+ */
+Assimp::IOStream * MyAssetIOSystem::Open(const char *pFile, const char *pMode) {
+
+    if (strchr(pMode, 'w') || strchr(pMode, 'a')) {
+        return NULL;
+    }
+    std::string assetName;
+    if (!FindAsset(pFile, assetName)) {
+        FILE *file = fopen(pFile, "rb");
+        if (!file) {
+            return NULL;
+        }
+        MyFileIOStream *fileStream = new MyFileIOStream(file);
+        bytesRead += fileStream->FileSize();
+        return fileStream;
+    }
+    MyAssetIOStream *assetStream = new MyAssetIOStream;
+    if (!gHelperObject->ReadAsset(assetName, assetStream->assetBuffer)) {
+        delete assetStream;
+        return NULL;
+    }
+    bytesRead += assetStream->FileSize();
+    return assetStream;
+}
+
+void MyAssetIOSystem::Close(Assimp::IOStream *pFile) {
+    delete pFile;
+}
@@ -0,0 +1,62 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Serves the files an import opens. Files registered with MapAsset, e.g. the MTL, are read from
+// the assets into memory, and so is anything else the model's directory in the assets has, e.g.
+// the extracted OBJ; only files the assets do not have are read from the file system. Assimp
+// only asks for a file by the name the OBJ gives it, so mapped files are matched by their name
+// without the directory
+
+#ifndef MY_ASSET_IO_SYSTEM_H
+#define MY_ASSET_IO_SYSTEM_H
+
+#include <assimp/IOSystem.hpp>
+#include <map>
+#include <string>
+
+class MyAssetIOSystem : public Assimp::IOSystem {
+public:
+    // read files named like assetName's file name from the asset
+    void                MapAsset(const std::string &assetName);
+    void                ClearAssets() { assetNames.clear(); }
+    // the asset a file name was mapped to, false if it is not mapped
+    bool                GetAssetName(const std::string &fileName, std::string &assetName) const;
+    // where the model's files are in the assets, e.g. "andy"
+    void                SetAssetDirectory(const std::string &assetDirectory) {
+        this->assetDirectory = assetDirectory;
+    }
+    // the asset a file the model refers to is read from: the mapped one, else the file's path
+    // and then its name in the asset directory. False if the assets do not have it
+    bool                FindAsset(const std::string &fileName, std::string &assetName) const;
+
+    // of the files opened since the last reset
+    size_t              GetBytesRead() const { return bytesRead; }
+    void                ResetBytesRead() { bytesRead = 0; }
+
+    bool                Exists(const char *pFile) const;
+    char                getOsSeparator() const { return '/'; }
+    Assimp::IOStream *  Open(const char *pFile, const char *pMode = "rb");
+    void                Close(Assimp::IOStream *pFile);
+
+    MyAssetIOSystem() : bytesRead(0) {}
+
+private:
+    std::map<std::string, std::string>  assetNames;     // by file name
+    std::string                         assetDirectory;
+    size_t                              bytesRead;
+};
+
+#endif //MY_ASSET_IO_SYSTEM_H
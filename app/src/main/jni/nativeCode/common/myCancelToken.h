@@ -0,0 +1,61 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Lets any thread stop a model load. The load polls the token between its stages and inside
+// the long ones, and gives up at the first check after Cancel. A token is never reset, every
+// load gets its own
+
+#ifndef MY_CANCEL_TOKEN_H
+#define MY_CANCEL_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+class MyCancelToken {
+public:
+    MyCancelToken() : isCancelled(false), cancelTimeNs(0) {}
+
+    void    Cancel() {
+        cancelTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        isCancelled = true;
+    }
+    bool    IsCancelled() const { return isCancelled; }
+
+    // time from Cancel to now, 0 if not cancelled
+    double  GetMsSinceCancel() const {
+        if (!isCancelled) {
+            return 0;
+        }
+        long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        return (nowNs - cancelTimeNs) / 1e6;
+    }
+
+private:
+    std::atomic<bool>       isCancelled;
+    std::atomic<long long>  cancelTimeNs;
+};
+
+typedef std::shared_ptr<MyCancelToken> MyCancelTokenHandle;
+
+// for loads that may be given no token
+inline bool IsCancelled(const MyCancelToken *cancelToken) {
+    return cancelToken && cancelToken->IsCancelled();
+}
+
+#endif //MY_CANCEL_TOKEN_H
@@ -0,0 +1,722 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myGLBFile.h"
+#include "myJSON.h"
+#include "myLogger.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(GLBHeader) == 12, "GLBHeader is read as is");
+static_assert(sizeof(GLBChunkHeader) == 8, "GLBChunkHeader is read as is");
+
+MyGLBFile::MyGLBFile() {
+    mapping = NULL;
+    mappingSize = 0;
+    glbData = NULL;
+    glbSize = 0;
+}
+
+bool MyGLBFile::Open(const std::string &fileName) {
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Close();
+        MyLOGE("Cannot open %s", fileName.c_str());
+        return false;
+    }
+    struct stat fileStat;
+    bool isOpen = fstat(fd, &fileStat) == 0 && Open(fd, 0, fileStat.st_size);
+    close(fd);
+    return isOpen;
+}
+
+/**
+ * The mapping starts at the page that holds start, as mmap wants, the file where start is in it
+ */
+bool MyGLBFile::Open(int fd, int64_t start, size_t length) {
+
+    Close();
+    if (length == 0) {
+        return false;
+    }
+    int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t mappingStart = start - start % pageSize;
+    mappingSize = length + (size_t) (start - mappingStart);
+    mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, (off_t) mappingStart);
+    if (mapping == MAP_FAILED) {
+        MyLOGE("Cannot map the GLB");
+        mapping = NULL;
+        mappingSize = 0;
+        return false;
+    }
+    return Check((const uint8_t *) mapping + (start - mappingStart), length);
+}
+
+bool MyGLBFile::Open(const uint8_t *data, size_t size) {
+
+    Close();
+    return Check(data, size);
+}
+
+bool MyGLBFile::Check(const uint8_t *data, size_t size) {
+
+    glbData = data;
+    glbSize = size;
+    if (!Parse(data, size)) {
+        MyLOGE("Not a GLB the loader can draw");
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MyGLBFile::Close() {
+
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = NULL;
+    mappingSize = 0;
+    glbData = NULL;
+    glbSize = 0;
+    bufferViews.clear();
+    accessors.clear();
+    primitives.clear();
+    firstPrimitives.clear();
+    materials.clear();
+    images.clear();
+    textureImages.clear();
+    nodes.clear();
+}
+
+unsigned int MyGLBFile::GetComponentSize(unsigned int componentType) {
+    switch (componentType) {
+        case GLB_BYTE:
+        case GLB_UNSIGNED_BYTE:
+            return 1;
+        case GLB_SHORT:
+        case GLB_UNSIGNED_SHORT:
+            return 2;
+        case GLB_UNSIGNED_INT:
+        case GLB_FLOAT:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * The chunks follow the header; the BIN chunk is optional and anything after it is ignored
+ */
+bool MyGLBFile::Parse(const uint8_t *fileData, size_t fileSize) {
+
+    const GLBHeader *header = (const GLBHeader *) fileData;
+    if (fileSize < sizeof(GLBHeader) + sizeof(GLBChunkHeader) || header->magic != GLB_MAGIC) {
+        MyLOGE("No GLB header");
+        return false;
+    }
+    if (header->version != GLB_VERSION || header->length > fileSize) {
+        MyLOGE("GLB version %u of %u bytes in a file of %zu", header->version, header->length,
+               fileSize);
+        return false;
+    }
+    size_t length = header->length;
+    size_t offset = sizeof(GLBHeader);
+    const GLBChunkHeader *jsonChunk = (const GLBChunkHeader *) (fileData + offset);
+    offset += sizeof(GLBChunkHeader);
+    if (jsonChunk->type != GLB_CHUNK_JSON || jsonChunk->length > length - offset) {
+        MyLOGE("The GLB's first chunk is not its JSON");
+        return false;
+    }
+    const char *jsonText = (const char *) (fileData + offset);
+    size_t jsonLength = jsonChunk->length;
+    offset += (jsonLength + 3) & ~(size_t) 3;
+
+    const uint8_t *binData = NULL;
+    size_t binSize = 0;
+    if (offset <= length && length - offset >= sizeof(GLBChunkHeader)) {
+        const GLBChunkHeader *binChunk = (const GLBChunkHeader *) (fileData + offset);
+        offset += sizeof(GLBChunkHeader);
+        if (binChunk->type == GLB_CHUNK_BIN) {
+            if (binChunk->length > length - offset) {
+                MyLOGE("The GLB's BIN chunk runs past its end");
+                return false;
+            }
+            binData = fileData + offset;
+            binSize = binChunk->length;
+        }
+    }
+
+    // the padding is spaces, but some writers pad with zeros
+    while (jsonLength > 0 && jsonText[jsonLength - 1] == 0) {
+        --jsonLength;
+    }
+    MyJSONValue document;
+    if (!ParseJSON(jsonText, jsonLength, document) || !document.IsObject()) {
+        MyLOGE("The GLB's JSON chunk is not a JSON object");
+        return false;
+    }
+    const MyJSONValue *asset = document.Find("asset");
+    std::string version;
+    if (!asset || !asset->GetString("version", version) || version.compare(0, 2, "2.") != 0) {
+        MyLOGE("The GLB is not glTF 2.x");
+        return false;
+    }
+    const MyJSONValue *extensionsRequired = document.Find("extensionsRequired");
+    if (extensionsRequired && extensionsRequired->GetSize() > 0) {
+        MyLOGE("The GLB requires extensions, e.g. %s",
+               (*extensionsRequired)[0].GetString().c_str());
+        return false;
+    }
+
+    return ParseBufferViews(document, binData, binSize) && ParseAccessors(document) &&
+           ParseImages(document) && ParseMaterials(document) && ParseMeshes(document) &&
+           ParseNodes(document);
+}
+
+/**
+ * Only buffer 0 can be read, and only if it is the BIN chunk. Views into other buffers are kept
+ * without data, an accessor or image using one is not loaded
+ */
+bool MyGLBFile::ParseBufferViews(const MyJSONValue &document, const uint8_t *binData,
+                                 size_t binSize) {
+
+    const MyJSONValue *buffers = document.Find("buffers");
+    size_t binLength = 0;
+    if (binData && buffers && buffers->IsArray() && buffers->GetSize() > 0 &&
+        !(*buffers)[0].Find("uri")) {
+        unsigned int byteLength;
+        if (!(*buffers)[0].GetIndex("byteLength", byteLength) || byteLength > binSize) {
+            MyLOGE("Buffer 0 does not fit in the BIN chunk");
+            return false;
+        }
+        binLength = byteLength;
+    } else {
+        binData = NULL;
+    }
+
+    const MyJSONValue *views = document.Find("bufferViews");
+    unsigned int viewCount = views && views->IsArray() ? views->GetSize() : 0;
+    bufferViews.resize(viewCount);
+    for (unsigned int v = 0; v < viewCount; ++v) {
+        const MyJSONValue &view = (*views)[v];
+        unsigned int buffer, byteLength, byteOffset = 0, byteStride = 0;
+        if (!view.GetIndex("buffer", buffer) || !view.GetIndex("byteLength", byteLength) ||
+            (view.Find("byteOffset") && !view.GetIndex("byteOffset", byteOffset)) ||
+            (view.Find("byteStride") && (!view.GetIndex("byteStride", byteStride) ||
+                                         byteStride < 4 || byteStride > 252 || byteStride % 4))) {
+            MyLOGE("Buffer view %u is malformed", v);
+            return false;
+        }
+        bufferViews[v].data = NULL;
+        bufferViews[v].length = byteLength;
+        bufferViews[v].stride = byteStride;
+        if (buffer == 0 && binData) {
+            if ((size_t) byteOffset + byteLength > binLength) {
+                MyLOGE("Buffer view %u runs past the BIN chunk", v);
+                return false;
+            }
+            bufferViews[v].data = binData + byteOffset;
+        }
+    }
+    return true;
+}
+
+/**
+ * An accessor that cannot be used, e.g. a sparse one, only fails the file if a primitive uses
+ * it. One that does not fit in its view or is misaligned always does
+ */
+bool MyGLBFile::ParseAccessors(const MyJSONValue &document) {
+
+    const MyJSONValue *accessorArray = document.Find("accessors");
+    unsigned int accessorCount = accessorArray && accessorArray->IsArray() ?
+                                 accessorArray->GetSize() : 0;
+    accessors.resize(accessorCount);
+    for (unsigned int a = 0; a < accessorCount; ++a) {
+        const MyJSONValue &json = (*accessorArray)[a];
+        GLBAccessor &accessor = accessors[a];
+        memset(&accessor, 0, sizeof(accessor));
+
+        std::string type;
+        const MyJSONValue *normalized = json.Find("normalized");
+        if (!json.GetIndex("componentType", accessor.componentType) ||
+            !json.GetIndex("count", accessor.count) || accessor.count == 0 ||
+            !json.GetString("type", type) ||
+            GetComponentSize(accessor.componentType) == 0) {
+            MyLOGE("Accessor %u is malformed", a);
+            return false;
+        }
+        accessor.isNormalized = normalized && normalized->GetType() == JSON_BOOL &&
+                                normalized->GetNumber() != 0;
+        if (type == "SCALAR") {
+            accessor.components = 1;
+        } else if (type.size() == 4 && type.compare(0, 3, "VEC") == 0 &&
+                   type[3] >= '2' && type[3] <= '4') {
+            accessor.components = type[3] - '0';
+        }
+        if (accessor.components == 3 && json.GetNumbers("min", accessor.boundsMin, 3) &&
+            json.GetNumbers("max", accessor.boundsMax, 3)) {
+            accessor.hasBounds = true;
+        }
+
+        // matrices and sparse accessors are left without data
+        unsigned int view;
+        if (!accessor.components || json.Find("sparse") || !json.GetIndex("bufferView", view)) {
+            continue;
+        }
+        unsigned int byteOffset = 0;
+        if (view >= bufferViews.size() ||
+            (json.Find("byteOffset") && !json.GetIndex("byteOffset", byteOffset))) {
+            MyLOGE("Accessor %u is malformed", a);
+            return false;
+        }
+        if (!bufferViews[view].data) {
+            continue;
+        }
+        unsigned int componentSize = GetComponentSize(accessor.componentType);
+        unsigned int elementSize = componentSize * accessor.components;
+        accessor.stride = bufferViews[view].stride ? bufferViews[view].stride : elementSize;
+        accessor.data = bufferViews[view].data + byteOffset;
+        uint64_t extent = (uint64_t) byteOffset +
+                          (uint64_t) accessor.stride * (accessor.count - 1) + elementSize;
+        if (accessor.stride < elementSize || extent > bufferViews[view].length) {
+            MyLOGE("Accessor %u runs past its buffer view", a);
+            return false;
+        }
+        // in memory, the file may start anywhere in the APK or the asset archive
+        if ((uintptr_t) accessor.data % componentSize) {
+            MyLOGE("Accessor %u is not aligned to its components", a);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Only images stored in a buffer view of the file are kept, textures of others are dropped
+ */
+bool MyGLBFile::ParseImages(const MyJSONValue &document) {
+
+    const MyJSONValue *imageArray = document.Find("images");
+    unsigned int imageCount = imageArray && imageArray->IsArray() ? imageArray->GetSize() : 0;
+    images.resize(imageCount);
+    for (unsigned int i = 0; i < imageCount; ++i) {
+        images[i].data = NULL;
+        images[i].size = 0;
+        unsigned int view;
+        if (!(*imageArray)[i].GetIndex("bufferView", view)) {
+            MyLOGI("Image %u is not in the GLB, it is not loaded", i);
+            continue;
+        }
+        if (view >= bufferViews.size()) {
+            MyLOGE("Image %u is malformed", i);
+            return false;
+        }
+        images[i].data = bufferViews[view].data;
+        images[i].size = images[i].data ? bufferViews[view].length : 0;
+    }
+
+    const MyJSONValue *textureArray = document.Find("textures");
+    unsigned int textureCount = textureArray && textureArray->IsArray() ?
+                                textureArray->GetSize() : 0;
+    textureImages.assign(textureCount, -1);
+    for (unsigned int t = 0; t < textureCount; ++t) {
+        unsigned int source;
+        if (!(*textureArray)[t].GetIndex("source", source)) {
+            continue;
+        }
+        if (source >= imageCount) {
+            MyLOGE("Texture %u is malformed", t);
+            return false;
+        }
+        if (images[source].data) {
+            textureImages[t] = source;
+        }
+    }
+    return true;
+}
+
+/**
+ * The image of a textureInfo, -1 if there is none we can draw. We only read TEXCOORD_0
+ */
+static bool GetTextureImage(const MyJSONValue *textureInfo, const std::vector<int> &textureImages,
+                            int &image) {
+    image = -1;
+    if (!textureInfo) {
+        return true;
+    }
+    unsigned int texture, texCoord = 0;
+    if (!textureInfo->GetIndex("index", texture) || texture >= textureImages.size()) {
+        return false;
+    }
+    textureInfo->GetIndex("texCoord", texCoord);
+    if (texCoord == 0) {
+        image = textureImages[texture];
+    }
+    return true;
+}
+
+bool MyGLBFile::ParseMaterials(const MyJSONValue &document) {
+
+    const MyJSONValue *materialArray = document.Find("materials");
+    unsigned int materialCount = materialArray && materialArray->IsArray() ?
+                                 materialArray->GetSize() : 0;
+    materials.resize(materialCount);
+    for (unsigned int m = 0; m < materialCount; ++m) {
+        const MyJSONValue &json = (*materialArray)[m];
+        GLBMaterial &material = materials[m];
+        json.GetString("name", material.name);
+        material.baseColorFactor = glm::vec4(1.0f);
+        material.baseColorImage = -1;
+        const MyJSONValue *pbr = json.Find("pbrMetallicRoughness");
+        if (pbr) {
+            pbr->GetNumbers("baseColorFactor", &material.baseColorFactor[0], 4);
+        }
+        if (!GetTextureImage(pbr ? pbr->Find("baseColorTexture") : NULL, textureImages,
+                             material.baseColorImage) ||
+            !GetTextureImage(json.Find("normalTexture"), textureImages, material.normalImage)) {
+            MyLOGE("Material %u is malformed", m);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Any accessor a drawn primitive uses must have data, the types glTF allows for the attribute and
+ * as many elements as POSITION
+ */
+bool MyGLBFile::CheckAttribute(int accessor, const char *semantic, unsigned int vertexCount,
+                               bool allowsNormalized, unsigned int componentsMask) const {
+
+    if (accessor < 0) {
+        return true;
+    }
+    const GLBAccessor &attribute = accessors[accessor];
+    bool isTypeAllowed = attribute.componentType == GLB_FLOAT ||
+                         (allowsNormalized && attribute.isNormalized &&
+                          (attribute.componentType == GLB_UNSIGNED_BYTE ||
+                           attribute.componentType == GLB_UNSIGNED_SHORT));
+    if (!attribute.data) {
+        MyLOGE("%s accessor %d is sparse or outside the GLB", semantic, accessor);
+        return false;
+    }
+    if (!isTypeAllowed || !(componentsMask & (1 << attribute.components)) ||
+        attribute.count != vertexCount) {
+        MyLOGE("%s accessor %d has the wrong type or count", semantic, accessor);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * GL reads indices packed and of an unsigned type, and every index must name a vertex
+ */
+bool MyGLBFile::CheckIndices(const GLBPrimitive &primitive) const {
+
+    unsigned int vertexCount = accessors[primitive.positions].count;
+    if (primitive.indices < 0) {
+        return vertexCount % 3 == 0;
+    }
+    const GLBAccessor &indices = accessors[primitive.indices];
+    if (!indices.data || indices.components != 1 || indices.isNormalized ||
+        indices.count % 3 != 0 || indices.stride != GetComponentSize(indices.componentType)) {
+        return false;
+    }
+    unsigned int maxIndex = 0;
+    switch (indices.componentType) {
+        case GLB_UNSIGNED_BYTE:
+            for (unsigned int i = 0; i < indices.count; ++i) {
+                maxIndex = std::max(maxIndex, (unsigned int) indices.data[i]);
+            }
+            break;
+        case GLB_UNSIGNED_SHORT: {
+            const uint16_t *data = (const uint16_t *) indices.data;
+            for (unsigned int i = 0; i < indices.count; ++i) {
+                maxIndex = std::max(maxIndex, (unsigned int) data[i]);
+            }
+            break;
+        }
+        case GLB_UNSIGNED_INT: {
+            const uint32_t *data = (const uint32_t *) indices.data;
+            for (unsigned int i = 0; i < indices.count; ++i) {
+                maxIndex = std::max(maxIndex, data[i]);
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+    return maxIndex < vertexCount;
+}
+
+static int GetAttribute(const MyJSONValue &attributes, const char *semantic) {
+    unsigned int accessor;
+    return attributes.GetIndex(semantic, accessor) ? (int) accessor : -1;
+}
+
+bool MyGLBFile::ParseMeshes(const MyJSONValue &document) {
+
+    const MyJSONValue *meshArray = document.Find("meshes");
+    unsigned int meshCount = meshArray && meshArray->IsArray() ? meshArray->GetSize() : 0;
+    int defaultMaterial = -1;
+    for (unsigned int m = 0; m < meshCount; ++m) {
+        firstPrimitives.push_back(primitives.size());
+        const MyJSONValue *primitiveArray = (*meshArray)[m].Find("primitives");
+        if (!primitiveArray || !primitiveArray->IsArray()) {
+            MyLOGE("Mesh %u is malformed", m);
+            return false;
+        }
+        for (unsigned int p = 0; p < primitiveArray->GetSize(); ++p) {
+            const MyJSONValue &json = (*primitiveArray)[p];
+            const MyJSONValue *attributes = json.Find("attributes");
+            unsigned int mode = GLB_MODE_TRIANGLES, material;
+            if (!attributes || !attributes->IsObject() ||
+                (json.Find("mode") && !json.GetIndex("mode", mode))) {
+                MyLOGE("Primitive %u of mesh %u is malformed", p, m);
+                return false;
+            }
+            GLBPrimitive primitive;
+            primitive.positions = GetAttribute(*attributes, "POSITION");
+            if (mode != GLB_MODE_TRIANGLES || primitive.positions < 0) {
+                MyLOGI("Primitive %u of mesh %u has no triangles, it is not drawn", p, m);
+                continue;
+            }
+            primitive.normals = GetAttribute(*attributes, "NORMAL");
+            primitive.textureCoords = GetAttribute(*attributes, "TEXCOORD_0");
+            primitive.tangents = GetAttribute(*attributes, "TANGENT");
+            primitive.colors = GetAttribute(*attributes, "COLOR_0");
+            primitive.indices = GetAttribute(json, "indices");
+            int accessorCount = accessors.size();
+            if (primitive.positions >= accessorCount || primitive.normals >= accessorCount ||
+                primitive.textureCoords >= accessorCount || primitive.tangents >= accessorCount ||
+                primitive.colors >= accessorCount || primitive.indices >= accessorCount) {
+                MyLOGE("Primitive %u of mesh %u uses a missing accessor", p, m);
+                return false;
+            }
+
+            if (json.GetIndex("material", material)) {
+                if (material >= materials.size()) {
+                    MyLOGE("Primitive %u of mesh %u uses a missing material", p, m);
+                    return false;
+                }
+                primitive.material = material;
+            } else {
+                if (defaultMaterial < 0) {
+                    defaultMaterial = materials.size();
+                    materials.push_back(GLBMaterial());
+                    materials.back().baseColorImage = -1;
+                    materials.back().normalImage = -1;
+                    materials.back().baseColorFactor = glm::vec4(1.0f);
+                }
+                primitive.material = defaultMaterial;
+            }
+
+            unsigned int vertexCount = accessors[primitive.positions].count;
+            if (!CheckAttribute(primitive.positions, "POSITION", vertexCount, false, 1 << 3) ||
+                !CheckAttribute(primitive.normals, "NORMAL", vertexCount, false, 1 << 3) ||
+                !CheckAttribute(primitive.tangents, "TANGENT", vertexCount, false, 1 << 4) ||
+                !CheckAttribute(primitive.textureCoords, "TEXCOORD_0", vertexCount, true,
+                                1 << 2) ||
+                !CheckAttribute(primitive.colors, "COLOR_0", vertexCount, true,
+                                1 << 3 | 1 << 4)) {
+                return false;
+            }
+            if (!CheckIndices(primitive)) {
+                MyLOGE("Primitive %u of mesh %u has indices GL cannot draw", p, m);
+                return false;
+            }
+            primitives.push_back(primitive);
+        }
+    }
+    firstPrimitives.push_back(primitives.size());
+    if (primitives.empty()) {
+        MyLOGE("The GLB has no triangles");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * glTF's matrix is column-major like glm's, TRS is translation * rotation * scale
+ */
+static glm::mat4 GetLocalMatrix(const MyJSONValue &node) {
+
+    float values[16];
+    if (node.GetNumbers("matrix", values, 16)) {
+        glm::mat4 matrix;
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                matrix[c][r] = values[c * 4 + r];
+            }
+        }
+        return matrix;
+    }
+    glm::vec3 translation(0.0f), scale(1.0f);
+    float rotation[4] = {0, 0, 0, 1};
+    node.GetNumbers("translation", &translation[0], 3);
+    node.GetNumbers("rotation", rotation, 4);
+    node.GetNumbers("scale", &scale[0], 3);
+    glm::quat quaternion(rotation[3], rotation[0], rotation[1], rotation[2]);
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(quaternion) *
+           glm::scale(glm::mat4(1.0f), scale);
+}
+
+/**
+ * glTF nodes form a forest: a node has at most one parent, and the scene's nodes are roots. With
+ * that checked, walking from the roots visits every node once. Several roots get a common one
+ */
+bool MyGLBFile::ParseNodes(const MyJSONValue &document) {
+
+    const MyJSONValue *nodeArray = document.Find("nodes");
+    unsigned int nodeCount = nodeArray && nodeArray->IsArray() ? nodeArray->GetSize() : 0;
+    std::vector<int> parents(nodeCount, -1);
+    for (unsigned int n = 0; n < nodeCount; ++n) {
+        const MyJSONValue *children = (*nodeArray)[n].Find("children");
+        unsigned int mesh;
+        if ((*nodeArray)[n].GetIndex("mesh", mesh) && mesh + 1 >= firstPrimitives.size()) {
+            MyLOGE("Node %u uses a missing mesh", n);
+            return false;
+        }
+        for (unsigned int c = 0; children && c < children->GetSize(); ++c) {
+            const MyJSONValue &child = (*children)[c];
+            unsigned int childIndex = (unsigned int) child.GetNumber();
+            if (!child.IsNumber() || child.GetNumber() < 0 || childIndex >= nodeCount ||
+                childIndex == n || parents[childIndex] >= 0) {
+                MyLOGE("Node %u has a child that is not in the tree", n);
+                return false;
+            }
+            parents[childIndex] = n;
+        }
+    }
+
+    std::vector<unsigned int> roots;
+    const MyJSONValue *scenes = document.Find("scenes");
+    unsigned int scene = 0;
+    document.GetIndex("scene", scene);
+    if (scenes && scenes->IsArray() && scene < scenes->GetSize()) {
+        const MyJSONValue *sceneNodes = (*scenes)[scene].Find("nodes");
+        for (unsigned int r = 0; sceneNodes && r < sceneNodes->GetSize(); ++r) {
+            unsigned int root = (unsigned int) (*sceneNodes)[r].GetNumber();
+            if (!(*sceneNodes)[r].IsNumber() || root >= nodeCount || parents[root] >= 0) {
+                MyLOGE("Scene %u has a root that is not one", scene);
+                return false;
+            }
+            roots.push_back(root);
+        }
+    } else {
+        for (unsigned int n = 0; n < nodeCount; ++n) {
+            if (parents[n] < 0) {
+                roots.push_back(n);
+            }
+        }
+    }
+
+    // (glTF node, parent in nodes), children pushed in reverse so the first comes out first
+    std::vector<std::pair<unsigned int, int> > stack;
+    std::vector<unsigned char> isVisited(nodeCount, 0);
+    if (roots.size() != 1) {
+        nodes.push_back(MySceneNode());
+        nodes.back().name = "root";
+        nodes.back().parent = -1;
+        nodes.back().localMatrix = glm::mat4(1.0f);
+        // a scene without nodes draws every mesh once
+        for (unsigned int p = 0; roots.empty() && p < primitives.size(); ++p) {
+            nodes.back().meshes.push_back(p);
+        }
+    }
+    for (unsigned int r = roots.size(); r-- > 0;) {
+        stack.push_back(std::make_pair(roots[r], nodes.empty() ? -1 : 0));
+    }
+    while (!stack.empty()) {
+        unsigned int n = stack.back().first;
+        int parent = stack.back().second;
+        stack.pop_back();
+        if (isVisited[n]) {
+            MyLOGE("Node %u is in the scene twice", n);
+            return false;
+        }
+        isVisited[n] = 1;
+
+        const MyJSONValue &json = (*nodeArray)[n];
+        int index = nodes.size();
+        nodes.push_back(MySceneNode());
+        MySceneNode &node = nodes.back();
+        json.GetString("name", node.name);
+        node.parent = parent;
+        node.localMatrix = GetLocalMatrix(json);
+        unsigned int mesh;
+        if (json.GetIndex("mesh", mesh)) {
+            for (unsigned int p = firstPrimitives[mesh]; p < firstPrimitives[mesh + 1]; ++p) {
+                node.meshes.push_back(p);
+            }
+        }
+        const MyJSONValue *children = json.Find("children");
+        for (unsigned int c = children ? children->GetSize() : 0; c-- > 0;) {
+            stack.push_back(std::make_pair((unsigned int) (*children)[c].GetNumber(), index));
+        }
+    }
+    return true;
+}
+
+/**
+ * Normalized integers as glTF defines them, signed ones clamped so that the minimum is -1
+ */
+void MyGLBFile::ReadFloats(const GLBAccessor &accessor, unsigned int components,
+                           float *values) {
+
+    unsigned int readComponents = std::min(components, accessor.components);
+    for (unsigned int e = 0; e < accessor.count; ++e) {
+        const uint8_t *element = accessor.data + (size_t) e * accessor.stride;
+        float *value = values + (size_t) e * components;
+        for (unsigned int c = 0; c < readComponents; ++c) {
+            switch (accessor.componentType) {
+                case GLB_FLOAT:
+                    value[c] = ((const float *) element)[c];
+                    break;
+                case GLB_UNSIGNED_BYTE:
+                    value[c] = element[c];
+                    value[c] *= accessor.isNormalized ? 1.0f / 255 : 1.0f;
+                    break;
+                case GLB_UNSIGNED_SHORT:
+                    value[c] = ((const uint16_t *) element)[c];
+                    value[c] *= accessor.isNormalized ? 1.0f / 65535 : 1.0f;
+                    break;
+                case GLB_BYTE:
+                    value[c] = ((const int8_t *) element)[c];
+                    value[c] = accessor.isNormalized ? std::max(value[c] / 127, -1.0f) : value[c];
+                    break;
+                case GLB_SHORT:
+                    value[c] = ((const int16_t *) element)[c];
+                    value[c] = accessor.isNormalized ? std::max(value[c] / 32767, -1.0f) :
+                               value[c];
+                    break;
+                default:
+                    value[c] = ((const uint32_t *) element)[c];
+                    break;
+            }
+        }
+        for (unsigned int c = readComponents; c < components; ++c) {
+            value[c] = c == 3 ? 1.0f : 0.0f;
+        }
+    }
+}
@@ -0,0 +1,172 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// A glTF 2.0 binary (.glb) model, mapped read-only and checked once when it is opened so that
+// the loader can hand its buffer views to GL as they are. Every accessor a primitive uses must
+// lie inside the file's BIN chunk, have the types glTF allows for its attribute and, for
+// indices, name existing vertices. What the loader does not draw is left out: primitives other
+// than triangle lists, sparse accessors and images outside the file are refused or skipped.
+// Each triangle primitive becomes one mesh of the loader, nodes are listed depth-first for
+// MySceneGraph. Layout, little-endian:
+//   GLBHeader
+//   GLBChunkHeader, JSON       padded with spaces to 4 bytes
+//   GLBChunkHeader, BIN        optional, buffer 0 of the JSON
+
+#ifndef MY_GLB_FILE_H
+#define MY_GLB_FILE_H
+
+#include "myGLM.h"
+#include "mySceneGraph.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define GLB_MAGIC               0x46546c67      // "glTF"
+#define GLB_VERSION             2
+#define GLB_CHUNK_JSON          0x4e4f534a      // "JSON"
+#define GLB_CHUNK_BIN           0x004e4942      // "BIN\0"
+
+// accessor component types, the same values as the GL enums
+#define GLB_BYTE                5120
+#define GLB_UNSIGNED_BYTE       5121
+#define GLB_SHORT               5122
+#define GLB_UNSIGNED_SHORT      5123
+#define GLB_UNSIGNED_INT        5125
+#define GLB_FLOAT               5126
+
+#define GLB_MODE_TRIANGLES      4
+#define GLB_ARRAY_BUFFER        34962           // bufferView targets
+#define GLB_ELEMENT_ARRAY_BUFFER 34963
+
+class MyJSONValue;
+
+struct GLBHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    length;         // of the whole file
+};
+
+struct GLBChunkHeader {
+    uint32_t    length;         // of the data that follows
+    uint32_t    type;
+};
+
+struct GLBAccessor {
+    const uint8_t * data;       // the first element, in the mapping
+    unsigned int    count;
+    unsigned int    componentType;
+    unsigned int    components; // 1 for SCALAR to 4 for VEC4
+    unsigned int    stride;     // bytes from one element to the next
+    bool            isNormalized;
+    bool            hasBounds;  // min and max of a VEC3
+    float           boundsMin[3], boundsMax[3];
+};
+
+struct GLBPrimitive {
+    int             positions;  // accessors, -1 if the primitive has none
+    int             normals;
+    int             textureCoords;
+    int             tangents;
+    int             colors;
+    int             indices;    // -1 for a primitive drawn in vertex order
+    unsigned int    material;   // always valid, a default one is added for primitives without
+};
+
+struct GLBMaterial {
+    std::string     name;
+    int             baseColorImage; // images, -1 if none or not embedded
+    int             normalImage;
+    glm::vec4       baseColorFactor;
+};
+
+struct GLBImage {
+    const uint8_t * data;       // PNG or JPEG in the mapping, NULL if not in the file
+    size_t          size;
+};
+
+class MyGLBFile {
+public:
+    MyGLBFile();
+    ~MyGLBFile() { Close(); }
+
+    // maps and checks the file, false if it is not a GLB whose meshes can be drawn
+    bool            Open(const std::string &fileName);
+    // maps length bytes of fd from start, e.g. a GLB stored uncompressed in the APK; fd may be
+    // closed afterwards
+    bool            Open(int fd, int64_t start, size_t length);
+    // checks a GLB that is in memory already, e.g. a stored entry of the asset archive; the
+    // data has to stay valid until Close
+    bool            Open(const uint8_t *data, size_t size);
+    void            Close();
+    bool            IsOpen() const { return glbData != NULL; }
+    size_t          GetFileSize() const { return glbSize; }
+
+    const std::vector<GLBAccessor> &    GetAccessors() const { return accessors; }
+    // one per triangle primitive, the loader's meshes
+    const std::vector<GLBPrimitive> &   GetPrimitives() const { return primitives; }
+    const std::vector<GLBMaterial> &    GetMaterials() const { return materials; }
+    const std::vector<GLBImage> &       GetImages() const { return images; }
+    // the default scene under one root, meshes are indices into the primitives
+    const std::vector<MySceneNode> &    GetNodes() const { return nodes; }
+
+    // count elements of components each from an accessor as floats, normalized integers are
+    // mapped to [0, 1] or [-1, 1]. Components the accessor lacks are 0, the fourth is 1
+    static void     ReadFloats(const GLBAccessor &accessor, unsigned int components,
+                               float *values);
+    // count elements of components floats without gaps, so the data can be used as it is
+    static bool     IsPackedFloats(const GLBAccessor &accessor, unsigned int components) {
+        return accessor.componentType == GLB_FLOAT && accessor.components == components &&
+               accessor.stride == components * sizeof(float);
+    }
+    static unsigned int GetComponentSize(unsigned int componentType);
+
+private:
+    struct BufferView {
+        const uint8_t * data;   // NULL if the view is not in the BIN chunk
+        size_t          length;
+        unsigned int    stride; // 0 for tightly packed
+    };
+
+    bool            Check(const uint8_t *data, size_t size);
+    bool            Parse(const uint8_t *fileData, size_t fileSize);
+    bool            ParseBufferViews(const MyJSONValue &document, const uint8_t *binData,
+                                     size_t binSize);
+    bool            ParseAccessors(const MyJSONValue &document);
+    bool            ParseImages(const MyJSONValue &document);
+    bool            ParseMaterials(const MyJSONValue &document);
+    bool            ParseMeshes(const MyJSONValue &document);
+    bool            ParseNodes(const MyJSONValue &document);
+    bool            CheckAttribute(int accessor, const char *semantic, unsigned int vertexCount,
+                                   bool allowsNormalized, unsigned int componentsMask) const;
+    bool            CheckIndices(const GLBPrimitive &primitive) const;
+
+    void *                      mapping;            // NULL for data the caller keeps
+    size_t                      mappingSize;
+    const uint8_t *             glbData;
+    size_t                      glbSize;
+    std::vector<BufferView>     bufferViews;
+    std::vector<GLBAccessor>    accessors;
+    std::vector<GLBPrimitive>   primitives;
+    std::vector<unsigned int>   firstPrimitives;    // per glTF mesh, and one past the last
+    std::vector<GLBMaterial>    materials;
+    std::vector<GLBImage>       images;
+    std::vector<int>            textureImages;      // per glTF texture, -1 if unusable
+    std::vector<MySceneNode>    nodes;
+};
+
+#endif //MY_GLB_FILE_H
@@ -23,26 +23,16 @@ MyGLCamera::MyGLCamera(
         float FOV,
         float zPosition,
         float nearPlaneDistance,
-        float farPlaneDistance) {
-
-    // camera position is fixed
-    glm::vec3 cameraPosition = glm::vec3(0, 0, zPosition);
-    viewMat = glm::lookAt(cameraPosition,        // Camera location in World Space
-                          glm::vec3(0, 0, -1),   // direction in which camera it is pointed
-                          glm::vec3(0, 1, 0));   // camera is pointing up
-
-    this->nearPlaneDistance = nearPlaneDistance;
-    this->farPlaneDistance = farPlaneDistance;
-    this->FOV       = FOV;
-
-    // 6DOF describing model's position
-    deltaX = deltaY = deltaZ = 0;                  // translations
-    modelQuaternion = glm::quat(glm::vec3(0,0,0)); // rotation
-
-    modelMat        = glm::mat4(1.0f);
-    translateMat    = glm::mat4(1.0f);
-    rotateMat       = glm::mat4(1.0f);
-    mvpMat = glm::mat4(1.0f); // projection is not known -> initialize MVP to identity
+        float farPlaneDistance) : publishedSnapshot(0) {
+
+    aspectRatio = 0;
+    for (int i = 0; i < 2; ++i) {
+        snapshots[i].modelMat = glm::mat4(1.0f);
+        snapshots[i].projectionViewMat = glm::mat4(1.0f);
+        snapshots[i].mvpMat = glm::mat4(1.0f);
+        snapshots[i].version = 0;
+    }
+    Reset(FOV, zPosition, nearPlaneDistance, farPlaneDistance);
 }
 
 void MyGLCamera::Reset(float FOV,
@@ -63,10 +53,7 @@ void MyGLCamera::Reset(float FOV,
     deltaX = deltaY = deltaZ = 0;                  // translations
     modelQuaternion = glm::quat(glm::vec3(0,0,0)); // rotation
 
-    modelMat        = glm::mat4(1.0f);
-    translateMat    = glm::mat4(1.0f);
-    rotateMat       = glm::mat4(1.0f);
-    mvpMat = glm::mat4(1.0f); // projection is not known -> initialize MVP to identity
+    ComputeProjectionViewMatrix();
 }
 
 /**
@@ -74,20 +61,30 @@ void MyGLCamera::Reset(float FOV,
  */
 void MyGLCamera::SetAspectRatio(float aspect) {
 
-    glm::mat4 projectionMat;
-    projectionMat = glm::perspective(FOV * float(M_PI / 180), // camera's field-of-view
-                                     aspect,                  // camera's aspect ratio
-                                     nearPlaneDistance,       // distance to the near plane
-                                     farPlaneDistance);       // distance to the far plane
-    projectionViewMat = projectionMat * viewMat;
-    ComputeMVPMatrix();
+    aspectRatio = aspect;
+    ComputeProjectionViewMatrix();
+}
 
+/**
+ * Projection is not known until the first SetAspectRatio, MVP stays identity until then
+ */
+void MyGLCamera::ComputeProjectionViewMatrix() {
+
+    if (aspectRatio > 0) {
+        glm::mat4 projectionMat;
+        projectionMat = glm::perspective(FOV * float(M_PI / 180), // camera's field-of-view
+                                         aspectRatio,             // camera's aspect ratio
+                                         nearPlaneDistance,       // distance to the near plane
+                                         farPlaneDistance);       // distance to the far plane
+        projectionViewMat = projectionMat * viewMat;
+    }
+    isDirty = true;
 }
 
 /**
  * Model's position has 6 degrees-of-freedom: 3 for x-y-z locations and
  * 3 for alpha-beta-gamma Euler angles
- * Convert euler angles to quaternion and update MVP
+ * Convert euler angles to quaternion
  */
 void MyGLCamera::SetModelPosition(std::vector<float> modelPosition) {
 
@@ -99,25 +96,33 @@ void MyGLCamera::SetModelPosition(std::vector<float> modelPosition) {
     float rollAngle  = modelPosition[5];
 
     modelQuaternion = glm::quat(glm::vec3(pitchAngle, yawAngle, rollAngle));
-    rotateMat = glm::toMat4(modelQuaternion);
-    ComputeMVPMatrix();
+    isDirty = true;
 }
 
-
 /**
- * Compute the translation matrix from x-y-z position and rotation matrix from
- * quaternion describing the rotation
+ * Compute the model matrix from quaternion and x-y-z position, once per frame
  * MVP = Projection * View * (Translation * Rotation)
+ * The new matrices go to the snapshot that is not published, then become the published one
  */
-void MyGLCamera::ComputeMVPMatrix() {
+bool MyGLCamera::UpdateSnapshot() {
+
+    if (!isDirty || aspectRatio <= 0) {
+        return false;
+    }
 
-    translateMat = glm::mat4(1, 0, 0, 0,                  // col0
-                             0, 1, 0, 0,	              // col1
-                             0, 0, 1, 0,	              // col2
-                             deltaX, deltaY, deltaZ, 1);  // col3
+    unsigned int published = publishedSnapshot.load(std::memory_order_relaxed);
+    CameraSnapshot &snapshot = snapshots[1 - published];
 
-    modelMat    = translateMat * rotateMat;
-    mvpMat = projectionViewMat * modelMat;
+    // Translation * Rotation only replaces the last column of the rotation matrix
+    snapshot.modelMat = glm::toMat4(modelQuaternion);
+    snapshot.modelMat[3] = glm::vec4(deltaX, deltaY, deltaZ, 1);
+    snapshot.projectionViewMat = projectionViewMat;
+    snapshot.mvpMat = projectionViewMat * snapshot.modelMat;
+    snapshot.version = snapshots[published].version + 1;
+
+    publishedSnapshot.store(1 - published, std::memory_order_release);
+    isDirty = false;
+    return true;
 }
 
 /**
@@ -126,7 +131,7 @@ void MyGLCamera::ComputeMVPMatrix() {
 void MyGLCamera::ScaleModel(float scaleFactor) {
 
     deltaZ += SCALE_TO_Z_TRANSLATION * (scaleFactor - 1);
-    ComputeMVPMatrix();
+    isDirty = true;
 }
 
 /**
@@ -161,18 +166,21 @@ void MyGLCamera::RotateModel(float distanceX, float distanceY,
     beginVec = glm::normalize(beginVec);
 
     // compute cross product of vectors to find axis of rotation
+    // a drag that ends where it started has no axis, and normalizing it would give NaNs
     glm::vec3 rotationAxis = glm::cross(beginVec, endVec);
+    if (glm::length(rotationAxis) == 0) {
+        return;
+    }
     rotationAxis = glm::normalize(rotationAxis);
 
     // compute angle between vectors using the dot product
     float dotProduct = fmax(fmin(glm::dot(beginVec, endVec), 1.), -1.);
     float rotationAngle = TRANSLATION_TO_ANGLE*acos(dotProduct);
 
-    // compute quat using above
-    modelQuaternion = glm::angleAxis(rotationAngle, rotationAxis);
-    rotateMat = glm::toMat4(modelQuaternion)*rotateMat;
-
-    ComputeMVPMatrix();
+    // compose with the model's rotation, renormalizing so that rounding cannot build up
+    modelQuaternion = glm::normalize(glm::angleAxis(rotationAngle, rotationAxis) *
+                                     modelQuaternion);
+    isDirty = true;
 }
 
 /**
@@ -182,5 +190,5 @@ void MyGLCamera::TranslateModel(float distanceX, float distanceY) {
 
     deltaX += XY_TRANSLATION_FACTOR * distanceX;
     deltaY += XY_TRANSLATION_FACTOR * distanceY;
-    ComputeMVPMatrix();
+    isDirty = true;
 }
\ No newline at end of file
@@ -18,6 +18,7 @@
 #ifndef GLCAMERA_H
 #define GLCAMERA_H
 
+#include <atomic>
 #include <vector>
 #include "misc.h"
 
@@ -26,6 +27,19 @@
 #define TRANSLATION_TO_ANGLE    5
 #define XY_TRANSLATION_FACTOR   10
 
+// matrices of one frame, published by UpdateSnapshot
+struct CameraSnapshot {
+    glm::mat4       modelMat;
+    glm::mat4       projectionViewMat;
+    glm::mat4       mvpMat;     // ModelViewProjection: obtained by multiplying Projection, View, & Model
+    unsigned int    version;    // incremented by every UpdateSnapshot that changed the matrices
+};
+
+// Gestures only accumulate the model's rotation (a quaternion) and translation and mark the
+// camera dirty; the matrices are built once per frame by UpdateSnapshot, which the GL thread
+// calls at the start of Render. Snapshots are double-buffered: GetSnapshot never waits, and the
+// snapshot it returns stays valid until the second UpdateSnapshot after it, so jobs started in
+// one frame can keep reading it until the next frame has begun
 class MyGLCamera {
 public:
     MyGLCamera(
@@ -36,7 +50,6 @@ public:
     );
     void        SetModelPosition(std::vector<float> modelPosition);
     void        SetAspectRatio(float aspect);
-    glm::mat4   GetMVP(){ return mvpMat; }
     void        RotateModel(float distanceX, float distanceY, float endPositionX, float endPositionY);
     void        ScaleModel(float scaleFactor);
     void        TranslateModel(float distanceX, float distanceY);
@@ -46,21 +59,28 @@ public:
                       float farPlaneDistance // as small as possible
                 );
 
+    bool        UpdateSnapshot();   // rebuild the matrices if dirty, returns true if it did
+    const CameraSnapshot & GetSnapshot() const {
+        return snapshots[publishedSnapshot.load(std::memory_order_acquire)];
+    }
+    glm::mat4   GetMVP() const { return GetSnapshot().mvpMat; }
+
 private:
-    void        ComputeMVPMatrix();
+    void        ComputeProjectionViewMatrix();
 
-    float       FOV;
+    float       FOV, aspectRatio;
     float       nearPlaneDistance, farPlaneDistance;
 
     glm::mat4   projectionViewMat;
-    glm::mat4   rotateMat, translateMat;
-    glm::mat4   modelMat;
     glm::mat4   viewMat;
-    glm::mat4   mvpMat;     // ModelViewProjection: obtained by multiplying Projection, View, & Model
 
     // six degrees-of-freedom of the model contained in a quaternion and x-y-z coordinates
     glm::quat   modelQuaternion;
     float       deltaX, deltaY, deltaZ;
+    bool        isDirty;            // 6DOF or projection changed since the last snapshot
+
+    CameraSnapshot  snapshots[2];
+    std::atomic<unsigned int> publishedSnapshot;
 };
 
 #endif //GLCAMERA_H
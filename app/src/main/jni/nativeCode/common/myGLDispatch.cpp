@@ -0,0 +1,80 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// this file needs the real gl* symbols, not the macros from myGLDispatch.h
+#define MY_GL_DISPATCH_IMPLEMENTATION
+#include "myGLFunctions.h"
+
+#ifdef MY_GL_DISPATCH
+
+/**
+ * Table with the driver's entry points
+ */
+const MyGLDispatch & GetDriverGLDispatch() {
+
+    static const MyGLDispatch driverDispatch = {
+            glActiveTexture,
+            glAttachShader,
+            glBindBuffer,
+            glBindTexture,
+            glBufferData,
+            glClear,
+            glClearColor,
+            glCompileShader,
+            glCreateProgram,
+            glCreateShader,
+            glDeleteBuffers,
+            glDeleteProgram,
+            glDeleteShader,
+            glDeleteTextures,
+            glDepthFunc,
+            glDisableVertexAttribArray,
+            glDrawElements,
+            glEnable,
+            glEnableVertexAttribArray,
+            glFinish,
+            glGenBuffers,
+            glGenTextures,
+            glGetAttribLocation,
+            glGetError,
+            glGetIntegerv,
+            glGetProgramBinary,
+            glGetProgramInfoLog,
+            glGetProgramiv,
+            glGetShaderInfoLog,
+            glGetShaderiv,
+            glGetString,
+            glGetUniformLocation,
+            glLinkProgram,
+            glProgramBinary,
+            glShaderSource,
+            glTexImage2D,
+            glTexParameteri,
+            glUniform1i,
+            glUniform3f,
+            glUniform4f,
+            glUniformMatrix3fv,
+            glUniformMatrix4fv,
+            glUseProgram,
+            glVertexAttribPointer,
+            glViewport
+    };
+    return driverDispatch;
+}
+
+MyGLDispatch gMyGLDispatch = GetDriverGLDispatch();
+
+#endif //MY_GL_DISPATCH
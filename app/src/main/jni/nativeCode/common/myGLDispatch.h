@@ -0,0 +1,143 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Optional indirection of the GLES 2 calls made by the native code through a function table.
+// Enabled by defining MY_GL_DISPATCH (the host build does), so that a recording or mock
+// backend (see myGLRecorder.h) can be swapped in. Without the define, gl* calls go straight
+// to the driver and this header adds nothing.
+// Must be included after the GL headers -- myGLFunctions.h takes care of that.
+
+#ifndef MY_GL_DISPATCH_H
+#define MY_GL_DISPATCH_H
+
+#ifdef MY_GL_DISPATCH
+
+struct MyGLDispatch {
+    void            (*ActiveTexture)(GLenum texture);
+    void            (*AttachShader)(GLuint program, GLuint shader);
+    void            (*BindBuffer)(GLenum target, GLuint buffer);
+    void            (*BindTexture)(GLenum target, GLuint texture);
+    void            (*BufferData)(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+    void            (*Clear)(GLbitfield mask);
+    void            (*ClearColor)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+    void            (*CompileShader)(GLuint shader);
+    GLuint          (*CreateProgram)(void);
+    GLuint          (*CreateShader)(GLenum type);
+    void            (*DeleteBuffers)(GLsizei n, const GLuint *buffers);
+    void            (*DeleteProgram)(GLuint program);
+    void            (*DeleteShader)(GLuint shader);
+    void            (*DeleteTextures)(GLsizei n, const GLuint *textures);
+    void            (*DepthFunc)(GLenum func);
+    void            (*DisableVertexAttribArray)(GLuint index);
+    void            (*DrawElements)(GLenum mode, GLsizei count, GLenum type, const void *indices);
+    void            (*Enable)(GLenum cap);
+    void            (*EnableVertexAttribArray)(GLuint index);
+    void            (*Finish)(void);
+    void            (*GenBuffers)(GLsizei n, GLuint *buffers);
+    void            (*GenTextures)(GLsizei n, GLuint *textures);
+    GLint           (*GetAttribLocation)(GLuint program, const GLchar *name);
+    GLenum          (*GetError)(void);
+    void            (*GetIntegerv)(GLenum pname, GLint *data);
+    void            (*GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length,
+                                        GLenum *binaryFormat, void *binary);
+    void            (*GetProgramInfoLog)(GLuint program, GLsizei bufSize, GLsizei *length,
+                                         GLchar *infoLog);
+    void            (*GetProgramiv)(GLuint program, GLenum pname, GLint *params);
+    void            (*GetShaderInfoLog)(GLuint shader, GLsizei bufSize, GLsizei *length,
+                                        GLchar *infoLog);
+    void            (*GetShaderiv)(GLuint shader, GLenum pname, GLint *params);
+    const GLubyte * (*GetString)(GLenum name);
+    GLint           (*GetUniformLocation)(GLuint program, const GLchar *name);
+    void            (*LinkProgram)(GLuint program);
+    void            (*ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary,
+                                     GLsizei length);
+    void            (*ShaderSource)(GLuint shader, GLsizei count, const GLchar *const *string,
+                                    const GLint *length);
+    void            (*TexImage2D)(GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                  GLsizei height, GLint border, GLenum format, GLenum type,
+                                  const void *pixels);
+    void            (*TexParameteri)(GLenum target, GLenum pname, GLint param);
+    void            (*Uniform1i)(GLint location, GLint v0);
+    void            (*Uniform3f)(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+    void            (*Uniform4f)(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+    void            (*UniformMatrix3fv)(GLint location, GLsizei count, GLboolean transpose,
+                                        const GLfloat *value);
+    void            (*UniformMatrix4fv)(GLint location, GLsizei count, GLboolean transpose,
+                                        const GLfloat *value);
+    void            (*UseProgram)(GLuint program);
+    void            (*VertexAttribPointer)(GLuint index, GLint size, GLenum type,
+                                           GLboolean normalized, GLsizei stride,
+                                           const void *pointer);
+    void            (*Viewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+};
+
+// table used by every gl* call below, initialized with the driver's entry points
+extern MyGLDispatch gMyGLDispatch;
+
+// table pointing at the driver, used to restore gMyGLDispatch or to forward calls
+const MyGLDispatch & GetDriverGLDispatch();
+
+#ifndef MY_GL_DISPATCH_IMPLEMENTATION
+#define glActiveTexture             gMyGLDispatch.ActiveTexture
+#define glAttachShader              gMyGLDispatch.AttachShader
+#define glBindBuffer                gMyGLDispatch.BindBuffer
+#define glBindTexture               gMyGLDispatch.BindTexture
+#define glBufferData                gMyGLDispatch.BufferData
+#define glClear                     gMyGLDispatch.Clear
+#define glClearColor                gMyGLDispatch.ClearColor
+#define glCompileShader             gMyGLDispatch.CompileShader
+#define glCreateProgram             gMyGLDispatch.CreateProgram
+#define glCreateShader              gMyGLDispatch.CreateShader
+#define glDeleteBuffers             gMyGLDispatch.DeleteBuffers
+#define glDeleteProgram             gMyGLDispatch.DeleteProgram
+#define glDeleteShader              gMyGLDispatch.DeleteShader
+#define glDeleteTextures            gMyGLDispatch.DeleteTextures
+#define glDepthFunc                 gMyGLDispatch.DepthFunc
+#define glDisableVertexAttribArray  gMyGLDispatch.DisableVertexAttribArray
+#define glDrawElements              gMyGLDispatch.DrawElements
+#define glEnable                    gMyGLDispatch.Enable
+#define glEnableVertexAttribArray   gMyGLDispatch.EnableVertexAttribArray
+#define glFinish                    gMyGLDispatch.Finish
+#define glGenBuffers                gMyGLDispatch.GenBuffers
+#define glGenTextures               gMyGLDispatch.GenTextures
+#define glGetAttribLocation         gMyGLDispatch.GetAttribLocation
+#define glGetError                  gMyGLDispatch.GetError
+#define glGetIntegerv               gMyGLDispatch.GetIntegerv
+#define glGetProgramBinary          gMyGLDispatch.GetProgramBinary
+#define glGetProgramInfoLog         gMyGLDispatch.GetProgramInfoLog
+#define glGetProgramiv              gMyGLDispatch.GetProgramiv
+#define glGetShaderInfoLog          gMyGLDispatch.GetShaderInfoLog
+#define glGetShaderiv               gMyGLDispatch.GetShaderiv
+#define glGetString                 gMyGLDispatch.GetString
+#define glGetUniformLocation        gMyGLDispatch.GetUniformLocation
+#define glLinkProgram               gMyGLDispatch.LinkProgram
+#define glProgramBinary             gMyGLDispatch.ProgramBinary
+#define glShaderSource              gMyGLDispatch.ShaderSource
+#define glTexImage2D                gMyGLDispatch.TexImage2D
+#define glTexParameteri             gMyGLDispatch.TexParameteri
+#define glUniform1i                 gMyGLDispatch.Uniform1i
+#define glUniform3f                 gMyGLDispatch.Uniform3f
+#define glUniform4f                 gMyGLDispatch.Uniform4f
+#define glUniformMatrix3fv          gMyGLDispatch.UniformMatrix3fv
+#define glUniformMatrix4fv          gMyGLDispatch.UniformMatrix4fv
+#define glUseProgram                gMyGLDispatch.UseProgram
+#define glVertexAttribPointer       gMyGLDispatch.VertexAttribPointer
+#define glViewport                  gMyGLDispatch.Viewport
+#endif
+
+#endif //MY_GL_DISPATCH
+
+#endif //MY_GL_DISPATCH_H
@@ -16,6 +16,7 @@
 
 #include "myGLFunctions.h"
 #include <sstream>
+#include <string.h>
 #include "myLogger.h"
 
 /**
@@ -46,14 +47,15 @@ void MyGLInits() {
 
 /**
  * Checks for OpenGL errors.
+ * Called every frame, so it takes a plain C string to avoid building a std::string each time
  */
-void CheckGLError(std::string funcName){
+void CheckGLError(const char *funcName){
 
     GLenum err = glGetError();
     if (err == GL_NO_ERROR) {
         return;
     } else {
-        MyLOGF("[FAIL GL] %s", funcName.c_str());
+        MyLOGF("[FAIL GL] %s", funcName);
     }
 
     switch(err) {
@@ -20,10 +20,11 @@
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #include "gl3stub.h"
+#include "myGLDispatch.h"
 #include <stdio.h>
 #include <string>
 
 void MyGLInits();
-void CheckGLError(std::string functionName);
+void CheckGLError(const char *functionName);
 
 #endif //MY_GL_FUNCTIONS_H
@@ -0,0 +1,632 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myGLRecorder.h"
+
+#ifdef MY_GL_DISPATCH
+
+#include "myLogger.h"
+#include <algorithm>
+#include <stdarg.h>
+#include <string.h>
+
+// the recording entry points are plain functions, they reach the recorder through this
+static MyGLRecorder *gActiveRecorder = NULL;
+
+#define DRIVER  GetDriverGLDispatch()
+
+/**
+ * Readable names for the enums that show up in the command stream
+ */
+static const char *GLEnumName(GLenum value) {
+
+    switch (value) {
+        case GL_ARRAY_BUFFER:           return "ARRAY_BUFFER";
+        case GL_ELEMENT_ARRAY_BUFFER:   return "ELEMENT_ARRAY_BUFFER";
+        case GL_TEXTURE_2D:             return "TEXTURE_2D";
+        case GL_TRIANGLES:              return "TRIANGLES";
+        case GL_TRIANGLE_STRIP:         return "TRIANGLE_STRIP";
+        case GL_TRIANGLE_FAN:           return "TRIANGLE_FAN";
+        case GL_LINES:                  return "LINES";
+        case GL_POINTS:                 return "POINTS";
+        case GL_UNSIGNED_BYTE:          return "UNSIGNED_BYTE";
+        case GL_UNSIGNED_SHORT:         return "UNSIGNED_SHORT";
+        case GL_UNSIGNED_INT:           return "UNSIGNED_INT";
+        case GL_FLOAT:                  return "FLOAT";
+        case GL_RGB:                    return "RGB";
+        case GL_RGBA:                   return "RGBA";
+        case GL_LUMINANCE:              return "LUMINANCE";
+        case GL_STATIC_DRAW:            return "STATIC_DRAW";
+        case GL_DYNAMIC_DRAW:           return "DYNAMIC_DRAW";
+        case GL_VERTEX_SHADER:          return "VERTEX_SHADER";
+        case GL_FRAGMENT_SHADER:        return "FRAGMENT_SHADER";
+        case GL_DEPTH_TEST:             return "DEPTH_TEST";
+        case GL_LEQUAL:                 return "LEQUAL";
+        case GL_LESS:                   return "LESS";
+        case GL_TEXTURE_MIN_FILTER:     return "TEXTURE_MIN_FILTER";
+        case GL_TEXTURE_MAG_FILTER:     return "TEXTURE_MAG_FILTER";
+        case GL_LINEAR:                 return "LINEAR";
+        case GL_NEAREST:                return "NEAREST";
+        default:                        break;
+    }
+    static char hexName[16];
+    snprintf(hexName, sizeof(hexName), "0x%04X", value);
+    return hexName;
+}
+
+/**
+ * Bytes per pixel of the client-side data handed to glTexImage2D
+ */
+static size_t BytesPerPixel(GLenum format, GLenum type) {
+
+    if (type == GL_UNSIGNED_SHORT_5_6_5 || type == GL_UNSIGNED_SHORT_4_4_4_4 ||
+        type == GL_UNSIGNED_SHORT_5_5_5_1) {
+        return 2;
+    }
+    size_t componentSize = (type == GL_FLOAT) ? 4 : 1;
+    switch (format) {
+        case GL_RGBA:               return 4 * componentSize;
+        case GL_RGB:                return 3 * componentSize;
+        case GL_LUMINANCE_ALPHA:    return 2 * componentSize;
+        default:                    return componentSize;
+    }
+}
+
+// ---- recording entry points, one per MyGLDispatch member ----
+
+static void RecActiveTexture(GLenum texture) {
+    gActiveRecorder->CountStateChange(texture == gActiveRecorder->activeTextureUnit);
+    gActiveRecorder->activeTextureUnit = texture;
+    gActiveRecorder->RecordCommand("ActiveTexture TEXTURE%u", texture - GL_TEXTURE0);
+    if (gActiveRecorder->forwardToDriver) DRIVER.ActiveTexture(texture);
+}
+
+static void RecAttachShader(GLuint program, GLuint shader) {
+    gActiveRecorder->RecordCommand("AttachShader %u %u", program, shader);
+    if (gActiveRecorder->forwardToDriver) DRIVER.AttachShader(program, shader);
+}
+
+static void RecBindBuffer(GLenum target, GLuint buffer) {
+    GLuint &boundBuffer = gActiveRecorder->boundBuffers[target];
+    gActiveRecorder->CountStateChange(boundBuffer == buffer);
+    boundBuffer = buffer;
+    gActiveRecorder->RecordCommand("BindBuffer %s %u", GLEnumName(target), buffer);
+    if (gActiveRecorder->forwardToDriver) DRIVER.BindBuffer(target, buffer);
+}
+
+static void RecBindTexture(GLenum target, GLuint texture) {
+    GLuint &boundTexture = gActiveRecorder->boundTextures[gActiveRecorder->activeTextureUnit];
+    gActiveRecorder->CountStateChange(boundTexture == texture);
+    boundTexture = texture;
+    gActiveRecorder->RecordCommand("BindTexture %s %u", GLEnumName(target), texture);
+    if (gActiveRecorder->forwardToDriver) DRIVER.BindTexture(target, texture);
+}
+
+static void RecBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    gActiveRecorder->CountBufferUpload(target, size);
+    gActiveRecorder->RecordCommand("BufferData %s buffer=%u bytes=%ld %s", GLEnumName(target),
+                                   gActiveRecorder->boundBuffers[target], (long) size,
+                                   GLEnumName(usage));
+    if (gActiveRecorder->forwardToDriver) DRIVER.BufferData(target, size, data, usage);
+}
+
+static void RecClear(GLbitfield mask) {
+    gActiveRecorder->RecordCommand("Clear 0x%X", mask);
+    if (gActiveRecorder->forwardToDriver) DRIVER.Clear(mask);
+}
+
+static void RecClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("ClearColor %g %g %g %g", red, green, blue, alpha);
+    if (gActiveRecorder->forwardToDriver) DRIVER.ClearColor(red, green, blue, alpha);
+}
+
+static void RecCompileShader(GLuint shader) {
+    gActiveRecorder->RecordCommand("CompileShader %u", shader);
+    if (gActiveRecorder->forwardToDriver) DRIVER.CompileShader(shader);
+}
+
+static GLuint RecCreateProgram(void) {
+    GLuint program = gActiveRecorder->forwardToDriver ? DRIVER.CreateProgram()
+                                                      : gActiveRecorder->nextName++;
+    gActiveRecorder->RecordCommand("CreateProgram -> %u", program);
+    return program;
+}
+
+static GLuint RecCreateShader(GLenum type) {
+    GLuint shader = gActiveRecorder->forwardToDriver ? DRIVER.CreateShader(type)
+                                                     : gActiveRecorder->nextName++;
+    gActiveRecorder->RecordCommand("CreateShader %s -> %u", GLEnumName(type), shader);
+    return shader;
+}
+
+static void RecDeleteBuffers(GLsizei n, const GLuint *buffers) {
+    for (GLsizei i = 0; i < n; ++i) {
+        gActiveRecorder->RecordCommand("DeleteBuffer %u", buffers[i]);
+    }
+    if (gActiveRecorder->forwardToDriver) DRIVER.DeleteBuffers(n, buffers);
+}
+
+static void RecDeleteProgram(GLuint program) {
+    gActiveRecorder->RecordCommand("DeleteProgram %u", program);
+    if (gActiveRecorder->forwardToDriver) DRIVER.DeleteProgram(program);
+}
+
+static void RecDeleteShader(GLuint shader) {
+    gActiveRecorder->RecordCommand("DeleteShader %u", shader);
+    if (gActiveRecorder->forwardToDriver) DRIVER.DeleteShader(shader);
+}
+
+static void RecDeleteTextures(GLsizei n, const GLuint *textures) {
+    for (GLsizei i = 0; i < n; ++i) {
+        gActiveRecorder->RecordCommand("DeleteTexture %u", textures[i]);
+    }
+    if (gActiveRecorder->forwardToDriver) DRIVER.DeleteTextures(n, textures);
+}
+
+static void RecDepthFunc(GLenum func) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("DepthFunc %s", GLEnumName(func));
+    if (gActiveRecorder->forwardToDriver) DRIVER.DepthFunc(func);
+}
+
+static void RecDisableVertexAttribArray(GLuint index) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("DisableVertexAttribArray %u", index);
+    if (gActiveRecorder->forwardToDriver) DRIVER.DisableVertexAttribArray(index);
+}
+
+static void RecDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {
+    gActiveRecorder->CountDraw(mode, count);
+    gActiveRecorder->RecordCommand("DrawElements %s %d %s %lu", GLEnumName(mode), count,
+                                   GLEnumName(type), (unsigned long) (size_t) indices);
+    if (gActiveRecorder->forwardToDriver) DRIVER.DrawElements(mode, count, type, indices);
+}
+
+static void RecEnable(GLenum cap) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("Enable %s", GLEnumName(cap));
+    if (gActiveRecorder->forwardToDriver) DRIVER.Enable(cap);
+}
+
+static void RecEnableVertexAttribArray(GLuint index) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("EnableVertexAttribArray %u", index);
+    if (gActiveRecorder->forwardToDriver) DRIVER.EnableVertexAttribArray(index);
+}
+
+static void RecFinish(void) {
+    if (gActiveRecorder->forwardToDriver) DRIVER.Finish();
+}
+
+static void RecGenBuffers(GLsizei n, GLuint *buffers) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GenBuffers(n, buffers);
+    } else {
+        for (GLsizei i = 0; i < n; ++i) buffers[i] = gActiveRecorder->nextName++;
+    }
+    for (GLsizei i = 0; i < n; ++i) {
+        gActiveRecorder->RecordCommand("GenBuffer -> %u", buffers[i]);
+    }
+}
+
+static void RecGenTextures(GLsizei n, GLuint *textures) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GenTextures(n, textures);
+    } else {
+        for (GLsizei i = 0; i < n; ++i) textures[i] = gActiveRecorder->nextName++;
+    }
+    for (GLsizei i = 0; i < n; ++i) {
+        gActiveRecorder->RecordCommand("GenTexture -> %u", textures[i]);
+    }
+}
+
+static GLint RecGetAttribLocation(GLuint program, const GLchar *name) {
+    static GLint nextMockLocation = 0;
+    return gActiveRecorder->forwardToDriver ? DRIVER.GetAttribLocation(program, name)
+                                            : nextMockLocation++;
+}
+
+static GLenum RecGetError(void) {
+    return gActiveRecorder->forwardToDriver ? DRIVER.GetError() : (GLenum) GL_NO_ERROR;
+}
+
+/**
+ * The mock reports zeros, which for GL_NUM_PROGRAM_BINARY_FORMATS turns program binaries off
+ */
+static void RecGetIntegerv(GLenum pname, GLint *data) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GetIntegerv(pname, data);
+    } else {
+        *data = 0;
+    }
+}
+
+static void RecGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *length,
+                                GLenum *binaryFormat, void *binary) {
+    gActiveRecorder->RecordCommand("GetProgramBinary %u", program);
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GetProgramBinary(program, bufSize, length, binaryFormat, binary);
+    } else if (length) {
+        *length = 0;
+    }
+}
+
+static void RecGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei *length,
+                                 GLchar *infoLog) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GetProgramInfoLog(program, bufSize, length, infoLog);
+    } else if (bufSize > 0) {
+        infoLog[0] = 0;
+    }
+}
+
+static void RecGetProgramiv(GLuint program, GLenum pname, GLint *params) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GetProgramiv(program, pname, params);
+    } else {
+        *params = (pname == GL_LINK_STATUS) ? GL_TRUE : 0;
+    }
+}
+
+static void RecGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei *length,
+                                GLchar *infoLog) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GetShaderInfoLog(shader, bufSize, length, infoLog);
+    } else if (bufSize > 0) {
+        infoLog[0] = 0;
+    }
+}
+
+static void RecGetShaderiv(GLuint shader, GLenum pname, GLint *params) {
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.GetShaderiv(shader, pname, params);
+    } else {
+        *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+    }
+}
+
+static const GLubyte *RecGetString(GLenum name) {
+    if (gActiveRecorder->forwardToDriver) {
+        return DRIVER.GetString(name);
+    }
+    switch (name) {
+        case GL_VERSION:                    return (const GLubyte *) "OpenGL ES 2.0 MyGLRecorder";
+        case GL_SHADING_LANGUAGE_VERSION:   return (const GLubyte *) "OpenGL ES GLSL ES 1.00";
+        case GL_RENDERER:                   return (const GLubyte *) "MyGLRecorder mock";
+        default:                            return (const GLubyte *) "";
+    }
+}
+
+static GLint RecGetUniformLocation(GLuint program, const GLchar *name) {
+    static GLint nextMockLocation = 0;
+    return gActiveRecorder->forwardToDriver ? DRIVER.GetUniformLocation(program, name)
+                                            : nextMockLocation++;
+}
+
+static void RecLinkProgram(GLuint program) {
+    gActiveRecorder->RecordCommand("LinkProgram %u", program);
+    if (gActiveRecorder->forwardToDriver) DRIVER.LinkProgram(program);
+}
+
+static void RecProgramBinary(GLuint program, GLenum binaryFormat, const void *binary,
+                             GLsizei length) {
+    gActiveRecorder->RecordCommand("ProgramBinary %u 0x%04X bytes=%d", program, binaryFormat,
+                                   length);
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.ProgramBinary(program, binaryFormat, binary, length);
+    }
+}
+
+static void RecShaderSource(GLuint shader, GLsizei count, const GLchar *const *string,
+                            const GLint *length) {
+    gActiveRecorder->RecordCommand("ShaderSource %u", shader);
+    if (gActiveRecorder->forwardToDriver) DRIVER.ShaderSource(shader, count, string, length);
+}
+
+static void RecTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width,
+                          GLsizei height, GLint border, GLenum format, GLenum type,
+                          const void *pixels) {
+    gActiveRecorder->CountTextureUpload(width, height, format, type);
+    gActiveRecorder->RecordCommand("TexImage2D texture=%u level=%d %dx%d %s %s",
+                                   gActiveRecorder->boundTextures[gActiveRecorder->activeTextureUnit],
+                                   level, width, height, GLEnumName(format), GLEnumName(type));
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.TexImage2D(target, level, internalformat, width, height, border, format, type,
+                          pixels);
+    }
+}
+
+static void RecTexParameteri(GLenum target, GLenum pname, GLint param) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("TexParameteri %s %s %s", GLEnumName(target),
+                                   GLEnumName(pname), GLEnumName(param));
+    if (gActiveRecorder->forwardToDriver) DRIVER.TexParameteri(target, pname, param);
+}
+
+static void RecUniform1i(GLint location, GLint v0) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("Uniform1i %d %d", location, v0);
+    if (gActiveRecorder->forwardToDriver) DRIVER.Uniform1i(location, v0);
+}
+
+static void RecUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("Uniform3f %d %g %g %g", location, v0, v1, v2);
+    if (gActiveRecorder->forwardToDriver) DRIVER.Uniform3f(location, v0, v1, v2);
+}
+
+static void RecUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("Uniform4f %d %g %g %g %g", location, v0, v1, v2, v3);
+    if (gActiveRecorder->forwardToDriver) DRIVER.Uniform4f(location, v0, v1, v2, v3);
+}
+
+static void RecUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose,
+                                const GLfloat *value) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("UniformMatrix3fv %d %d", location, count);
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.UniformMatrix3fv(location, count, transpose, value);
+    }
+}
+
+static void RecUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+                                const GLfloat *value) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("UniformMatrix4fv %d %d", location, count);
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.UniformMatrix4fv(location, count, transpose, value);
+    }
+}
+
+static void RecUseProgram(GLuint program) {
+    gActiveRecorder->CountStateChange(program == gActiveRecorder->boundProgram);
+    gActiveRecorder->boundProgram = program;
+    gActiveRecorder->RecordCommand("UseProgram %u", program);
+    if (gActiveRecorder->forwardToDriver) DRIVER.UseProgram(program);
+}
+
+static void RecVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                   GLsizei stride, const void *pointer) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("VertexAttribPointer %u %d %s buffer=%u", index, size,
+                                   GLEnumName(type),
+                                   gActiveRecorder->boundBuffers[GL_ARRAY_BUFFER]);
+    if (gActiveRecorder->forwardToDriver) {
+        DRIVER.VertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+}
+
+static void RecViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    gActiveRecorder->CountStateChange();
+    gActiveRecorder->RecordCommand("Viewport %d %d %d %d", x, y, width, height);
+    if (gActiveRecorder->forwardToDriver) DRIVER.Viewport(x, y, width, height);
+}
+
+static const MyGLDispatch recordingDispatch = {
+        RecActiveTexture,
+        RecAttachShader,
+        RecBindBuffer,
+        RecBindTexture,
+        RecBufferData,
+        RecClear,
+        RecClearColor,
+        RecCompileShader,
+        RecCreateProgram,
+        RecCreateShader,
+        RecDeleteBuffers,
+        RecDeleteProgram,
+        RecDeleteShader,
+        RecDeleteTextures,
+        RecDepthFunc,
+        RecDisableVertexAttribArray,
+        RecDrawElements,
+        RecEnable,
+        RecEnableVertexAttribArray,
+        RecFinish,
+        RecGenBuffers,
+        RecGenTextures,
+        RecGetAttribLocation,
+        RecGetError,
+        RecGetIntegerv,
+        RecGetProgramBinary,
+        RecGetProgramInfoLog,
+        RecGetProgramiv,
+        RecGetShaderInfoLog,
+        RecGetShaderiv,
+        RecGetString,
+        RecGetUniformLocation,
+        RecLinkProgram,
+        RecProgramBinary,
+        RecShaderSource,
+        RecTexImage2D,
+        RecTexParameteri,
+        RecUniform1i,
+        RecUniform3f,
+        RecUniform4f,
+        RecUniformMatrix3fv,
+        RecUniformMatrix4fv,
+        RecUseProgram,
+        RecVertexAttribPointer,
+        RecViewport
+};
+
+// ---- MyGLRecorder ----
+
+MyGLRecorder::MyGLRecorder() {
+    forwardToDriver = true;
+    recordCommands = false;
+    Reset();
+}
+
+MyGLRecorder::~MyGLRecorder() {
+    Uninstall();
+}
+
+/**
+ * Route all gl* calls through this recorder. If forwardToDriver is false, no GL context is
+ * needed and the driver is never called
+ */
+void MyGLRecorder::Install(bool forwardToDriver, bool recordCommands) {
+
+    this->forwardToDriver = forwardToDriver;
+    this->recordCommands = recordCommands;
+    gActiveRecorder = this;
+    gMyGLDispatch = recordingDispatch;
+}
+
+/**
+ * Restore the driver's entry points
+ */
+void MyGLRecorder::Uninstall() {
+
+    if (gActiveRecorder != this) {
+        return;
+    }
+    gMyGLDispatch = GetDriverGLDispatch();
+    gActiveRecorder = NULL;
+}
+
+/**
+ * Clear all counters and the command stream, keeps the tracked GL state
+ */
+void MyGLRecorder::Reset() {
+
+    stats.drawCalls = stats.stateChanges = stats.redundantStateChanges = 0;
+    stats.trianglesSubmitted = 0;
+    stats.bufferBytesUploaded = stats.textureBytesUploaded = 0;
+    stats.bytesPerBuffer.clear();
+    stats.bytesPerTexture.clear();
+    stats.frames.clear();
+    memset(&currentFrame, 0, sizeof(currentFrame));
+    isFrameOpen = false;
+    commandStream.clear();
+
+    if (gActiveRecorder != this) {
+        nextName = 1;
+        activeTextureUnit = GL_TEXTURE0;
+        boundProgram = 0;
+        boundBuffers.clear();
+        boundTextures.clear();
+    }
+}
+
+void MyGLRecorder::BeginFrame() {
+
+    memset(&currentFrame, 0, sizeof(currentFrame));
+    isFrameOpen = true;
+    RecordCommand("# frame %u", (unsigned int) stats.frames.size());
+}
+
+void MyGLRecorder::EndFrame() {
+
+    if (isFrameOpen) {
+        stats.frames.push_back(currentFrame);
+        isFrameOpen = false;
+    }
+}
+
+void MyGLRecorder::RecordCommand(const char *format, ...) {
+
+    if (!recordCommands) {
+        return;
+    }
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    commandStream += line;
+    commandStream += '\n';
+}
+
+void MyGLRecorder::CountStateChange(bool isRedundant) {
+
+    stats.stateChanges++;
+    currentFrame.stateChanges++;
+    if (isRedundant) {
+        stats.redundantStateChanges++;
+    }
+}
+
+void MyGLRecorder::CountDraw(GLenum mode, GLsizei count) {
+
+    unsigned long triangles = 0;
+    if (mode == GL_TRIANGLES) {
+        triangles = count / 3;
+    } else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2) {
+        triangles = count - 2;
+    }
+    stats.drawCalls++;
+    stats.trianglesSubmitted += triangles;
+    currentFrame.drawCalls++;
+    currentFrame.trianglesSubmitted += triangles;
+}
+
+void MyGLRecorder::CountBufferUpload(GLenum target, GLsizeiptr size) {
+
+    stats.bufferBytesUploaded += size;
+    stats.bytesPerBuffer[boundBuffers[target]] += size;
+}
+
+void MyGLRecorder::CountTextureUpload(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+
+    size_t size = (size_t) width * height * BytesPerPixel(format, type);
+    stats.textureBytesUploaded += size;
+    stats.bytesPerTexture[boundTextures[activeTextureUnit]] += size;
+}
+
+bool MyGLRecorder::SaveCommandStream(std::string fileName) const {
+
+    FILE *out = fopen(fileName.c_str(), "w");
+    if (!out) {
+        MyLOGE("Cannot open %s", fileName.c_str());
+        return false;
+    }
+    fwrite(commandStream.data(), 1, commandStream.size(), out);
+    fclose(out);
+    return true;
+}
+
+/**
+ * Print totals and per-frame maxima as a JSON object
+ */
+void MyGLRecorder::PrintSummary(FILE *out) const {
+
+    MyGLFrameStats maxFrame;
+    memset(&maxFrame, 0, sizeof(maxFrame));
+    for (unsigned int i = 0; i < stats.frames.size(); ++i) {
+        maxFrame.drawCalls = std::max(maxFrame.drawCalls, stats.frames[i].drawCalls);
+        maxFrame.stateChanges = std::max(maxFrame.stateChanges, stats.frames[i].stateChanges);
+        maxFrame.trianglesSubmitted = std::max(maxFrame.trianglesSubmitted,
+                                               stats.frames[i].trianglesSubmitted);
+    }
+
+    fprintf(out, "{\"drawCalls\": %lu, \"stateChanges\": %lu, \"redundantStateChanges\": %lu, "
+                 "\"triangles\": %lu, \"bufferBytes\": %lu, \"buffers\": %lu, "
+                 "\"textureBytes\": %lu, \"textures\": %lu, \"frames\": %lu, "
+                 "\"maxFrameDrawCalls\": %lu, \"maxFrameStateChanges\": %lu, "
+                 "\"maxFrameTriangles\": %lu}",
+            stats.drawCalls, stats.stateChanges, stats.redundantStateChanges,
+            stats.trianglesSubmitted, (unsigned long) stats.bufferBytesUploaded,
+            (unsigned long) stats.bytesPerBuffer.size(),
+            (unsigned long) stats.textureBytesUploaded,
+            (unsigned long) stats.bytesPerTexture.size(), (unsigned long) stats.frames.size(),
+            maxFrame.drawCalls, maxFrame.stateChanges, maxFrame.trianglesSubmitted);
+}
+
+#endif //MY_GL_DISPATCH
@@ -0,0 +1,89 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef MY_GL_RECORDER_H
+#define MY_GL_RECORDER_H
+
+#include "myGLFunctions.h"
+
+#ifdef MY_GL_DISPATCH
+
+#include <map>
+#include <vector>
+
+// counters for one frame, i.e., everything between BeginFrame and EndFrame
+struct MyGLFrameStats {
+    unsigned long   drawCalls;
+    unsigned long   stateChanges;
+    unsigned long   trianglesSubmitted;
+};
+
+struct MyGLRecorderStats {
+    unsigned long   drawCalls;
+    unsigned long   stateChanges;               // binds, enables, uniforms, pointers, ...
+    unsigned long   redundantStateChanges;      // binds of what was already bound
+    unsigned long   trianglesSubmitted;
+    size_t          bufferBytesUploaded;
+    size_t          textureBytesUploaded;
+    std::map<GLuint, size_t>    bytesPerBuffer;     // (buffer name, bytes uploaded to it)
+    std::map<GLuint, size_t>    bytesPerTexture;    // (texture name, bytes uploaded to it)
+    std::vector<MyGLFrameStats> frames;
+};
+
+// Replaces gMyGLDispatch with a table that counts draws, state changes and uploads and
+// optionally keeps a textual command stream. In mock mode nothing reaches the driver, so no
+// GL context is needed: names are generated, shaders always compile and glGetError is clean.
+class MyGLRecorder {
+public:
+    MyGLRecorder();
+    ~MyGLRecorder();
+
+    void    Install(bool forwardToDriver, bool recordCommands);
+    void    Uninstall();
+    void    BeginFrame();
+    void    EndFrame();
+    void    Reset();
+    bool    SaveCommandStream(std::string fileName) const;
+    void    PrintSummary(FILE *out) const;
+
+    const MyGLRecorderStats & GetStats() const { return stats; }
+    const std::string & GetCommandStream() const { return commandStream; }
+
+    // called by the recording entry points
+    void    RecordCommand(const char *format, ...);
+    void    CountStateChange(bool isRedundant = false);
+    void    CountDraw(GLenum mode, GLsizei count);
+    void    CountBufferUpload(GLenum target, GLsizeiptr size);
+    void    CountTextureUpload(GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+    bool            forwardToDriver;
+    bool            recordCommands;
+    GLuint          nextName;                   // mock names for buffers, textures, shaders
+    GLenum          activeTextureUnit;
+    GLuint          boundProgram;
+    std::map<GLenum, GLuint>    boundBuffers;   // (target, buffer)
+    std::map<GLenum, GLuint>    boundTextures;  // (texture unit, texture)
+
+private:
+    MyGLRecorderStats   stats;
+    MyGLFrameStats      currentFrame;
+    bool                isFrameOpen;
+    std::string         commandStream;
+};
+
+#endif //MY_GL_DISPATCH
+
+#endif //MY_GL_RECORDER_H
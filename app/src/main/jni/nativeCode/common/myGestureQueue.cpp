@@ -0,0 +1,53 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myGestureQueue.h"
+#include <time.h>
+
+MyGestureQueue::MyGestureQueue() : head(0), tail(0), droppedEvents(0) {
+}
+
+/**
+ * The release store of tail publishes the event to the consumer's acquire load
+ */
+bool MyGestureQueue::Push(const GestureEvent &event) {
+
+    unsigned int currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) == GESTURE_QUEUE_CAPACITY) {
+        droppedEvents++;
+        return false;
+    }
+    events[currentTail & (GESTURE_QUEUE_CAPACITY - 1)] = event;
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+}
+
+bool MyGestureQueue::Pop(GestureEvent &event) {
+
+    unsigned int currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    event = events[currentHead & (GESTURE_QUEUE_CAPACITY - 1)];
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+}
+
+int64_t GetMonotonicTimeNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
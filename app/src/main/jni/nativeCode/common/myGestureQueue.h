@@ -0,0 +1,64 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Gestures arrive on the UI thread while the camera is read on the GL thread. The UI thread
+// pushes them into this single-producer single-consumer ring without locking; the GL thread
+// pops them once per frame, so only the GL thread ever touches MyGLCamera
+
+#ifndef MY_GESTURE_QUEUE_H
+#define MY_GESTURE_QUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#define GESTURE_QUEUE_CAPACITY  256     // power of two, several frames of 120 Hz touch input
+
+enum GestureType {
+    GESTURE_DOUBLE_TAP,
+    GESTURE_SCROLL,     // one-finger drag: distance x/y and end position x/y, in pixels
+    GESTURE_SCALE,      // pinch: scale factor in x
+    GESTURE_MOVE        // two-finger drag: distance x/y in pixels
+};
+
+struct GestureEvent {
+    GestureType type;
+    float       x, y;               // distance, or scale factor in x
+    float       positionX, positionY;
+    int64_t     timestampNs;        // CLOCK_MONOTONIC time of the touch event
+};
+
+class MyGestureQueue {
+public:
+    MyGestureQueue();
+
+    bool    Push(const GestureEvent &event);   // UI thread, false if the ring is full
+    bool    Pop(GestureEvent &event);          // GL thread, false if the ring is empty
+
+    unsigned long   GetDroppedEvents() const { return droppedEvents; }
+
+private:
+    // head and tail are written by one side each, the ring between them keeps them off the
+    // same cache line
+    std::atomic<unsigned int>   head;               // next slot to pop, owned by the GL thread
+    GestureEvent                events[GESTURE_QUEUE_CAPACITY];
+    std::atomic<unsigned int>   tail;               // next slot to push, owned by the UI thread
+    std::atomic<unsigned long>  droppedEvents;      // UI thread too
+};
+
+// CLOCK_MONOTONIC in nanoseconds, the clock behind Android's SystemClock.uptimeMillis
+int64_t GetMonotonicTimeNs();
+
+#endif //MY_GESTURE_QUEUE_H
@@ -0,0 +1,120 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myImportStepTimer.h"
+#include "myLogger.h"
+#include <assimp/DefaultLogger.hpp>
+#include <string.h>
+
+MyImportStepTimer::MyImportStepTimer() {
+    isRunning = false;
+    previousSeverity = Assimp::Logger::NORMAL;
+}
+
+MyImportStepTimer::~MyImportStepTimer() {
+    Stop();
+}
+
+/**
+ * Attach to Assimp's logger. Debug messages are only emitted by a VERBOSE logger, so raise
+ * its severity until Stop
+ */
+bool MyImportStepTimer::Start() {
+
+    if (isRunning) {
+        return true;
+    }
+    stepTimes.clear();
+    if (Assimp::DefaultLogger::isNullLogger()) {
+        MyLOGW("Import steps are not timed, there is no Assimp DefaultLogger");
+        return false;
+    }
+
+    previousSeverity = Assimp::DefaultLogger::get()->getLogSeverity();
+    Assimp::DefaultLogger::get()->setLogSeverity(Assimp::Logger::VERBOSE);
+    Assimp::DefaultLogger::get()->attachStream(this, Assimp::Logger::Debugging |
+                                                     Assimp::Logger::Info);
+
+    isRunning = true;
+    currentStep = "Import";
+    stepStart = Clock::now();
+    return true;
+}
+
+void MyImportStepTimer::Stop() {
+
+    if (!isRunning) {
+        return;
+    }
+    CloseStep("");
+    isRunning = false;
+
+    Assimp::DefaultLogger::get()->detatchStream(this, Assimp::Logger::Debugging |
+                                                      Assimp::Logger::Info);
+    Assimp::DefaultLogger::get()->setLogSeverity(previousSeverity);
+}
+
+/**
+ * Charge the time since the last boundary to the running step and start the next one
+ */
+void MyImportStepTimer::CloseStep(std::string nextStep) {
+
+    Clock::time_point now = Clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - stepStart).count();
+    stepStart = now;
+
+    unsigned int i = 0;
+    while (i < stepTimes.size() && stepTimes[i].name != currentStep) {
+        ++i;
+    }
+    if (i == stepTimes.size()) {
+        ImportStepTime stepTime = {currentStep, 0};
+        stepTimes.push_back(stepTime);
+    }
+    stepTimes[i].ms += ms;
+    currentStep = nextStep;
+}
+
+/**
+ * Record a step that ran after ReadFile, e.g. the steps done by PostProcessMeshes
+ */
+void MyImportStepTimer::AddStepTime(std::string stepName, double ms) {
+    ImportStepTime stepTime = {stepName, ms};
+    stepTimes.push_back(stepTime);
+}
+
+/**
+ * Messages look like "Debug, T0: JoinVerticesProcess begin\n"
+ */
+void MyImportStepTimer::write(const char *message) {
+
+    const char *text = strstr(message, ": ");
+    text = text ? text + 2 : message;
+
+    const char *space = strchr(text, ' ');
+    if (!space) {
+        return;
+    }
+    std::string stepName(text, space - text);
+    const char *verb = space + 1;
+
+    if (strncmp(verb, "begin", 5) == 0) {
+        CloseStep(stepName);
+    } else if (stepName == currentStep &&
+               (strncmp(verb, "finished", 8) == 0 || strncmp(verb, "end", 3) == 0)) {
+        CloseStep("Other");
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef MY_IMPORT_STEP_TIMER_H
+#define MY_IMPORT_STEP_TIMER_H
+
+#include <assimp/Logger.hpp>
+#include <assimp/LogStream.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct ImportStepTime {
+    std::string name;       // post-process step, e.g. "JoinVerticesProcess", or "Import"/"Other"
+    double      ms;
+};
+
+// Splits the time of an Importer::ReadFile call into file parsing ("Import"), every
+// post-processing step and the gaps between steps ("Other"). Assimp 3.0 has no per-step
+// callback (ProgressHandler only sees the start and end of ReadFile), but every step logs
+// "<Step> begin" and "<Step> finished"/"<Step> end" at debug level, so the timer listens
+// to Assimp's logger for the duration of the import. It attaches to the DefaultLogger that
+// the app created and never replaces it; without one there is nothing to listen to
+class MyImportStepTimer : public Assimp::LogStream {
+public:
+    MyImportStepTimer();
+    ~MyImportStepTimer();
+
+    bool    Start();                // call right before ReadFile, false if there is no logger
+    void    Stop();                 // call right after ReadFile
+    void    write(const char *message);
+    void    AddStepTime(std::string stepName, double ms);  // for steps that run outside Assimp
+
+    const std::vector<ImportStepTime> & GetStepTimes() const { return stepTimes; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void    CloseStep(std::string nextStep);
+
+    std::vector<ImportStepTime> stepTimes;
+    std::string         currentStep;
+    Clock::time_point   stepStart;
+    bool                isRunning;
+    Assimp::Logger::LogSeverity previousSeverity;
+};
+
+#endif //MY_IMPORT_STEP_TIMER_H
@@ -17,6 +17,7 @@
 #include "myJNIHelper.h"
 #include "misc.h"
 #include <android/asset_manager_jni.h>
+#include <unistd.h>
 
 MyJNIHelper::MyJNIHelper(JNIEnv *env, jobject obj, jobject assetManager, jstring pathToInternalDir) {
 
@@ -32,6 +33,8 @@ MyJNIHelper::MyJNIHelper(JNIEnv *env, jobject obj, jobject assetManager, jstring
 
     //mutex for thread safety
     pthread_mutex_init(&threadMutex, NULL );
+
+    OpenArchive(MY_ASSET_ARCHIVE);
 }
 
 MyJNIHelper::~MyJNIHelper()
@@ -50,16 +53,23 @@ bool MyJNIHelper::ExtractAssetReturnFilename(std::string assetName, std::string
 
     // check if the file was previously extracted and is available in app's internal dir
     FILE* file = fopen(filename.c_str(), "rb");
-    if (file && checkIfFileIsAvailable) {
-
-        MyLOGI("Found extracted file in assets: %s", filename.c_str());
+    if (file) {
         fclose(file);
-        pthread_mutex_unlock( &threadMutex);
-        return true;
-
+        if (checkIfFileIsAvailable) {
+            MyLOGI("Found extracted file in assets: %s", filename.c_str());
+            return true;
+        }
     }
 
     // let us look for the file in assets
+    // under the lock the loose assets are extracted with, two threads may extract one file
+    const ArchiveEntry *entry = archive.FindEntry(assetName);
+    if (entry) {
+        pthread_mutex_lock( &threadMutex);
+        bool isExtracted = archive.ExtractEntry(entry, filename);
+        pthread_mutex_unlock( &threadMutex);
+        return isExtracted;
+    }
     bool result = false;
 
     // AAsset objects are not thread safe and need to be protected with mutex
@@ -92,3 +102,154 @@ bool MyJNIHelper::ExtractAssetReturnFilename(std::string assetName, std::string
     return result;
 
 }
+
+/**
+ * An uncompressed asset is mapped from the APK and viewed in place; AAsset_getBuffer inflates
+ * a compressed one, and if that fails the asset is read into the buffer's copy
+ */
+bool MyJNIHelper::ReadAsset(const std::string &assetName, MyAssetBuffer &buffer) {
+
+    const ArchiveEntry *entry = archive.FindEntry(assetName);
+    if (entry) {
+        return archive.ReadEntry(entry, buffer);
+    }
+    buffer.Release();
+
+    // AAsset objects are not thread safe and need to be protected with mutex
+    pthread_mutex_lock( &threadMutex);
+    AAsset* asset = AAssetManager_open(apkAssetManager, assetName.c_str(), AASSET_MODE_BUFFER);
+    if (asset == NULL) {
+        pthread_mutex_unlock( &threadMutex);
+        MyLOGE("Asset not found: %s", assetName.c_str());
+        return false;
+    }
+
+    size_t assetLength = AAsset_getLength(asset);
+    const void *assetBuffer = AAsset_getBuffer(asset);
+    bool result = true;
+    if (assetBuffer != NULL) {
+        buffer.asset = asset;
+        buffer.data = (const uint8_t *) assetBuffer;
+        buffer.size = assetLength;
+    } else {
+        buffer.copy.resize(assetLength);
+        size_t bytesRead = 0;
+        int nb_read = 0;
+        while (bytesRead < assetLength &&
+               (nb_read = AAsset_read(asset, &buffer.copy[bytesRead], assetLength - bytesRead)) > 0)
+        {
+            bytesRead += nb_read;
+        }
+        AAsset_close(asset);
+        result = bytesRead == assetLength;
+        buffer.data = buffer.copy.data();
+        buffer.size = result ? assetLength : 0;
+    }
+    pthread_mutex_unlock( &threadMutex);
+    return result;
+}
+
+bool MyJNIHelper::GetAssetSize(const std::string &assetName, size_t &assetSize) {
+
+    const ArchiveEntry *entry = archive.FindEntry(assetName);
+    if (entry) {
+        assetSize = entry->size;
+        return true;
+    }
+    pthread_mutex_lock( &threadMutex);
+    AAsset* asset = AAssetManager_open(apkAssetManager, assetName.c_str(), AASSET_MODE_UNKNOWN);
+    if (asset != NULL) {
+        assetSize = AAsset_getLength(asset);
+        AAsset_close(asset);
+    }
+    pthread_mutex_unlock( &threadMutex);
+    return asset != NULL;
+}
+
+bool MyJNIHelper::ListAssets(const std::string &directory, std::vector<std::string> &fileNames) {
+
+    if (archive.IsOpen()) {
+        archive.ListDirectory(directory, fileNames);
+        return true;
+    }
+    pthread_mutex_lock( &threadMutex);
+    AAssetDir* assetDir = AAssetManager_openDir(apkAssetManager, directory.c_str());
+    if (assetDir != NULL) {
+        const char *fileName;
+        while ((fileName = AAssetDir_getNextFileName(assetDir)) != NULL) {
+            fileNames.push_back(fileName);
+        }
+        AAssetDir_close(assetDir);
+    }
+    pthread_mutex_unlock( &threadMutex);
+    return assetDir != NULL;
+}
+
+/**
+ * The archive is mapped straight from the APK when it is stored there uncompressed, see
+ * aaptOptions in build.gradle; otherwise it is extracted and the copy is mapped
+ */
+bool MyJNIHelper::OpenAssetFileDescriptor(const std::string &assetName, int &fd,
+                                          int64_t &start, size_t &length) {
+
+    // AAsset objects are not thread safe and need to be protected with mutex
+    pthread_mutex_lock( &threadMutex);
+    AAsset* asset = AAssetManager_open(apkAssetManager, assetName.c_str(), AASSET_MODE_RANDOM);
+    off_t assetStart = 0, assetLength = 0;
+    fd = -1;
+    if (asset != NULL) {
+        fd = AAsset_openFileDescriptor(asset, &assetStart, &assetLength);
+        AAsset_close(asset);
+    }
+    pthread_mutex_unlock( &threadMutex);
+    start = assetStart;
+    length = assetLength;
+    return fd >= 0;
+}
+
+bool MyJNIHelper::OpenArchive(const std::string &archiveName) {
+
+    pthread_mutex_lock( &threadMutex);
+    AAsset* asset = AAssetManager_open(apkAssetManager, archiveName.c_str(), AASSET_MODE_RANDOM);
+    int fd = -1;
+    off_t start = 0, length = 0;
+    if (asset != NULL) {
+        fd = AAsset_openFileDescriptor(asset, &start, &length);
+        AAsset_close(asset);
+    }
+    pthread_mutex_unlock( &threadMutex);
+    if (asset == NULL) {
+        MyLOGI("No asset archive %s, reading the loose assets", archiveName.c_str());
+        return false;
+    }
+
+    if (fd >= 0) {
+        bool isOpen = archive.Open(fd, start, length);
+        close(fd);
+        return isOpen;
+    }
+    MyLOGI("Asset archive %s is compressed in the APK, extracting it", archiveName.c_str());
+    std::string archivePath;
+    return ExtractAssetReturnFilename(archiveName, archivePath) && archive.OpenFile(archivePath);
+}
+
+bool MyJNIHelper::ReadFileFromAssetsToBuffer(const char *filename,
+                                             std::vector<uint8_t> *bufferRef) {
+
+    MyAssetBuffer buffer;
+    if (!bufferRef || !ReadAsset(filename, buffer)) {
+        return false;
+    }
+    bufferRef->assign(buffer.GetData(), buffer.GetData() + buffer.GetSize());
+    return true;
+}
+
+void MyAssetBuffer::Release() {
+
+    if (asset) {
+        AAsset_close((AAsset *) asset);
+        asset = NULL;
+    }
+    data = NULL;
+    size = 0;
+}
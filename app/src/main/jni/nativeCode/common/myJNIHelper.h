@@ -17,34 +17,91 @@
 #ifndef MY_JNI_HELPER_H
 #define MY_JNI_HELPER_H
 
+#include "myAssetArchive.h"
 #include "myLogger.h"
-#include <android_native_app_glue.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <string>
-#include <jni.h>
 #include <vector>
 
+#ifdef __ANDROID__
+#include <android_native_app_glue.h>
+#include <jni.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// An asset's contents, read without going through internal storage: a view of the asset's own
+// buffer when the platform has one, otherwise a copy in memory the buffer keeps for its next read
+class MyAssetBuffer {
+public:
+    MyAssetBuffer() : data(NULL), size(0), asset(NULL) {}
+    ~MyAssetBuffer() { Release(); }
+
+    const uint8_t * GetData() const { return data; }
+    size_t          GetSize() const { return size; }
+    // closes the asset; the memory of a copy is kept for reuse
+    void            Release();
+
+private:
+    MyAssetBuffer(const MyAssetBuffer &);
+    MyAssetBuffer & operator=(const MyAssetBuffer &);
+
+    friend class MyJNIHelper;
+    friend class MyAssetArchive;
+    const uint8_t *         data;
+    size_t                  size;
+    void *                  asset;          // AAsset that data points into, NULL for a copy
+    std::vector<uint8_t>    copy;
+};
+
 class MyJNIHelper {
 
 private:
     mutable pthread_mutex_t threadMutex;
     std::string apkInternalPath;
+    MyAssetArchive archive;         // read before the loose assets once open
+#ifdef __ANDROID__
     AAssetManager *apkAssetManager;
+#else
+    std::string hostAssetPath;      // directory that mirrors app/src/main/assets
+#endif
 
 public:
+#ifdef __ANDROID__
     MyJNIHelper(JNIEnv *env, jobject obj, jobject assetManager, jstring pathToInternalDir);
-    ~MyJNIHelper();
 
     void Init(JNIEnv *env, jobject obj, jobject assetManager, jstring pathToInternalDir);
+#else
+    MyJNIHelper(std::string pathToAssetDir, std::string pathToInternalDir);
+#endif
+    ~MyJNIHelper();
 
     bool ExtractAssetReturnFilename(std::string assetName, std::string &filename,
                                     bool checkIfFileIsAvailable = false);
 
+    // read an asset into memory, buffer stays valid until it is released or read into again
+    bool ReadAsset(const std::string &assetName, MyAssetBuffer &buffer);
+    // the file a loose asset stored uncompressed is in, e.g. the APK, and where in it, so that
+    // the asset can be mapped; false if it is compressed or missing. The caller closes fd
+    bool OpenAssetFileDescriptor(const std::string &assetName, int &fd, int64_t &start,
+                                 size_t &length);
+    // size of an asset without reading it, false if there is no such asset
+    bool GetAssetSize(const std::string &assetName, size_t &assetSize);
+    // names of the files in an asset directory, without subdirectories, which Android's asset
+    // manager does not list
+    bool ListAssets(const std::string &directory, std::vector<std::string> &fileNames);
     bool ReadFileFromAssetsToBuffer(const char *filename, std::vector<uint8_t> *bufferRef);
+
+    // read the assets an archive has from it, see myAssetArchive.h; false if there is no
+    // such archive, the loose assets are read then. Call it before any other thread reads
+    bool OpenArchive(const std::string &archiveName);
+    const MyAssetArchive & GetArchive() const { return archive; }
+
+    // app's internal storage, where assets are extracted and caches are kept
+    const std::string & GetInternalPath() const { return apkInternalPath; }
 };
 
 extern MyJNIHelper *gHelperObject;
@@ -0,0 +1,358 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myJSON.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+class MyJSONParser {
+public:
+    MyJSONParser(const char *text, size_t length) : next(text), end(text + length) {}
+
+    bool ParseDocument(MyJSONValue &value) {
+        if (!ParseValue(value, 0)) {
+            return false;
+        }
+        SkipWhitespace();
+        return next == end;
+    }
+
+private:
+    void SkipWhitespace() {
+        while (next < end && (*next == ' ' || *next == '\t' || *next == '\n' || *next == '\r')) {
+            ++next;
+        }
+    }
+
+    bool Expect(const char *literal) {
+        size_t length = strlen(literal);
+        if ((size_t) (end - next) < length || memcmp(next, literal, length) != 0) {
+            return false;
+        }
+        next += length;
+        return true;
+    }
+
+    bool ParseValue(MyJSONValue &value, unsigned int depth);
+    bool ParseNumber(MyJSONValue &value);
+    bool ParseString(std::string &text);
+    bool ParseHex4(unsigned int &codeUnit);
+
+    const char *next;
+    const char *end;
+};
+
+bool MyJSONParser::ParseValue(MyJSONValue &value, unsigned int depth) {
+
+    SkipWhitespace();
+    if (next == end || depth > MY_JSON_MAX_DEPTH) {
+        return false;
+    }
+    switch (*next) {
+        case '{':
+            value.type = JSON_OBJECT;
+            ++next;
+            SkipWhitespace();
+            if (next < end && *next == '}') {
+                ++next;
+                return true;
+            }
+            for (;;) {
+                SkipWhitespace();
+                value.keys.push_back(std::string());
+                if (!ParseString(value.keys.back())) {
+                    return false;
+                }
+                SkipWhitespace();
+                if (!Expect(":")) {
+                    return false;
+                }
+                value.items.push_back(MyJSONValue());
+                if (!ParseValue(value.items.back(), depth + 1)) {
+                    return false;
+                }
+                SkipWhitespace();
+                if (Expect("}")) {
+                    return true;
+                }
+                if (!Expect(",")) {
+                    return false;
+                }
+            }
+
+        case '[':
+            value.type = JSON_ARRAY;
+            ++next;
+            SkipWhitespace();
+            if (next < end && *next == ']') {
+                ++next;
+                return true;
+            }
+            for (;;) {
+                value.items.push_back(MyJSONValue());
+                if (!ParseValue(value.items.back(), depth + 1)) {
+                    return false;
+                }
+                SkipWhitespace();
+                if (Expect("]")) {
+                    return true;
+                }
+                if (!Expect(",")) {
+                    return false;
+                }
+            }
+
+        case '"':
+            value.type = JSON_STRING;
+            return ParseString(value.text);
+
+        case 't':
+            value.type = JSON_BOOL;
+            value.number = 1;
+            return Expect("true");
+
+        case 'f':
+            value.type = JSON_BOOL;
+            value.number = 0;
+            return Expect("false");
+
+        case 'n':
+            value.type = JSON_NULL;
+            return Expect("null");
+
+        default:
+            return ParseNumber(value);
+    }
+}
+
+/**
+ * Checks the JSON grammar, then lets strtod convert a NUL-terminated copy, since the text may
+ * run on past the number
+ */
+bool MyJSONParser::ParseNumber(MyJSONValue &value) {
+
+    const char *start = next;
+    if (next < end && *next == '-') {
+        ++next;
+    }
+    if (next < end && *next == '0') {
+        ++next;
+    } else {
+        if (next == end || *next < '1' || *next > '9') {
+            return false;
+        }
+        while (next < end && *next >= '0' && *next <= '9') {
+            ++next;
+        }
+    }
+    if (next < end && *next == '.') {
+        ++next;
+        if (next == end || *next < '0' || *next > '9') {
+            return false;
+        }
+        while (next < end && *next >= '0' && *next <= '9') {
+            ++next;
+        }
+    }
+    if (next < end && (*next == 'e' || *next == 'E')) {
+        ++next;
+        if (next < end && (*next == '+' || *next == '-')) {
+            ++next;
+        }
+        if (next == end || *next < '0' || *next > '9') {
+            return false;
+        }
+        while (next < end && *next >= '0' && *next <= '9') {
+            ++next;
+        }
+    }
+
+    char digits[64];
+    size_t length = next - start;
+    if (length >= sizeof(digits)) {
+        return false;
+    }
+    memcpy(digits, start, length);
+    digits[length] = 0;
+    value.type = JSON_NUMBER;
+    value.number = strtod(digits, NULL);
+    return true;
+}
+
+bool MyJSONParser::ParseHex4(unsigned int &codeUnit) {
+
+    if (end - next < 4) {
+        return false;
+    }
+    codeUnit = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = *next++;
+        unsigned int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        codeUnit = codeUnit * 16 + digit;
+    }
+    return true;
+}
+
+/**
+ * Escapes are decoded, \u ones to UTF-8 with surrogate pairs combined. Other bytes are copied
+ * as they are, control characters are not allowed unescaped
+ */
+bool MyJSONParser::ParseString(std::string &text) {
+
+    if (!Expect("\"")) {
+        return false;
+    }
+    for (;;) {
+        const char *run = next;
+        while (next < end && *next != '"' && *next != '\\' && (unsigned char) *next >= 0x20) {
+            ++next;
+        }
+        text.append(run, next - run);
+        if (next == end || (unsigned char) *next < 0x20) {
+            return false;
+        }
+        if (*next++ == '"') {
+            return true;
+        }
+
+        if (next == end) {
+            return false;
+        }
+        char escape = *next++;
+        switch (escape) {
+            case '"':  text.push_back('"');  break;
+            case '\\': text.push_back('\\'); break;
+            case '/':  text.push_back('/');  break;
+            case 'b':  text.push_back('\b'); break;
+            case 'f':  text.push_back('\f'); break;
+            case 'n':  text.push_back('\n'); break;
+            case 'r':  text.push_back('\r'); break;
+            case 't':  text.push_back('\t'); break;
+            case 'u': {
+                unsigned int codePoint;
+                if (!ParseHex4(codePoint)) {
+                    return false;
+                }
+                if (codePoint >= 0xD800 && codePoint < 0xDC00) {
+                    unsigned int low;
+                    if (!Expect("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000) {
+                        return false;
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codePoint >= 0xDC00 && codePoint < 0xE000) {
+                    return false;
+                }
+                if (codePoint < 0x80) {
+                    text.push_back((char) codePoint);
+                } else if (codePoint < 0x800) {
+                    text.push_back((char) (0xC0 | (codePoint >> 6)));
+                    text.push_back((char) (0x80 | (codePoint & 0x3F)));
+                } else if (codePoint < 0x10000) {
+                    text.push_back((char) (0xE0 | (codePoint >> 12)));
+                    text.push_back((char) (0x80 | ((codePoint >> 6) & 0x3F)));
+                    text.push_back((char) (0x80 | (codePoint & 0x3F)));
+                } else {
+                    text.push_back((char) (0xF0 | (codePoint >> 18)));
+                    text.push_back((char) (0x80 | ((codePoint >> 12) & 0x3F)));
+                    text.push_back((char) (0x80 | ((codePoint >> 6) & 0x3F)));
+                    text.push_back((char) (0x80 | (codePoint & 0x3F)));
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
+bool ParseJSON(const char *text, size_t length, MyJSONValue &value) {
+
+    value = MyJSONValue();
+    MyJSONParser parser(text, length);
+    return parser.ParseDocument(value);
+}
+
+const MyJSONValue * MyJSONValue::Find(const char *key) const {
+
+    if (type != JSON_OBJECT) {
+        return NULL;
+    }
+    for (unsigned int m = 0; m < keys.size(); ++m) {
+        if (keys[m] == key) {
+            return &items[m];
+        }
+    }
+    return NULL;
+}
+
+bool MyJSONValue::GetIndex(const char *key, unsigned int &value) const {
+
+    const MyJSONValue *member = Find(key);
+    if (!member || member->type != JSON_NUMBER || member->number < 0 ||
+        member->number >= 4294967296.0 || member->number != floor(member->number)) {
+        return false;
+    }
+    value = (unsigned int) member->number;
+    return true;
+}
+
+bool MyJSONValue::GetNumber(const char *key, double &value) const {
+
+    const MyJSONValue *member = Find(key);
+    if (!member || member->type != JSON_NUMBER) {
+        return false;
+    }
+    value = member->number;
+    return true;
+}
+
+bool MyJSONValue::GetString(const char *key, std::string &value) const {
+
+    const MyJSONValue *member = Find(key);
+    if (!member || member->type != JSON_STRING) {
+        return false;
+    }
+    value = member->text;
+    return true;
+}
+
+bool MyJSONValue::GetNumbers(const char *key, float *values, unsigned int count) const {
+
+    const MyJSONValue *member = Find(key);
+    if (!member || member->type != JSON_ARRAY || member->items.size() != count) {
+        return false;
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        if (member->items[i].type != JSON_NUMBER) {
+            return false;
+        }
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        values[i] = (float) member->items[i].number;
+    }
+    return true;
+}
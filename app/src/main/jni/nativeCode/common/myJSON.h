@@ -0,0 +1,81 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// A small JSON reader for the documents the app reads itself, e.g. the JSON chunk of a GLB.
+// Parses the whole text into a tree of values; input that is not strict JSON is rejected, as is
+// nesting deeper than MY_JSON_MAX_DEPTH. The text need not be NUL-terminated
+
+#ifndef MY_JSON_H
+#define MY_JSON_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#define MY_JSON_MAX_DEPTH   64
+
+enum MyJSONType {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+};
+
+class MyJSONValue {
+public:
+    MyJSONValue() : type(JSON_NULL), number(0) {}
+
+    MyJSONType      GetType() const { return type; }
+    bool            IsNumber() const { return type == JSON_NUMBER; }
+    bool            IsString() const { return type == JSON_STRING; }
+    bool            IsArray() const { return type == JSON_ARRAY; }
+    bool            IsObject() const { return type == JSON_OBJECT; }
+    // 1 for true, 0 for false
+    double          GetNumber() const { return number; }
+    const std::string & GetString() const { return text; }
+
+    // elements of an array or members of an object, in document order
+    unsigned int    GetSize() const { return items.size(); }
+    const MyJSONValue & operator[](unsigned int index) const { return items[index]; }
+    const std::string & GetKey(unsigned int member) const { return keys[member]; }
+    // the member's value, NULL if this is not an object or has no such member
+    const MyJSONValue * Find(const char *key) const;
+
+    // member lookups for optional members: false if the member is missing or of another type,
+    // leaving value as it was. GetIndex wants a whole number in [0, 2^32)
+    bool            GetIndex(const char *key, unsigned int &value) const;
+    bool            GetNumber(const char *key, double &value) const;
+    bool            GetString(const char *key, std::string &value) const;
+    // the first count numbers of an array member, false unless it has exactly count numbers
+    bool            GetNumbers(const char *key, float *values, unsigned int count) const;
+
+private:
+    friend class MyJSONParser;
+
+    MyJSONType                  type;
+    double                      number;
+    std::string                 text;
+    std::vector<MyJSONValue>    items;
+    std::vector<std::string>    keys;           // of an object's items
+};
+
+// false if the text is not one JSON value, optionally surrounded by whitespace
+bool ParseJSON(const char *text, size_t length, MyJSONValue &value);
+
+#endif //MY_JSON_H
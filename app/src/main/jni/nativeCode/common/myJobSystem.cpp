@@ -0,0 +1,391 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myJobSystem.h"
+#include "myLogger.h"
+#include <algorithm>
+
+struct MyJob {
+    MyJobFunction               function;
+    bool                        isGLThreadJob;
+    bool                        isLowPriority;
+    std::atomic<int>            remainingDependencies;  // plus one while the job is being set up
+    std::atomic<bool>           isDone;
+    std::mutex                  mutex;                  // guards dependents and the isDone flip
+    std::vector<MyJobHandle>    dependents;
+
+    MyJob() : isGLThreadJob(false), isLowPriority(false), remainingDependencies(1),
+              isDone(false) {}
+};
+
+// which pool and worker the current thread belongs to, -1 outside every pool
+static thread_local MyJobSystem *tCurrentJobSystem = NULL;
+static thread_local int tWorkerIndex = -1;
+
+MyJobSystem::MyJobSystem(unsigned int numberOfWorkers) : queuedJobs(0), queuedLowPriorityJobs(0),
+                                                         waitingThreads(0) {
+
+    isStopping = false;
+    statsStart = Clock::now();
+    for (unsigned int i = 0; i < numberOfWorkers; ++i) {
+        queues.push_back(new WorkerQueue);
+    }
+    for (unsigned int i = 0; i < numberOfWorkers; ++i) {
+        workers.push_back(std::thread(&MyJobSystem::WorkerLoop, this, (int) i));
+    }
+    MyLOGI("MyJobSystem: %u workers", numberOfWorkers);
+}
+
+/**
+ * Lets the workers drain their queues, jobs still waiting for the GL thread are dropped
+ */
+MyJobSystem::~MyJobSystem() {
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        isStopping = true;
+    }
+    wakeCondition.notify_all();
+    for (unsigned int i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    for (unsigned int i = 0; i < queues.size(); ++i) {
+        delete queues[i];
+    }
+}
+
+/**
+ * One worker per core beside the GL thread, at most 7 so that the pool stays small on servers,
+ * and one when the number of cores is unknown
+ */
+unsigned int MyJobSystem::GetDefaultNumberOfWorkers() {
+    unsigned int numberOfCores = std::thread::hardware_concurrency(); // 0 if unknown
+    return numberOfCores > 1 ? std::min(8u, numberOfCores) - 1 : 1;
+}
+
+MyJobHandle MyJobSystem::Submit(MyJobFunction function) {
+    return CreateJob(function, false, false, std::vector<MyJobHandle>());
+}
+
+MyJobHandle MyJobSystem::Submit(MyJobFunction function,
+                                const std::vector<MyJobHandle> &dependencies) {
+    return CreateJob(function, false, false, dependencies);
+}
+
+MyJobHandle MyJobSystem::SubmitToGLThread(MyJobFunction function,
+                                          const std::vector<MyJobHandle> &dependencies) {
+    return CreateJob(function, true, false, dependencies);
+}
+
+MyJobHandle MyJobSystem::SubmitLowPriority(MyJobFunction function,
+                                           const std::vector<MyJobHandle> &dependencies) {
+    return CreateJob(function, false, true, dependencies);
+}
+
+/**
+ * Register the job with every unfinished dependency, the last one to finish enqueues it.
+ * The extra count held during setup keeps a dependency that finishes meanwhile from doing so
+ */
+MyJobHandle MyJobSystem::CreateJob(MyJobFunction function, bool isGLThreadJob,
+                                   bool isLowPriority,
+                                   const std::vector<MyJobHandle> &dependencies) {
+
+    MyJobHandle job(new MyJob);
+    job->function = function;
+    job->isGLThreadJob = isGLThreadJob;
+    job->isLowPriority = isLowPriority;
+    for (unsigned int i = 0; i < dependencies.size(); ++i) {
+        const MyJobHandle &dependency = dependencies[i];
+        if (!dependency) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->isDone) {
+            job->remainingDependencies++;
+            dependency->dependents.push_back(job);
+        }
+    }
+    if (--job->remainingDependencies == 0) {
+        Enqueue(job);
+    }
+    return job;
+}
+
+/**
+ * Workers push onto their own deque, every other thread onto the shared queue
+ */
+void MyJobSystem::Enqueue(const MyJobHandle &job) {
+
+    if (job->isGLThreadJob) {
+        std::lock_guard<std::mutex> lock(glThreadMutex);
+        glThreadJobs.push_back(job);
+        return;
+    }
+
+    if (job->isLowPriority) {
+        std::lock_guard<std::mutex> lock(lowPriorityMutex);
+        lowPriorityJobs.push_back(job);
+        queuedLowPriorityJobs++;
+    } else if (tCurrentJobSystem == this && tWorkerIndex >= 0) {
+        std::lock_guard<std::mutex> lock(queues[tWorkerIndex]->mutex);
+        queues[tWorkerIndex]->jobs.push_back(job);
+        queuedJobs++;
+    } else {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedJobs.push_back(job);
+        queuedJobs++;
+    }
+    {
+        // taking the lock orders this against a thread that is about to sleep
+        std::lock_guard<std::mutex> lock(wakeMutex);
+    }
+    wakeCondition.notify_one();
+    if (!job->isLowPriority && waitingThreads > 0) {
+        doneCondition.notify_all();     // they can run it while they wait
+    }
+}
+
+/**
+ * Own deque from the back (most recent, still in cache), then the shared queue, then steal
+ * the oldest job of another worker. Idle workers with nothing else take the oldest low-priority
+ * job; a thread in Wait does not, since a preload could hold it long after its job is done
+ */
+MyJobHandle MyJobSystem::PopJob(int workerIndex, bool isLowPriorityAllowed) {
+
+    MyJobHandle job;
+    if (workerIndex >= 0) {
+        std::lock_guard<std::mutex> lock(queues[workerIndex]->mutex);
+        if (!queues[workerIndex]->jobs.empty()) {
+            job = queues[workerIndex]->jobs.back();
+            queues[workerIndex]->jobs.pop_back();
+        }
+    }
+    if (!job) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!sharedJobs.empty()) {
+            job = sharedJobs.front();
+            sharedJobs.pop_front();
+        }
+    }
+    for (unsigned int i = 1; !job && i <= queues.size(); ++i) {
+        WorkerQueue *victim = queues[(workerIndex + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        if (!victim->jobs.empty()) {
+            job = victim->jobs.front();
+            victim->jobs.pop_front();
+            if (workerIndex >= 0) {
+                queues[workerIndex]->jobsStolen++;
+            }
+        }
+    }
+    if (!job && isLowPriorityAllowed) {
+        std::lock_guard<std::mutex> lock(lowPriorityMutex);
+        if (!lowPriorityJobs.empty()) {
+            job = lowPriorityJobs.front();
+            lowPriorityJobs.pop_front();
+        }
+    }
+    if (job && job->isLowPriority) {
+        queuedLowPriorityJobs--;
+    } else if (job) {
+        queuedJobs--;
+    }
+    return job;
+}
+
+void MyJobSystem::Execute(const MyJobHandle &job, int workerIndex) {
+
+    Clock::time_point start = Clock::now();
+    job->function();
+    job->function = nullptr; // drop the captures now, handles may outlive the job for long
+    if (workerIndex >= 0) {
+        queues[workerIndex]->busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start).count();
+        queues[workerIndex]->jobsRun++;
+    }
+    Finish(job);
+}
+
+/**
+ * Mark the job done and release the jobs that were waiting on it
+ */
+void MyJobSystem::Finish(const MyJobHandle &job) {
+
+    std::vector<MyJobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->isDone = true;
+        dependents.swap(job->dependents);
+    }
+    // isDone is set before waitingThreads is read and a waiter counts itself before it reads
+    // isDone, so either it sees the job done or this sees it waiting
+    if (waitingThreads > 0) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        doneCondition.notify_all();
+    }
+    for (unsigned int i = 0; i < dependents.size(); ++i) {
+        if (--dependents[i]->remainingDependencies == 0) {
+            Enqueue(dependents[i]);
+        }
+    }
+}
+
+bool MyJobSystem::TryRunOneJob(bool isLowPriorityAllowed) {
+
+    int workerIndex = tCurrentJobSystem == this ? tWorkerIndex : -1;
+    MyJobHandle job = PopJob(workerIndex, isLowPriorityAllowed);
+    if (!job) {
+        return false;
+    }
+    Execute(job, workerIndex);
+    return true;
+}
+
+void MyJobSystem::WorkerLoop(int workerIndex) {
+
+    tCurrentJobSystem = this;
+    tWorkerIndex = workerIndex;
+    while (true) {
+        if (TryRunOneJob(true)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.wait(lock, [this]() {
+            return isStopping || queuedJobs > 0 || queuedLowPriorityJobs > 0;
+        });
+        if (isStopping && queuedJobs == 0 && queuedLowPriorityJobs == 0) {
+            break;
+        }
+    }
+}
+
+/**
+ * Run other jobs until this one is done, and sleep while there are none to run. Finish wakes
+ * the thread when the job is done and Enqueue when there is a job to help with
+ */
+void MyJobSystem::Wait(const MyJobHandle &job) {
+
+    while (job && !job->isDone) {
+        if (TryRunOneJob(false)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        waitingThreads++;
+        doneCondition.wait(lock, [this, &job]() { return job->isDone || queuedJobs > 0; });
+        waitingThreads--;
+    }
+}
+
+/**
+ * Cancel does not wake the waiting thread, so it checks the token every millisecond
+ */
+bool MyJobSystem::Wait(const MyJobHandle &job, const MyCancelToken *cancelToken) {
+
+    while (job && !job->isDone && !IsCancelled(cancelToken)) {
+        if (TryRunOneJob(false)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        waitingThreads++;
+        doneCondition.wait_for(lock, std::chrono::milliseconds(1),
+                               [this, &job]() { return job->isDone || queuedJobs > 0; });
+        waitingThreads--;
+    }
+    return IsDone(job);
+}
+
+bool MyJobSystem::IsDone(const MyJobHandle &job) const {
+    return !job || job->isDone;
+}
+
+/**
+ * Chunks are handed out from a shared counter, so the helpers that start late just find
+ * nothing left to do. The caller works too and then waits for the helpers
+ */
+void MyJobSystem::ParallelFor(unsigned int count, unsigned int grainSize,
+                              const MyRangeFunction &function, unsigned int maxThreads) {
+
+    grainSize = std::max(1u, grainSize);
+    unsigned int numberOfChunks = (count + grainSize - 1) / grainSize;
+    unsigned int numberOfThreads = std::min<unsigned int>(numberOfChunks, workers.size() + 1);
+    if (maxThreads > 0) {
+        numberOfThreads = std::min(numberOfThreads, maxThreads);
+    }
+    if (numberOfThreads <= 1) {
+        function(0, count);
+        return;
+    }
+
+    std::atomic<unsigned int> nextChunk(0);
+    auto runChunks = [&]() {
+        for (unsigned int chunk = nextChunk++; chunk < numberOfChunks; chunk = nextChunk++) {
+            unsigned int begin = chunk * grainSize;
+            function(begin, std::min(count, begin + grainSize));
+        }
+    };
+    std::vector<MyJobHandle> helpers;
+    for (unsigned int i = 1; i < numberOfThreads; ++i) {
+        helpers.push_back(Submit(runChunks));
+    }
+    runChunks();
+    for (unsigned int i = 0; i < helpers.size(); ++i) {
+        Wait(helpers[i]);
+    }
+}
+
+void MyJobSystem::RunGLThreadJobs() {
+
+    {
+        std::lock_guard<std::mutex> lock(glThreadMutex);
+        if (glThreadJobs.empty()) {
+            return;
+        }
+        glThreadRunning.swap(glThreadJobs);
+    }
+    for (unsigned int i = 0; i < glThreadRunning.size(); ++i) {
+        Execute(glThreadRunning[i], -1);
+    }
+    glThreadRunning.clear();
+}
+
+std::vector<MyJobWorkerStats> MyJobSystem::GetWorkerStats() const {
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - statsStart).count();
+    std::vector<MyJobWorkerStats> workerStats(queues.size());
+    for (unsigned int i = 0; i < queues.size(); ++i) {
+        workerStats[i].jobsRun = queues[i]->jobsRun;
+        workerStats[i].jobsStolen = queues[i]->jobsStolen;
+        workerStats[i].busyMs = queues[i]->busyNs / 1e6;
+        workerStats[i].utilization = elapsedMs > 0 ? workerStats[i].busyMs / elapsedMs : 0;
+    }
+    return workerStats;
+}
+
+void MyJobSystem::ResetStats() {
+    for (unsigned int i = 0; i < queues.size(); ++i) {
+        queues[i]->jobsRun = 0;
+        queues[i]->jobsStolen = 0;
+        queues[i]->busyNs = 0;
+    }
+    statsStart = Clock::now();
+}
+
+MyJobSystem & GetJobSystem() {
+    static MyJobSystem jobSystem;
+    return jobSystem;
+}
@@ -0,0 +1,135 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Small work-stealing scheduler. Every worker owns a deque: it pushes and pops at the back,
+// idle workers steal from the front of the others. Jobs submitted from outside the pool go to
+// a shared queue. A job starts once all of its dependencies have finished; jobs marked for the
+// GL thread are held until the GL thread calls RunGLThreadJobs, which ModelAssimp::Render does
+// once per frame. Threads that Wait or run a ParallelFor execute pool jobs meanwhile, so
+// nested ParallelFor calls from inside jobs cannot deadlock, and sleep when there is none.
+// Low-priority jobs wait in a queue of their own that only workers take from, and only when
+// there is nothing else to run; a thread waiting for something else never picks one up.
+// Do not Wait for a GL thread job on the GL thread, poll IsDone from Render instead
+
+#ifndef MY_JOB_SYSTEM_H
+#define MY_JOB_SYSTEM_H
+
+#include "myCancelToken.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> MyJobFunction;
+typedef std::function<void(unsigned int begin, unsigned int end)> MyRangeFunction;
+
+struct MyJob;
+typedef std::shared_ptr<MyJob> MyJobHandle;
+
+// counters of one worker since the last ResetStats
+struct MyJobWorkerStats {
+    unsigned long   jobsRun;
+    unsigned long   jobsStolen;     // taken from another worker's deque
+    double          busyMs;         // time spent inside jobs
+    double          utilization;    // busyMs over the time since ResetStats
+};
+
+class MyJobSystem {
+public:
+    MyJobSystem(unsigned int numberOfWorkers = GetDefaultNumberOfWorkers());
+    ~MyJobSystem();
+
+    MyJobHandle Submit(MyJobFunction function);
+    MyJobHandle Submit(MyJobFunction function, const std::vector<MyJobHandle> &dependencies);
+    MyJobHandle SubmitToGLThread(MyJobFunction function,
+                                 const std::vector<MyJobHandle> &dependencies =
+                                 std::vector<MyJobHandle>());
+    // background work such as preloading, which must not delay the jobs of a frame
+    MyJobHandle SubmitLowPriority(MyJobFunction function,
+                                  const std::vector<MyJobHandle> &dependencies =
+                                  std::vector<MyJobHandle>());
+
+    void    Wait(const MyJobHandle &job);
+    // gives up once the token is cancelled, the job goes on; false if the job is not done
+    bool    Wait(const MyJobHandle &job, const MyCancelToken *cancelToken);
+    bool    IsDone(const MyJobHandle &job) const;
+
+    // run function over [0, count) in chunks of grainSize, on at most maxThreads threads
+    // including the caller (0 for no limit); returns when every chunk is done
+    void    ParallelFor(unsigned int count, unsigned int grainSize, const MyRangeFunction &function,
+                        unsigned int maxThreads = 0);
+
+    // GL thread only: run the jobs waiting for it, does not allocate when there are none
+    void    RunGLThreadJobs();
+
+    unsigned int    GetNumberOfWorkers() const { return workers.size(); }
+    std::vector<MyJobWorkerStats> GetWorkerStats() const;
+    void    ResetStats();
+
+    static unsigned int GetDefaultNumberOfWorkers();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct WorkerQueue {
+        std::mutex                  mutex;
+        std::deque<MyJobHandle>     jobs;
+        std::atomic<unsigned long>  jobsRun;
+        std::atomic<unsigned long>  jobsStolen;
+        std::atomic<unsigned long long> busyNs;
+
+        WorkerQueue() : jobsRun(0), jobsStolen(0), busyNs(0) {}
+    };
+
+    MyJobHandle CreateJob(MyJobFunction function, bool isGLThreadJob, bool isLowPriority,
+                          const std::vector<MyJobHandle> &dependencies);
+    void    Enqueue(const MyJobHandle &job);
+    // low-priority jobs are left to the worker loop, so that Wait never runs one inline
+    bool    TryRunOneJob(bool isLowPriorityAllowed);
+    MyJobHandle PopJob(int workerIndex, bool isLowPriorityAllowed);
+    void    Execute(const MyJobHandle &job, int workerIndex);
+    void    Finish(const MyJobHandle &job);
+    void    WorkerLoop(int workerIndex);
+
+    std::vector<std::thread>    workers;
+    std::vector<WorkerQueue *>  queues;             // one per worker
+    std::mutex                  sharedMutex;
+    std::deque<MyJobHandle>     sharedJobs;         // submitted from outside the pool
+    std::mutex                  lowPriorityMutex;
+    std::deque<MyJobHandle>     lowPriorityJobs;
+    std::mutex                  glThreadMutex;
+    std::vector<MyJobHandle>    glThreadJobs;
+    std::vector<MyJobHandle>    glThreadRunning;    // swapped with glThreadJobs every frame
+
+    std::mutex                  wakeMutex;
+    std::condition_variable     wakeCondition;      // idle workers sleep on it
+    std::condition_variable     doneCondition;      // threads in Wait sleep on it
+    std::atomic<int>            queuedJobs;         // in the queues other than lowPriorityJobs
+    std::atomic<int>            queuedLowPriorityJobs;
+    std::atomic<int>            waitingThreads;     // in Wait with nothing to run
+    bool                        isStopping;
+    Clock::time_point           statsStart;
+};
+
+// pool shared by the native layer, created on first use
+MyJobSystem & GetJobSystem();
+
+#endif //MY_JOB_SYSTEM_H
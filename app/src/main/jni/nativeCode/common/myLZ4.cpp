@@ -0,0 +1,233 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myLZ4.h"
+#include <string.h>
+#include <vector>
+
+#define LZ4_MIN_MATCH       4
+#define LZ4_LAST_LITERALS   5       // the block always ends with this many literals
+#define LZ4_MATCH_LIMIT     12      // no match starts this close to the end
+#define LZ4_MAX_OFFSET      65535
+#define LZ4_HASH_LOG        16
+#define LZ4_WILD_COPY       16      // copies may write this far past their end when there is room
+
+static inline uint32_t Read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t HashSequence(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/**
+ * Copies in fixed 16-byte steps, up to LZ4_WILD_COPY - 1 bytes past dst + size. src may overlap
+ * dst if it starts at least 16 bytes before it
+ */
+static inline void CopyWild(uint8_t *dst, const uint8_t *src, size_t size) {
+    for (size_t copied = 0; copied < size; copied += LZ4_WILD_COPY) {
+        memcpy(dst + copied, src + copied, LZ4_WILD_COPY);
+    }
+}
+
+/**
+ * Lengths of 15 and more continue in bytes of 255 and a last byte below 255
+ */
+static inline bool WriteLength(size_t length, uint8_t *&op, const uint8_t *opEnd) {
+    for (; length >= 255; length -= 255) {
+        if (op >= opEnd) {
+            return false;
+        }
+        *op++ = 255;
+    }
+    if (op >= opEnd) {
+        return false;
+    }
+    *op++ = (uint8_t) length;
+    return true;
+}
+
+static bool WriteSequence(const uint8_t *literals, size_t literalLength, size_t offset,
+                          size_t matchLength, uint8_t *&op, const uint8_t *opEnd) {
+
+    if (op >= opEnd) {
+        return false;
+    }
+    uint8_t *token = op++;
+    *token = (uint8_t) ((literalLength < 15 ? literalLength : 15) << 4);
+    if (literalLength >= 15 && !WriteLength(literalLength - 15, op, opEnd)) {
+        return false;
+    }
+    if ((size_t) (opEnd - op) < literalLength) {
+        return false;
+    }
+    if (literalLength) {
+        memcpy(op, literals, literalLength);
+        op += literalLength;
+    }
+    if (matchLength == 0) {
+        return true;    // the last literals have no match
+    }
+
+    if (opEnd - op < 2) {
+        return false;
+    }
+    *op++ = (uint8_t) offset;
+    *op++ = (uint8_t) (offset >> 8);
+    size_t matchCode = matchLength - LZ4_MIN_MATCH;
+    *token |= (uint8_t) (matchCode < 15 ? matchCode : 15);
+    return matchCode < 15 || WriteLength(matchCode - 15, op, opEnd);
+}
+
+/**
+ * Greedy: each position is looked up in a table of the last position with the same 4 bytes,
+ * and the step between lookups grows while nothing matches, like the reference's fast mode
+ */
+size_t LZ4Compress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity) {
+
+    uint8_t *op = dst;
+    const uint8_t *opEnd = dst + dstCapacity;
+    size_t anchor = 0;
+
+    if (srcSize > LZ4_MATCH_LIMIT) {
+        std::vector<uint32_t> table((size_t) 1 << LZ4_HASH_LOG, 0);
+        size_t matchStartLimit = srcSize - LZ4_MATCH_LIMIT;
+        size_t matchEndLimit = srcSize - LZ4_LAST_LITERALS;
+        size_t ip = 1;
+        table[HashSequence(Read32(src))] = 0;
+
+        while (ip < matchStartLimit) {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t hash = HashSequence(sequence);
+            size_t ref = table[hash];
+            table[hash] = (uint32_t) ip;
+            if (ip - ref > LZ4_MAX_OFFSET || Read32(src + ref) != sequence) {
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+            }
+            size_t matchLength = LZ4_MIN_MATCH;
+            while (ip + matchLength < matchEndLimit && src[ref + matchLength] == src[ip + matchLength]) {
+                matchLength++;
+            }
+            if (!WriteSequence(src + anchor, ip - anchor, ip - ref, matchLength, op, opEnd)) {
+                return 0;
+            }
+            ip += matchLength;
+            anchor = ip;
+            if (ip < matchStartLimit) {
+                table[HashSequence(Read32(src + ip - 2))] = (uint32_t) (ip - 2);
+            }
+        }
+    }
+
+    if (!WriteSequence(src + anchor, srcSize - anchor, 0, 0, op, opEnd)) {
+        return 0;
+    }
+    return op - dst;
+}
+
+bool LZ4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize) {
+
+    const uint8_t *ip = src;
+    const uint8_t *ipEnd = src + srcSize;
+    uint8_t *op = dst;
+    uint8_t *opEnd = dst + dstSize;
+
+    while (ip < ipEnd) {
+        unsigned int token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            unsigned int byte;
+            do {
+                if (ip >= ipEnd) {
+                    return false;
+                }
+                byte = *ip++;
+                literalLength += byte;
+            } while (byte == 255);
+        }
+        if ((size_t) (ipEnd - ip) < literalLength || (size_t) (opEnd - op) < literalLength) {
+            return false;
+        }
+        if ((size_t) (ipEnd - ip) - literalLength >= LZ4_WILD_COPY &&
+            (size_t) (opEnd - op) - literalLength >= LZ4_WILD_COPY) {
+            CopyWild(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+        } else if (literalLength) {
+            memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+        }
+        if (ip == ipEnd) {
+            break;      // the last sequence is literals only
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t) (op - dst)) {
+            return false;
+        }
+        size_t matchLength = (token & 15) + LZ4_MIN_MATCH;
+        if ((token & 15) == 15) {
+            unsigned int byte;
+            do {
+                if (ip >= ipEnd) {
+                    return false;
+                }
+                byte = *ip++;
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        if ((size_t) (opEnd - op) < matchLength) {
+            return false;
+        }
+
+        // a match may overlap its own output when the offset is shorter than the match
+        const uint8_t *match = op - offset;
+        if (offset >= LZ4_WILD_COPY && (size_t) (opEnd - op) - matchLength >= LZ4_WILD_COPY) {
+            CopyWild(op, match, matchLength);
+            op += matchLength;
+        } else if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+            op += matchLength;
+        } else if (offset >= 8) {
+            for (size_t copied = 0; copied < matchLength; copied += 8) {
+                size_t chunk = matchLength - copied < 8 ? matchLength - copied : 8;
+                memcpy(op + copied, match + copied, chunk);
+            }
+            op += matchLength;
+        } else {
+            for (size_t i = 0; i < matchLength; ++i) {
+                op[i] = match[i];
+            }
+            op += matchLength;
+        }
+    }
+    return op == opEnd;
+}
@@ -0,0 +1,37 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// LZ4 block format (no frame header): a compressor for the host tools and a bounds-checked
+// decompressor for the app. Both follow the reference format, so blocks written by the lz4
+// library decode here and the other way around
+
+#ifndef MY_LZ4_H
+#define MY_LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// largest block LZ4Compress can write for size bytes
+inline size_t LZ4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+// size of the block written to dst, 0 if it does not fit in dstCapacity
+size_t LZ4Compress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstCapacity);
+
+// false if the block is malformed or does not decode to exactly dstSize bytes
+bool LZ4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize);
+
+#endif //MY_LZ4_H
@@ -0,0 +1,110 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myLightingScaler.h"
+#include "myLogger.h"
+#include <algorithm>
+
+MyLightingScaler::MyLightingScaler() {
+    tier = LIGHTING_PER_PIXEL;
+    isAutomatic = true;
+    skipNextFrame = false;
+    lastStepWasUp = false;
+    targetFrameMs = LIGHTING_TARGET_FRAME_MS;
+    windowMs = 0;
+    windowFrames = 0;
+    framesAtTier = 0;
+    probeFrames = LIGHTING_PROBE_FRAMES;
+    meanFrameMs = 0;
+    frames = stepsDown = stepsUp = 0;
+}
+
+void MyLightingScaler::SetAutomatic(bool isAutomatic) {
+    this->isAutomatic = isAutomatic;
+    windowMs = 0;
+    windowFrames = 0;
+    framesAtTier = 0;
+    probeFrames = LIGHTING_PROBE_FRAMES;
+}
+
+void MyLightingScaler::SetTier(LightingTier lightingTier) {
+    tier = lightingTier;
+    windowMs = 0;
+    windowFrames = 0;
+    framesAtTier = 0;
+}
+
+/**
+ * Steps down when a window runs 25% over the target, so that missing a vsync now and then does
+ * not count; steps up only from a window within 10% of it
+ */
+LightingTier MyLightingScaler::AddFrameTime(double frameMs) {
+
+    if (skipNextFrame) {
+        skipNextFrame = false;
+        return tier;
+    }
+    frames++;
+    if (!isAutomatic) {
+        return tier;
+    }
+    windowMs += frameMs;
+    windowFrames++;
+    framesAtTier++;
+    if (windowFrames < LIGHTING_WINDOW_FRAMES) {
+        return tier;
+    }
+    meanFrameMs = windowMs / windowFrames;
+    windowMs = 0;
+    windowFrames = 0;
+
+    if (meanFrameMs > targetFrameMs * 1.25 && tier > LIGHTING_UNLIT) {
+        // the last probe did not hold, wait longer before the next one
+        if (lastStepWasUp && framesAtTier <= probeFrames) {
+            probeFrames = std::min(probeFrames * 2, (unsigned int) LIGHTING_MAX_PROBE_FRAMES);
+        }
+        ChangeTier(-1);
+    } else if (meanFrameMs <= targetFrameMs * 1.1 && tier < LIGHTING_TIER_COUNT - 1 &&
+               framesAtTier >= probeFrames) {
+        ChangeTier(1);
+    }
+    return tier;
+}
+
+void MyLightingScaler::ChangeTier(int step) {
+
+    tier = (LightingTier) (tier + step);
+    MyLOGI("Lighting %s at %.2f ms per frame", GetLightingTierName(tier), meanFrameMs);
+    if (step > 0) {
+        stepsUp++;
+    } else {
+        stepsDown++;
+    }
+    lastStepWasUp = step > 0;
+    framesAtTier = 0;
+}
+
+LightingScalerStats MyLightingScaler::GetStats() const {
+
+    LightingScalerStats stats;
+    stats.frames = frames;
+    stats.stepsDown = stepsDown;
+    stats.stepsUp = stepsUp;
+    stats.meanFrameMs = meanFrameMs;
+    stats.tier = tier;
+    return stats;
+}
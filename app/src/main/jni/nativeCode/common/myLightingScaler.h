@@ -0,0 +1,76 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Picks the lighting tier the models are drawn with from the time between frames. The mean
+// of every LIGHTING_WINDOW_FRAMES frames is compared with the target: well over it steps down
+// a tier, at or under it for long enough probes the tier above. A probe that has to step down
+// again soon doubles the wait before the next one, so a device that cannot hold the higher
+// tier does not flip between the two.
+// GL thread only
+
+#ifndef MY_LIGHTING_SCALER_H
+#define MY_LIGHTING_SCALER_H
+
+#include "myShaderVariants.h"
+
+#define LIGHTING_WINDOW_FRAMES      30      // frames averaged for a decision
+#define LIGHTING_PROBE_FRAMES       300     // frames at a tier before probing the one above
+#define LIGHTING_MAX_PROBE_FRAMES   4800
+#define LIGHTING_TARGET_FRAME_MS    (1000. / 60.)
+
+struct LightingScalerStats {
+    unsigned long   frames;             // frame times counted
+    unsigned long   stepsDown;
+    unsigned long   stepsUp;
+    double          meanFrameMs;        // of the last full window
+    LightingTier    tier;
+};
+
+class MyLightingScaler {
+public:
+    MyLightingScaler();
+
+    void            SetTargetFrameMs(double targetFrameMs) { this->targetFrameMs = targetFrameMs; }
+    // a manual tier stays until automatic scaling is turned back on
+    void            SetAutomatic(bool isAutomatic);
+    bool            IsAutomatic() const { return isAutomatic; }
+    void            SetTier(LightingTier lightingTier);
+    // the next frame time is not the tier's doing, like a frame that loaded a model
+    void            SkipNextFrame() { skipNextFrame = true; }
+    // from Render with the time since the previous frame; the tier to draw this frame with
+    LightingTier    AddFrameTime(double frameMs);
+    LightingTier    GetTier() const { return tier; }
+
+    LightingScalerStats GetStats() const;
+
+private:
+    void            ChangeTier(int step);
+
+    LightingTier    tier;
+    bool            isAutomatic;
+    bool            skipNextFrame;
+    bool            lastStepWasUp;
+    double          targetFrameMs;
+    double          windowMs;           // sum of the frame times in the window so far
+    unsigned int    windowFrames;
+    unsigned int    framesAtTier;       // since the last change of tier
+    unsigned int    probeFrames;        // framesAtTier needed before stepping up
+    double          meanFrameMs;
+    unsigned long   frames, stepsDown, stepsUp;
+};
+
+#endif //MY_LIGHTING_SCALER_H
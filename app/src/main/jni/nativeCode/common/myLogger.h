@@ -17,15 +17,42 @@
 #ifndef My_LOGGER_H
 #define My_LOGGER_H
 
+#define LOG_TAG "AssimpAndroid"
+
+#ifdef __ANDROID__
+
 #include <android/log.h>
 
-#define LOG_TAG "AssimpAndroid"
 #define  MyLOGD(...)  __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 #define  MyLOGE(...)  __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define  MyLOGV(...)  __android_log_print(ANDROID_LOG_VERBOSE, LOG_TAG,__VA_ARGS__)
 #define  MyLOGI(...)  __android_log_print(ANDROID_LOG_INFO   , LOG_TAG,__VA_ARGS__)
 #define  MyLOGW(...)  __android_log_print(ANDROID_LOG_WARN   , LOG_TAG,__VA_ARGS__)
 #define  MyLOGF(...)  __android_log_print(ANDROID_LOG_FATAL   , LOG_TAG,__VA_ARGS__)
+
+#else
+
+// host build: print to stderr, debug/verbose/info only if MY_HOST_LOG_VERBOSE is defined
+#include <stdio.h>
+
+#define  MyHOSTLOG(level, ...) \
+    do { fprintf(stderr, level "/" LOG_TAG ": " __VA_ARGS__); fputc('\n', stderr); } while (0)
+
+#ifdef MY_HOST_LOG_VERBOSE
+#define  MyLOGD(...)  MyHOSTLOG("D", __VA_ARGS__)
+#define  MyLOGV(...)  MyHOSTLOG("V", __VA_ARGS__)
+#define  MyLOGI(...)  MyHOSTLOG("I", __VA_ARGS__)
+#else
+#define  MyLOGD(...)  do { if (0) fprintf(stderr, __VA_ARGS__); } while (0)
+#define  MyLOGV(...)  do { if (0) fprintf(stderr, __VA_ARGS__); } while (0)
+#define  MyLOGI(...)  do { if (0) fprintf(stderr, __VA_ARGS__); } while (0)
+#endif
+#define  MyLOGE(...)  MyHOSTLOG("E", __VA_ARGS__)
+#define  MyLOGW(...)  MyHOSTLOG("W", __VA_ARGS__)
+#define  MyLOGF(...)  MyHOSTLOG("F", __VA_ARGS__)
+
+#endif
+
 #define  MyLOGSIMPLE(...)
 
 #endif //My_LOGGER_H
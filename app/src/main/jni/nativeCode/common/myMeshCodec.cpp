@@ -0,0 +1,797 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+#include "myMeshCodec.h"
+#include "myLogger.h"
+#include "myLZ4.h"
+#include <math.h>
+#include <string.h>
+#include <string>
+
+#define MESH_CODEC_MAX_DEPTH    256     // of the node hierarchy
+#define MESH_CODEC_MAX_RATIO    255     // LZ4 cannot expand more than this
+
+// positions, UVs, colors, normals and tangents take this many plane bytes per vertex
+static const unsigned int gPositionBytes = 6;
+static const unsigned int gUVBytes = 4;
+static const unsigned int gWideUVBytes = 8;
+static const unsigned int gColorBytes = 4;
+static const unsigned int gVectorBytes = 4;
+static const unsigned int gTangentSignBytes = 1;
+
+static void Append(std::vector<uint8_t> &out, const void *data, size_t size) {
+    out.insert(out.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+}
+
+static void AppendUint32(std::vector<uint8_t> &out, uint32_t value) {
+    Append(out, &value, sizeof(value));
+}
+
+static void AppendString(std::vector<uint8_t> &out, const char *text, size_t length) {
+    AppendUint32(out, length);
+    Append(out, text, length);
+}
+
+// bounds-checked reads of the scene block, a failed read fails every later one too
+class MeshCodecReader {
+public:
+    MeshCodecReader(const uint8_t *data, size_t size) : data(data), end(data + size) {}
+
+    bool    Read(void *value, size_t size) {
+        if (!data || (size_t) (end - data) < size) {
+            data = NULL;
+            return false;
+        }
+        memcpy(value, data, size);
+        data += size;
+        return true;
+    }
+    uint32_t ReadUint32() {
+        uint32_t value = 0;
+        Read(&value, sizeof(value));
+        return value;
+    }
+    bool    ReadString(aiString &text) {
+        uint32_t length = ReadUint32();
+        if (!data || length >= MAXLEN || (size_t) (end - data) < length) {
+            data = NULL;
+            return false;
+        }
+        memcpy(text.data, data, length);
+        text.data[length] = '\0';
+        text.length = length;
+        data += length;
+        return true;
+    }
+    bool    IsValid() const { return data != NULL; }
+    bool    IsAtEnd() const { return data == end; }
+
+private:
+    const uint8_t * data;       // NULL after a failed read
+    const uint8_t * end;
+};
+
+/**
+ * Stored as it is if LZ4 does not make it smaller
+ */
+static void AppendBlock(std::vector<uint8_t> &out, const std::vector<uint8_t> &raw) {
+
+    std::vector<uint8_t> compressed(LZ4CompressBound(raw.size()));
+    size_t compressedSize = LZ4Compress(raw.data(), raw.size(), compressed.data(),
+                                        compressed.size());
+    MeshCodecBlock block;
+    block.size = raw.size();
+    block.storedSize = compressedSize && compressedSize < raw.size() ? compressedSize : raw.size();
+    Append(out, &block, sizeof(block));
+    Append(out, block.storedSize < raw.size() ? compressed.data() : raw.data(), block.storedSize);
+}
+
+/**
+ * The block's bytes, decompressed into the arena if they are compressed. NULL if the block
+ * does not fit in the data or does not decompress to its size
+ */
+static const uint8_t * ReadBlock(const uint8_t *&data, const uint8_t *end, MyArena &arena,
+                                 size_t &size) {
+
+    MeshCodecBlock block;
+    if ((size_t) (end - data) < sizeof(block)) {
+        return NULL;
+    }
+    memcpy(&block, data, sizeof(block));
+    data += sizeof(block);
+    if ((size_t) (end - data) < block.storedSize || block.storedSize > block.size ||
+        block.size > (uint64_t) block.storedSize * MESH_CODEC_MAX_RATIO + 16) {
+        return NULL;
+    }
+    const uint8_t *stored = data;
+    data += block.storedSize;
+    size = block.size;
+    if (block.storedSize == block.size) {
+        return stored;
+    }
+    uint8_t *decompressed = arena.AllocateArray<uint8_t>(block.size);
+    return LZ4Decompress(stored, block.storedSize, decompressed, block.size) ? decompressed : NULL;
+}
+
+static inline uint32_t Quantize(float value, float minimum, float scale, uint32_t maximum) {
+    double steps = scale > 0 ? (value - (double) minimum) / scale + 0.5 : 0;
+    return steps > 0 ? (steps < maximum ? (uint32_t) steps : maximum) : 0;
+}
+
+/**
+ * Component c of vertex v is values[v * components + c]. Every component becomes a plane per
+ * byte of its zigzagged differences to the vertex before, low bytes first
+ */
+template <typename T>
+static void AppendDeltaPlanes(std::vector<uint8_t> &out, const T *values, unsigned int count,
+                              unsigned int components) {
+
+    for (unsigned int c = 0; c < components; ++c) {
+        size_t planeStart = out.size();
+        out.resize(planeStart + sizeof(T) * count);
+        uint8_t *planes = &out[planeStart];
+        T previous = 0;
+        for (unsigned int v = 0; v < count; ++v) {
+            T value = values[v * components + c];
+            T difference = value - previous;
+            T delta = (T) (difference << 1) ^ (T) (0 - (difference >> (8 * sizeof(T) - 1)));
+            for (unsigned int b = 0; b < sizeof(T); ++b) {
+                planes[b * (size_t) count + v] = (uint8_t) (delta >> (8 * b));
+            }
+            previous = value;
+        }
+    }
+}
+
+/**
+ * The first components of the vectors from the planes of AppendQuantizedPlanes<T>, undoing the
+ * deltas and the quantization in one pass
+ */
+template <typename T>
+static void DecodeQuantizedPlanes(const uint8_t *planes, unsigned int count,
+                                  unsigned int components, const float *minimum,
+                                  const float *scale, aiVector3D *vectors) {
+
+    for (unsigned int c = 0; c < components; ++c) {
+        const uint8_t *bytes = planes + sizeof(T) * (size_t) c * count;
+        float componentMinimum = minimum[c], componentScale = scale[c];
+        T value = 0;
+        for (unsigned int v = 0; v < count; ++v) {
+            T delta = bytes[v];
+            for (unsigned int b = 1; b < sizeof(T); ++b) {
+                delta |= (T) bytes[b * (size_t) count + v] << (8 * b);
+            }
+            value += (T) ((delta >> 1) ^ (0 - (delta & 1)));
+            vectors[v][c] = componentMinimum + (float) value * componentScale;
+        }
+    }
+}
+
+static void DecodeDeltaPlanes16(const uint8_t *planes, unsigned int count,
+                                unsigned int components, uint16_t *values) {
+
+    for (unsigned int c = 0; c < components; ++c) {
+        const uint8_t *lowBytes = planes + 2 * (size_t) c * count;
+        const uint8_t *highBytes = lowBytes + count;
+        uint16_t value = 0;
+        for (unsigned int v = 0; v < count; ++v) {
+            unsigned int delta = lowBytes[v] | (highBytes[v] << 8);
+            value += (uint16_t) ((delta >> 1) ^ (0u - (delta & 1)));
+            values[v * components + c] = value;
+        }
+    }
+}
+
+/**
+ * Unit vector folded onto the octahedron and unfolded into the square, as two snorm16
+ */
+static void EncodeOctahedral(const aiVector3D &vector, uint16_t *encoded) {
+
+    float length = fabsf(vector.x) + fabsf(vector.y) + fabsf(vector.z);
+    float x = 0, y = 0;
+    if (length > 0) {       // false for NaNs too
+        x = vector.x / length;
+        y = vector.y / length;
+    }
+    if (vector.z < 0) {
+        float foldedX = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+        y = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+        x = foldedX;
+    }
+    encoded[0] = (uint16_t) (int16_t) lrintf(x * 32767);
+    encoded[1] = (uint16_t) (int16_t) lrintf(y * 32767);
+}
+
+static inline aiVector3D DecodeOctahedral(const uint16_t *encoded) {
+
+    float x = (int16_t) encoded[0] * (1.f / 32767);
+    float y = (int16_t) encoded[1] * (1.f / 32767);
+    float z = 1 - fabsf(x) - fabsf(y);
+    if (z < 0) {
+        float unfoldedX = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+        y = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+        x = unfoldedX;
+    }
+    float inverseLength = 1 / sqrtf(x * x + y * y + z * z);
+    return aiVector3D(x * inverseLength, y * inverseLength, z * inverseLength);
+}
+
+static void AppendOctahedralPlanes(std::vector<uint8_t> &out, const aiVector3D *vectors,
+                                   const std::vector<unsigned int> &oldIndices) {
+
+    std::vector<uint16_t> encoded(2 * oldIndices.size());
+    for (unsigned int v = 0; v < oldIndices.size(); ++v) {
+        EncodeOctahedral(vectors[oldIndices[v]], &encoded[2 * v]);
+    }
+    AppendDeltaPlanes(out, encoded.data(), oldIndices.size(), 2);
+}
+
+/**
+ * Bounds of the first components of the vectors; returns the largest range
+ */
+static float GetBounds(const aiVector3D *vectors, const std::vector<unsigned int> &oldIndices,
+                       unsigned int components, float *minimum, float *range) {
+
+    float largestRange = 0;
+    for (unsigned int c = 0; c < components; ++c) {
+        float low = 0, high = 0;
+        for (unsigned int v = 0; v < oldIndices.size(); ++v) {
+            float value = vectors[oldIndices[v]][c];
+            low = v == 0 || value < low ? value : low;
+            high = v == 0 || value > high ? value : high;
+        }
+        minimum[c] = low;
+        range[c] = high - low;
+        largestRange = range[c] > largestRange ? range[c] : largestRange;
+    }
+    return largestRange;
+}
+
+/**
+ * Bounds of the positions of all the meshes, so that every mesh is quantized to the same grid
+ */
+static void GetSceneBounds(const aiScene *scene, float *minimum, float *range) {
+
+    bool isEmpty = true;
+    float high[3] = {0, 0, 0};
+    for (unsigned int c = 0; c < 3; ++c) {
+        minimum[c] = 0;
+    }
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+        const aiMesh *mesh = scene->mMeshes[n];
+        for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+            for (unsigned int c = 0; c < 3; ++c) {
+                float value = mesh->mVertices[v][c];
+                minimum[c] = isEmpty || value < minimum[c] ? value : minimum[c];
+                high[c] = isEmpty || value > high[c] ? value : high[c];
+            }
+            isEmpty = false;
+        }
+    }
+    for (unsigned int c = 0; c < 3; ++c) {
+        range[c] = high[c] - minimum[c];
+    }
+}
+
+/**
+ * The bounds become the quantization step of T's width, 16 or 24 bits
+ */
+template <typename T>
+static void AppendQuantizedPlanes(std::vector<uint8_t> &out, const aiVector3D *vectors,
+                                  const std::vector<unsigned int> &oldIndices,
+                                  unsigned int components, const float *minimum, float *scale) {
+
+    uint32_t maximum = sizeof(T) == 2 ? 65535 : 16777215;
+    for (unsigned int c = 0; c < components; ++c) {
+        scale[c] /= maximum;
+    }
+    std::vector<T> quantized(components * oldIndices.size());
+    for (unsigned int v = 0; v < oldIndices.size(); ++v) {
+        for (unsigned int c = 0; c < components; ++c) {
+            quantized[v * components + c] = (T) Quantize(vectors[oldIndices[v]][c], minimum[c],
+                                                         scale[c], maximum);
+        }
+    }
+    AppendDeltaPlanes(out, quantized.data(), oldIndices.size(), components);
+}
+
+/**
+ * 1 for a vertex whose bitangent points away from normal x tangent, e.g. on mirrored UVs
+ */
+static void AppendTangentSigns(std::vector<uint8_t> &out, const aiMesh *mesh,
+                               const std::vector<unsigned int> &oldIndices) {
+
+    for (unsigned int v = 0; v < oldIndices.size(); ++v) {
+        unsigned int oldIndex = oldIndices[v];
+        const aiVector3D &normal = mesh->mNormals[oldIndex];
+        const aiVector3D &tangent = mesh->mTangents[oldIndex];
+        out.push_back(((normal ^ tangent) * mesh->mBitangents[oldIndex]) < 0);
+    }
+}
+
+/**
+ * A new vertex is always the next one in first-use order and is written as 0, an earlier
+ * one as its distance below the next one, in 7-bit groups
+ */
+static void AppendIndices(std::vector<uint8_t> &out, const std::vector<unsigned int> &indices) {
+
+    unsigned int nextVertex = 0;
+    for (unsigned int i = 0; i < indices.size(); ++i) {
+        unsigned int distance = 0;
+        if (indices[i] == nextVertex) {
+            nextVertex++;
+        } else {
+            distance = nextVertex - indices[i];
+        }
+        while (distance >= 128) {
+            out.push_back((uint8_t) (distance | 128));
+            distance >>= 7;
+        }
+        out.push_back((uint8_t) distance);
+    }
+}
+
+/**
+ * Most indices fit in a byte, so the loop only branches for longer ones and checks all of them
+ * for vertices that are out of range once at the end
+ */
+static bool DecodeIndices(const uint8_t *data, const uint8_t *end, unsigned int vertexCount,
+                          unsigned int *indices, unsigned int indexCount) {
+
+    unsigned int nextVertex = 0;
+    bool isOutOfRange = false;
+    for (unsigned int i = 0; i < indexCount; ++i) {
+        if (data == end) {
+            return false;
+        }
+        unsigned int distance = *data++;
+        if (distance >= 128) {
+            distance &= 127;
+            for (unsigned int shift = 7; ; shift += 7) {
+                if (data == end || shift > 28) {
+                    return false;
+                }
+                unsigned int byte = *data++;
+                distance |= (byte & 127) << shift;
+                if (byte < 128) {
+                    break;
+                }
+            }
+        }
+        unsigned int index = nextVertex - distance;
+        isOutOfRange |= (distance > nextVertex) | (index >= vertexCount);
+        nextVertex += distance == 0;
+        indices[i] = index;
+    }
+    return !isOutOfRange && data == end;
+}
+
+/**
+ * Vertices are renumbered in the order the triangles first use them, which makes the deltas
+ * of cache-ordered meshes small and the new vertex of a triangle the next one; vertices no
+ * triangle uses keep their order after those. Positions are quantized over the scene's
+ * bounds, see GetSceneBounds
+ */
+static bool AppendMesh(std::vector<uint8_t> &out, const aiMesh *mesh, const float *positionMin,
+                       const float *positionRange) {
+
+    if (!mesh->HasPositions() || mesh->HasBones() || mesh->mNumAnimMeshes ||
+        (mesh->HasTangentsAndBitangents() && !mesh->HasNormals())) {
+        return false;
+    }
+    std::vector<unsigned int> newIndices(mesh->mNumVertices, UINT32_MAX);
+    std::vector<unsigned int> oldIndices;
+    std::vector<unsigned int> indices(3 * (size_t) mesh->mNumFaces);
+    oldIndices.reserve(mesh->mNumVertices);
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace &face = mesh->mFaces[f];
+        if (face.mNumIndices != 3) {
+            return false;
+        }
+        for (unsigned int k = 0; k < 3; ++k) {
+            unsigned int oldIndex = face.mIndices[k];
+            if (oldIndex >= mesh->mNumVertices) {
+                return false;
+            }
+            if (newIndices[oldIndex] == UINT32_MAX) {
+                newIndices[oldIndex] = oldIndices.size();
+                oldIndices.push_back(oldIndex);
+            }
+            indices[3 * f + k] = newIndices[oldIndex];
+        }
+    }
+    for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+        if (newIndices[v] == UINT32_MAX) {
+            oldIndices.push_back(v);
+        }
+    }
+
+    MeshCodecMesh encodedMesh;
+    memset(&encodedMesh, 0, sizeof(encodedMesh));
+    encodedMesh.vertexCount = mesh->mNumVertices;
+    encodedMesh.faceCount = mesh->mNumFaces;
+    encodedMesh.materialIndex = mesh->mMaterialIndex;
+    encodedMesh.attributes = (mesh->HasTextureCoords(0) ? MESH_CODEC_UVS : 0) |
+                             (mesh->HasVertexColors(0) ? MESH_CODEC_COLORS : 0) |
+                             (mesh->HasNormals() ? MESH_CODEC_NORMALS : 0) |
+                             (mesh->HasTangentsAndBitangents() ? MESH_CODEC_TANGENTS : 0);
+    std::vector<uint8_t> raw;
+    memcpy(encodedMesh.positionMin, positionMin, sizeof(encodedMesh.positionMin));
+    memcpy(encodedMesh.positionScale, positionRange, sizeof(encodedMesh.positionScale));
+    AppendQuantizedPlanes<uint16_t>(raw, mesh->mVertices, oldIndices, 3,
+                                    encodedMesh.positionMin, encodedMesh.positionScale);
+    if (encodedMesh.attributes & MESH_CODEC_UVS) {
+        float uvRange = GetBounds(mesh->mTextureCoords[0], oldIndices, 2, encodedMesh.uvMin,
+                                  encodedMesh.uvScale);
+        if (uvRange > MESH_CODEC_WIDE_UV_RANGE) {
+            encodedMesh.attributes |= MESH_CODEC_WIDE_UVS;
+            AppendQuantizedPlanes<uint32_t>(raw, mesh->mTextureCoords[0], oldIndices, 2,
+                                            encodedMesh.uvMin, encodedMesh.uvScale);
+        } else {
+            AppendQuantizedPlanes<uint16_t>(raw, mesh->mTextureCoords[0], oldIndices, 2,
+                                            encodedMesh.uvMin, encodedMesh.uvScale);
+        }
+    }
+    if (encodedMesh.attributes & MESH_CODEC_COLORS) {
+        for (unsigned int c = 0; c < 4; ++c) {
+            uint8_t previous = 0;
+            for (unsigned int v = 0; v < oldIndices.size(); ++v) {
+                float value = mesh->mColors[0][oldIndices[v]][c] * 255 + 0.5f;
+                uint8_t quantized = value > 0 ? (value < 255 ? (uint8_t) value : 255) : 0;
+                raw.push_back((uint8_t) (quantized - previous));
+                previous = quantized;
+            }
+        }
+    }
+    if (encodedMesh.attributes & MESH_CODEC_NORMALS) {
+        AppendOctahedralPlanes(raw, mesh->mNormals, oldIndices);
+    }
+    if (encodedMesh.attributes & MESH_CODEC_TANGENTS) {
+        AppendOctahedralPlanes(raw, mesh->mTangents, oldIndices);
+        AppendTangentSigns(raw, mesh, oldIndices);
+    }
+    AppendIndices(raw, indices);
+
+    Append(out, &encodedMesh, sizeof(encodedMesh));
+    AppendBlock(out, raw);
+    return true;
+}
+
+/**
+ * Depth-first, each node followed by its subtree
+ */
+static bool AppendNode(std::vector<uint8_t> &out, const aiNode *node, unsigned int meshCount,
+                       unsigned int depth, unsigned int &nodeCount) {
+
+    if (depth > MESH_CODEC_MAX_DEPTH) {
+        return false;
+    }
+    nodeCount++;
+    AppendString(out, node->mName.data, node->mName.length);
+    Append(out, &node->mTransformation, sizeof(node->mTransformation));
+    AppendUint32(out, node->mNumMeshes);
+    for (unsigned int m = 0; m < node->mNumMeshes; ++m) {
+        if (node->mMeshes[m] >= meshCount) {
+            return false;
+        }
+        AppendUint32(out, node->mMeshes[m]);
+    }
+    AppendUint32(out, node->mNumChildren);
+    for (unsigned int c = 0; c < node->mNumChildren; ++c) {
+        if (!AppendNode(out, node->mChildren[c], meshCount, depth + 1, nodeCount)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The diffuse color, the diffuse textures and the normal map are all the loader reads of a
+ * material, see AssimpLoader::BuildMaterialTable
+ */
+static void AppendMaterial(std::vector<uint8_t> &out, const aiMaterial *material) {
+
+    aiColor4D diffuseColor(1.f, 1.f, 1.f, 1.f);
+    material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+    Append(out, &diffuseColor, sizeof(diffuseColor));
+
+    aiString texturePath;
+    unsigned int diffuseCount = 0;
+    while (material->GetTexture(aiTextureType_DIFFUSE, diffuseCount, &texturePath) == AI_SUCCESS) {
+        diffuseCount++;
+    }
+    AppendUint32(out, diffuseCount);
+    for (unsigned int t = 0; t < diffuseCount; ++t) {
+        material->GetTexture(aiTextureType_DIFFUSE, t, &texturePath);
+        AppendString(out, texturePath.data, texturePath.length);
+    }
+    bool hasNormalMap =
+            material->GetTexture(aiTextureType_NORMALS, 0, &texturePath) == AI_SUCCESS ||
+            material->GetTexture(aiTextureType_HEIGHT, 0, &texturePath) == AI_SUCCESS;
+    AppendUint32(out, hasNormalMap);
+    if (hasNormalMap) {
+        AppendString(out, texturePath.data, texturePath.length);
+    }
+}
+
+bool EncodeScene(const aiScene *scene, uint64_t sourceKey, std::vector<uint8_t> &encoded) {
+
+    MeshCodecHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_CODEC_MAGIC;
+    header.version = MESH_CODEC_VERSION;
+    header.sourceKey = sourceKey;
+    header.meshCount = scene->mNumMeshes;
+    header.materialCount = scene->mNumMaterials;
+    if (!header.materialCount) {
+        return false;
+    }
+
+    std::vector<uint8_t> sceneBlock;
+    for (unsigned int m = 0; m < scene->mNumMaterials; ++m) {
+        AppendMaterial(sceneBlock, scene->mMaterials[m]);
+    }
+    if (scene->mRootNode &&
+        !AppendNode(sceneBlock, scene->mRootNode, scene->mNumMeshes, 0, header.nodeCount)) {
+        return false;
+    }
+
+    float positionMin[3], positionRange[3];
+    GetSceneBounds(scene, positionMin, positionRange);
+    encoded.clear();
+    Append(encoded, &header, sizeof(header));
+    AppendBlock(encoded, sceneBlock);
+    for (unsigned int n = 0; n < scene->mNumMeshes; ++n) {
+        if (scene->mMeshes[n]->mMaterialIndex >= scene->mNumMaterials ||
+            !AppendMesh(encoded, scene->mMeshes[n], positionMin, positionRange)) {
+            encoded.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+static aiMaterial * ReadMaterial(MeshCodecReader &reader) {
+
+    aiMaterial *material = new aiMaterial();
+    aiColor4D diffuseColor;
+    reader.Read(&diffuseColor, sizeof(diffuseColor));
+    material->AddProperty(&diffuseColor, 1, AI_MATKEY_COLOR_DIFFUSE);
+    aiString texturePath;
+    unsigned int diffuseCount = reader.ReadUint32();
+    for (unsigned int t = 0; t < diffuseCount && reader.ReadString(texturePath); ++t) {
+        material->AddProperty(&texturePath, AI_MATKEY_TEXTURE_DIFFUSE(t));
+    }
+    if (reader.ReadUint32() && reader.ReadString(texturePath)) {
+        material->AddProperty(&texturePath, AI_MATKEY_TEXTURE_NORMALS(0));
+    }
+    return material;
+}
+
+/**
+ * NULL if the node or its subtree is corrupt, or there are more nodes than nodesLeft
+ */
+static aiNode * ReadNode(MeshCodecReader &reader, unsigned int meshCount, unsigned int depth,
+                         unsigned int &nodesLeft) {
+
+    if (depth > MESH_CODEC_MAX_DEPTH || nodesLeft == 0) {
+        return NULL;
+    }
+    nodesLeft--;
+    aiNode *node = new aiNode();
+    reader.ReadString(node->mName);
+    reader.Read(&node->mTransformation, sizeof(node->mTransformation));
+    unsigned int nodeMeshes = reader.ReadUint32();
+    if (nodeMeshes > meshCount) {
+        delete node;
+        return NULL;
+    }
+    node->mMeshes = new unsigned int[nodeMeshes];
+    node->mNumMeshes = nodeMeshes;
+    for (unsigned int m = 0; m < nodeMeshes; ++m) {
+        node->mMeshes[m] = reader.ReadUint32();
+        if (node->mMeshes[m] >= meshCount) {
+            delete node;
+            return NULL;
+        }
+    }
+    unsigned int children = reader.ReadUint32();
+    if (!reader.IsValid() || children > nodesLeft) {
+        delete node;
+        return NULL;
+    }
+    node->mChildren = new aiNode *[children];
+    for (unsigned int c = 0; c < children; ++c) {
+        node->mChildren[c] = ReadNode(reader, meshCount, depth + 1, nodesLeft);
+        if (!node->mChildren[c]) {
+            delete node;
+            return NULL;
+        }
+        node->mChildren[c]->mParent = node;
+        node->mNumChildren = c + 1;
+    }
+    return node;
+}
+
+/**
+ * Attributes go straight into the mesh's arrays, with one pass to undo the deltas and one to
+ * dequantize. The indices stay in the arena, the decompressed block and the planes of a 16-bit
+ * attribute only until the mesh is read
+ */
+static aiMesh * ReadMesh(const uint8_t *&data, const uint8_t *end, unsigned int materialCount,
+                         MyArena &arena, const unsigned int *&indices) {
+
+    MeshCodecMesh encodedMesh;
+    MeshCodecBlock block;
+    if ((size_t) (end - data) < sizeof(encodedMesh) + sizeof(block)) {
+        return NULL;
+    }
+    memcpy(&encodedMesh, data, sizeof(encodedMesh));
+    data += sizeof(encodedMesh);
+    memcpy(&block, data, sizeof(block));
+    unsigned int vertexCount = encodedMesh.vertexCount;
+    unsigned int attributes = encodedMesh.attributes;
+    size_t uvBytes = attributes & MESH_CODEC_WIDE_UVS ? gWideUVBytes : gUVBytes;
+    size_t tangentBytes = gVectorBytes + gTangentSignBytes;
+    size_t vertexBytes = gPositionBytes + (attributes & MESH_CODEC_UVS ? uvBytes : 0) +
+                         (attributes & MESH_CODEC_COLORS ? gColorBytes : 0) +
+                         (attributes & MESH_CODEC_NORMALS ? gVectorBytes : 0) +
+                         (attributes & MESH_CODEC_TANGENTS ? tangentBytes : 0);
+    // every index takes at least a byte
+    if (encodedMesh.materialIndex >= materialCount || attributes > 31 ||
+        ((attributes & MESH_CODEC_TANGENTS) && !(attributes & MESH_CODEC_NORMALS)) ||
+        vertexCount > block.size / vertexBytes || encodedMesh.faceCount > block.size / 3 ||
+        vertexCount * vertexBytes + 3 * (size_t) encodedMesh.faceCount > block.size) {
+        return NULL;
+    }
+    unsigned int *meshIndices =
+            arena.AllocateArray<unsigned int>(3 * (size_t) encodedMesh.faceCount);
+    MyArenaMarker blockMarker = arena.GetMarker();
+    size_t rawSize;
+    const uint8_t *raw = ReadBlock(data, end, arena, rawSize);
+    if (!raw) {
+        return NULL;
+    }
+
+    aiMesh *mesh = new aiMesh();
+    mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    mesh->mMaterialIndex = encodedMesh.materialIndex;
+    mesh->mNumVertices = vertexCount;
+    mesh->mNumFaces = encodedMesh.faceCount;
+    uint16_t *values = arena.AllocateArray<uint16_t>(2 * (size_t) vertexCount);
+
+    mesh->mVertices = new aiVector3D[vertexCount];
+    DecodeQuantizedPlanes<uint16_t>(raw, vertexCount, 3, encodedMesh.positionMin,
+                                    encodedMesh.positionScale, mesh->mVertices);
+    raw += gPositionBytes * (size_t) vertexCount;
+    if (attributes & MESH_CODEC_UVS) {
+        mesh->mTextureCoords[0] = new aiVector3D[vertexCount];
+        mesh->mNumUVComponents[0] = 2;
+        if (attributes & MESH_CODEC_WIDE_UVS) {
+            DecodeQuantizedPlanes<uint32_t>(raw, vertexCount, 2, encodedMesh.uvMin,
+                                            encodedMesh.uvScale, mesh->mTextureCoords[0]);
+        } else {
+            DecodeQuantizedPlanes<uint16_t>(raw, vertexCount, 2, encodedMesh.uvMin,
+                                            encodedMesh.uvScale, mesh->mTextureCoords[0]);
+        }
+        raw += uvBytes * (size_t) vertexCount;
+    }
+    if (attributes & MESH_CODEC_COLORS) {
+        mesh->mColors[0] = new aiColor4D[vertexCount];
+        for (unsigned int c = 0; c < 4; ++c) {
+            uint8_t value = 0;
+            for (unsigned int v = 0; v < vertexCount; ++v) {
+                value += raw[v];
+                mesh->mColors[0][v][c] = value * (1.f / 255);
+            }
+            raw += vertexCount;
+        }
+    }
+    if (attributes & MESH_CODEC_NORMALS) {
+        DecodeDeltaPlanes16(raw, vertexCount, 2, values);
+        raw += gVectorBytes * (size_t) vertexCount;
+        mesh->mNormals = new aiVector3D[vertexCount];
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            mesh->mNormals[v] = DecodeOctahedral(&values[2 * v]);
+        }
+    }
+    if (attributes & MESH_CODEC_TANGENTS) {
+        DecodeDeltaPlanes16(raw, vertexCount, 2, values);
+        raw += gVectorBytes * (size_t) vertexCount;
+        mesh->mTangents = new aiVector3D[vertexCount];
+        mesh->mBitangents = new aiVector3D[vertexCount];
+        for (unsigned int v = 0; v < vertexCount; ++v) {
+            mesh->mTangents[v] = DecodeOctahedral(&values[2 * v]);
+            mesh->mBitangents[v] = mesh->mNormals[v] ^ mesh->mTangents[v];
+            if (raw[v]) {
+                mesh->mBitangents[v] = -mesh->mBitangents[v];
+            }
+        }
+        raw += gTangentSignBytes * (size_t) vertexCount;
+    }
+
+    const uint8_t *rawEnd = raw + (rawSize - vertexCount * vertexBytes);
+    bool isDecoded = DecodeIndices(raw, rawEnd, vertexCount, meshIndices, 3 * mesh->mNumFaces);
+    arena.Rewind(blockMarker);
+    if (!isDecoded) {
+        delete mesh;
+        return NULL;
+    }
+    indices = meshIndices;
+    return mesh;
+}
+
+aiScene * DecodeScene(const uint8_t *encoded, size_t encodedSize, uint64_t sourceKey,
+                      MyArena &arena, std::vector<const unsigned int *> &meshIndices) {
+
+    MeshCodecHeader header;
+    if (encodedSize < sizeof(header)) {
+        return NULL;
+    }
+    memcpy(&header, encoded, sizeof(header));
+    const uint8_t *data = encoded + sizeof(header);
+    const uint8_t *end = encoded + encodedSize;
+    // every material, node and mesh takes at least a few bytes, which bounds the counts
+    if (header.magic != MESH_CODEC_MAGIC || header.version != MESH_CODEC_VERSION ||
+        header.sourceKey != sourceKey || header.meshCount > encodedSize ||
+        header.materialCount == 0 || header.materialCount > encodedSize ||
+        header.nodeCount > encodedSize) {
+        return NULL;
+    }
+
+    MyArenaMarker sceneBlockMarker = arena.GetMarker();
+    size_t sceneBlockSize;
+    const uint8_t *sceneBlock = ReadBlock(data, end, arena, sceneBlockSize);
+    if (!sceneBlock) {
+        return NULL;
+    }
+    aiScene *scene = new aiScene();
+    MeshCodecReader reader(sceneBlock, sceneBlockSize);
+    scene->mMaterials = new aiMaterial *[header.materialCount];
+    for (unsigned int m = 0; m < header.materialCount; ++m) {
+        scene->mMaterials[m] = ReadMaterial(reader);
+        scene->mNumMaterials = m + 1;
+    }
+    unsigned int nodesLeft = header.nodeCount;
+    if (nodesLeft) {
+        scene->mRootNode = ReadNode(reader, header.meshCount, 0, nodesLeft);
+    }
+    if (!reader.IsValid() || !reader.IsAtEnd() || nodesLeft ||
+        (header.nodeCount && !scene->mRootNode)) {
+        delete scene;
+        return NULL;
+    }
+    arena.Rewind(sceneBlockMarker);
+
+    meshIndices.assign(header.meshCount, NULL);
+    scene->mMeshes = new aiMesh *[header.meshCount];
+    for (unsigned int n = 0; n < header.meshCount; ++n) {
+        scene->mMeshes[n] = ReadMesh(data, end, header.materialCount, arena, meshIndices[n]);
+        if (!scene->mMeshes[n]) {
+            delete scene;
+            meshIndices.clear();
+            return NULL;
+        }
+        scene->mNumMeshes = n + 1;
+    }
+    if (data != end) {
+        delete scene;
+        meshIndices.clear();
+        return NULL;
+    }
+    return scene;
+}
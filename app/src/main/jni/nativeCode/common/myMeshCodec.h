@@ -0,0 +1,93 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+
+// Compact binary form of an imported scene, which AssimpLoader keeps in a mesh cache so that
+// later loads decode it instead of parsing the OBJ again. It holds the meshes, the node
+// hierarchy and the material textures and diffuse colors that the loader keeps.
+// Every mesh is stored as
+//   - positions quantized to 16 bits over the bounds of the whole scene, so that vertices
+//     that meshes share decode to the same position and their seams do not crack, UVs over
+//     the mesh's range (24 bits for tiled UVs that span more than MESH_CODEC_WIDE_UV_RANGE),
+//     normals and tangents as 16-bit octahedral vectors with a byte for the sign of the
+//     bitangent, and colors as 8-bit RGBA
+//   - each attribute delta-coded from the previous vertex, with vertices renumbered in the
+//     order the triangles first use them, and split into byte planes
+//   - indices as 0 for the next vertex not used yet and otherwise as their distance below
+//     it, one byte for most cache-ordered triangles
+// and then LZ4-compressed, see myLZ4.h. Decoding undoes this in one pass per attribute.
+// Layout, little-endian:
+//   MeshCodecHeader
+//   block with the materials and the nodes
+//   meshCount times a MeshCodecMesh and a block with its attributes and indices
+// where a block is a MeshCodecBlock and its bytes, stored as they are if storedSize == size
+
+#ifndef MY_MESH_CODEC_H
+#define MY_MESH_CODEC_H
+
+#include "myArena.h"
+#include <assimp/scene.h>
+#include <stdint.h>
+#include <vector>
+
+#define MESH_CODEC_MAGIC        0x434d594d      // "MYMC"
+#define MESH_CODEC_VERSION      2
+#define MESH_CODEC_WIDE_UV_RANGE    8   // above it 16 bits are off by half a texel at 8K
+
+struct MeshCodecHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    sourceKey;      // of the OBJ the scene was imported from, with the settings
+    uint32_t    meshCount;
+    uint32_t    materialCount;
+    uint32_t    nodeCount;
+    uint32_t    reserved;
+};
+
+// the sizes come first, so that the decoder can check them before it allocates anything
+struct MeshCodecMesh {
+    uint32_t    vertexCount;
+    uint32_t    faceCount;
+    uint32_t    materialIndex;
+    uint32_t    attributes;         // MESH_CODEC_* bits
+    float       positionMin[3];     // of the scene, the same in every mesh
+    float       positionScale[3];   // of a quantization step
+    float       uvMin[2];
+    float       uvScale[2];
+};
+
+enum MeshCodecAttributes {
+    MESH_CODEC_UVS          = 1,
+    MESH_CODEC_COLORS       = 2,
+    MESH_CODEC_NORMALS      = 4,
+    MESH_CODEC_TANGENTS     = 8,    // bitangents are rebuilt from the normals, tangents and signs
+    MESH_CODEC_WIDE_UVS     = 16    // quantized to 24 bits
+};
+
+struct MeshCodecBlock {
+    uint32_t    size;
+    uint32_t    storedSize;     // LZ4-compressed if less than size
+};
+
+// false if the scene has something the codec does not keep, e.g. a mesh that is not all
+// triangles or bones
+bool        EncodeScene(const aiScene *scene, uint64_t sourceKey, std::vector<uint8_t> &encoded);
+// a new scene the caller deletes, NULL if the data is corrupt or has another sourceKey. The
+// meshes have no aiFaces: the three indices per face of mesh n are at meshIndices[n], in arena
+aiScene *   DecodeScene(const uint8_t *encoded, size_t encodedSize, uint64_t sourceKey,
+                        MyArena &arena, std::vector<const unsigned int *> &meshIndices);
+
+#endif //MY_MESH_CODEC_H
@@ -0,0 +1,559 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myMeshPostProcess.h"
+#include "myJobSystem.h"
+#include "myLogger.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#define NO_INDEX    0xFFFFFFFFu
+
+typedef std::chrono::steady_clock PostProcessClock;
+
+static double ElapsedMs(PostProcessClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(PostProcessClock::now() - start).count();
+}
+
+/**
+ * Mesh steps share the native job pool, numberOfThreads caps how much of it they take
+ */
+template <typename Function>
+static void ParallelFor(unsigned int count, unsigned int grainSize, unsigned int numberOfThreads,
+                        const Function &function) {
+    GetJobSystem().ParallelFor(count, grainSize, function, std::max(1u, numberOfThreads));
+}
+
+// ---- hashing ----
+
+static inline uint32_t FloatBits(float value) {
+    if (value == 0.f) {
+        value = 0.f; // -0 and +0 compare equal, so they must hash the same
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline uint64_t HashWord(uint64_t hash, uint32_t word) {
+    return (hash ^ word) * 0x100000001b3ULL;
+}
+
+static inline uint64_t HashVector(uint64_t hash, const aiVector3D &vector) {
+    return HashWord(HashWord(HashWord(hash, FloatBits(vector.x)), FloatBits(vector.y)),
+                    FloatBits(vector.z));
+}
+
+static inline uint32_t FinishHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (uint32_t) hash;
+}
+
+static unsigned int GetTableSize(unsigned int numberOfKeys) {
+    unsigned int tableSize = 16;
+    while (tableSize < 2 * numberOfKeys) {
+        tableSize *= 2;
+    }
+    return tableSize;
+}
+
+// ---- smooth normals ----
+
+/**
+ * Same result as Assimp's GenVertexNormalsProcess without an angle limit: every vertex gets
+ * the normalized sum of the face normals of all vertices within ComputePositionEpsilon of it.
+ * Face normals and the neighbour sums run in parallel; exact duplicates are grouped first
+ * so that the neighbour search runs once per distinct position
+ */
+void GenerateSmoothNormals(aiMesh *mesh, unsigned int numberOfThreads) {
+
+    // like Assimp, keep normals that came with the file
+    if (mesh->mNormals || mesh->mNumFaces == 0 || mesh->mNumVertices == 0) {
+        return;
+    }
+    unsigned int numberOfVertices = mesh->mNumVertices;
+    const float qnan = std::numeric_limits<float>::quiet_NaN();
+
+    // face normals, degenerate faces, points and lines get NaN and are skipped in the sums
+    std::vector<aiVector3D> faceNormals(mesh->mNumFaces);
+    ParallelFor(mesh->mNumFaces, 4096, numberOfThreads, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int f = begin; f < end; ++f) {
+            const aiFace &face = mesh->mFaces[f];
+            if (face.mNumIndices < 3) {
+                faceNormals[f] = aiVector3D(qnan, qnan, qnan);
+                continue;
+            }
+            const aiVector3D &v1 = mesh->mVertices[face.mIndices[0]];
+            const aiVector3D &v2 = mesh->mVertices[face.mIndices[1]];
+            const aiVector3D &v3 = mesh->mVertices[face.mIndices[face.mNumIndices - 1]];
+            aiVector3D normal = (v2 - v1) ^ (v3 - v1);
+            float length = normal.Length();
+            faceNormals[f] = length > 0.f ? normal / length : aiVector3D(qnan, qnan, qnan);
+        }
+    });
+
+    // every vertex keeps the normal of the last face using it, as in Assimp
+    std::vector<aiVector3D> vertexFaceNormals(numberOfVertices, aiVector3D(qnan, qnan, qnan));
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace &face = mesh->mFaces[f];
+        for (unsigned int i = 0; i < face.mNumIndices; ++i) {
+            vertexFaceNormals[face.mIndices[i]] = faceNormals[f];
+        }
+    }
+
+    // group exact duplicates and add up their face normals
+    std::vector<unsigned int> positionIndex(numberOfVertices);
+    std::vector<unsigned int> uniqueVertices;      // first vertex with each distinct position
+    std::vector<aiVector3D> positionSums;
+    {
+        unsigned int tableSize = GetTableSize(numberOfVertices);
+        std::vector<unsigned int> table(tableSize, NO_INDEX);
+        for (unsigned int i = 0; i < numberOfVertices; ++i) {
+            const aiVector3D &position = mesh->mVertices[i];
+            unsigned int slot = FinishHash(HashVector(0xcbf29ce484222325ULL, position)) &
+                                (tableSize - 1);
+            while (table[slot] != NO_INDEX &&
+                   mesh->mVertices[uniqueVertices[table[slot]]] != position) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if (table[slot] == NO_INDEX) {
+                table[slot] = uniqueVertices.size();
+                uniqueVertices.push_back(i);
+                positionSums.push_back(aiVector3D(0, 0, 0));
+            }
+            positionIndex[i] = table[slot];
+            if (!std::isnan(vertexFaceNormals[i].x)) {
+                positionSums[table[slot]] += vertexFaceNormals[i];
+            }
+        }
+    }
+    unsigned int numberOfPositions = uniqueVertices.size();
+
+    // uniform grid with cells of epsilon size, neighbours are in the surrounding 27 cells
+    aiVector3D boundsMin = mesh->mVertices[0], boundsMax = mesh->mVertices[0];
+    for (unsigned int i = 1; i < numberOfVertices; ++i) {
+        const aiVector3D &position = mesh->mVertices[i];
+        boundsMin.x = std::min(boundsMin.x, position.x);
+        boundsMin.y = std::min(boundsMin.y, position.y);
+        boundsMin.z = std::min(boundsMin.z, position.z);
+        boundsMax.x = std::max(boundsMax.x, position.x);
+        boundsMax.y = std::max(boundsMax.y, position.y);
+        boundsMax.z = std::max(boundsMax.z, position.z);
+    }
+    float epsilon = (boundsMax - boundsMin).Length() * 1e-4f; // Assimp's ComputePositionEpsilon
+    float squareEpsilon = epsilon * epsilon;
+    float inverseCellSize = epsilon > 0.f ? 1.f / epsilon : 0.f;
+
+    std::vector<int> cellCoordinates(3 * numberOfPositions);
+    unsigned int cellTableSize = GetTableSize(numberOfPositions);
+    std::vector<unsigned int> cellTable(cellTableSize, NO_INDEX);   // first position in the cell
+    std::vector<unsigned int> nextInCell(numberOfPositions, NO_INDEX);
+    auto cellSlot = [&](const int *cell) {
+        uint64_t hash = HashWord(HashWord(HashWord(0xcbf29ce484222325ULL, cell[0]), cell[1]),
+                                 cell[2]);
+        unsigned int slot = FinishHash(hash) & (cellTableSize - 1);
+        while (cellTable[slot] != NO_INDEX &&
+               memcmp(&cellCoordinates[3 * cellTable[slot]], cell, 3 * sizeof(int)) != 0) {
+            slot = (slot + 1) & (cellTableSize - 1);
+        }
+        return slot;
+    };
+    for (unsigned int p = 0; p < numberOfPositions; ++p) {
+        const aiVector3D &position = mesh->mVertices[uniqueVertices[p]];
+        int *cell = &cellCoordinates[3 * p];
+        cell[0] = (int) std::floor((position.x - boundsMin.x) * inverseCellSize);
+        cell[1] = (int) std::floor((position.y - boundsMin.y) * inverseCellSize);
+        cell[2] = (int) std::floor((position.z - boundsMin.z) * inverseCellSize);
+        unsigned int slot = cellSlot(cell);
+        nextInCell[p] = cellTable[slot];
+        cellTable[slot] = p;
+    }
+
+    // parallel accumulation: every distinct position gathers the sums of its neighbours
+    std::vector<aiVector3D> smoothNormals(numberOfPositions);
+    ParallelFor(numberOfPositions, 1024, numberOfThreads, [&](unsigned int begin,
+                                                              unsigned int end) {
+        for (unsigned int p = begin; p < end; ++p) {
+            const aiVector3D &position = mesh->mVertices[uniqueVertices[p]];
+            const int *cell = &cellCoordinates[3 * p];
+            aiVector3D normal = positionSums[p];
+            for (int dz = -1; dz <= 1; ++dz) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        int neighbourCell[3] = {cell[0] + dx, cell[1] + dy, cell[2] + dz};
+                        unsigned int q = cellTable[cellSlot(neighbourCell)];
+                        for (; q != NO_INDEX; q = nextInCell[q]) {
+                            if (q != p && (mesh->mVertices[uniqueVertices[q]] - position)
+                                                  .SquareLength() < squareEpsilon) {
+                                normal += positionSums[q];
+                            }
+                        }
+                    }
+                }
+            }
+            float length = normal.Length();
+            smoothNormals[p] = length > 0.f ? normal / length : aiVector3D(0, 0, 0);
+        }
+    });
+
+    mesh->mNormals = new aiVector3D[numberOfVertices];
+    ParallelFor(numberOfVertices, 16384, numberOfThreads, [&](unsigned int begin,
+                                                              unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            mesh->mNormals[i] = smoothNormals[positionIndex[i]];
+        }
+    });
+}
+
+// ---- welding ----
+
+static uint64_t HashVertex(const aiMesh *mesh, unsigned int i) {
+
+    uint64_t hash = HashVector(0xcbf29ce484222325ULL, mesh->mVertices[i]);
+    if (mesh->mNormals) {
+        hash = HashVector(hash, mesh->mNormals[i]);
+    }
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS && mesh->mTextureCoords[c]; ++c) {
+        hash = HashVector(hash, mesh->mTextureCoords[c][i]);
+    }
+    return hash;
+}
+
+static bool IsSameVertex(const aiMesh *mesh, unsigned int a, unsigned int b) {
+
+    if (mesh->mVertices[a] != mesh->mVertices[b]) {
+        return false;
+    }
+    if (mesh->mNormals && mesh->mNormals[a] != mesh->mNormals[b]) {
+        return false;
+    }
+    if (mesh->mTangents && (mesh->mTangents[a] != mesh->mTangents[b] ||
+                            mesh->mBitangents[a] != mesh->mBitangents[b])) {
+        return false;
+    }
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS && mesh->mTextureCoords[c]; ++c) {
+        if (mesh->mTextureCoords[c][a] != mesh->mTextureCoords[c][b]) {
+            return false;
+        }
+    }
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS && mesh->mColors[c]; ++c) {
+        if (mesh->mColors[c][a] != mesh->mColors[c][b]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Keep only the vertices listed in newToOld, in that order
+ */
+template <typename T>
+static void GatherVertices(T *&attribute, const std::vector<unsigned int> &newToOld) {
+    if (!attribute) {
+        return;
+    }
+    T *gathered = new T[newToOld.size()];
+    for (unsigned int i = 0; i < newToOld.size(); ++i) {
+        gathered[i] = attribute[newToOld[i]];
+    }
+    delete[] attribute;
+    attribute = gathered;
+}
+
+static void GatherAllVertices(aiMesh *mesh, const std::vector<unsigned int> &newToOld) {
+
+    GatherVertices(mesh->mVertices, newToOld);
+    GatherVertices(mesh->mNormals, newToOld);
+    GatherVertices(mesh->mTangents, newToOld);
+    GatherVertices(mesh->mBitangents, newToOld);
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++c) {
+        GatherVertices(mesh->mTextureCoords[c], newToOld);
+    }
+    for (unsigned int c = 0; c < AI_MAX_NUMBER_OF_COLOR_SETS; ++c) {
+        GatherVertices(mesh->mColors[c], newToOld);
+    }
+    mesh->mNumVertices = newToOld.size();
+}
+
+/**
+ * Merge vertices whose attributes are all equal, keeping the first occurrence like Assimp's
+ * JoinVerticesProcess. Meshes with bones or morph targets are left alone
+ */
+void WeldIdenticalVertices(aiMesh *mesh) {
+
+    if (mesh->HasBones() || mesh->mNumAnimMeshes || mesh->mNumVertices == 0) {
+        return;
+    }
+
+    unsigned int tableSize = GetTableSize(mesh->mNumVertices);
+    std::vector<unsigned int> table(tableSize, NO_INDEX);
+    std::vector<unsigned int> oldToNew(mesh->mNumVertices);
+    std::vector<unsigned int> newToOld;
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+        unsigned int slot = FinishHash(HashVertex(mesh, i)) & (tableSize - 1);
+        while (table[slot] != NO_INDEX && !IsSameVertex(mesh, newToOld[table[slot]], i)) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == NO_INDEX) {
+            table[slot] = newToOld.size();
+            newToOld.push_back(i);
+        }
+        oldToNew[i] = table[slot];
+    }
+    if (newToOld.size() == mesh->mNumVertices) {
+        return;
+    }
+
+    GatherAllVertices(mesh, newToOld);
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        aiFace &face = mesh->mFaces[f];
+        for (unsigned int i = 0; i < face.mNumIndices; ++i) {
+            face.mIndices[i] = oldToNew[face.mIndices[i]];
+        }
+    }
+}
+
+// ---- vertex cache ----
+
+/**
+ * Tipsify (Sander, Nehab and Barczak 2007): fan around the vertex most likely to still be
+ * in a FIFO cache of cacheSize entries, then store the vertices in order of first use
+ */
+void OptimizeVertexCache(aiMesh *mesh, unsigned int cacheSize) {
+
+    unsigned int numberOfVertices = mesh->mNumVertices;
+    unsigned int numberOfFaces = mesh->mNumFaces;
+    for (unsigned int f = 0; f < numberOfFaces; ++f) {
+        if (mesh->mFaces[f].mNumIndices != 3) {
+            return;
+        }
+    }
+    if (numberOfFaces == 0) {
+        return;
+    }
+
+    // triangles around every vertex
+    std::vector<unsigned int> adjacencyStart(numberOfVertices + 1, 0);
+    for (unsigned int f = 0; f < numberOfFaces; ++f) {
+        for (unsigned int i = 0; i < 3; ++i) {
+            adjacencyStart[mesh->mFaces[f].mIndices[i] + 1]++;
+        }
+    }
+    for (unsigned int v = 0; v < numberOfVertices; ++v) {
+        adjacencyStart[v + 1] += adjacencyStart[v];
+    }
+    std::vector<unsigned int> adjacency(3 * numberOfFaces);
+    std::vector<unsigned int> liveTriangles(numberOfVertices);
+    for (unsigned int v = 0; v < numberOfVertices; ++v) {
+        liveTriangles[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+    }
+    {
+        std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (unsigned int f = 0; f < numberOfFaces; ++f) {
+            for (unsigned int i = 0; i < 3; ++i) {
+                adjacency[fill[mesh->mFaces[f].mIndices[i]]++] = f;
+            }
+        }
+    }
+
+    std::vector<unsigned int> cacheTime(numberOfVertices, 0);
+    std::vector<bool> isEmitted(numberOfFaces, false);
+    std::vector<unsigned int> deadEnds, candidates;
+    std::vector<unsigned int> triangleOrder;
+    triangleOrder.reserve(numberOfFaces);
+    unsigned int timeStamp = cacheSize + 1;
+    unsigned int cursor = 0;
+
+    int fanningVertex = 0;
+    while (fanningVertex >= 0) {
+
+        candidates.clear();
+        for (unsigned int a = adjacencyStart[fanningVertex]; a < adjacencyStart[fanningVertex + 1];
+             ++a) {
+            unsigned int t = adjacency[a];
+            if (isEmitted[t]) {
+                continue;
+            }
+            triangleOrder.push_back(t);
+            for (unsigned int i = 0; i < 3; ++i) {
+                unsigned int v = mesh->mFaces[t].mIndices[i];
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timeStamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timeStamp++;
+                }
+            }
+            isEmitted[t] = true;
+        }
+
+        // next fan: the candidate that stays in the cache longest while its fan is emitted
+        fanningVertex = -1;
+        int bestPriority = -1;
+        for (unsigned int c = 0; c < candidates.size(); ++c) {
+            unsigned int v = candidates[c];
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            int priority = 0;
+            if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = timeStamp - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanningVertex = v;
+            }
+        }
+
+        // dead end: go back to a recent vertex with triangles left, or scan forward
+        while (fanningVertex < 0 && !deadEnds.empty()) {
+            unsigned int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) {
+                fanningVertex = v;
+            }
+        }
+        while (fanningVertex < 0 && cursor < numberOfVertices) {
+            if (liveTriangles[cursor] > 0) {
+                fanningVertex = cursor;
+            } else {
+                ++cursor;
+            }
+        }
+    }
+
+    // rewrite faces in the new order, renumbering vertices by first use
+    std::vector<unsigned int> indices(3 * numberOfFaces);
+    for (unsigned int f = 0; f < numberOfFaces; ++f) {
+        memcpy(&indices[3 * f], mesh->mFaces[triangleOrder[f]].mIndices, 3 * sizeof(unsigned int));
+    }
+    bool canReorderVertices = !mesh->HasBones() && !mesh->mNumAnimMeshes;
+    std::vector<unsigned int> oldToNew(numberOfVertices, NO_INDEX);
+    std::vector<unsigned int> newToOld;
+    if (canReorderVertices) {
+        newToOld.reserve(numberOfVertices);
+        for (unsigned int i = 0; i < indices.size(); ++i) {
+            if (oldToNew[indices[i]] == NO_INDEX) {
+                oldToNew[indices[i]] = newToOld.size();
+                newToOld.push_back(indices[i]);
+            }
+            indices[i] = oldToNew[indices[i]];
+        }
+        for (unsigned int v = 0; v < numberOfVertices; ++v) {
+            if (oldToNew[v] == NO_INDEX) {
+                oldToNew[v] = newToOld.size();
+                newToOld.push_back(v);
+            }
+        }
+        GatherAllVertices(mesh, newToOld);
+    }
+    for (unsigned int f = 0; f < numberOfFaces; ++f) {
+        memcpy(mesh->mFaces[f].mIndices, &indices[3 * f], 3 * sizeof(unsigned int));
+    }
+}
+
+/**
+ * Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache,
+ * -1 for a cache of no entries
+ */
+float ComputeACMR(const aiMesh *mesh, unsigned int cacheSize) {
+
+    if (cacheSize == 0) {
+        MyLOGE("ComputeACMR needs a cache of at least one entry");
+        return -1.f;
+    }
+    if (mesh->mNumFaces == 0) {
+        return 0.f;
+    }
+    std::vector<unsigned int> fifo(cacheSize, NO_INDEX);
+    unsigned int fifoHead = 0, misses = 0;
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace &face = mesh->mFaces[f];
+        for (unsigned int i = 0; i < face.mNumIndices; ++i) {
+            if (std::find(fifo.begin(), fifo.end(), face.mIndices[i]) == fifo.end()) {
+                fifo[fifoHead] = face.mIndices[i];
+                fifoHead = (fifoHead + 1) % cacheSize;
+                misses++;
+            }
+        }
+    }
+    return (float) misses / mesh->mNumFaces;
+}
+
+unsigned int GetDefaultPostProcessThreads() {
+    return GetJobSystem().GetNumberOfWorkers() + 1;
+}
+
+/**
+ * Normals need the unwelded mesh (one vertex per face corner after an OBJ import), so they run
+ * mesh by mesh with threads inside each mesh; weld and cache optimization run one mesh per thread
+ */
+void PostProcessMeshes(aiScene *scene, unsigned int steps, unsigned int numberOfThreads,
+                       MeshPostProcessStats *stats, const MyCancelToken *cancelToken) {
+
+    MeshPostProcessStats localStats;
+    if (!stats) {
+        stats = &localStats;
+    }
+    memset(stats, 0, sizeof(MeshPostProcessStats));
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+        stats->verticesIn += scene->mMeshes[m]->mNumVertices;
+    }
+
+    PostProcessClock::time_point start = PostProcessClock::now();
+    if (steps & aiProcess_GenSmoothNormals) {
+        for (unsigned int m = 0; m < scene->mNumMeshes && !IsCancelled(cancelToken); ++m) {
+            GenerateSmoothNormals(scene->mMeshes[m], numberOfThreads);
+        }
+    }
+    stats->normalsMs = ElapsedMs(start);
+
+    start = PostProcessClock::now();
+    if (steps & aiProcess_JoinIdenticalVertices) {
+        ParallelFor(scene->mNumMeshes, 1, numberOfThreads, [&](unsigned int begin,
+                                                               unsigned int end) {
+            for (unsigned int m = begin; m < end && !IsCancelled(cancelToken); ++m) {
+                WeldIdenticalVertices(scene->mMeshes[m]);
+            }
+        });
+    }
+    stats->weldMs = ElapsedMs(start);
+
+    start = PostProcessClock::now();
+    if (steps & aiProcess_ImproveCacheLocality) {
+        ParallelFor(scene->mNumMeshes, 1, numberOfThreads, [&](unsigned int begin,
+                                                               unsigned int end) {
+            for (unsigned int m = begin; m < end && !IsCancelled(cancelToken); ++m) {
+                OptimizeVertexCache(scene->mMeshes[m]);
+            }
+        });
+    }
+    stats->cacheMs = ElapsedMs(start);
+
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+        stats->verticesOut += scene->mMeshes[m]->mNumVertices;
+    }
+    MyLOGI("PostProcessMeshes: %u -> %u vertices, normals %.2f ms, weld %.2f ms, cache %.2f ms "
+           "on %u threads", stats->verticesIn, stats->verticesOut, stats->normalsMs,
+           stats->weldMs, stats->cacheMs, numberOfThreads);
+}
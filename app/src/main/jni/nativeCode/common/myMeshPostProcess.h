@@ -0,0 +1,58 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Multithreaded replacement for Assimp's per-mesh post-processing steps. Import with the steps
+// in MY_MESH_POSTPROCESS_STEPS removed from the flags, then run PostProcessMeshes on the scene.
+// Normals and welding match Assimp to within float rounding on inputs like OBJ, where duplicate
+// vertices are exact copies; Assimp also merges positions that differ by a few ULPs.
+// The cache optimizer is Tipsify, not Assimp's algorithm, so only its ACMR is comparable
+
+#ifndef MY_MESH_POSTPROCESS_H
+#define MY_MESH_POSTPROCESS_H
+
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include "myCancelToken.h"
+
+#define MY_MESH_POSTPROCESS_STEPS   (aiProcess_GenSmoothNormals | \
+                                     aiProcess_JoinIdenticalVertices | \
+                                     aiProcess_ImproveCacheLocality)
+#define MY_VERTEX_CACHE_SIZE        12  // Assimp's default AI_CONFIG_PP_ICL_PTCACHE_SIZE
+
+struct MeshPostProcessStats {
+    double          normalsMs;
+    double          weldMs;
+    double          cacheMs;
+    unsigned int    verticesIn;
+    unsigned int    verticesOut;
+};
+
+// run the steps of MY_MESH_POSTPROCESS_STEPS that are set in steps, in Assimp's order;
+// a cancelled run stops between meshes and leaves the scene half processed
+void    PostProcessMeshes(aiScene *scene, unsigned int steps, unsigned int numberOfThreads,
+                          MeshPostProcessStats *stats = NULL,
+                          const MyCancelToken *cancelToken = NULL);
+
+// single steps on one mesh
+void    GenerateSmoothNormals(aiMesh *mesh, unsigned int numberOfThreads);
+void    WeldIdenticalVertices(aiMesh *mesh);
+void    OptimizeVertexCache(aiMesh *mesh, unsigned int cacheSize = MY_VERTEX_CACHE_SIZE);
+
+// -1 if cacheSize is 0
+float   ComputeACMR(const aiMesh *mesh, unsigned int cacheSize = MY_VERTEX_CACHE_SIZE);
+unsigned int GetDefaultPostProcessThreads();
+
+#endif //MY_MESH_POSTPROCESS_H
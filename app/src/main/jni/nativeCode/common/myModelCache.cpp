@@ -0,0 +1,130 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myModelCache.h"
+#include "myLogger.h"
+
+MyModelCache::MyModelCache() {
+    residentBytes = 0;
+    budgetBytes = (size_t) MY_MODEL_CACHE_BUDGET_MB << 20;
+    hits = misses = evictions = 0;
+}
+
+MyModelCache::~MyModelCache() {
+    Clear();
+}
+
+AssimpLoader * MyModelCache::Acquire(const std::string &key) {
+
+    std::map<std::string, EntryIterator>::iterator found = entryMap.find(key);
+    if (found == entryMap.end()) {
+        misses++;
+        return NULL;
+    }
+    hits++;
+    EntryIterator entry = found->second;
+    entry->useCount++;
+    entries.splice(entries.begin(), entries, entry);
+    return entry->loader;
+}
+
+/**
+ * The loader's size is taken now, when it is loaded, and assumed not to change
+ */
+void MyModelCache::Insert(const std::string &key, AssimpLoader *loader, bool isInUse) {
+
+    CacheEntry newEntry;
+    newEntry.key = key;
+    newEntry.loader = loader;
+    ModelMemoryStats memoryStats = loader->GetMemoryStats();
+    newEntry.bytes = memoryStats.cpuBytes + memoryStats.gpuBufferBytes +
+                     memoryStats.gpuTextureBytes;
+    newEntry.useCount = isInUse ? 1 : 0;
+
+    // a second load of the same key replaces the entry once nothing uses the old one
+    std::map<std::string, EntryIterator>::iterator found = entryMap.find(key);
+    if (found != entryMap.end()) {
+        found->second->key.clear();
+        entryMap.erase(found);
+    }
+    entries.push_front(newEntry);
+    entryMap[key] = entries.begin();
+    residentBytes += newEntry.bytes;
+    EvictToBudget();
+}
+
+void MyModelCache::Release(AssimpLoader *loader) {
+
+    for (EntryIterator entry = entries.begin(); entry != entries.end(); ++entry) {
+        if (entry->loader == loader) {
+            if (entry->useCount) {
+                entry->useCount--;
+            }
+            break;
+        }
+    }
+    EvictToBudget();
+}
+
+/**
+ * Oldest first, skipping models in the scene; entries replaced by a newer load of their key
+ * have an empty key and go as soon as they are unused
+ */
+void MyModelCache::EvictToBudget() {
+
+    EntryIterator entry = entries.end();
+    while (entry != entries.begin()) {
+        --entry;
+        if (entry->useCount || (residentBytes <= budgetBytes && !entry->key.empty())) {
+            continue;
+        }
+        MyLOGD("Evicting model %s, %zu bytes", entry->key.c_str(), entry->bytes);
+        if (!entry->key.empty()) {
+            entryMap.erase(entry->key);
+            evictions++;
+        }
+        residentBytes -= entry->bytes;
+        delete entry->loader;
+        entry = entries.erase(entry);
+    }
+}
+
+void MyModelCache::Clear() {
+
+    for (EntryIterator entry = entries.begin(); entry != entries.end(); ++entry) {
+        delete entry->loader;
+    }
+    entries.clear();
+    entryMap.clear();
+    residentBytes = 0;
+}
+
+void MyModelCache::SetBudgetBytes(size_t budgetBytes) {
+    this->budgetBytes = budgetBytes;
+    EvictToBudget();
+}
+
+ModelCacheStats MyModelCache::GetStats() const {
+
+    ModelCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.residentModels = entries.size();
+    stats.residentBytes = residentBytes;
+    stats.budgetBytes = budgetBytes;
+    return stats;
+}
@@ -0,0 +1,79 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Loaded models stay resident after they leave the scene, so showing one again skips the
+// import and the uploads. Once the cache holds more CPU + GPU bytes than its budget, the least
+// recently used models are deleted; models still in the scene are never evicted.
+// GL thread only, like the loaders it owns
+
+#ifndef MY_MODEL_CACHE_H
+#define MY_MODEL_CACHE_H
+
+#include "assimpLoader.h"
+#include <list>
+#include <map>
+#include <string>
+
+#define MY_MODEL_CACHE_BUDGET_MB    64
+
+struct ModelCacheStats {
+    unsigned long   hits;
+    unsigned long   misses;
+    unsigned long   evictions;
+    unsigned int    residentModels;     // in the scene or cached
+    size_t          residentBytes;      // CPU + GPU bytes of those
+    size_t          budgetBytes;
+};
+
+class MyModelCache {
+public:
+    MyModelCache();
+    ~MyModelCache();
+
+    // the cached loader, now in use and most recent; NULL on a miss
+    AssimpLoader *  Acquire(const std::string &key);
+    // takes ownership of a loader just loaded for key, in use unless it was loaded ahead
+    void            Insert(const std::string &key, AssimpLoader *loader, bool isInUse = true);
+    // does not count as a hit or a miss
+    bool            IsCached(const std::string &key) const {
+        return entryMap.find(key) != entryMap.end();
+    }
+    // the loader left the scene and may be evicted
+    void            Release(AssimpLoader *loader);
+    void            Clear();
+
+    void            SetBudgetBytes(size_t budgetBytes);
+    ModelCacheStats GetStats() const;
+
+private:
+    struct CacheEntry {
+        std::string     key;
+        AssimpLoader *  loader;
+        size_t          bytes;
+        unsigned int    useCount;       // times it is in the scene
+    };
+    typedef std::list<CacheEntry>::iterator EntryIterator;
+
+    void            EvictToBudget();
+
+    std::list<CacheEntry>   entries;        // most recently used first
+    std::map<std::string, EntryIterator> entryMap;
+    size_t                  residentBytes;
+    size_t                  budgetBytes;
+    unsigned long           hits, misses, evictions;
+};
+
+#endif //MY_MODEL_CACHE_H
@@ -0,0 +1,324 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myModelPreloader.h"
+#include "myAllocTracker.h"
+#include "myJNIHelper.h"
+#include "myLogger.h"
+#include <mutex>
+
+/**
+ * Assets are extracted under their file name alone, so two models can write the same file
+ */
+static std::mutex & GetModelFilesMutex() {
+    static std::mutex modelFilesMutex;
+    return modelFilesMutex;
+}
+
+std::string GetModelCacheKey(const ModelRequest &model, bool keepPickingData) {
+    return model.modelId + "|" + GetImportProfileName(model.importProfile) +
+           (keepPickingData ? "|picking" : "");
+}
+
+/**
+ * A missing OBJ fails the model; a missing MTL or texture only shows up as a missing material
+ */
+bool ExtractModelAssets(const ModelRequest &model, AssimpLoader *loader, std::string &objPath,
+                        const MyCancelToken *cancelToken) {
+
+    if (IsCancelled(cancelToken)) {
+        return false;
+    }
+    // PrepareModel maps a GLB from the assets, it has its textures inside
+    if (IsGLBFileName(model.objFileName)) {
+        size_t glbSize;
+        objPath = model.objFileName;
+        if (!gHelperObject->GetAssetSize(model.objFileName, glbSize)) {
+            MyLOGE("Model %s does not exist!", model.objFileName.c_str());
+            return false;
+        }
+        return true;
+    }
+    bool isExtracted;
+    {
+        std::lock_guard<std::mutex> lock(GetModelFilesMutex());
+        isExtracted = gHelperObject->ExtractAssetReturnFilename(model.objFileName, objPath);
+    }
+    if (!isExtracted) {
+        MyLOGE("Model %s does not exist!", model.objFileName.c_str());
+        return false;
+    }
+    MyLOGD("objFileName %s", model.objFileName.c_str());
+
+    // the catalog resolved the MTLs and textures the model names, files it did not find are
+    // looked for next to the OBJ
+    std::string::size_type slashIndex = model.objFileName.find_last_of('/');
+    loader->SetAssetDirectory(slashIndex == std::string::npos ? "" :
+                              model.objFileName.substr(0, slashIndex));
+    loader->SetMeshCacheKey(model.sourceHash);
+    // the import reads the OBJ from the assets, not from the copy another model may overwrite
+    loader->MapAsset(model.objFileName);
+    for (unsigned int a = 0; a < model.assetNames.size(); ++a) {
+        loader->MapAsset(model.assetNames[a]);
+    }
+    return true;
+}
+
+MyModelPreloader::MyModelPreloader(MyModelCache *modelCache) : prepared(0) {
+    this->modelCache = modelCache;
+    keepPickingData = false;
+    requested = uploaded = cancelled = hits = misses = 0;
+}
+
+/**
+ * The jobs point back at the preloader, so every one of them has to finish first
+ */
+MyModelPreloader::~MyModelPreloader() {
+
+    CancelAll();
+    for (unsigned int i = 0; i < cancelledTasks.size(); ++i) {
+        GetJobSystem().Wait(cancelledTasks[i]->prepareJob);
+    }
+    ReapCancelled();
+}
+
+/**
+ * Models already queued keep their place and whatever work was done for them; new ones go
+ * behind the last queued model, each job waiting for the previous one, so the background
+ * never takes more than one worker and models are ready in the order asked for
+ */
+void MyModelPreloader::Preload(const std::vector<ModelRequest> &models, bool keepPickingData) {
+
+    ReapCancelled();
+    this->keepPickingData = keepPickingData;
+
+    std::vector<PreloadTaskHandle> newTasks;
+    for (unsigned int m = 0; m < models.size(); ++m) {
+
+        std::string cacheKey = GetModelCacheKey(models[m], keepPickingData);
+        if (modelCache->IsCached(cacheKey)) {
+            continue;
+        }
+        bool isQueued = false;
+        for (unsigned int t = 0; t < newTasks.size() && !isQueued; ++t) {
+            isQueued = newTasks[t]->cacheKey == cacheKey;
+        }
+        for (unsigned int t = 0; t < tasks.size() && !isQueued; ++t) {
+            if (tasks[t] && tasks[t]->cacheKey == cacheKey) {
+                newTasks.push_back(tasks[t]);
+                tasks[t].reset();
+                isQueued = true;
+            }
+        }
+        if (isQueued) {
+            continue;
+        }
+
+        PreloadTaskHandle task(new PreloadTask);
+        task->cacheKey = cacheKey;
+        task->model = models[m];
+        task->keepPickingData = keepPickingData;
+        task->loader = new AssimpLoader();
+        // keep the import on the one worker, its parallel steps would run at normal priority
+        task->loader->SetPostProcessThreads(1);
+        task->preparedBytes = 0;
+        task->state = PRELOAD_QUEUED;
+        task->prepareJob = GetJobSystem().SubmitLowPriority([this, task]() { Prepare(task); },
+                                                            std::vector<MyJobHandle>(1, lastPrepareJob));
+        lastPrepareJob = task->prepareJob;
+        newTasks.push_back(task);
+        requested++;
+    }
+
+    // uploaded models stay in the cache, the rest is no longer wanted
+    for (unsigned int t = 0; t < tasks.size(); ++t) {
+        if (tasks[t] && tasks[t]->state != PRELOAD_UPLOADED) {
+            Cancel(tasks[t]);
+        }
+    }
+    tasks.swap(newTasks);
+}
+
+/**
+ * Runs on a worker alongside loads on the GL thread, which it never blocks
+ */
+void MyModelPreloader::Prepare(const PreloadTaskHandle &task) {
+
+    int expected = PRELOAD_QUEUED;
+    if (!task->state.compare_exchange_strong(expected, PRELOAD_RUNNING)) {
+        return;
+    }
+
+    bool isPrepared = false;
+    if (!task->cancelToken.IsCancelled()) {
+        std::string objPath;
+        isPrepared = ExtractModelAssets(task->model, task->loader, objPath,
+                                        &task->cancelToken) &&
+                     task->loader->PrepareModel(objPath, task->model.importProfile,
+                                                &task->cancelToken);
+    }
+    if (isPrepared) {
+        task->preparedBytes = task->loader->GetPreparedBytes();
+        prepared++;
+        MyLOGD("Preloaded %s", task->cacheKey.c_str());
+    }
+    task->state = isPrepared ? PRELOAD_PREPARED : PRELOAD_FAILED;
+}
+
+/**
+ * A task that has not started yet is not waited for, loading it on the GL thread right away
+ * is quicker than waiting behind the models queued before it. A running one is dropped when
+ * the load is superseded, its job stops at its next check
+ */
+AssimpLoader * MyModelPreloader::Take(const std::string &cacheKey,
+                                      const MyCancelToken *cancelToken) {
+
+    ReapCancelled();
+
+    PreloadTaskHandle task;
+    for (unsigned int t = 0; t < tasks.size(); ++t) {
+        if (tasks[t]->cacheKey == cacheKey) {
+            task = tasks[t];
+            tasks.erase(tasks.begin() + t);
+            break;
+        }
+    }
+    if (!task) {
+        return NULL;
+    }
+
+    int expected = PRELOAD_QUEUED;
+    if (task->state.compare_exchange_strong(expected, PRELOAD_CANCELLED)) {
+        delete task->loader;
+        task->loader = NULL;
+        return NULL;
+    }
+    if (task->state == PRELOAD_RUNNING &&
+        !GetJobSystem().Wait(task->prepareJob, cancelToken)) {
+        Cancel(task);
+        return NULL;
+    }
+
+    AssimpLoader *loader = NULL;
+    if (task->state == PRELOAD_UPLOADED) {
+        // NULL if the cache evicted it meanwhile
+        loader = modelCache->Acquire(cacheKey);
+    } else if ((task->state == PRELOAD_PREPARED || task->state == PRELOAD_UPLOADING) &&
+               task->loader->UploadModel(task->keepPickingData, cancelToken)) {
+        loader = task->loader;
+        modelCache->Insert(cacheKey, loader);
+    } else {
+        delete task->loader;
+    }
+    task->loader = NULL;
+    if (loader) {
+        hits++;
+    }
+    return loader;
+}
+
+/**
+ * Only prepared models that fit in the cache's budget are uploaded, so preloading never evicts
+ * a model that was shown before. One model at a time, a part of it each frame so that a
+ * preload never holds up a frame for a whole upload
+ */
+void MyModelPreloader::Update() {
+
+    ReapCancelled();
+    PreloadTask *uploadTask = NULL;
+    for (unsigned int t = 0; t < tasks.size() && !uploadTask; ++t) {
+        if (tasks[t]->state == PRELOAD_UPLOADING) {
+            uploadTask = tasks[t].get();
+        }
+    }
+    for (unsigned int t = 0; t < tasks.size() && !uploadTask; ++t) {
+        PreloadTask &task = *tasks[t];
+        ModelCacheStats cacheStats = modelCache->GetStats();
+        if (task.state == PRELOAD_PREPARED &&
+            cacheStats.residentBytes + task.preparedBytes <= cacheStats.budgetBytes) {
+            task.state = PRELOAD_UPLOADING;
+            uploadTask = &task;
+        }
+    }
+    if (!uploadTask) {
+        return;
+    }
+
+    // the upload allocates, unlike the rest of the frame
+    MyAllocScope allocScope("MyModelPreloader::Update");
+    bool isUploaded;
+    if (!uploadTask->loader->UploadModelStep(uploadTask->keepPickingData,
+                                             PRELOAD_UPLOAD_BYTES_PER_FRAME, isUploaded)) {
+        delete uploadTask->loader;
+        uploadTask->loader = NULL;
+        uploadTask->state = PRELOAD_FAILED;
+    } else if (isUploaded) {
+        modelCache->Insert(uploadTask->cacheKey, uploadTask->loader, false);
+        uploadTask->loader = NULL;
+        uploadTask->state = PRELOAD_UPLOADED;
+        uploaded++;
+    }
+}
+
+void MyModelPreloader::Cancel(const PreloadTaskHandle &task) {
+
+    MyLOGD("Cancelling preload of %s", task->cacheKey.c_str());
+    task->cancelToken.Cancel();
+    int expected = PRELOAD_QUEUED;
+    task->state.compare_exchange_strong(expected, PRELOAD_CANCELLED);
+    cancelledTasks.push_back(task);
+    cancelled++;
+}
+
+void MyModelPreloader::CancelAll() {
+
+    for (unsigned int t = 0; t < tasks.size(); ++t) {
+        if (tasks[t]->state != PRELOAD_UPLOADED) {
+            Cancel(tasks[t]);
+        }
+    }
+    tasks.clear();
+}
+
+/**
+ * Loaders of cancelled tasks are deleted once their jobs stop using them
+ */
+void MyModelPreloader::ReapCancelled() {
+
+    unsigned int t = 0;
+    while (t < cancelledTasks.size()) {
+        if (!GetJobSystem().IsDone(cancelledTasks[t]->prepareJob)) {
+            ++t;
+            continue;
+        }
+        delete cancelledTasks[t]->loader;
+        cancelledTasks[t] = cancelledTasks.back();
+        cancelledTasks.pop_back();
+    }
+}
+
+PreloadStats MyModelPreloader::GetStats() const {
+
+    PreloadStats stats;
+    stats.requested = requested;
+    stats.prepared = prepared;
+    stats.uploaded = uploaded;
+    stats.cancelled = cancelled;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.hitRate = hits + misses ? (double) hits / (hits + misses) : 0;
+    return stats;
+}
@@ -0,0 +1,123 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Loads the models the user is likely to pick next before they are asked for. Extraction,
+// import and texture decode run as low-priority jobs, one model at a time in the order given.
+// Render uploads a prepared model over several frames, PRELOAD_UPLOAD_BYTES_PER_FRAME at a
+// time, and puts it in the model cache if it fits in the cache's budget, otherwise the model
+// waits on the CPU until Take uploads it.
+// All calls on the GL thread
+
+#ifndef MY_MODEL_PRELOADER_H
+#define MY_MODEL_PRELOADER_H
+
+#include "assimpLoader.h"
+#include "myCancelToken.h"
+#include "myJobSystem.h"
+#include "myModelCache.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// GPU bytes of a preload that Update sends in one frame; a texture or mesh is never split, so a
+// bigger one goes in a frame of its own
+#define PRELOAD_UPLOAD_BYTES_PER_FRAME  (2 << 20)
+
+// a model as the asset catalog describes it, see ModelAssimp::ResetModel
+struct ModelRequest {
+    std::string                 modelId;
+    std::string                 objFileName;    // or a .glb, which has everything inside
+    std::vector<std::string>    assetNames;     // the MTLs and textures, all optional
+    ImportProfile               importProfile;
+    uint64_t                    sourceHash;     // of the OBJ and MTLs, 0 if unknown
+};
+
+struct PreloadStats {
+    unsigned long   requested;      // models queued by Preload
+    unsigned long   prepared;       // imported and decoded in the background
+    unsigned long   uploaded;       // of those, also uploaded into the model cache
+    unsigned long   cancelled;      // dropped from the queue before they were used
+    unsigned long   hits;           // loads served by a preload, even one still running
+    unsigned long   misses;         // loads that had to start from scratch
+    double          hitRate;        // hits / (hits + misses)
+};
+
+class MyModelPreloader {
+public:
+    MyModelPreloader(MyModelCache *modelCache);
+    ~MyModelPreloader();
+
+    // replaces the queue; preloads of models no longer in the list are cancelled
+    void            Preload(const std::vector<ModelRequest> &models, bool keepPickingData);
+    // the preloaded model for a cache key, uploaded and in use in the cache; waits for its
+    // preparation if that is still running, unless the load's token is cancelled meanwhile.
+    // NULL if there is no usable preload or the load was cancelled
+    AssimpLoader *  Take(const std::string &cacheKey, const MyCancelToken *cancelToken = NULL);
+    void            CountMiss() { misses++; }
+    void            CancelAll();
+    // from Render: upload part of one prepared model, does not allocate when there is none
+    void            Update();
+
+    PreloadStats    GetStats() const;
+
+private:
+    enum PreloadState {
+        PRELOAD_QUEUED,
+        PRELOAD_RUNNING,
+        PRELOAD_PREPARED,
+        PRELOAD_UPLOADING,      // part of it is in GL, Update sends the rest
+        PRELOAD_UPLOADED,
+        PRELOAD_FAILED,
+        PRELOAD_CANCELLED
+    };
+
+    // shared with the jobs, which may outlive the preloader's interest in them
+    struct PreloadTask {
+        std::string                 cacheKey;
+        ModelRequest                model;
+        bool                        keepPickingData;
+        AssimpLoader *              loader;         // owned until uploaded into the cache
+        size_t                      preparedBytes;  // GPU bytes the upload will add
+        MyJobHandle                 prepareJob;
+        std::atomic<int>            state;
+        MyCancelToken               cancelToken;
+    };
+    typedef std::shared_ptr<PreloadTask> PreloadTaskHandle;
+
+    void            Prepare(const PreloadTaskHandle &task);   // on a worker
+    void            Cancel(const PreloadTaskHandle &task);
+    void            ReapCancelled();
+
+    MyModelCache *                  modelCache;
+    bool                            keepPickingData;
+    MyJobHandle                     lastPrepareJob; // the next preload starts after it
+    std::vector<PreloadTaskHandle>  tasks;          // in priority order
+    std::vector<PreloadTaskHandle>  cancelledTasks; // jobs still running
+    std::atomic<unsigned long>      prepared;       // counted by the jobs
+    unsigned long   requested, uploaded, cancelled, hits, misses;
+};
+
+// key of a model in MyModelCache
+std::string GetModelCacheKey(const ModelRequest &model, bool keepPickingData);
+// copy the model's OBJ out of the assets, objPath is the extracted OBJ; the loader reads the
+// OBJ, the MTL and the textures its materials use from the assets in memory, from the model's
+// assets if given and otherwise from the OBJ's directory, so loads of several models can run
+// at once. False if the OBJ is missing or the token was cancelled
+bool ExtractModelAssets(const ModelRequest &model, AssimpLoader *loader, std::string &objPath,
+                        const MyCancelToken *cancelToken = NULL);
+
+#endif //MY_MODEL_PRELOADER_H
@@ -0,0 +1,247 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mySceneGraph.h"
+#include <algorithm>
+#include <float.h>
+
+/**
+ * aiMatrix4x4 is row-major, glm is column-major
+ */
+static glm::mat4 ToGLM(const aiMatrix4x4 &matrix) {
+    glm::mat4 result;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            result[c][r] = matrix[r][c];
+        }
+    }
+    return result;
+}
+
+MySceneGraph::MySceneGraph() {
+    areBoundsDirty = false;
+}
+
+void MySceneGraph::Clear() {
+    parents.clear();
+    subtreeEnds.clear();
+    names.clear();
+    localMatrices.clear();
+    worldMatrices.clear();
+    isDirty.clear();
+    dirtyNodes.clear();
+    firstInstances.clear();
+    instanceNodes.clear();
+    instanceMeshes.clear();
+    instanceLocal.Resize(0);
+    instanceWorld.Resize(0);
+    areBoundsDirty = false;
+}
+
+/**
+ * Depth-first, so the node's subtree is everything added until AddNode returns
+ */
+void MySceneGraph::AddNode(const aiNode *node, int parent) {
+
+    unsigned int index = parents.size();
+    parents.push_back(parent);
+    subtreeEnds.push_back(0);
+    names.push_back(node->mName.C_Str());
+    localMatrices.push_back(ToGLM(node->mTransformation));
+    worldMatrices.push_back(glm::mat4(1.0f));
+    isDirty.push_back(0);
+    firstInstances.push_back(instanceNodes.size());
+    for (unsigned int m = 0; m < node->mNumMeshes; ++m) {
+        instanceNodes.push_back(index);
+        instanceMeshes.push_back(node->mMeshes[m]);
+    }
+
+    for (unsigned int c = 0; c < node->mNumChildren; ++c) {
+        AddNode(node->mChildren[c], index);
+    }
+    subtreeEnds[index] = parents.size();
+}
+
+void MySceneGraph::Build(const aiScene *scene) {
+
+    Clear();
+    if (scene->mRootNode) {
+        AddNode(scene->mRootNode, -1);
+    } else {
+        parents.push_back(-1);
+        subtreeEnds.push_back(1);
+        names.push_back("root");
+        localMatrices.push_back(glm::mat4(1.0f));
+        worldMatrices.push_back(glm::mat4(1.0f));
+        isDirty.push_back(0);
+        firstInstances.push_back(0);
+        for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+            instanceNodes.push_back(0);
+            instanceMeshes.push_back(m);
+        }
+    }
+    FinishBuild();
+}
+
+/**
+ * Subtree ends in one pass from the back: a node's subtree ends where its last descendant's does
+ */
+void MySceneGraph::Build(const std::vector<MySceneNode> &nodes) {
+
+    Clear();
+    for (unsigned int n = 0; n < nodes.size(); ++n) {
+        parents.push_back(nodes[n].parent);
+        subtreeEnds.push_back(n + 1);
+        names.push_back(nodes[n].name);
+        localMatrices.push_back(nodes[n].localMatrix);
+        worldMatrices.push_back(glm::mat4(1.0f));
+        isDirty.push_back(0);
+        firstInstances.push_back(instanceNodes.size());
+        for (unsigned int m = 0; m < nodes[n].meshes.size(); ++m) {
+            instanceNodes.push_back(n);
+            instanceMeshes.push_back(nodes[n].meshes[m]);
+        }
+    }
+    for (unsigned int n = nodes.size(); n-- > 1;) {
+        unsigned int parent = parents[n];
+        subtreeEnds[parent] = std::max(subtreeEnds[parent], subtreeEnds[n]);
+    }
+    FinishBuild();
+}
+
+/**
+ * An empty node list leaves the graph cleared, with no root to mark dirty
+ */
+void MySceneGraph::FinishBuild() {
+
+    if (parents.empty()) {
+        return;
+    }
+    firstInstances.push_back(instanceNodes.size());
+
+    instanceLocal.Resize(instanceNodes.size());
+    instanceWorld.Resize(instanceNodes.size());
+
+    // the root's subtree is everything
+    dirtyNodes.reserve(parents.size());
+    dirtyNodes.push_back(0);
+    isDirty[0] = 1;
+    UpdateWorldMatrices();
+}
+
+int MySceneGraph::FindNode(const std::string &name) const {
+    for (unsigned int n = 0; n < names.size(); ++n) {
+        if (names[n] == name) {
+            return n;
+        }
+    }
+    return -1;
+}
+
+void MySceneGraph::SetLocalMatrix(unsigned int node, const glm::mat4 &matrix) {
+    localMatrices[node] = matrix;
+    if (!isDirty[node]) {
+        isDirty[node] = 1;
+        dirtyNodes.push_back(node);
+    }
+}
+
+/**
+ * Parents come first, so with the dirty nodes sorted an ancestor's subtree is recomputed before
+ * its dirty descendants come up, and those are skipped since the subtree cleared their flags
+ */
+unsigned int MySceneGraph::UpdateWorldMatrices() {
+
+    unsigned int numberOfUpdated = 0;
+    std::sort(dirtyNodes.begin(), dirtyNodes.end());
+    for (unsigned int d = 0; d < dirtyNodes.size(); ++d) {
+
+        unsigned int n = dirtyNodes[d];
+        if (!isDirty[n]) {
+            continue;
+        }
+        unsigned int subtreeEnd = subtreeEnds[n];
+        for (unsigned int k = n; k < subtreeEnd; ++k) {
+            worldMatrices[k] = parents[k] < 0 ? localMatrices[k] :
+                               worldMatrices[parents[k]] * localMatrices[k];
+            isDirty[k] = 0;
+        }
+        for (unsigned int i = firstInstances[n]; i < firstInstances[subtreeEnd]; ++i) {
+            instanceLocal.SetMatrix(i, worldMatrices[instanceNodes[i]]);
+        }
+        if (!areBoundsDirty) {
+            instanceWorld.TransformBounds(instanceLocal, firstInstances[n],
+                                          firstInstances[subtreeEnd]);
+        }
+        numberOfUpdated += subtreeEnd - n;
+    }
+    dirtyNodes.clear();
+
+    // new mesh bounds move every instance of the mesh, redo all of them
+    if (areBoundsDirty) {
+        instanceWorld.TransformBounds(instanceLocal);
+        areBoundsDirty = false;
+    }
+    return numberOfUpdated;
+}
+
+void MySceneGraph::SetMeshBounds(unsigned int mesh, const glm::vec3 &boundsMin,
+                                 const glm::vec3 &boundsMax) {
+    for (unsigned int i = 0; i < instanceMeshes.size(); ++i) {
+        if (instanceMeshes[i] == mesh) {
+            instanceLocal.SetBounds(i, boundsMin, boundsMax);
+        }
+    }
+    areBoundsDirty = true;
+}
+
+/**
+ * Instances of meshes without vertices have empty bounds and are left out
+ */
+void MySceneGraph::GetWorldBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const {
+
+    boundsMin = glm::vec3(FLT_MAX);
+    boundsMax = glm::vec3(-FLT_MAX);
+    for (unsigned int i = 0; i < instanceMeshes.size(); ++i) {
+        glm::vec3 localMin, localMax, worldMin, worldMax;
+        instanceLocal.GetBounds(i, localMin, localMax);
+        if (localMin.x > localMax.x) {
+            continue;
+        }
+        instanceWorld.GetBounds(i, worldMin, worldMax);
+        boundsMin = glm::min(boundsMin, worldMin);
+        boundsMax = glm::max(boundsMax, worldMax);
+    }
+}
+
+unsigned int MySceneGraph::CullInstances(const glm::vec4 planes[6],
+                                         unsigned char *visible) const {
+    return instanceWorld.CullBounds(planes, visible);
+}
+
+size_t MySceneGraph::GetMemoryBytes() const {
+    size_t bytes = parents.capacity() * sizeof(int) +
+                   (subtreeEnds.capacity() + firstInstances.capacity() +
+                    instanceNodes.capacity() + instanceMeshes.capacity()) * sizeof(unsigned int) +
+                   (localMatrices.capacity() + worldMatrices.capacity()) * sizeof(glm::mat4) +
+                   isDirty.capacity() + dirtyNodes.capacity() * sizeof(unsigned int) +
+                   names.capacity() * sizeof(std::string) +
+                   (instanceLocal.GetCount() + instanceWorld.GetCount()) * 22 * sizeof(float);
+    for (unsigned int n = 0; n < names.size(); ++n) {
+        bytes += names[n].capacity();
+    }
+    return bytes;
+}
@@ -0,0 +1,97 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// The aiNode tree flattened into arrays in depth-first order, so a node's parent always comes
+// before it and every subtree is one contiguous range of nodes. Meshes are not copied: a node
+// refers to the loader's meshes by index, and a mesh used by several nodes is drawn once for
+// each of them. An instance is one (node, mesh) pair, instances are stored in node order too
+
+#ifndef MY_SCENE_GRAPH_H
+#define MY_SCENE_GRAPH_H
+
+#include "myGLM.h"
+#include "myTransformBatch.h"
+#include <assimp/scene.h>
+#include <string>
+#include <vector>
+
+// a node of a tree that does not come from Assimp, e.g. a glTF scene, listed depth-first
+struct MySceneNode {
+    std::string                 name;
+    int                         parent;         // an earlier node, -1 for the root
+    glm::mat4                   localMatrix;
+    std::vector<unsigned int>   meshes;
+};
+
+class MySceneGraph {
+public:
+    MySceneGraph();
+
+    // a scene without nodes gets a single root that uses every mesh
+    void            Build(const aiScene *scene);
+    // nodes[0] is the root and every other node comes after its parent and its earlier siblings'
+    // subtrees; an empty list gives a graph without nodes
+    void            Build(const std::vector<MySceneNode> &nodes);
+    void            Clear();
+
+    unsigned int    GetNumberOfNodes() const { return parents.size(); }
+    int             GetParent(unsigned int node) const { return parents[node]; }
+    const std::string & GetName(unsigned int node) const { return names[node]; }
+    int             FindNode(const std::string &name) const;   // -1 if there is none
+
+    void            SetLocalMatrix(unsigned int node, const glm::mat4 &matrix);
+    const glm::mat4 & GetLocalMatrix(unsigned int node) const { return localMatrices[node]; }
+    // as of the last UpdateWorldMatrices
+    const glm::mat4 & GetWorldMatrix(unsigned int node) const { return worldMatrices[node]; }
+
+    // recomputes the subtrees under nodes changed since the last call and the world bounds of
+    // their instances, returns the number of nodes recomputed. Does not allocate
+    unsigned int    UpdateWorldMatrices();
+
+    unsigned int    GetNumberOfInstances() const { return instanceNodes.size(); }
+    unsigned int    GetInstanceNode(unsigned int instance) const { return instanceNodes[instance]; }
+    unsigned int    GetInstanceMesh(unsigned int instance) const { return instanceMeshes[instance]; }
+
+    // model-space bounds of a mesh, applied to every instance of it
+    void            SetMeshBounds(unsigned int mesh, const glm::vec3 &boundsMin,
+                                  const glm::vec3 &boundsMax);
+    void            GetWorldBounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const;
+    // visible[i] for every instance i, see MyTransformBatch::CullBounds
+    unsigned int    CullInstances(const glm::vec4 planes[6], unsigned char *visible) const;
+
+    size_t          GetMemoryBytes() const;
+
+private:
+    void            AddNode(const aiNode *node, int parent);
+    void            FinishBuild();
+
+    std::vector<int>            parents;            // -1 for the root
+    std::vector<unsigned int>   subtreeEnds;        // one past the node's last descendant
+    std::vector<std::string>    names;
+    std::vector<glm::mat4>      localMatrices;      // relative to the parent
+    std::vector<glm::mat4>      worldMatrices;      // relative to the root's parent
+    std::vector<unsigned char>  isDirty;            // local matrix changed since the last update
+    std::vector<unsigned int>   dirtyNodes;         // the nodes with isDirty set, reserved for all
+    bool                        areBoundsDirty;     // world bounds need recomputing
+
+    std::vector<unsigned int>   firstInstances;     // per node, and one past the last instance
+    std::vector<unsigned int>   instanceNodes;
+    std::vector<unsigned int>   instanceMeshes;
+    MyTransformBatch            instanceLocal;      // world matrix and model-space mesh bounds
+    MyTransformBatch            instanceWorld;      // world bounds for culling
+};
+
+#endif //MY_SCENE_GRAPH_H
@@ -16,55 +16,243 @@
 
 #include "myShader.h"
 #include "myJNIHelper.h"
+#include <chrono>
 #include <iostream>
-#include <fstream>
+#include <string.h>
+
+#ifdef __ANDROID__
+#include <EGL/egl.h>
+#endif
+
+#define MY_PROGRAM_BINARY_MAGIC     0x4250594d  // "MYPB"
+
+// written in front of the binary; the file is named after the hash of the sources
+struct ProgramBinaryHeader {
+    uint32_t    magic;
+    uint32_t    binaryFormat;
+    uint32_t    binaryLength;
+    float       compileMs;      // what compiling and linking took when the binary was saved
+    uint64_t    driverHash;     // of GL_VENDOR, GL_RENDERER and GL_VERSION
+};
+
+struct ProgramBinaryFunctions {
+    PFNGLGETPROGRAMBINARYOESPROC    getProgramBinary;
+    PFNGLPROGRAMBINARYOESPROC       programBinary;
+};
+
+static ProgramCacheStats gProgramCacheStats = {0, 0, 0, 0, 0, 0};
+
+typedef std::chrono::steady_clock ShaderClock;
+
+static double ElapsedMs(ShaderClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(ShaderClock::now() - start).count();
+}
 
 /**
- * Read the shader code from assets
+ * FNV-1a, continuing from hash
  */
-bool ReadShaderCode(std::string & shaderCode, std::string & shaderFileName) {
+static uint64_t HashString(const char *text, uint64_t hash = 14695981039346656037ULL) {
+    for (; text && *text; ++text) {
+        hash = (hash ^ (unsigned char) *text) * 1099511628211ULL;
+    }
+    // a separator, so that "ab" + "c" and "a" + "bc" differ
+    return (hash ^ 0xff) * 1099511628211ULL;
+}
 
-    MyLOGI("Reading shader: %s", shaderFileName.c_str());
+// the GLES 3 entry points, called through wrappers so that glGetProgramBinary may be a
+// function, a gl3stub pointer or a dispatch table member
+static void GL_APIENTRY GetProgramBinaryES3(GLuint program, GLsizei bufSize, GLsizei *length,
+                                            GLenum *binaryFormat, void *binary) {
+    glGetProgramBinary(program, bufSize, length, binaryFormat, binary);
+}
 
-    // android shaders are stored in assets
-    // read them using MyJNIHelper
-    bool isFilePresent = gHelperObject->ExtractAssetReturnFilename(shaderFileName,
-                                                                                shaderFileName);
-    if( !isFilePresent ) {
-        return false;
+static void GL_APIENTRY ProgramBinaryES3(GLuint program, GLenum binaryFormat,
+                                         const void *binary, GLint length) {
+    glProgramBinary(program, binaryFormat, binary, length);
+}
+
+/**
+ * Core in GLES 3 if gl3stub found its entry points, else OES_get_program_binary. NULL if the
+ * context has neither or offers no binary format, as drivers without a shader cache do.
+ * Resolved by the first program, the driver does not change while the app runs
+ */
+static const ProgramBinaryFunctions * GetProgramBinaryFunctions() {
+
+    static bool isResolved = false;
+    static bool isSupported = false;
+    static ProgramBinaryFunctions functions;
+    if (isResolved) {
+        return isSupported ? &functions : NULL;
+    }
+    isResolved = true;
+
+    functions.getProgramBinary = NULL;
+    functions.programBinary = NULL;
+    const char *version = (const char *) glGetString(GL_VERSION);
+    if (version && strstr(version, "OpenGL ES 3.") && gl3stubInit()) {
+        functions.getProgramBinary = GetProgramBinaryES3;
+        functions.programBinary = ProgramBinaryES3;
+    }
+#ifdef __ANDROID__
+    else if (strstr((const char *) glGetString(GL_EXTENSIONS), "GL_OES_get_program_binary")) {
+        functions.getProgramBinary = (PFNGLGETPROGRAMBINARYOESPROC)
+                eglGetProcAddress("glGetProgramBinaryOES");
+        functions.programBinary = (PFNGLPROGRAMBINARYOESPROC)
+                eglGetProcAddress("glProgramBinaryOES");
+    }
+#endif
+    if (!functions.getProgramBinary || !functions.programBinary) {
+        return NULL;
+    }
+    GLint numberOfFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &numberOfFormats);
+    isSupported = numberOfFormats > 0;
+    return isSupported ? &functions : NULL;
+}
+
+/**
+ * The program saved for these sources by an earlier run, 0 if there is none, it was saved by
+ * another driver or this driver refuses it
+ */
+static GLuint LoadProgramBinary(const ProgramBinaryFunctions &functions,
+                                const std::string &binaryFileName, uint64_t driverHash) {
+
+    FILE *binaryFile = fopen(binaryFileName.c_str(), "rb");
+    if (!binaryFile) {
+        gProgramCacheStats.misses++;
+        return 0;
+    }
+    ShaderClock::time_point start = ShaderClock::now();
+    ProgramBinaryHeader header;
+    std::vector<char> binary;
+    bool isValid = fread(&header, sizeof(header), 1, binaryFile) == 1 &&
+                   header.magic == MY_PROGRAM_BINARY_MAGIC && header.driverHash == driverHash;
+    // a damaged header must not make us allocate more than the file holds
+    long binaryStart = isValid ? ftell(binaryFile) : -1;
+    long fileBytes = binaryStart >= 0 && fseek(binaryFile, 0, SEEK_END) == 0 ?
+                     ftell(binaryFile) : -1;
+    isValid = isValid && header.binaryLength > 0 && fileBytes >= binaryStart &&
+              header.binaryLength <= (unsigned long) (fileBytes - binaryStart) &&
+              fseek(binaryFile, binaryStart, SEEK_SET) == 0;
+    if (isValid) {
+        binary.resize(header.binaryLength);
+        isValid = fread(&binary[0], 1, binary.size(), binaryFile) == binary.size();
     }
+    fclose(binaryFile);
 
-    std::ifstream shaderStream(shaderFileName.c_str(), std::ios::in);
-    if (shaderStream.is_open()) {
-        std::string Line = "";
-        while (getline(shaderStream, Line)) {
-            shaderCode += "\n" + Line;
+    GLuint programID = 0;
+    if (isValid) {
+        programID = glCreateProgram();
+        functions.programBinary(programID, header.binaryFormat, &binary[0], binary.size());
+        GLint result = GL_FALSE;
+        glGetProgramiv(programID, GL_LINK_STATUS, &result);
+        if (!result) {
+            glDeleteProgram(programID);
+            programID = 0;
         }
-        shaderStream.close();
-    } else {
-        MyLOGF("Cannot open %s", shaderFileName.c_str());
+    }
+    // the driver may leave an error behind for a binary it refuses
+    while (glGetError() != GL_NO_ERROR);
+
+    if (!programID) {
+        MyLOGI("Program binary %s is stale, compiling", binaryFileName.c_str());
+        gProgramCacheStats.rejected++;
+        return 0;
+    }
+    double loadMs = ElapsedMs(start);
+    gProgramCacheStats.hits++;
+    gProgramCacheStats.loadMs += loadMs;
+    gProgramCacheStats.savedMs += header.compileMs - loadMs;
+    MyLOGI("Loaded program binary in %.2f ms instead of compiling for %.2f ms", loadMs,
+           header.compileMs);
+    return programID;
+}
+
+/**
+ * Write over the binary of an earlier driver or of a refused one. The binary goes to a
+ * temporary file that is renamed once complete, so that a crash or a full disk never leaves
+ * a truncated binary under the real name
+ */
+static void SaveProgramBinary(const ProgramBinaryFunctions &functions, GLuint programID,
+                              const std::string &binaryFileName, uint64_t driverHash,
+                              double compileMs) {
+
+    GLint binaryLength = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH_OES, &binaryLength);
+    if (binaryLength <= 0) {
+        return;
+    }
+    std::vector<char> binary(binaryLength);
+    ProgramBinaryHeader header;
+    GLenum binaryFormat = 0;
+    GLsizei length = 0;
+    functions.getProgramBinary(programID, binaryLength, &length, &binaryFormat, &binary[0]);
+    if (length <= 0) {
+        return;
+    }
+    header.magic = MY_PROGRAM_BINARY_MAGIC;
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = length;
+    header.compileMs = compileMs;
+    header.driverHash = driverHash;
+
+    std::string temporaryFileName = binaryFileName + ".tmp";
+    FILE *binaryFile = fopen(temporaryFileName.c_str(), "wb");
+    if (!binaryFile) {
+        MyLOGE("Cannot write %s", temporaryFileName.c_str());
+        return;
+    }
+    bool isWritten = fwrite(&header, sizeof(header), 1, binaryFile) == 1 &&
+                     fwrite(&binary[0], 1, length, binaryFile) == (size_t) length;
+    isWritten = fclose(binaryFile) == 0 && isWritten;
+    if (!isWritten || rename(temporaryFileName.c_str(), binaryFileName.c_str()) != 0) {
+        MyLOGE("Cannot write %s", binaryFileName.c_str());
+        remove(temporaryFileName.c_str());
+    }
+}
+
+ProgramCacheStats GetProgramCacheStats() {
+    return gProgramCacheStats;
+}
+
+/**
+ * Read the shader code from assets, straight from memory
+ */
+bool ReadShaderCode(std::string & shaderCode, const std::string & shaderFileName) {
+
+    MyLOGI("Reading shader: %s", shaderFileName.c_str());
+
+    MyAssetBuffer shaderBuffer;
+    if (!gHelperObject->ReadAsset(shaderFileName, shaderBuffer)) {
         return false;
     }
+    shaderCode.assign((const char *) shaderBuffer.GetData(), shaderBuffer.GetSize());
 
     MyLOGI("Read successfully");
     return true;
 }
 
 /**
- * Compile the shader and log any error messages
+ * Start compiling a shader, CheckShaderCompile waits for the result
  */
-bool CompileShader(GLuint & shaderID, const GLenum shaderType, std::string shaderCode) {
+static GLuint IssueShaderCompile(const GLenum shaderType, const std::string &shaderCode) {
 
     // Create the shader
-    shaderID = glCreateShader(shaderType);
+    GLuint shaderID = glCreateShader(shaderType);
 
     // Compile Shader
     MyLOGI("Compiling shader");
     char const * sourcePointer = shaderCode.c_str();
     glShaderSource(shaderID, 1, &sourcePointer, NULL);
     glCompileShader(shaderID);
+    return shaderID;
+}
+
+/**
+ * Check the shader and log any error messages
+ */
+static bool CheckShaderCompile(GLuint shaderID) {
 
-    // Check Shader
     GLint result = GL_FALSE;
     int infoLogLength;
 
@@ -85,40 +273,21 @@ bool CompileShader(GLuint & shaderID, const GLenum shaderType, std::string shade
 }
 
 /**
- * Link the vertex and fragment shaders together
+ * Check the link of the program and log any error messages
  */
-bool LinkProgram(GLuint programID, GLuint vertexShaderID,
-                 GLuint fragmentShaderID) {
+static bool CheckProgramLink(GLuint programID) {
+
     GLint result = GL_FALSE;
     int infoLogLength;
 
-    MyLOGI("Linking program");
-
-    glAttachShader(programID, vertexShaderID);
-    glAttachShader(programID, fragmentShaderID);
-    glLinkProgram(programID);
-
-    // Check the program
     glGetProgramiv(programID, GL_LINK_STATUS, &result);
     glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-    // common deletes
-    if (vertexShaderID) {
-        glDeleteShader(vertexShaderID);
-    }
-    if (fragmentShaderID) {
-        glDeleteShader(fragmentShaderID);
-    }
-
     if (result == 0) {
         MyLOGI("Failed to link program: %d", programID);
         std::vector<char> programErrorMessage(infoLogLength + 1);
         glGetProgramInfoLog(programID, infoLogLength, NULL,
                             &programErrorMessage[0]);
         MyLOGI("%s", &programErrorMessage[0]);
-        if (programID) {
-            glDeleteProgram(programID);
-        }
         return false;
     }
     MyLOGI("Linked successfully");
@@ -127,43 +296,146 @@ bool LinkProgram(GLuint programID, GLuint vertexShaderID,
 }
 
 /**
- * Read the vertex & fragment shaders, compile and link them, return the program ID
+ * Read the vertex & fragment shaders and start compiling and linking them, or load the program
+ * saved for the same sources on the same driver by an earlier run
+ * Nothing here waits for the driver, so drivers that compile on their own threads work on all
+ * the programs begun before the first FinishLoadShaders
  */
-GLuint LoadShaders(std::string vertexShaderFilename,
-                   std::string fragmentShaderFilename) {
+bool BeginLoadShaders(std::string vertexShaderFilename, std::string fragmentShaderFilename,
+                      const std::string &defines, PendingProgram &program) {
 
-    GLuint vertexShaderID, fragmentShaderID, programID;
-    programID = glCreateProgram();
+    program.programID = program.vertexShaderID = program.fragmentShaderID = 0;
+    program.isFromBinary = false;
+    program.binaryFileName.clear();
+    program.issueMs = 0;
 
-    // read and compile the vertex shader
-    std::string vertexShaderCode;
-    if (!ReadShaderCode(vertexShaderCode, vertexShaderFilename)) {
+    // read the shaders, their code is the key of the program binary
+    std::string vertexShaderCode = defines;
+    std::string shaderCode;
+    if (!ReadShaderCode(shaderCode, vertexShaderFilename)) {
         MyLOGE("Error in reading Vertex shader");
-        return 0;
-    }
-    if (!CompileShader(vertexShaderID, GL_VERTEX_SHADER, vertexShaderCode)) {
-        MyLOGE("Error in compiling Vertex shader");
-        return 0;
+        return false;
     }
-
-    // read and compile the fragment shader
-    std::string fragmentShaderCode;
-    if (!ReadShaderCode(fragmentShaderCode, fragmentShaderFilename)) {
+    vertexShaderCode += shaderCode;
+    std::string fragmentShaderCode = defines;
+    if (!ReadShaderCode(shaderCode, fragmentShaderFilename)) {
         MyLOGE("Error in reading Fragment shader");
-        return 0;
+        return false;
     }
-    if (!CompileShader(fragmentShaderID, GL_FRAGMENT_SHADER, fragmentShaderCode)) {
-        MyLOGE("Error in compiling fragment shader");
-        return 0;
+    fragmentShaderCode += shaderCode;
+
+    const ProgramBinaryFunctions *binaryFunctions = GetProgramBinaryFunctions();
+    program.driverHash = HashString((const char *) glGetString(GL_VENDOR));
+    program.driverHash = HashString((const char *) glGetString(GL_RENDERER), program.driverHash);
+    program.driverHash = HashString((const char *) glGetString(GL_VERSION), program.driverHash);
+    if (binaryFunctions) {
+        char binaryName[32];
+        snprintf(binaryName, sizeof(binaryName), "program_%016llx.bin", (unsigned long long)
+                HashString(fragmentShaderCode.c_str(), HashString(vertexShaderCode.c_str())));
+        program.binaryFileName = gHelperObject->GetInternalPath() + "/" + binaryName;
+        program.programID = LoadProgramBinary(*binaryFunctions, program.binaryFileName,
+                                              program.driverHash);
+        if (program.programID) {
+            program.isFromBinary = true;
+            return true;
+        }
+    } else {
+        gProgramCacheStats.misses++;
     }
 
+    ShaderClock::time_point start = ShaderClock::now();
+    program.programID = glCreateProgram();
+    program.vertexShaderID = IssueShaderCompile(GL_VERTEX_SHADER, vertexShaderCode);
+    program.fragmentShaderID = IssueShaderCompile(GL_FRAGMENT_SHADER, fragmentShaderCode);
+
     // Link both the shaders together
-    if (!LinkProgram(programID, vertexShaderID, fragmentShaderID)) {
+    MyLOGI("Linking program");
+    glAttachShader(program.programID, program.vertexShaderID);
+    glAttachShader(program.programID, program.fragmentShaderID);
+    glLinkProgram(program.programID);
+    program.issueMs = ElapsedMs(start);
+    return true;
+}
+
+/**
+ * With KHR_parallel_shader_compile the driver says when a link is done; without it there is no
+ * way to tell, and only programs loaded from a binary are known to be ready
+ */
+bool IsProgramReady(const PendingProgram &program) {
+
+    static int isParallelCompileSupported = -1;
+    if (isParallelCompileSupported < 0) {
+        const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+        isParallelCompileSupported = extensions &&
+                                     strstr(extensions, "GL_KHR_parallel_shader_compile");
+    }
+    if (program.isFromBinary) {
+        return true;
+    }
+    if (!isParallelCompileSupported) {
+        return false;
+    }
+    GLint isDone = GL_FALSE;
+    glGetProgramiv(program.programID, MY_GL_COMPLETION_STATUS_KHR, &isDone);
+    return isDone == GL_TRUE;
+}
+
+/**
+ * Wait for the compiles and the link begun by BeginLoadShaders, return the program ID
+ * A newly linked program is saved for the next run
+ */
+GLuint FinishLoadShaders(PendingProgram &program) {
+
+    if (program.isFromBinary || !program.programID) {
+        return program.programID;
+    }
+
+    ShaderClock::time_point start = ShaderClock::now();
+    bool isLinked = true;
+    if (!CheckShaderCompile(program.vertexShaderID)) {
+        MyLOGE("Error in compiling Vertex shader");
+        isLinked = false;
+    } else if (!CheckShaderCompile(program.fragmentShaderID)) {
+        MyLOGE("Error in compiling fragment shader");
+        isLinked = false;
+    } else if (!CheckProgramLink(program.programID)) {
         MyLOGE("Error in linking shaders");
+        isLinked = false;
+    }
+
+    // common deletes
+    glDeleteShader(program.vertexShaderID);
+    glDeleteShader(program.fragmentShaderID);
+    program.vertexShaderID = program.fragmentShaderID = 0;
+    if (!isLinked) {
+        glDeleteProgram(program.programID);
+        program.programID = 0;
         return 0;
     }
+    double compileMs = program.issueMs + ElapsedMs(start);
+    gProgramCacheStats.compileMs += compileMs;
 
-    return programID;
+    const ProgramBinaryFunctions *binaryFunctions = GetProgramBinaryFunctions();
+    if (!program.binaryFileName.empty() && binaryFunctions) {
+        SaveProgramBinary(*binaryFunctions, program.programID, program.binaryFileName,
+                          program.driverHash, compileMs);
+    }
+    return program.programID;
+}
+
+/**
+ * Read the vertex & fragment shaders, compile and link them, return the program ID
+ * The linked program is saved next to the extracted assets, and later calls with the same
+ * sources on the same driver load it instead of compiling
+ */
+GLuint LoadShaders(std::string vertexShaderFilename, std::string fragmentShaderFilename,
+                   const std::string &defines) {
+
+    PendingProgram program;
+    if (!BeginLoadShaders(vertexShaderFilename, fragmentShaderFilename, defines, program)) {
+        return 0;
+    }
+    return FinishLoadShaders(program);
 }
 
 /*
@@ -188,7 +460,6 @@ GLint GetUniformLocation(GLuint programID, std::string uniformName) {
     GLint loc = glGetUniformLocation(programID, uniformName.c_str());
     if (loc == -1) {
         MyLOGF("error in uniform: %s", uniformName.c_str());
-    } else {
-        return loc;
     }
+    return loc;
 }
@@ -18,9 +18,43 @@
 #define MY_SHADER_H
 #include "myGLFunctions.h"
 #include "myLogger.h"
+#include <stdint.h>
 #include <string>
 
-GLuint LoadShaders(std::string vertexShaderCode, std::string fragmentShaderCode);
+// from KHR_parallel_shader_compile, not in older GL headers
+#define MY_GL_COMPLETION_STATUS_KHR     0x91B1
+
+// linked programs are saved with glGetProgramBinary and loaded on later runs
+struct ProgramCacheStats {
+    unsigned long   hits;           // programs loaded from a saved binary
+    unsigned long   misses;         // compiled, no binary or binaries not supported
+    unsigned long   rejected;       // compiled, the binary was from another driver or refused
+    double          loadMs;         // loading the hits
+    double          compileMs;      // compiling and linking the rest
+    double          savedMs;        // compile + link time of the hits when they were saved,
+                                    // minus loadMs
+};
+
+// a program whose compiles and link were issued but not checked yet
+struct PendingProgram {
+    GLuint          programID;
+    GLuint          vertexShaderID, fragmentShaderID;   // 0 once checked or if from a binary
+    bool            isFromBinary;
+    std::string     binaryFileName;     // where the linked program is saved, empty if nowhere
+    uint64_t        driverHash;
+    double          issueMs;            // spent issuing the compiles and the link
+};
+
+GLuint LoadShaders(std::string vertexShaderFilename, std::string fragmentShaderFilename,
+                   const std::string &defines = "");
+// LoadShaders in two halves, so that several programs can compile at once; defines go in front
+// of both shaders
+bool BeginLoadShaders(std::string vertexShaderFilename, std::string fragmentShaderFilename,
+                      const std::string &defines, PendingProgram &program);
+// FinishLoadShaders would not wait; false while the driver compiles or if it cannot tell
+bool IsProgramReady(const PendingProgram &program);
+GLuint FinishLoadShaders(PendingProgram &program);
+ProgramCacheStats GetProgramCacheStats();
 GLuint GetAttributeLocation(GLuint programID, std::string variableName);
 GLint GetUniformLocation(GLuint programID, std::string uniformName);
 
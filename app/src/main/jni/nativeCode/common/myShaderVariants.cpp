@@ -0,0 +1,213 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myShaderVariants.h"
+#include <chrono>
+#include <string.h>
+
+#ifdef __ANDROID__
+#include <EGL/egl.h>
+#endif
+
+typedef void (GL_APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+/**
+ * Let the driver use as many compiler threads as it likes, it picks a small number by default
+ */
+static void AllowParallelCompile() {
+#ifdef __ANDROID__
+    const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "GL_KHR_parallel_shader_compile")) {
+        return;
+    }
+    MaxShaderCompilerThreadsProc maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)
+            eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    if (maxShaderCompilerThreads) {
+        maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+#endif
+}
+
+static const char *gLightingTierNames[LIGHTING_TIER_COUNT] = {"unlit", "vertex", "pixel"};
+
+unsigned int SelectShaderVariant(bool isTextured, bool hasVertexColors, bool hasNormals,
+                                 bool hasNormalMap, bool hasTangents) {
+    unsigned int variant = (isTextured ? SHADER_VARIANT_TEXTURED : 0) |
+                           (hasVertexColors ? SHADER_VARIANT_VERTEX_COLOR : 0);
+    if (hasNormals) {
+        variant |= SHADER_VARIANT_LIT | SHADER_VARIANT_PER_PIXEL;
+        if (isTextured && hasNormalMap && hasTangents) {
+            variant |= SHADER_VARIANT_NORMAL_MAP;
+        }
+    }
+    return variant;
+}
+
+unsigned int ApplyLightingTier(unsigned int variant, LightingTier lightingTier) {
+    switch (lightingTier) {
+        case LIGHTING_UNLIT:
+            return variant & ~(SHADER_VARIANT_LIT | SHADER_VARIANT_PER_PIXEL |
+                               SHADER_VARIANT_NORMAL_MAP);
+        case LIGHTING_PER_VERTEX:
+            return variant & ~(SHADER_VARIANT_PER_PIXEL | SHADER_VARIANT_NORMAL_MAP);
+        default:
+            return variant;
+    }
+}
+
+/**
+ * Every variant SelectShaderVariant can return, as drawn at the tier
+ */
+unsigned int GetShaderVariantMask(LightingTier lightingTier) {
+
+    unsigned int variantMask = 0;
+    for (unsigned int features = 0; features < 16; ++features) {
+        unsigned int variant = SelectShaderVariant(features & 1, features & 2, features & 4,
+                                                   features & 8, features & 8);
+        variantMask |= 1u << ApplyLightingTier(variant, lightingTier);
+    }
+    return variantMask;
+}
+
+const char * GetLightingTierName(LightingTier lightingTier) {
+    return lightingTier < LIGHTING_TIER_COUNT ? gLightingTierNames[lightingTier] : "unknown";
+}
+
+bool GetLightingTierByName(const std::string &tierName, LightingTier &lightingTier) {
+    for (int i = 0; i < LIGHTING_TIER_COUNT; ++i) {
+        if (tierName == gLightingTierNames[i]) {
+            lightingTier = (LightingTier) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+MyShaderVariants & GetShaderVariants() {
+    static MyShaderVariants shaderVariants;
+    return shaderVariants;
+}
+
+MyShaderVariants::MyShaderVariants() {
+    Reset();
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MyShaderVariants::Reset() {
+    for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; ++v) {
+        memset(&variants[v], 0, sizeof(variants[v]));
+        pendingPrograms[v].programID = 0;
+        states[v] = VARIANT_NONE;
+    }
+}
+
+void MyShaderVariants::Begin(unsigned int variant) {
+
+    std::string defines;
+    if (variant & SHADER_VARIANT_TEXTURED) {
+        defines += "#define MY_TEXTURED\n";
+    }
+    if (variant & SHADER_VARIANT_VERTEX_COLOR) {
+        defines += "#define MY_VERTEX_COLOR\n";
+    }
+    if (variant & SHADER_VARIANT_LIT) {
+        defines += "#define MY_LIT\n";
+    }
+    if (variant & SHADER_VARIANT_PER_PIXEL) {
+        defines += "#define MY_PER_PIXEL\n";
+    }
+    if (variant & SHADER_VARIANT_NORMAL_MAP) {
+        defines += "#define MY_NORMAL_MAP\n";
+    }
+    bool isBegun = BeginLoadShaders("shaders/model.vsh", "shaders/model.fsh", defines,
+                                    pendingPrograms[variant]);
+    states[variant] = isBegun ? VARIANT_PENDING : VARIANT_FAILED;
+}
+
+/**
+ * Check the program and look up its inputs
+ */
+void MyShaderVariants::Finish(unsigned int variant) {
+
+    GLuint programID = FinishLoadShaders(pendingPrograms[variant]);
+    if (!programID) {
+        MyLOGE("Shader variant %u failed", variant);
+        states[variant] = VARIANT_FAILED;
+        return;
+    }
+    ShaderVariant &shaderVariant = variants[variant];
+    shaderVariant.programID = programID;
+    shaderVariant.vertexAttribute = glGetAttribLocation(programID, "vertexPosition");
+    shaderVariant.vertexUVAttribute = glGetAttribLocation(programID, "vertexUV");
+    shaderVariant.vertexColorAttribute = glGetAttribLocation(programID, "vertexColor");
+    shaderVariant.vertexNormalAttribute = glGetAttribLocation(programID, "vertexNormal");
+    shaderVariant.vertexTangentAttribute = glGetAttribLocation(programID, "vertexTangent");
+    shaderVariant.mvpLocation = glGetUniformLocation(programID, "mvpMat");
+    shaderVariant.normalMatLocation = glGetUniformLocation(programID, "normalMat");
+    shaderVariant.worldMatLocation = glGetUniformLocation(programID, "worldMat");
+    shaderVariant.textureSamplerLocation = glGetUniformLocation(programID, "textureSampler");
+    shaderVariant.normalSamplerLocation = glGetUniformLocation(programID, "normalSampler");
+    shaderVariant.diffuseColorLocation = glGetUniformLocation(programID, "diffuseColor");
+    shaderVariant.lightDirectionLocation = glGetUniformLocation(programID, "lightDirection");
+    CheckGLError("MyShaderVariants::Finish");
+    states[variant] = VARIANT_READY;
+}
+
+/**
+ * All compiles and links are issued before any status is asked for, asking would make the
+ * driver finish the program asked about first
+ */
+void MyShaderVariants::Precompile(unsigned int variantMask) {
+
+    AllowParallelCompile();
+    for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; ++v) {
+        if ((variantMask & (1u << v)) && states[v] == VARIANT_NONE) {
+            Begin(v);
+            stats.precompiled++;
+        }
+    }
+}
+
+void MyShaderVariants::Update() {
+    for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; ++v) {
+        if (states[v] == VARIANT_PENDING && IsProgramReady(pendingPrograms[v])) {
+            Finish(v);
+            stats.finishedInUpdate++;
+        }
+    }
+}
+
+const ShaderVariant * MyShaderVariants::GetVariant(unsigned int variant) {
+
+    if (variant >= SHADER_VARIANT_COUNT) {
+        return NULL;
+    }
+    if (states[variant] != VARIANT_READY && states[variant] != VARIANT_FAILED) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (states[variant] == VARIANT_NONE) {
+            stats.compiledOnUse++;
+            Begin(variant);
+        } else {
+            stats.waited++;
+        }
+        if (states[variant] == VARIANT_PENDING) {
+            Finish(variant);
+        }
+        stats.waitMs += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+    return states[variant] == VARIANT_READY ? &variants[variant] : NULL;
+}
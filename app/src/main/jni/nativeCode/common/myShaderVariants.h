@@ -0,0 +1,127 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Programs for every kind of mesh AssimpLoader draws, built from shaders/model.vsh and .fsh with
+// a #define per mesh feature. A mesh gets the variant of what it has, so meshes without a
+// texture no longer sample one. The variants are compiled all at once by Precompile, so that
+// drivers with compiler threads work on them in parallel while the first model loads.
+// GL thread only
+
+#ifndef MY_SHADER_VARIANTS_H
+#define MY_SHADER_VARIANTS_H
+
+#include "myGLFunctions.h"
+#include "myShader.h"
+
+// a variant is the OR of its features, untextured meshes use the material's diffuse color.
+// PER_PIXEL moves the lighting of LIT to the fragment shader, NORMAL_MAP adds a tangent-space
+// normal map to that and needs TEXTURED for the UVs
+enum ShaderVariantFlags {
+    SHADER_VARIANT_UNTEXTURED   = 0,
+    SHADER_VARIANT_TEXTURED     = 1,
+    SHADER_VARIANT_VERTEX_COLOR = 2,
+    SHADER_VARIANT_LIT          = 4,
+    SHADER_VARIANT_PER_PIXEL    = 8,
+    SHADER_VARIANT_NORMAL_MAP   = 16,
+    SHADER_VARIANT_COUNT        = 32
+};
+
+// how much of a mesh's lighting is drawn, cheapest first
+enum LightingTier {
+    LIGHTING_UNLIT,
+    LIGHTING_PER_VERTEX,
+    LIGHTING_PER_PIXEL,                 // with the normal map where the mesh has one
+    LIGHTING_TIER_COUNT
+};
+
+// locations are -1 where the variant does not have the input
+struct ShaderVariant {
+    GLuint  programID;
+    GLint   vertexAttribute;
+    GLint   vertexUVAttribute;
+    GLint   vertexColorAttribute;
+    GLint   vertexNormalAttribute;
+    GLint   vertexTangentAttribute;
+    GLint   mvpLocation;
+    GLint   normalMatLocation;      // lit variants: inverse-transpose of the node's world matrix
+    GLint   worldMatLocation;       // normal-mapped variants: the node's world matrix, for tangents
+    GLint   textureSamplerLocation;
+    GLint   normalSamplerLocation;
+    GLint   diffuseColorLocation;
+    GLint   lightDirectionLocation;
+};
+
+struct ShaderVariantStats {
+    unsigned int    precompiled;        // begun by Precompile
+    unsigned int    finishedInUpdate;   // of those, done before their first use
+    unsigned int    waited;             // first use had to wait for the compile
+    unsigned int    compiledOnUse;      // not precompiled, compiled by the first use
+    double          waitMs;             // spent by first uses on compiles
+};
+
+class MyShaderVariants {
+public:
+    MyShaderVariants();
+
+    // begin compiling the variants in the mask, one bit per variant, without waiting for any;
+    // see GetShaderVariantMask
+    void                    Precompile(unsigned int variantMask);
+    // from Render: pick up the variants the driver says are finished, never waits. Drivers
+    // without KHR_parallel_shader_compile cannot say, their variants are finished by GetVariant
+    // when a model that draws with them is uploaded
+    void                    Update();
+    // the program of a variant, compiled and linked now if it is not yet; NULL if it failed.
+    // May wait for the compiler, so not for Render
+    const ShaderVariant *   GetVariant(unsigned int variant);
+    // the program of a variant if it is finished, NULL otherwise; never waits
+    const ShaderVariant *   GetReadyVariant(unsigned int variant) const {
+        return variant < SHADER_VARIANT_COUNT && states[variant] == VARIANT_READY ?
+               &variants[variant] : NULL;
+    }
+    // the context is gone and its programs with it
+    void                    Reset();
+
+    ShaderVariantStats      GetStats() const { return stats; }
+
+private:
+    enum VariantState {
+        VARIANT_NONE,
+        VARIANT_PENDING,
+        VARIANT_READY,
+        VARIANT_FAILED
+    };
+
+    void                    Begin(unsigned int variant);
+    void                    Finish(unsigned int variant);
+
+    ShaderVariant           variants[SHADER_VARIANT_COUNT];
+    PendingProgram          pendingPrograms[SHADER_VARIANT_COUNT];
+    VariantState            states[SHADER_VARIANT_COUNT];
+    ShaderVariantStats      stats;
+};
+
+MyShaderVariants &  GetShaderVariants();
+// the most a mesh can be drawn with, hasTangents covers normals too
+unsigned int        SelectShaderVariant(bool isTextured, bool hasVertexColors, bool hasNormals,
+                                        bool hasNormalMap = false, bool hasTangents = false);
+// what a mesh selected with SelectShaderVariant is drawn with at a tier
+unsigned int        ApplyLightingTier(unsigned int variant, LightingTier lightingTier);
+// a bit for every variant that meshes can be drawn with at the tier
+unsigned int        GetShaderVariantMask(LightingTier lightingTier);
+const char *        GetLightingTierName(LightingTier lightingTier);
+bool                GetLightingTierByName(const std::string &tierName, LightingTier &lightingTier);
+
+#endif //MY_SHADER_VARIANTS_H
@@ -0,0 +1,352 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "myTransformBatch.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+// four floats per register; loads and stores are unaligned since std::vector only promises
+// 8-byte alignment on 32-bit Android
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MY_TRANSFORM_SIMD "neon"
+typedef float32x4_t Float4;
+typedef uint32x4_t  Mask4;
+static inline Float4 Load4(const float *p)                  { return vld1q_f32(p); }
+static inline void   Store4(float *p, Float4 a)             { vst1q_f32(p, a); }
+static inline Float4 Splat4(float a)                        { return vdupq_n_f32(a); }
+static inline Float4 Add4(Float4 a, Float4 b)               { return vaddq_f32(a, b); }
+static inline Float4 Mul4(Float4 a, Float4 b)               { return vmulq_f32(a, b); }
+static inline Float4 MulAdd4(Float4 a, Float4 b, Float4 c)  { return vmlaq_f32(c, a, b); }
+static inline Float4 Min4(Float4 a, Float4 b)               { return vminq_f32(a, b); }
+static inline Float4 Max4(Float4 a, Float4 b)               { return vmaxq_f32(a, b); }
+static inline Mask4  Less4(Float4 a, Float4 b)              { return vcltq_f32(a, b); }
+static inline Mask4  Or4(Mask4 a, Mask4 b)                  { return vorrq_u32(a, b); }
+static inline Mask4  NoMask4()                              { return vdupq_n_u32(0); }
+static inline int    MaskBits4(Mask4 a) {
+    return (vgetq_lane_u32(a, 0) & 1) | (vgetq_lane_u32(a, 1) & 2) |
+           (vgetq_lane_u32(a, 2) & 4) | (vgetq_lane_u32(a, 3) & 8);
+}
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define MY_TRANSFORM_SIMD "sse"
+typedef __m128 Float4;
+typedef __m128 Mask4;
+static inline Float4 Load4(const float *p)                  { return _mm_loadu_ps(p); }
+static inline void   Store4(float *p, Float4 a)             { _mm_storeu_ps(p, a); }
+static inline Float4 Splat4(float a)                        { return _mm_set1_ps(a); }
+static inline Float4 Add4(Float4 a, Float4 b)               { return _mm_add_ps(a, b); }
+static inline Float4 Mul4(Float4 a, Float4 b)               { return _mm_mul_ps(a, b); }
+static inline Float4 MulAdd4(Float4 a, Float4 b, Float4 c)  { return _mm_add_ps(c, _mm_mul_ps(a, b)); }
+static inline Float4 Min4(Float4 a, Float4 b)               { return _mm_min_ps(a, b); }
+static inline Float4 Max4(Float4 a, Float4 b)               { return _mm_max_ps(a, b); }
+static inline Mask4  Less4(Float4 a, Float4 b)              { return _mm_cmplt_ps(a, b); }
+static inline Mask4  Or4(Mask4 a, Mask4 b)                  { return _mm_or_ps(a, b); }
+static inline Mask4  NoMask4()                              { return _mm_setzero_ps(); }
+static inline int    MaskBits4(Mask4 a)                     { return _mm_movemask_ps(a); }
+#endif
+
+MyTransformBatch::MyTransformBatch() {
+    count = capacity = 0;
+}
+
+/**
+ * Rows are capacity long, so growing the capacity moves every row
+ */
+void MyTransformBatch::Resize(unsigned int count) {
+
+    unsigned int newCapacity = (count + 3) & ~3u;
+    if (newCapacity != capacity) {
+        std::vector<float> newMatrices(16 * newCapacity), newBounds(6 * newCapacity);
+        unsigned int keptCount = std::min(this->count, count);
+        for (unsigned int e = 0; e < 16; ++e) {
+            if (keptCount) {
+                memcpy(&newMatrices[e * newCapacity], Row(e), keptCount * sizeof(float));
+            }
+        }
+        for (unsigned int e = 0; e < 6; ++e) {
+            if (keptCount) {
+                memcpy(&newBounds[e * newCapacity], BoundsRow(e), keptCount * sizeof(float));
+            }
+        }
+        matrices.swap(newMatrices);
+        bounds.swap(newBounds);
+        capacity = newCapacity;
+    }
+    for (unsigned int i = this->count; i < count; ++i) {
+        SetMatrix(i, glm::mat4(1.0f));
+        SetBounds(i, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+    }
+    this->count = count;
+}
+
+void MyTransformBatch::SetMatrix(unsigned int index, const glm::mat4 &matrix) {
+    const float *elements = glm::value_ptr(matrix);
+    for (unsigned int e = 0; e < 16; ++e) {
+        Row(e)[index] = elements[e];
+    }
+}
+
+glm::mat4 MyTransformBatch::GetMatrix(unsigned int index) const {
+    glm::mat4 matrix;
+    float *elements = glm::value_ptr(matrix);
+    for (unsigned int e = 0; e < 16; ++e) {
+        elements[e] = Row(e)[index];
+    }
+    return matrix;
+}
+
+void MyTransformBatch::SetBounds(unsigned int index, const glm::vec3 &boundsMin,
+                                 const glm::vec3 &boundsMax) {
+    for (unsigned int axis = 0; axis < 3; ++axis) {
+        BoundsRow(axis)[index] = boundsMin[axis];
+        BoundsRow(axis + 3)[index] = boundsMax[axis];
+    }
+}
+
+void MyTransformBatch::GetBounds(unsigned int index, glm::vec3 &boundsMin,
+                                 glm::vec3 &boundsMax) const {
+    for (unsigned int axis = 0; axis < 3; ++axis) {
+        boundsMin[axis] = BoundsRow(axis)[index];
+        boundsMax[axis] = BoundsRow(axis + 3)[index];
+    }
+}
+
+// ---- mat4 x mat4 ----
+
+/**
+ * out[c][r] = sum over k of left[k][r] * right[c][k], left shared by all transforms
+ */
+void MyTransformBatch::MultiplyLeft(const glm::mat4 &left, const MyTransformBatch &right,
+                                    TransformKernel kernel) {
+
+    Resize(right.count);
+    const float *l = glm::value_ptr(left);
+    unsigned int i = 0;
+#ifdef MY_TRANSFORM_SIMD
+    if (kernel == TRANSFORM_KERNEL_SIMD) {
+        for (; i < capacity; i += 4) {
+            Float4 r[16];
+            for (unsigned int e = 0; e < 16; ++e) {
+                r[e] = Load4(right.Row(e) + i);
+            }
+            for (unsigned int c = 0; c < 4; ++c) {
+                for (unsigned int row = 0; row < 4; ++row) {
+                    Float4 sum = Mul4(Splat4(l[row]), r[c * 4]);
+                    sum = MulAdd4(Splat4(l[4 + row]), r[c * 4 + 1], sum);
+                    sum = MulAdd4(Splat4(l[8 + row]), r[c * 4 + 2], sum);
+                    sum = MulAdd4(Splat4(l[12 + row]), r[c * 4 + 3], sum);
+                    Store4(Row(c * 4 + row) + i, sum);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        float result[16];
+        for (unsigned int c = 0; c < 4; ++c) {
+            for (unsigned int row = 0; row < 4; ++row) {
+                result[c * 4 + row] = l[row] * right.Row(c * 4)[i] +
+                                      l[4 + row] * right.Row(c * 4 + 1)[i] +
+                                      l[8 + row] * right.Row(c * 4 + 2)[i] +
+                                      l[12 + row] * right.Row(c * 4 + 3)[i];
+            }
+        }
+        for (unsigned int e = 0; e < 16; ++e) {
+            Row(e)[i] = result[e];
+        }
+    }
+}
+
+void MyTransformBatch::Multiply(const MyTransformBatch &left, const MyTransformBatch &right,
+                                TransformKernel kernel) {
+
+    unsigned int newCount = std::min(left.count, right.count);
+    if (this != &left && this != &right) {
+        Resize(newCount);
+    }
+    unsigned int i = 0;
+#ifdef MY_TRANSFORM_SIMD
+    if (kernel == TRANSFORM_KERNEL_SIMD) {
+        for (; i + 4 <= ((newCount + 3) & ~3u); i += 4) {
+            Float4 l[16], r[16];
+            for (unsigned int e = 0; e < 16; ++e) {
+                l[e] = Load4(left.Row(e) + i);
+                r[e] = Load4(right.Row(e) + i);
+            }
+            for (unsigned int c = 0; c < 4; ++c) {
+                for (unsigned int row = 0; row < 4; ++row) {
+                    Float4 sum = Mul4(l[row], r[c * 4]);
+                    sum = MulAdd4(l[4 + row], r[c * 4 + 1], sum);
+                    sum = MulAdd4(l[8 + row], r[c * 4 + 2], sum);
+                    sum = MulAdd4(l[12 + row], r[c * 4 + 3], sum);
+                    Store4(Row(c * 4 + row) + i, sum);
+                }
+            }
+        }
+    }
+#endif
+    for (; i < newCount; ++i) {
+        float result[16];
+        for (unsigned int c = 0; c < 4; ++c) {
+            for (unsigned int row = 0; row < 4; ++row) {
+                result[c * 4 + row] = left.Row(row)[i] * right.Row(c * 4)[i] +
+                                      left.Row(4 + row)[i] * right.Row(c * 4 + 1)[i] +
+                                      left.Row(8 + row)[i] * right.Row(c * 4 + 2)[i] +
+                                      left.Row(12 + row)[i] * right.Row(c * 4 + 3)[i];
+            }
+        }
+        for (unsigned int e = 0; e < 16; ++e) {
+            Row(e)[i] = result[e];
+        }
+    }
+}
+
+// ---- bounds ----
+
+void MyTransformBatch::TransformBounds(const MyTransformBatch &source, TransformKernel kernel) {
+
+    if (this != &source) {
+        Resize(source.count);
+    }
+    TransformBounds(source, 0, count, kernel);
+}
+
+/**
+ * Arvo's method: each output axis starts at the translation and adds, for every input axis,
+ * the smaller (for min) or larger (for max) of the matrix entry times the box's min and max.
+ * The SIMD kernel starts at the group of four that holds first; transforms before first in
+ * that group are recomputed from the same source, so they do not change
+ */
+void MyTransformBatch::TransformBounds(const MyTransformBatch &source, unsigned int first,
+                                       unsigned int end, TransformKernel kernel) {
+
+    unsigned int i = first;
+#ifdef MY_TRANSFORM_SIMD
+    if (kernel == TRANSFORM_KERNEL_SIMD) {
+        for (i = first & ~3u; i < end; i += 4) {
+            Float4 boxMin[3], boxMax[3], newMin[3], newMax[3];
+            for (unsigned int axis = 0; axis < 3; ++axis) {
+                boxMin[axis] = Load4(source.BoundsRow(axis) + i);
+                boxMax[axis] = Load4(source.BoundsRow(axis + 3) + i);
+            }
+            for (unsigned int row = 0; row < 3; ++row) {
+                newMin[row] = newMax[row] = Load4(source.Row(12 + row) + i);
+                for (unsigned int k = 0; k < 3; ++k) {
+                    Float4 m = Load4(source.Row(k * 4 + row) + i);
+                    Float4 a = Mul4(m, boxMin[k]), b = Mul4(m, boxMax[k]);
+                    newMin[row] = Add4(newMin[row], Min4(a, b));
+                    newMax[row] = Add4(newMax[row], Max4(a, b));
+                }
+            }
+            for (unsigned int axis = 0; axis < 3; ++axis) {
+                Store4(BoundsRow(axis) + i, newMin[axis]);
+                Store4(BoundsRow(axis + 3) + i, newMax[axis]);
+            }
+        }
+    }
+#endif
+    for (; i < end; ++i) {
+        float newMin[3], newMax[3];
+        for (unsigned int row = 0; row < 3; ++row) {
+            newMin[row] = newMax[row] = source.Row(12 + row)[i];
+            for (unsigned int k = 0; k < 3; ++k) {
+                float m = source.Row(k * 4 + row)[i];
+                float a = m * source.BoundsRow(k)[i], b = m * source.BoundsRow(k + 3)[i];
+                newMin[row] += std::min(a, b);
+                newMax[row] += std::max(a, b);
+            }
+        }
+        for (unsigned int axis = 0; axis < 3; ++axis) {
+            BoundsRow(axis)[i] = newMin[axis];
+            BoundsRow(axis + 3)[i] = newMax[axis];
+        }
+    }
+}
+
+/**
+ * A box is outside if its corner furthest along a plane's normal is behind that plane. The
+ * corner is picked per plane from the signs of the normal, the same for every box
+ */
+unsigned int MyTransformBatch::CullBounds(const glm::vec4 planes[6], unsigned char *visible,
+                                          TransformKernel kernel) const {
+
+    unsigned int numberOfVisible = 0;
+    unsigned int i = 0;
+#ifdef MY_TRANSFORM_SIMD
+    if (kernel == TRANSFORM_KERNEL_SIMD) {
+        for (; i < capacity; i += 4) {
+            Mask4 isOutside = NoMask4();
+            for (unsigned int p = 0; p < 6; ++p) {
+                Float4 distance = Splat4(planes[p].w);
+                for (unsigned int axis = 0; axis < 3; ++axis) {
+                    const float *corner = planes[p][axis] > 0 ? BoundsRow(axis + 3) :
+                                                                BoundsRow(axis);
+                    distance = MulAdd4(Splat4(planes[p][axis]), Load4(corner + i), distance);
+                }
+                isOutside = Or4(isOutside, Less4(distance, Splat4(0)));
+            }
+            int outsideBits = MaskBits4(isOutside);
+            for (unsigned int lane = 0; lane < 4 && i + lane < count; ++lane) {
+                visible[i + lane] = (outsideBits >> lane) & 1 ? 0 : 1;
+                numberOfVisible += visible[i + lane];
+            }
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        bool isOutside = false;
+        for (unsigned int p = 0; p < 6 && !isOutside; ++p) {
+            float distance = planes[p].w;
+            for (unsigned int axis = 0; axis < 3; ++axis) {
+                distance += planes[p][axis] * (planes[p][axis] > 0 ? BoundsRow(axis + 3)[i] :
+                                                                     BoundsRow(axis)[i]);
+            }
+            isOutside = distance < 0;
+        }
+        visible[i] = isOutside ? 0 : 1;
+        numberOfVisible += visible[i];
+    }
+    return numberOfVisible;
+}
+
+/**
+ * Gribb/Hartmann: the planes are sums and differences of the fourth row of mvp with the others.
+ * Planes are not normalized, which the sign test does not need
+ */
+void ExtractFrustumPlanes(const glm::mat4 &mvp, glm::vec4 planes[6]) {
+
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; ++r) {
+        row[r] = glm::vec4(mvp[0][r], mvp[1][r], mvp[2][r], mvp[3][r]);
+    }
+    planes[0] = row[3] + row[0];    // left
+    planes[1] = row[3] - row[0];    // right
+    planes[2] = row[3] + row[1];    // bottom
+    planes[3] = row[3] - row[1];    // top
+    planes[4] = row[3] + row[2];    // near
+    planes[5] = row[3] - row[2];    // far
+}
+
+const char * GetTransformBatchSIMD() {
+#ifdef MY_TRANSFORM_SIMD
+    return MY_TRANSFORM_SIMD;
+#else
+    return "none";
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+ *    Copyright 2016 Anand Muralidhar
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+// Transforms and bounding boxes stored structure-of-arrays: element e of every matrix is one
+// contiguous row, so the kernels process four transforms per instruction with NEON or SSE,
+// with a scalar version of every kernel for other targets and for comparison.
+// glm's gtx/simd_mat4 is not used since it only builds with SSE2
+
+#ifndef MY_TRANSFORM_BATCH_H
+#define MY_TRANSFORM_BATCH_H
+
+#include "myGLM.h"
+#include <vector>
+
+enum TransformKernel {
+    TRANSFORM_KERNEL_SIMD,      // NEON or SSE, same as scalar if neither was compiled in
+    TRANSFORM_KERNEL_SCALAR
+};
+
+class MyTransformBatch {
+public:
+    MyTransformBatch();
+
+    void            Resize(unsigned int count);     // new transforms are identity, bounds empty
+    unsigned int    GetCount() const { return count; }
+
+    void            SetMatrix(unsigned int index, const glm::mat4 &matrix);
+    glm::mat4       GetMatrix(unsigned int index) const;
+    void            SetBounds(unsigned int index, const glm::vec3 &boundsMin,
+                              const glm::vec3 &boundsMax);
+    void            GetBounds(unsigned int index, glm::vec3 &boundsMin, glm::vec3 &boundsMax) const;
+
+    // matrix[i] = left * right.matrix[i], right may be this batch
+    void            MultiplyLeft(const glm::mat4 &left, const MyTransformBatch &right,
+                                 TransformKernel kernel = TRANSFORM_KERNEL_SIMD);
+    // matrix[i] = left.matrix[i] * right.matrix[i], either may be this batch
+    void            Multiply(const MyTransformBatch &left, const MyTransformBatch &right,
+                             TransformKernel kernel = TRANSFORM_KERNEL_SIMD);
+    // bounds[i] = box around source.bounds[i] transformed by source.matrix[i]
+    void            TransformBounds(const MyTransformBatch &source,
+                                    TransformKernel kernel = TRANSFORM_KERNEL_SIMD);
+    // the same for transforms first to end - 1 only, this batch must be as large as source
+    void            TransformBounds(const MyTransformBatch &source, unsigned int first,
+                                    unsigned int end, TransformKernel kernel = TRANSFORM_KERNEL_SIMD);
+    // visible[i] = 1 if bounds[i] is not entirely outside one of the planes, returns the count
+    unsigned int    CullBounds(const glm::vec4 planes[6], unsigned char *visible,
+                               TransformKernel kernel = TRANSFORM_KERNEL_SIMD) const;
+
+private:
+    float *         Row(unsigned int element) { return &matrices[element * capacity]; }
+    const float *   Row(unsigned int element) const { return &matrices[element * capacity]; }
+    float *         BoundsRow(unsigned int element) { return &bounds[element * capacity]; }
+    const float *   BoundsRow(unsigned int element) const { return &bounds[element * capacity]; }
+
+    unsigned int        count;
+    unsigned int        capacity;       // count rounded up to a multiple of 4
+    std::vector<float>  matrices;       // 16 rows, element column * 4 + row as in glm
+    std::vector<float>  bounds;         // 6 rows: min x, y, z, max x, y, z
+};
+
+// planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside, in the space that mvp transforms
+// from: the model's own space for a model-view-projection matrix
+void            ExtractFrustumPlanes(const glm::mat4 &mvp, glm::vec4 planes[6]);
+const char *    GetTransformBatchSIMD();    // "neon", "sse" or "none"
+
+#endif //MY_TRANSFORM_BATCH_H
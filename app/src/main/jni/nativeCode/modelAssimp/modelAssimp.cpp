@@ -16,21 +16,37 @@
 
 #include "myShader.h"
 #include "modelAssimp.h"
+#include "myAllocTracker.h"
+#include "myJobSystem.h"
+#include "myMeshPostProcess.h"
+#include "myShaderVariants.h"
 
 
 #include "assimp/Importer.hpp"
 #include <opencv2/opencv.hpp>
 #include <myJNIHelper.h>
+#include <algorithm>
+#include <string.h>
 
 using namespace std;
 
 /**
  * Class constructor
  */
-ModelAssimp::ModelAssimp() {
+ModelAssimp::ModelAssimp() : modelPreloader(&modelCache) {
 
     MyLOGD("ModelAssimp::ModelAssimp");
     initsDone = false;
+    keepPickingData = false;
+    measureImportSteps = false;
+    screenWidth = screenHeight = 1;
+    pendingGestureTimeNs = 0;
+    gestureLatencyCount = 0;
+    gestureEventsApplied = gestureEventsCoalesced = 0;
+    postProcessThreads = GetDefaultPostProcessThreads();
+    lastModelRequest = 0;
+    memset(&cancelStats, 0, sizeof(cancelStats));
+    lastFrameTimeNs = 0;
 
     // create MyGLCamera object and set default position for the object
     myGLCamera = new MyGLCamera();
@@ -38,7 +54,7 @@ ModelAssimp::ModelAssimp() {
     std::copy(&pos[0], &pos[5], std::back_inserter(modelDefaultPosition));
     myGLCamera->SetModelPosition(modelDefaultPosition);
 
-    modelObject = NULL;
+    assetCatalog.Load();
 }
 
 ModelAssimp::~ModelAssimp() {
@@ -47,114 +63,322 @@ ModelAssimp::~ModelAssimp() {
     if (myGLCamera) {
         delete myGLCamera;
     }
-    if (modelObject) {
-        delete modelObject;
-    }
+    // the cache deletes the models
 }
 
 /**
  * Perform inits and load the triangle's vertices/colors to GLES
+ * Called again when the context was recreated: the models' GL objects went with the old
+ * context, so every model is dropped before anything is created in the new one
  */
 void ModelAssimp::PerformGLInits() {
     MyLOGD("ModelAssimp::PerformGLInits");
 
+    sceneModels.clear();
+    modelPreloader.CancelAll();
+    modelCache.Clear();
     MyGLInits();
-    modelObject = new AssimpLoader();
+    GetJobSystem(); // start the workers now rather than inside the first Render
+    // the programs went with the old context; compile all of them while the first model loads,
+    // the current lighting tier's first so the other tiers' do not hold up the first frame
+    GetShaderVariants().Reset();
+    unsigned int variantMask = GetShaderVariantMask(lightingScaler.GetTier());
+    GetShaderVariants().Precompile(variantMask);
+    for (int tier = 0; tier < LIGHTING_TIER_COUNT; ++tier) {
+        variantMask |= GetShaderVariantMask((LightingTier) tier);
+    }
+    GetShaderVariants().Precompile(variantMask);
+    lastFrameTimeNs = 0;
+
 
     CheckGLError("ModelAssimp::PerformGLInits");
     initsDone = true;
 }
 
-vector<string> split(const string &s, const string &seperator) {
-    vector<string> result;
-    typedef string::size_type string_size;
-    string_size i = 0;
-
-    while (i != s.size()) {
-        //找到字符串中首个不等于分隔符的字母；
-        int flag = 0;
-        while (i != s.size() && flag == 0) {
-            flag = 1;
-            for (string_size x = 0; x < seperator.size(); ++x)
-                if (s[i] == seperator[x]) {
-                    ++i;
-                    flag = 0;
-                    break;
-                }
-        }
+/**
+ * Called by the UI thread as soon as a model is picked, before the load is queued for the GL
+ * thread, so that a load still running for an earlier pick stops instead of delaying this one
+ */
+unsigned int ModelAssimp::RequestModel() {
+
+    std::lock_guard<std::mutex> lock(modelRequestMutex);
+    cancelStats.requests++;
+    if (loadCancelToken) {
+        loadCancelToken->Cancel();
+    }
+    return ++lastModelRequest;
+}
+
+/**
+ * Replace the scene with a single model. The new model is added before the old ones are
+ * released, so switching to a model that is already in the scene never reloads it
+ */
+void ModelAssimp::ResetModel(std::string modelId,
+                             ImportProfile importProfile,
+                             unsigned int modelRequest) {
 
-        //找到又一个分隔符，将两个分隔符之间的字符串取出；
-        flag = 0;
-        string_size j = i;
-        while (j != s.size() && flag == 0) {
-            for (string_size x = 0; x < seperator.size(); ++x)
-                if (s[j] == seperator[x]) {
-                    flag = 1;
-                    break;
-                }
-            if (flag == 0)
-                ++j;
+    MyAllocScope allocScope("ModelAssimp::ResetModel");
+
+    if (!initsDone) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(modelRequestMutex);
+        if (modelRequest && modelRequest != lastModelRequest) {
+            MyLOGI("Request for %s superseded before its load", modelId.c_str());
+            cancelStats.dropped++;
+            return;
         }
-        if (i != j) {
-            result.push_back(s.substr(i, j - i));
-            i = j;
+        loadCancelToken.reset(new MyCancelToken);
+    }
+    std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+
+    std::vector<SceneModel> oldModels;
+    oldModels.swap(sceneModels);
+    int modelIndex = AddModel(modelId, importProfile);
+
+    std::lock_guard<std::mutex> lock(modelRequestMutex);
+    if (modelIndex < 0 && loadCancelToken->IsCancelled()) {
+        // the next request replaces the scene, keep showing the current one until then
+        sceneModels.swap(oldModels);
+        double cancelMs = loadCancelToken->GetMsSinceCancel();
+        cancelStats.cancelled++;
+        cancelStats.wastedMs += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - loadStart).count();
+        cancelStats.maxCancelMs = std::max(cancelStats.maxCancelMs, cancelMs);
+        MyLOGI("Load of %s cancelled %.2f ms after the next request", modelId.c_str(),
+               cancelMs);
+    } else {
+        myGLCamera->Reset(45, 10, 1.0f, 2000.0f);
+        for (unsigned int i = 0; i < oldModels.size(); ++i) {
+            modelCache.Release(oldModels[i].loader);
         }
     }
-    return result;
+    loadCancelToken.reset();
 }
 
-void ModelAssimp::ResetModel(JNIEnv *env,
-                             jobject instance,
-                             jstring objFileName,
-                             jstring mtlFileName,
-                             jstring texFileName) {
+ModelLoadCancelStats ModelAssimp::GetModelLoadCancelStats() const {
+    std::lock_guard<std::mutex> lock(modelRequestMutex);
+    return cancelStats;
+}
 
-    if (initsDone) {
-        modelObject->Delete3DModel();
-        myGLCamera->Reset(45, 10, 1.0f, 2000.0f);
+/**
+ * A model named by its OBJ gets the catalog's ID, so both names share the model cache. A model
+ * the cooked catalog does not have is only located, this runs on the GL thread; without its
+ * hashes it is not kept in the mesh cache
+ */
+bool ModelAssimp::FindModelRequest(const std::string &modelId, ImportProfile importProfile,
+                                   ModelRequest &model) {
+
+    CatalogModel catalogModel;
+    if (!assetCatalog.FindModel(modelId, catalogModel)) {
+        if (!assetCatalog.LocateModel(modelId, catalogModel)) {
+            return false;
+        }
+        MyLOGI("Model %s is not in the asset catalog, run CookAssetCatalog", modelId.c_str());
+    }
+    model.modelId = catalogModel.modelId;
+    model.objFileName = catalogModel.obj.assetName;
+    model.assetNames.clear();
+    for (unsigned int m = 0; m < catalogModel.mtls.size(); ++m) {
+        model.assetNames.push_back(catalogModel.mtls[m].assetName);
+    }
+    for (unsigned int t = 0; t < catalogModel.textures.size(); ++t) {
+        model.assetNames.push_back(catalogModel.textures[t].assetName);
+    }
+    model.importProfile = importProfile;
+    // a change to any of the files the import reads makes a new mesh cache entry
+    model.sourceHash = catalogModel.obj.hash;
+    for (unsigned int m = 0; m < catalogModel.mtls.size(); ++m) {
+        model.sourceHash = (model.sourceHash ^ catalogModel.mtls[m].hash) * 1099511628211ULL;
+    }
+    return true;
+}
 
+/**
+ * Extract the model's OBJ from assets and load the model with the MTL and textures the asset
+ * catalog lists for it, unless it was preloaded or the model cache still has it from an
+ * earlier load with the same settings
+ */
+int ModelAssimp::AddModel(std::string modelId, ImportProfile importProfile) {
+
+    if (!initsDone) {
+        return -1;
+    }
+    // the time of the frame around the load says nothing about the lighting tier
+    lightingScaler.SkipNextFrame();
+
+    ModelRequest model;
+    if (!FindModelRequest(modelId, importProfile, model)) {
+        return -1;
+    }
+    std::string cacheKey = GetModelCacheKey(model, keepPickingData);
+
+    // set by ResetModel, the token is only replaced on this thread
+    const MyCancelToken *cancelToken = loadCancelToken.get();
+    AssimpLoader *modelObject = modelPreloader.Take(cacheKey, cancelToken);
+    if (!modelObject && IsCancelled(cancelToken)) {
+        return -1;
+    }
+    if (!modelObject) {
+        modelObject = modelCache.Acquire(cacheKey);
+    }
+    if (modelObject) {
+        MyLOGD("Model %s is preloaded or cached", modelId.c_str());
+        importStepTimes.clear();
+    } else {
+
+        modelPreloader.CountMiss();
+        modelObject = new AssimpLoader();
+        modelObject->SetMeasureImportSteps(measureImportSteps);
+        modelObject->SetPostProcessThreads(postProcessThreads);
         std::string newObjFileNameStr;
-        const char *cObjFileName = env->GetStringUTFChars(objFileName, NULL);
-        std::string objFileNameStr = std::string(cObjFileName);
-        bool isFilesPresent = gHelperObject->ExtractAssetReturnFilename(objFileNameStr, newObjFileNameStr);
-        MyLOGE("objFileName %s", objFileNameStr.c_str());
+        bool isLoaded = ExtractModelAssets(model, modelObject, newObjFileNameStr, cancelToken) &&
+                        modelObject->PrepareModel(newObjFileNameStr, importProfile,
+                                                  cancelToken) &&
+                        modelObject->UploadModel(keepPickingData, cancelToken);
+        importStepTimes = modelObject->GetImportStepTimes();
+        if (!isLoaded) {
+            delete modelObject;
+            return -1;
+        }
+        ModelReadStats readStats = modelObject->GetReadStats();
+        MyLOGI("Read %zu bytes of OBJ and MTL, %zu of mesh cache and %zu of %u textures, "
+               "%u textures unused", readStats.modelBytes, readStats.meshCacheBytes,
+               readStats.textureBytes, readStats.texturesRead, readStats.texturesSkipped);
+        modelCache.Insert(cacheKey, modelObject);
+    }
 
-        if (!isFilesPresent) {
-            MyLOGE("Model %s does not exist!", newObjFileNameStr.c_str());
-            return;
+    SceneModel sceneModel;
+    sceneModel.loader = modelObject;
+    sceneModel.transform = glm::mat4(1.0f);
+    sceneModels.push_back(sceneModel);
+    return sceneModels.size() - 1;
+}
+
+/**
+ * Start loading the models most likely to be shown next, most likely first; each replaces the
+ * list of the previous call. Models the assets do not have are left out
+ */
+void ModelAssimp::PreloadModels(const std::vector<std::string> &modelIds,
+                                ImportProfile importProfile) {
+
+    if (!initsDone) {
+        return;
+    }
+    std::vector<ModelRequest> models;
+    for (unsigned int m = 0; m < modelIds.size(); ++m) {
+        ModelRequest model;
+        if (FindModelRequest(modelIds[m], importProfile, model)) {
+            models.push_back(model);
         }
+    }
+    modelPreloader.Preload(models, keepPickingData);
+}
 
-        std::string newMtlFileNameStr;
-        const char *cMtlFileName = env->GetStringUTFChars(mtlFileName, NULL);
-        std::string mtlFileNameStr = std::string(cMtlFileName);
-        gHelperObject->ExtractAssetReturnFilename(mtlFileNameStr, newMtlFileNameStr);
-        MyLOGE("mtlFileName %s", mtlFileNameStr.c_str());
+/**
+ * The model stays in the cache until it is evicted
+ */
+void ModelAssimp::RemoveModel(unsigned int modelIndex) {
 
-        const char *cTexFileName = env->GetStringUTFChars(texFileName, NULL);
-        std::string texFileNameStr = std::string(cTexFileName);
-        std::vector<string> texFileNameArray = split(texFileNameStr, "&");
+    if (modelIndex >= sceneModels.size()) {
+        return;
+    }
+    AssimpLoader *modelObject = sceneModels[modelIndex].loader;
+    sceneModels.erase(sceneModels.begin() + modelIndex);
+    modelCache.Release(modelObject);
+}
+
+void ModelAssimp::SetModelTransform(unsigned int modelIndex, const glm::mat4 &transform) {
+
+    if (modelIndex < sceneModels.size()) {
+        sceneModels[modelIndex].transform = transform;
+    }
+}
+
+/**
+ * Per-step import times of the last load, empty unless SetMeasureImportSteps was enabled
+ */
+const std::vector<ImportStepTime> & ModelAssimp::GetImportStepTimes() const {
+    return importStepTimes;
+}
+
+/**
+ * CPU and GPU bytes held by the models in the scene, each model counted once
+ */
+ModelMemoryStats ModelAssimp::GetModelMemoryStats() const {
 
-        for(vector<string>::size_type i = 0; i < texFileNameArray.size(); ++i) {
-            std::string newTexFileNameStr;
-            gHelperObject->ExtractAssetReturnFilename(texFileNameArray[i], newTexFileNameStr);
-            MyLOGE("texFileName %s", texFileNameArray[i].c_str());
+    ModelMemoryStats stats = {0, 0, 0};
+    for (unsigned int i = 0; i < sceneModels.size(); ++i) {
+        bool isCounted = false;
+        for (unsigned int j = 0; j < i && !isCounted; ++j) {
+            isCounted = sceneModels[j].loader == sceneModels[i].loader;
         }
+        if (!isCounted) {
+            ModelMemoryStats modelStats = sceneModels[i].loader->GetMemoryStats();
+            stats.cpuBytes += modelStats.cpuBytes;
+            stats.gpuBufferBytes += modelStats.gpuBufferBytes;
+            stats.gpuTextureBytes += modelStats.gpuTextureBytes;
+        }
+    }
+    return stats;
+}
 
-        modelObject->Load3DModel(newObjFileNameStr);
+/**
+ * Counted once for a model that is in the scene more than once, like GetModelMemoryStats
+ */
+ModelReadStats ModelAssimp::GetModelReadStats() const {
+
+    ModelReadStats stats = {0, 0, 0, 0, 0};
+    for (unsigned int i = 0; i < sceneModels.size(); ++i) {
+        bool isCounted = false;
+        for (unsigned int j = 0; j < i && !isCounted; ++j) {
+            isCounted = sceneModels[j].loader == sceneModels[i].loader;
+        }
+        if (!isCounted) {
+            ModelReadStats modelStats = sceneModels[i].loader->GetReadStats();
+            stats.modelBytes += modelStats.modelBytes;
+            stats.meshCacheBytes += modelStats.meshCacheBytes;
+            stats.textureBytes += modelStats.textureBytes;
+            stats.texturesRead += modelStats.texturesRead;
+            stats.texturesSkipped += modelStats.texturesSkipped;
+        }
     }
+    return stats;
 }
 
 
 /**
  * Render to the display
+ * Runs every frame and must not allocate
  */
 void ModelAssimp::Render() {
 
+    MyAllocScope allocScope("ModelAssimp::Render");
+
     // clear the screen
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::mat4 mvpMat = myGLCamera->GetMVP();
-    modelObject->Render3DModel(&mvpMat);
+    // uploads and other GL work queued by jobs on the worker threads
+    GetJobSystem().RunGLThreadJobs();
+    modelPreloader.Update();
+    GetShaderVariants().Update();
+    ApplyGestures();
+
+    // the interval between two Renders includes the swap, which waits for the GPU
+    int64_t frameTimeNs = GetMonotonicTimeNs();
+    LightingTier lightingTier = lastFrameTimeNs ?
+            lightingScaler.AddFrameTime((frameTimeNs - lastFrameTimeNs) / 1e6) :
+            lightingScaler.GetTier();
+    lastFrameTimeNs = frameTimeNs;
+
+    // the camera builds its matrices here, once, however many gestures this frame applied
+    myGLCamera->UpdateSnapshot();
+    const glm::mat4 &cameraMVP = myGLCamera->GetSnapshot().mvpMat;
+    for (unsigned int i = 0; i < sceneModels.size(); ++i) {
+        glm::mat4 mvpMat = cameraMVP * sceneModels[i].transform;
+        sceneModels[i].loader->Render3DModel(&mvpMat, lightingTier);
+    }
 
     CheckGLError("ModelAssimp::Render");
 
@@ -174,6 +398,131 @@ void ModelAssimp::SetViewport(int width, int height) {
 }
 
 
+/**
+ * Called on the UI thread by the gesture callbacks. The queue has a single producer, so every
+ * caller must push from that one thread; the host driver pushes from its only thread.
+ * Returns false if the queue is full and the gesture was dropped
+ */
+bool ModelAssimp::PushGesture(const GestureEvent &gestureEvent) {
+    return gestureQueue.Push(gestureEvent);
+}
+
+/**
+ * Drain the gesture queue and apply the gestures of the frame as at most one action per kind.
+ * Rotation, translation and zoom are separate parts of the camera state, so their order does
+ * not matter; a double-tap discards everything queued before it.
+ * Drags add up their distances and keep the last position, which rotates along the arc from the
+ * first touch to the last instead of through every intermediate point.
+ * Runs inside Render, must not allocate
+ */
+void ModelAssimp::ApplyGestures() {
+
+    int64_t frameStartNs = GetMonotonicTimeNs();
+    if (pendingGestureTimeNs) {
+        gestureLatencyMs[gestureLatencyCount % GESTURE_LATENCY_SAMPLES] =
+                (frameStartNs - pendingGestureTimeNs) / 1e6f;
+        gestureLatencyCount++;
+        pendingGestureTimeNs = 0;
+    }
+
+    bool isDoubleTap = false;
+    unsigned int numberOfEvents = 0, numberOfScrolls = 0, numberOfScales = 0, numberOfMoves = 0;
+    float scrollX = 0, scrollY = 0, scrollPositionX = 0, scrollPositionY = 0;
+    float scaleChange = 0, moveX = 0, moveY = 0;
+    int64_t oldestTimeNs = 0;
+
+    GestureEvent gestureEvent;
+    while (gestureQueue.Pop(gestureEvent)) {
+        numberOfEvents++;
+        if (!oldestTimeNs || gestureEvent.timestampNs < oldestTimeNs) {
+            oldestTimeNs = gestureEvent.timestampNs;
+        }
+        switch (gestureEvent.type) {
+            case GESTURE_DOUBLE_TAP:
+                isDoubleTap = true;
+                numberOfScrolls = numberOfScales = numberOfMoves = 0;
+                scrollX = scrollY = scaleChange = moveX = moveY = 0;
+                break;
+            case GESTURE_SCROLL:
+                numberOfScrolls++;
+                scrollX += gestureEvent.x;
+                scrollY += gestureEvent.y;
+                scrollPositionX = gestureEvent.positionX;
+                scrollPositionY = gestureEvent.positionY;
+                break;
+            case GESTURE_SCALE:
+                numberOfScales++;
+                scaleChange += gestureEvent.x - 1; // ScaleModel is linear in (scaleFactor - 1)
+                break;
+            case GESTURE_MOVE:
+                numberOfMoves++;
+                moveX += gestureEvent.x;
+                moveY += gestureEvent.y;
+                break;
+        }
+    }
+    if (numberOfEvents == 0) {
+        return;
+    }
+
+    if (isDoubleTap) {
+        DoubleTapAction();
+    }
+
+    // normalize movements on the screen wrt GL surface dimensions
+    // invert dY to be consistent with GLES conventions
+    if (numberOfScrolls) {
+        float dX = scrollX / screenWidth;
+        float dY = -scrollY / screenHeight;
+        float posX = 2 * scrollPositionX / screenWidth - 1.f;
+        float posY = -2 * scrollPositionY / screenHeight + 1.f;
+        posX = fmax(-1., fmin(1., posX));
+        posY = fmax(-1., fmin(1., posY));
+        ScrollAction(dX, dY, posX, posY);
+    }
+    if (numberOfScales) {
+        ScaleAction(1 + scaleChange);
+    }
+    if (numberOfMoves) {
+        MoveAction(moveX / screenWidth, -moveY / screenHeight);
+    }
+
+    unsigned int numberOfActions = (isDoubleTap ? 1 : 0) + (numberOfScrolls ? 1 : 0) +
+                                   (numberOfScales ? 1 : 0) + (numberOfMoves ? 1 : 0);
+    gestureEventsApplied += numberOfEvents;
+    gestureEventsCoalesced += numberOfEvents - numberOfActions;
+    pendingGestureTimeNs = oldestTimeNs;
+}
+
+/**
+ * Latency of the frames that applied gestures, from the oldest gesture in the frame to the
+ * start of the next frame
+ */
+GestureLatencyStats ModelAssimp::GetGestureLatencyStats() const {
+
+    GestureLatencyStats latencyStats;
+    latencyStats.eventsApplied = gestureEventsApplied;
+    latencyStats.eventsCoalesced = gestureEventsCoalesced;
+    latencyStats.eventsDropped = gestureQueue.GetDroppedEvents();
+    latencyStats.samples = std::min(gestureLatencyCount, (unsigned int) GESTURE_LATENCY_SAMPLES);
+    latencyStats.meanMs = latencyStats.p50Ms = latencyStats.p95Ms = latencyStats.maxMs = 0;
+    if (latencyStats.samples == 0) {
+        return latencyStats;
+    }
+
+    std::vector<float> sortedMs(gestureLatencyMs, gestureLatencyMs + latencyStats.samples);
+    std::sort(sortedMs.begin(), sortedMs.end());
+    double totalMs = 0;
+    for (unsigned int i = 0; i < sortedMs.size(); ++i) {
+        totalMs += sortedMs[i];
+    }
+    latencyStats.meanMs = totalMs / sortedMs.size();
+    latencyStats.p50Ms = sortedMs[sortedMs.size() / 2];
+    latencyStats.p95Ms = sortedMs[(sortedMs.size() * 95) / 100];
+    latencyStats.maxMs = sortedMs.back();
+    return latencyStats;
+}
+
 /**
  * reset model's position in double-tap
  */
@@ -21,36 +21,137 @@
 #include "myGLFunctions.h"
 #include "myGLCamera.h"
 #include "assimpLoader.h"
-#include "../../../../../../../../../android_tools/ndk/android-ndk-r11b/platforms/android-23/arch-arm/usr/include/jni.h"
+#include "myAssetCatalog.h"
+#include "myModelCache.h"
+#include "myModelPreloader.h"
+#include "myGestureQueue.h"
+#include "myCancelToken.h"
+#include "myLightingScaler.h"
+#include <mutex>
 #include <sstream>
 #include <iostream>
 #include <stdio.h>
 #include <string>
 
 
+#define GESTURE_LATENCY_SAMPLES 512     // most recent input-to-frame latencies kept
+
+// latency from a touch event to the end of the frame that shows its effect
+struct GestureLatencyStats {
+    unsigned long   eventsApplied;      // gestures popped by Render
+    unsigned long   eventsCoalesced;    // of those, gestures merged into another of the same frame
+    unsigned long   eventsDropped;      // queue was full
+    unsigned int    samples;            // frames with gestures in the last GESTURE_LATENCY_SAMPLES
+    double          meanMs, p50Ms, p95Ms, maxMs;
+};
+
+// loads given up because the user asked for another model before they finished
+struct ModelLoadCancelStats {
+    unsigned long   requests;           // RequestModel calls
+    unsigned long   dropped;            // superseded before their load started
+    unsigned long   cancelled;          // superseded while loading
+    double          wastedMs;           // time the cancelled loads ran
+    double          maxCancelMs;        // longest time from RequestModel to a load giving up
+};
+
+// a model drawn in the scene, with its placement relative to the camera's model matrix
+struct SceneModel {
+    AssimpLoader *  loader;             // owned by the model cache
+    glm::mat4       transform;
+};
+
 class ModelAssimp {
 public:
     ModelAssimp();
     ~ModelAssimp();
     void    PerformGLInits();
-    void    ResetModel(JNIEnv *env, jobject instance, jstring objFileName, jstring mtlFileName, jstring texFileName);
+    // any thread: a new model is wanted, cancels the load running for the previous request;
+    // returns the request number to pass to ResetModel
+    unsigned int RequestModel();
+    // replaces every model in the scene with this one and resets the camera; a modelRequest
+    // from RequestModel makes the load give up once a newer request comes, leaving the scene
+    // as it was. Models are named by their ID in the asset catalog or by their OBJ
+    void    ResetModel(std::string modelId, ImportProfile importProfile = DEFAULT_IMPORT_PROFILE,
+                       unsigned int modelRequest = 0);
+    // adds a model to the scene, from the cache if it was loaded before; -1 if it cannot load
+    int     AddModel(std::string modelId, ImportProfile importProfile = DEFAULT_IMPORT_PROFILE);
+    // loads the models in the background, most likely next first, see MyModelPreloader
+    void    PreloadModels(const std::vector<std::string> &modelIds, ImportProfile importProfile);
+    const MyAssetCatalog & GetAssetCatalog() const { return assetCatalog; }
+    PreloadStats GetPreloadStats() const { return modelPreloader.GetStats(); }
+    ModelLoadCancelStats GetModelLoadCancelStats() const;
+    void    RemoveModel(unsigned int modelIndex);     // later models move down by one
+    void    SetModelTransform(unsigned int modelIndex, const glm::mat4 &transform);
+    unsigned int GetNumberOfModels() const { return sceneModels.size(); }
     void    Render();
     void    SetViewport(int width, int height);
+    // UI thread only, the queue has a single producer: queue a gesture for the next Render
+    bool    PushGesture(const GestureEvent &gestureEvent);
+    GestureLatencyStats GetGestureLatencyStats() const;
+    int     GetScreenWidth() const { return screenWidth; }
+    int     GetScreenHeight() const { return screenHeight; }
+    void    SetKeepPickingData(bool keepPickingData) { this->keepPickingData = keepPickingData; }
+    ModelMemoryStats GetModelMemoryStats() const;     // models in the scene
+    ModelReadStats GetModelReadStats() const;         // what their loads read
+    ModelCacheStats GetModelCacheStats() const { return modelCache.GetStats(); }
+    void    SetModelCacheBudgetBytes(size_t budgetBytes) {
+        modelCache.SetBudgetBytes(budgetBytes);
+    }
+    void    SetMeasureImportSteps(bool measureImportSteps) {
+        this->measureImportSteps = measureImportSteps;
+    }
+    const std::vector<ImportStepTime> & GetImportStepTimes() const;
+    void    SetPostProcessThreads(unsigned int postProcessThreads) {
+        this->postProcessThreads = postProcessThreads;
+    }
+    // scaled by frame time unless a tier is set, see MyLightingScaler
+    void    SetLightingAutomatic() { lightingScaler.SetAutomatic(true); }
+    void    SetLightingTier(LightingTier lightingTier) {
+        lightingScaler.SetAutomatic(false);
+        lightingScaler.SetTier(lightingTier);
+    }
+    LightingScalerStats GetLightingStats() const { return lightingScaler.GetStats(); }
+
+private:
+    // the catalog's model and its assets, false if the assets do not have it
+    bool    FindModelRequest(const std::string &modelId, ImportProfile importProfile,
+                             ModelRequest &model);
+    void    ApplyGestures();
     void    DoubleTapAction();
     void    ScrollAction(float distanceX, float distanceY, float positionX, float positionY);
     void    ScaleAction(float scaleFactor);
     void    MoveAction(float distanceX, float distanceY);
-    int     GetScreenWidth() const { return screenWidth; }
-    int     GetScreenHeight() const { return screenHeight; }
 
-private:
     bool    initsDone;
+    bool    keepPickingData;    // keep triangles on the CPU for AssimpLoader::PickRay
+    bool    measureImportSteps; // time every post-process step of the next loads
+    unsigned int postProcessThreads;    // 0 leaves normals/weld/cache to Assimp
     int     screenWidth, screenHeight;
 
     std::vector<float> modelDefaultPosition;
     MyGLCamera * myGLCamera;
-    AssimpLoader * modelObject;
-//    AssimpLoader * modelObject2;
+    std::vector<SceneModel> sceneModels;
+    MyAssetCatalog  assetCatalog;       // loaded once, see FindModelRequest
+    MyModelCache    modelCache;
+    MyModelPreloader modelPreloader;    // declared after the cache, which it inserts into
+    std::vector<ImportStepTime> importStepTimes;    // of the last load
+
+    // guards the request number and the token of the load running for it
+    mutable std::mutex  modelRequestMutex;
+    unsigned int        lastModelRequest;
+    MyCancelTokenHandle loadCancelToken;    // NULL when no ResetModel is running
+    ModelLoadCancelStats cancelStats;
+
+    // gestures from the UI thread; latency of a frame is closed when the next Render starts,
+    // since GLSurfaceView swaps buffers between the two
+    MyGestureQueue  gestureQueue;
+    int64_t         pendingGestureTimeNs;   // oldest gesture of the last frame, 0 if none
+    float           gestureLatencyMs[GESTURE_LATENCY_SAMPLES];
+    unsigned int    gestureLatencyCount;
+    unsigned long   gestureEventsApplied, gestureEventsCoalesced;
+
+    MyLightingScaler lightingScaler;
+    int64_t         lastFrameTimeNs;        // start of the previous Render, 0 if none
 };
 
 #endif //MODELASSIMP_H